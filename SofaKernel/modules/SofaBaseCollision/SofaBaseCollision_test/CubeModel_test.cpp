@@ -0,0 +1,164 @@
+/******************************************************************************
+*                 SOFA, Simulation Open-Framework Architecture                *
+*                    (c) 2006 INRIA, USTL, UJF, CNRS, MGH                     *
+*                                                                             *
+* This program is free software; you can redistribute it and/or modify it     *
+* under the terms of the GNU Lesser General Public License as published by    *
+* the Free Software Foundation; either version 2.1 of the License, or (at     *
+* your option) any later version.                                             *
+*                                                                             *
+* This program is distributed in the hope that it will be useful, but WITHOUT *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License *
+* for more details.                                                           *
+*                                                                             *
+* You should have received a copy of the GNU Lesser General Public License    *
+* along with this program. If not, see <http://www.gnu.org/licenses/>.        *
+*******************************************************************************
+* Authors: The SOFA Team and external contributors (see Authors.txt)          *
+*                                                                             *
+* Contact information: contact@sofa-framework.org                             *
+******************************************************************************/
+#include <sofa/testing/BaseSimulationTest.h>
+using sofa::testing::BaseSimulationTest;
+
+#include <SofaBaseCollision/CubeModel.h>
+using sofa::component::collision::CubeCollisionModel;
+using sofa::component::collision::Cube;
+
+#include <SofaBaseCollision/SphereModel.h>
+using sofa::component::collision::SphereCollisionModel;
+
+#include <sofa/core/behavior/MechanicalState.h>
+
+#include <sstream>
+
+namespace sofa
+{
+
+/// The refitted bounding tree must contain the moved elements, and be rebuilt once its quality degrades past the threshold.
+class CubeModel_test : public BaseSimulationTest
+{
+public:
+    typedef defaulttype::Vec3Types DataTypes;
+    typedef defaulttype::Vector3 Vector3;
+
+    void onSetUp() override
+    {
+        importPlugin("SofaBaseMechanics");
+        importPlugin("SofaBaseCollision");
+    }
+
+    /// every cell of the tree contains its subcells
+    static void checkTree(CubeCollisionModel* leaves)
+    {
+        for (core::CollisionModel* level = leaves->getPrevious(); level != nullptr; level = level->getPrevious())
+        {
+            CubeCollisionModel* cubes = dynamic_cast<CubeCollisionModel*>(level);
+            ASSERT_NE(cubes, nullptr);
+            for (Index i = 0; i < cubes->getSize(); ++i)
+            {
+                const Cube cell(cubes, i);
+                const std::pair<Cube,Cube>& subcells = cell.subcells();
+                for (Cube c = subcells.first; c != subcells.second; ++c)
+                {
+                    for (int d = 0; d < 3; ++d)
+                    {
+                        EXPECT_LE(cell.minVect()[d], c.minVect()[d]);
+                        EXPECT_GE(cell.maxVect()[d], c.maxVect()[d]);
+                    }
+                }
+            }
+        }
+    }
+
+    /// summed area of the cells below the root
+    static SReal treeArea(CubeCollisionModel* leaves)
+    {
+        SReal area = 0;
+        for (core::CollisionModel* level = leaves->getPrevious(); level != nullptr && level->getPrevious() != nullptr; level = level->getPrevious())
+        {
+            CubeCollisionModel* cubes = static_cast<CubeCollisionModel*>(level);
+            for (Index i = 0; i < cubes->getSize(); ++i)
+            {
+                const Vector3 l = Cube(cubes, i).maxVect() - Cube(cubes, i).minVect();
+                area += 2 * (l[0]*l[1] + l[1]*l[2] + l[2]*l[0]);
+            }
+        }
+        return area;
+    }
+
+    void checkRefit(bool parallel)
+    {
+        const int n = 20;
+        std::ostringstream scene;
+        scene << "<Node name='root'>\n"
+                 "  <MechanicalObject name='dofs' position='";
+        for (int i = 0; i < n; ++i)
+            for (int j = 0; j < n; ++j)
+                scene << i << " " << j << " 0 ";
+        scene << "'/>\n"
+                 "  <SphereCollisionModel name='spheres' radius='0.4'/>\n"
+                 "</Node>\n";
+        SceneInstance instance("xml", scene.str());
+        instance.initScene();
+
+        SphereCollisionModel<DataTypes>* spheres = nullptr;
+        instance.root->get(spheres);
+        ASSERT_NE(spheres, nullptr);
+        core::behavior::MechanicalState<DataTypes>* dofs = nullptr;
+        instance.root->get(dofs);
+        ASSERT_NE(dofs, nullptr);
+
+        spheres->computeBoundingTree(4);
+        CubeCollisionModel* leaves = dynamic_cast<CubeCollisionModel*>(spheres->getPrevious());
+        ASSERT_NE(leaves, nullptr);
+        leaves->d_parallel.setValue(parallel);
+        checkTree(leaves);
+        const SReal builtArea = treeArea(leaves);
+
+        // mirror half of the rows: the cells of the refitted tree now overlap
+        auto shuffle = [&](bool mirror)
+        {
+            auto x = sofa::helper::getWriteAccessor(*dofs->write(core::VecCoordId::position()));
+            for (int i = 0; i < n; ++i)
+                for (int j = 0; j < n; ++j)
+                    x[i*n+j] = Vector3(i, (mirror && i%2) ? n-1-j : j, 0);
+        };
+        shuffle(true);
+        spheres->computeBoundingTree(4);
+        checkTree(leaves);
+        const SReal refittedArea = treeArea(leaves);
+        EXPECT_GT(refittedArea, 1.2 * builtArea);
+
+        // the tree is kept while its quality is within the threshold...
+        leaves->d_rebuildThreshold.setValue(10);
+        spheres->computeBoundingTree(4);
+        EXPECT_NEAR(treeArea(leaves), refittedArea, 1e-9 * refittedArea);
+
+        // ...and rebuilt otherwise
+        leaves->d_rebuildThreshold.setValue(1.2);
+        spheres->computeBoundingTree(4);
+        checkTree(leaves);
+        EXPECT_NEAR(treeArea(leaves), builtArea, 1e-9 * builtArea);
+
+        // the elements are found back in the rebuilt tree
+        shuffle(false);
+        leaves->d_rebuildThreshold.setValue(0);
+        spheres->computeBoundingTree(4);
+        checkTree(leaves);
+        EXPECT_GT(treeArea(leaves), 1.2 * builtArea);
+    }
+};
+
+TEST_F(CubeModel_test, refit)
+{
+    checkRefit(false);
+}
+
+TEST_F(CubeModel_test, parallelRefit)
+{
+    checkRefit(true);
+}
+
+} // namespace sofa
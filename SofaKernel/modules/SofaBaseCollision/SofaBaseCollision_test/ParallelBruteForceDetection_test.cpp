@@ -0,0 +1,245 @@
+/******************************************************************************
+*                 SOFA, Simulation Open-Framework Architecture                *
+*                    (c) 2006 INRIA, USTL, UJF, CNRS, MGH                     *
+*                                                                             *
+* This program is free software; you can redistribute it and/or modify it     *
+* under the terms of the GNU Lesser General Public License as published by    *
+* the Free Software Foundation; either version 2.1 of the License, or (at     *
+* your option) any later version.                                             *
+*                                                                             *
+* This program is distributed in the hope that it will be useful, but WITHOUT *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License *
+* for more details.                                                           *
+*                                                                             *
+* You should have received a copy of the GNU Lesser General Public License    *
+* along with this program. If not, see <http://www.gnu.org/licenses/>.        *
+*******************************************************************************
+* Authors: The SOFA Team and external contributors (see Authors.txt)          *
+*                                                                             *
+* Contact information: contact@sofa-framework.org                             *
+******************************************************************************/
+#include <SofaTest/Sofa_test.h>
+using sofa::Sofa_test;
+
+#include <SofaBaseCollision/BruteForceDetection.h>
+using sofa::component::collision::BruteForceDetection;
+
+#include <SofaBaseCollision/ParallelBruteForceDetection.h>
+using sofa::component::collision::ParallelBruteForceDetection;
+
+#include <SofaBaseCollision/NewProximityIntersection.h>
+using sofa::component::collision::NewProximityIntersection;
+
+#include <SofaBaseCollision/SphereModel.h>
+using sofa::component::collision::SphereCollisionModel;
+
+#include <SofaMeshCollision/TriangleModel.h>
+using sofa::component::collision::TriangleCollisionModel;
+
+#include <SofaBaseMechanics/MechanicalObject.h>
+#include <SofaBaseTopology/MeshTopology.h>
+#include <SofaSimulationGraph/DAGNode.h>
+#include <sofa/simulation/TaskScheduler.h>
+
+using sofa::core::objectmodel::New;
+
+namespace sofa
+{
+
+struct ParallelBruteForceDetection_test : public Sofa_test<>
+{
+    typedef defaulttype::Vec3Types DataTypes;
+    typedef component::container::MechanicalObject<DataTypes> MechanicalObject3;
+    typedef helper::vector<core::collision::DetectionOutput> Contacts;
+    typedef std::map<std::pair<core::CollisionModel*, core::CollisionModel*>, Contacts> ContactsMap;
+    typedef helper::vector< std::pair<core::CollisionModel*, core::CollisionModel*> > Pairs;
+
+    simulation::Node::SPtr root;
+    NewProximityIntersection::SPtr intersection;
+    BruteForceDetection::SPtr sequential;
+    ParallelBruteForceDetection::SPtr parallel;
+
+    void onSetUp() override
+    {
+        simulation::TaskScheduler::getInstance()->init(4);
+
+        root = New<simulation::graph::DAGNode>();
+        intersection = New<NewProximityIntersection>();
+        intersection->setAlarmDistance(0.3);
+        intersection->setContactDistance(0.1);
+        root->addObject(intersection);
+        intersection->init();
+        sequential = New<BruteForceDetection>();
+        root->addObject(sequential);
+        parallel = New<ParallelBruteForceDetection>();
+        parallel->d_nbSubtreeTasks.setValue(16);
+        root->addObject(parallel);
+    }
+
+    MechanicalObject3::SPtr makeDOFs(simulation::Node::SPtr node, const MechanicalObject3::VecCoord& points)
+    {
+        MechanicalObject3::SPtr dofs = New<MechanicalObject3>();
+        dofs->resize(points.size());
+        dofs->x.setValue(points);
+        node->addObject(dofs);
+        return dofs;
+    }
+
+    /// grid of n x n spheres
+    SphereCollisionModel<DataTypes>::SPtr makeSpheres(int n, const defaulttype::Vector3& origin)
+    {
+        simulation::Node::SPtr node = root->createChild("spheres");
+        MechanicalObject3::VecCoord points;
+        for (int i = 0; i < n; ++i)
+            for (int j = 0; j < n; ++j)
+                points.push_back(origin + defaulttype::Vector3(i, j, 0));
+        makeDOFs(node, points);
+
+        SphereCollisionModel<DataTypes>::SPtr spheres = New<SphereCollisionModel<DataTypes> >();
+        spheres->defaultRadius.setValue(0.4);
+        node->addObject(spheres);
+        spheres->init();
+        spheres->computeBoundingTree(6);
+        return spheres;
+    }
+
+    /// two parallel triangulated n x n sheets in the same model, closer than the alarm distance
+    TriangleCollisionModel<DataTypes>::SPtr makeSheets(int n)
+    {
+        simulation::Node::SPtr node = root->createChild("sheets");
+        MechanicalObject3::VecCoord points;
+        component::topology::MeshTopology::SPtr topology = New<component::topology::MeshTopology>();
+        for (int s = 0; s < 2; ++s)
+        {
+            const Index first = points.size();
+            for (int i = 0; i < n; ++i)
+                for (int j = 0; j < n; ++j)
+                    points.push_back(defaulttype::Vector3(i + 0.3 * s, j + 0.1 * s, 0.2 * s));
+            for (int i = 0; i + 1 < n; ++i)
+            {
+                for (int j = 0; j + 1 < n; ++j)
+                {
+                    const Index p = first + i * n + j;
+                    topology->addTriangle(p, p + n, p + n + 1);
+                    topology->addTriangle(p, p + n + 1, p + 1);
+                }
+            }
+        }
+        makeDOFs(node, points);
+        node->addObject(topology);
+        topology->init();
+
+        TriangleCollisionModel<DataTypes>::SPtr triangles = New<TriangleCollisionModel<DataTypes> >();
+        triangles->setSelfCollision(true);
+        node->addObject(triangles);
+        triangles->init();
+        triangles->computeBoundingTree(6);
+        return triangles;
+    }
+
+    ContactsMap detect(core::collision::NarrowPhaseDetection* detection, const Pairs& pairs)
+    {
+        detection->setIntersectionMethod(intersection.get());
+        detection->beginNarrowPhase();
+        detection->addCollisionPairs(pairs);
+        detection->endNarrowPhase();
+
+        ContactsMap contacts;
+        for (const auto& outputs : detection->getDetectionOutputs())
+        {
+            const Contacts* c = dynamic_cast<const Contacts*>(outputs.second);
+            EXPECT_NE(c, nullptr);
+            if (c) contacts[outputs.first] = *c;
+        }
+        return contacts;
+    }
+
+    /// the sub-tree tasks do not visit the elements in the traversal order: the contacts are compared sorted
+    static Contacts sorted(Contacts contacts)
+    {
+        std::sort(contacts.begin(), contacts.end(), [](const core::collision::DetectionOutput& a, const core::collision::DetectionOutput& b)
+        {
+            if (a.elem.first.getIndex() != b.elem.first.getIndex()) return a.elem.first.getIndex() < b.elem.first.getIndex();
+            if (a.elem.second.getIndex() != b.elem.second.getIndex()) return a.elem.second.getIndex() < b.elem.second.getIndex();
+            return a.id < b.id;
+        });
+        return contacts;
+    }
+
+    /// same contacts as the sequential narrow phase, in an order which does not depend on the scheduling
+    void checkContacts(const Pairs& pairs, unsigned int splitSize, std::size_t minContacts)
+    {
+        const ContactsMap reference = detect(sequential.get(), pairs);
+        std::size_t nbContacts = 0;
+        for (const auto& c : reference)
+            nbContacts += c.second.size();
+        EXPECT_GT(nbContacts, minContacts);
+
+        parallel->d_splitSize.setValue(splitSize);
+        const ContactsMap contacts = detect(parallel.get(), pairs);
+        ASSERT_EQ(contacts.size(), reference.size());
+        for (const auto& c : reference)
+        {
+            const auto it = contacts.find(c.first);
+            ASSERT_NE(it, contacts.end());
+            ASSERT_EQ(it->second.size(), c.second.size()) << "splitSize " << splitSize;
+
+            const Contacts sortedRef = sorted(c.second);
+            const Contacts sortedPar = sorted(it->second);
+            for (std::size_t i = 0; i < sortedRef.size(); ++i)
+            {
+                EXPECT_EQ(sortedPar[i].elem.first.getIndex(), sortedRef[i].elem.first.getIndex());
+                EXPECT_EQ(sortedPar[i].elem.second.getIndex(), sortedRef[i].elem.second.getIndex());
+                EXPECT_EQ(sortedPar[i].id, sortedRef[i].id);
+                EXPECT_NEAR(sortedPar[i].value, sortedRef[i].value, 1e-12);
+                EXPECT_LT((sortedPar[i].normal - sortedRef[i].normal).norm(), 1e-12);
+            }
+        }
+
+        const ContactsMap again = detect(parallel.get(), pairs);
+        for (const auto& c : contacts)
+        {
+            const Contacts& second = again.at(c.first);
+            ASSERT_EQ(second.size(), c.second.size());
+            for (std::size_t i = 0; i < second.size(); ++i)
+            {
+                EXPECT_EQ(second[i].elem.first.getIndex(), c.second[i].elem.first.getIndex());
+                EXPECT_EQ(second[i].elem.second.getIndex(), c.second[i].elem.second.getIndex());
+            }
+        }
+    }
+};
+
+TEST_F(ParallelBruteForceDetection_test, spheres)
+{
+    // three grids partially overlapping each other
+    Pairs pairs;
+    std::vector<core::CollisionModel*> models;
+    for (int g = 0; g < 3; ++g)
+    {
+        models.push_back(makeSpheres(20, defaulttype::Vector3(6.0 * g, 0.1 * g, 0.2 * g))->getFirst());
+        for (int h = 0; h < g; ++h)
+            pairs.emplace_back(models[h], models[g]);
+    }
+
+    checkContacts(pairs, 0, 100);
+    checkContacts(pairs, 50, 100);
+}
+
+TEST_F(ParallelBruteForceDetection_test, triangleSelfCollision)
+{
+    // the tasks test the same triangles concurrently: the intersection must not orient their normals in the model
+    TriangleCollisionModel<DataTypes>::SPtr sheets = makeSheets(12);
+    const TriangleCollisionModel<DataTypes>::VecDeriv normals = sheets->getNormals();
+    const Pairs pairs { std::make_pair(sheets->getFirst(), sheets->getFirst()) };
+
+    checkContacts(pairs, 20, 100);
+    ASSERT_EQ(sheets->getNormals().size(), normals.size());
+    for (std::size_t i = 0; i < normals.size(); ++i)
+    {
+        EXPECT_EQ(sheets->getNormals()[i], normals[i]);
+    }
+}
+
+} // namespace sofa
@@ -0,0 +1,186 @@
+/******************************************************************************
+*                 SOFA, Simulation Open-Framework Architecture                *
+*                    (c) 2006 INRIA, USTL, UJF, CNRS, MGH                     *
+*                                                                             *
+* This program is free software; you can redistribute it and/or modify it     *
+* under the terms of the GNU Lesser General Public License as published by    *
+* the Free Software Foundation; either version 2.1 of the License, or (at     *
+* your option) any later version.                                             *
+*                                                                             *
+* This program is distributed in the hope that it will be useful, but WITHOUT *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License *
+* for more details.                                                           *
+*                                                                             *
+* You should have received a copy of the GNU Lesser General Public License    *
+* along with this program. If not, see <http://www.gnu.org/licenses/>.        *
+*******************************************************************************
+* Authors: The SOFA Team and external contributors (see Authors.txt)          *
+*                                                                             *
+* Contact information: contact@sofa-framework.org                             *
+******************************************************************************/
+#include <SofaTest/Sofa_test.h>
+using sofa::Sofa_test;
+
+#include <SofaBaseCollision/BruteForceDetection.h>
+using sofa::component::collision::BruteForceDetection;
+
+#include <SofaBaseCollision/SpatialHashDetection.h>
+using sofa::component::collision::SpatialHashDetection;
+
+#include <SofaBaseCollision/NewProximityIntersection.h>
+using sofa::component::collision::NewProximityIntersection;
+
+#include <SofaBaseCollision/SphereModel.h>
+using sofa::component::collision::SphereCollisionModel;
+
+#include <SofaBaseMechanics/MechanicalObject.h>
+#include <SofaSimulationGraph/DAGNode.h>
+
+#include <random>
+#include <set>
+#include <tuple>
+
+using sofa::core::objectmodel::New;
+
+namespace sofa
+{
+
+struct SpatialHashDetection_test : public Sofa_test<>
+{
+    typedef defaulttype::Vec3Types DataTypes;
+    typedef component::container::MechanicalObject<DataTypes> MechanicalObject3;
+    typedef std::tuple<core::CollisionModel*, Index, core::CollisionModel*, Index> Contact;
+
+    simulation::Node::SPtr root;
+    NewProximityIntersection::SPtr intersection;
+    BruteForceDetection::SPtr bruteForce;
+    SpatialHashDetection::SPtr spatialHash;
+
+    void onSetUp() override
+    {
+        root = New<simulation::graph::DAGNode>();
+        intersection = New<NewProximityIntersection>();
+        intersection->setAlarmDistance(0.2);
+        intersection->setContactDistance(0.05);
+        root->addObject(intersection);
+        intersection->init();
+        bruteForce = New<BruteForceDetection>();
+        root->addObject(bruteForce);
+        spatialHash = New<SpatialHashDetection>();
+        root->addObject(spatialHash);
+    }
+
+    SphereCollisionModel<DataTypes>::SPtr makeSpheres(const MechanicalObject3::VecCoord& points, SReal radius, bool selfCollision = false)
+    {
+        simulation::Node::SPtr node = root->createChild("spheres");
+        MechanicalObject3::SPtr dofs = New<MechanicalObject3>();
+        dofs->resize(points.size());
+        dofs->x.setValue(points);
+        node->addObject(dofs);
+
+        SphereCollisionModel<DataTypes>::SPtr spheres = New<SphereCollisionModel<DataTypes> >();
+        spheres->defaultRadius.setValue(radius);
+        spheres->setSelfCollision(selfCollision);
+        node->addObject(spheres);
+        spheres->init();
+        return spheres;
+    }
+
+    /// contacts between the elements, independently of the order of the models
+    std::set<Contact> detect(core::collision::BroadPhaseDetection* broadPhase, core::collision::NarrowPhaseDetection* narrowPhase,
+                             const helper::vector<core::CollisionModel*>& models)
+    {
+        broadPhase->setIntersectionMethod(intersection.get());
+        narrowPhase->setIntersectionMethod(intersection.get());
+        broadPhase->beginBroadPhase();
+        broadPhase->addCollisionModels(models);
+        broadPhase->endBroadPhase();
+        narrowPhase->beginNarrowPhase();
+        narrowPhase->addCollisionPairs(broadPhase->getCollisionModelPairs());
+        narrowPhase->endNarrowPhase();
+
+        std::set<Contact> contacts;
+        for (const auto& outputs : narrowPhase->getDetectionOutputs())
+        {
+            const auto* c = dynamic_cast<const helper::vector<core::collision::DetectionOutput>*>(outputs.second);
+            EXPECT_NE(c, nullptr);
+            if (c == nullptr) continue;
+            for (const core::collision::DetectionOutput& o : *c)
+            {
+                Contact contact(o.elem.first.getCollisionModel(), o.elem.first.getIndex(), o.elem.second.getCollisionModel(), o.elem.second.getIndex());
+                if (std::make_pair(std::get<2>(contact), std::get<3>(contact)) < std::make_pair(std::get<0>(contact), std::get<1>(contact)))
+                    contact = Contact(std::get<2>(contact), std::get<3>(contact), std::get<0>(contact), std::get<1>(contact));
+                EXPECT_TRUE(contacts.insert(contact).second) << "contact found twice";
+            }
+        }
+        return contacts;
+    }
+};
+
+TEST_F(SpatialHashDetection_test, sameContactsAsBruteForce)
+{
+    // many models of a few spheres, a self-colliding model and a big sphere
+    std::mt19937 generator(42);
+    std::uniform_real_distribution<SReal> position(0, 10);
+    const auto randomPoints = [&](int n)
+    {
+        MechanicalObject3::VecCoord points;
+        for (int i = 0; i < n; ++i)
+            points.push_back(defaulttype::Vector3(position(generator), position(generator), position(generator)));
+        return points;
+    };
+
+    helper::vector<core::CollisionModel*> models;
+    for (int m = 0; m < 300; ++m)
+        models.push_back(makeSpheres(randomPoints(1 + m % 3), 0.3).get());
+    models.push_back(makeSpheres(randomPoints(50), 0.3, true).get());
+    models.push_back(makeSpheres({ defaulttype::Vector3(5, 5, 5) }, 3).get());
+    for (core::CollisionModel*& cm : models)
+    {
+        cm->computeBoundingTree(6);
+        cm = cm->getFirst();
+    }
+
+    const std::set<Contact> reference = detect(bruteForce.get(), bruteForce.get(), models);
+    EXPECT_GT(reference.size(), 100u);
+
+    // estimated cell size, a fine grid in which the big sphere is a large element, and a coarse grid
+    for (SReal cellSize : { 0.0, 0.2, 4.0 })
+    {
+        spatialHash->d_cellSize.setValue(cellSize);
+        const std::set<Contact> contacts = detect(spatialHash.get(), spatialHash.get(), models);
+        EXPECT_EQ(contacts.size(), reference.size()) << "cellSize " << cellSize;
+        EXPECT_TRUE(contacts == reference) << "cellSize " << cellSize;
+        EXPECT_GT(spatialHash->d_currentCellSize.getValue(), 0);
+        if (cellSize > 0)
+            EXPECT_EQ(spatialHash->d_currentCellSize.getValue(), cellSize);
+    }
+}
+
+TEST_F(SpatialHashDetection_test, modelWithoutBoundingBoxes)
+{
+    // the bounding tree of the second model is not computed: it is ignored, with a single warning
+    SphereCollisionModel<DataTypes>::SPtr first = makeSpheres({ defaulttype::Vector3(0, 0, 0) }, 0.3);
+    first->computeBoundingTree(6);
+    SphereCollisionModel<DataTypes>::SPtr second = makeSpheres({ defaulttype::Vector3(0.2, 0, 0) }, 0.3);
+    const helper::vector<core::CollisionModel*> models { first.get(), second.get() };
+
+    {
+        EXPECT_MSG_EMIT(Warning);
+        EXPECT_TRUE(detect(spatialHash.get(), spatialHash.get(), models).empty());
+    }
+    {
+        EXPECT_MSG_NOEMIT(Warning);
+        EXPECT_TRUE(detect(spatialHash.get(), spatialHash.get(), models).empty());
+    }
+
+    // the models may have changed since the last init: they are reported again
+    spatialHash->reinit();
+    {
+        EXPECT_MSG_EMIT(Warning);
+        EXPECT_TRUE(detect(spatialHash.get(), spatialHash.get(), models).empty());
+    }
+}
+
+} // namespace sofa
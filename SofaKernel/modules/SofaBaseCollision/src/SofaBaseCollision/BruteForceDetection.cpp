@@ -138,39 +138,52 @@ bool BruteForceDetection::keepCollisionBetween(core::CollisionModel *cm1, core::
 }
 
 void BruteForceDetection::addCollisionPair(const std::pair<core::CollisionModel*, core::CollisionModel*>& cmPair)
-{    
-    typedef std::pair< std::pair<core::CollisionElementIterator,core::CollisionElementIterator>, std::pair<core::CollisionElementIterator,core::CollisionElementIterator> > TestPair;
+{
+    const std::string msg = "BruteForceDetection addCollisionPair: " + cmPair.first->getLast()->getName() + " - " + cmPair.second->getLast()->getName();
+    sofa::helper::ScopedAdvancedTimer bfTimer(msg);
+
+    PairTraversal traversal;
+    if (!initTraversal(cmPair, traversal))
+        return;
 
+    sofa::core::collision::DetectionOutputVector*& outputs = this->getDetectionOutputs(traversal.outputModel1, traversal.outputModel2);
+
+    traversal.outputIntersector->beginIntersect(traversal.outputModel1, traversal.outputModel2, outputs);//creates outputs if null
+
+    std::queue< TestPair > externalCells;
+    for (const TestPair& root : traversal.roots)
+        externalCells.push(root);
+    traverse(traversal, externalCells, outputs);
+}
+
+bool BruteForceDetection::initTraversal(const std::pair<core::CollisionModel*, core::CollisionModel*>& cmPair, PairTraversal& traversal)
+{
     core::CollisionModel *cm1 = cmPair.first; //->getNext();
     core::CollisionModel *cm2 = cmPair.second; //->getNext();
 
     if (!cm1->isSimulated() && !cm2->isSimulated())
-        return;
+        return false;
 
     if (cm1->empty() || cm2->empty())
-        return;
+        return false;
 
     core::CollisionModel *finalcm1 = cm1->getLast();//get the finnest CollisionModel which is not a CubeModel
     core::CollisionModel *finalcm2 = cm2->getLast();
 
-    const std::string msg = "BruteForceDetection addCollisionPair: " + finalcm1->getName() + " - " + finalcm2->getName();
-    sofa::helper::ScopedAdvancedTimer bfTimer(msg);
-    
     bool swapModels = false;
     core::collision::ElementIntersector* finalintersector = intersectionMethod->findIntersector(finalcm1, finalcm2, swapModels);//find the method for the finnest CollisionModels
     if (finalintersector == nullptr)
-        return;
+        return false;
     if (swapModels)
     {
 		std::swap(cm1, cm2);
 		std::swap(finalcm1, finalcm2);
     }
 
-    const bool self = (finalcm1->getContext() == finalcm2->getContext());
-
-    sofa::core::collision::DetectionOutputVector*& outputs = this->getDetectionOutputs(finalcm1, finalcm2);
-
-    finalintersector->beginIntersect(finalcm1, finalcm2, outputs);//creates outputs if null
+    traversal.self = (finalcm1->getContext() == finalcm2->getContext());
+    traversal.outputModel1 = finalcm1;
+    traversal.outputModel2 = finalcm2;
+    traversal.outputIntersector = finalintersector;
 
     if (finalcm1 == cm1 || finalcm2 == cm2)
     {
@@ -179,34 +192,49 @@ void BruteForceDetection::addCollisionPair(const std::pair<core::CollisionModel*
         finalcm2 = nullptr;
         finalintersector = nullptr;
     }
-
-    std::queue< TestPair > externalCells;
+    traversal.finalcm1 = finalcm1;
+    traversal.finalcm2 = finalcm2;
+    traversal.finalintersector = finalintersector;
 
     std::pair<core::CollisionElementIterator,core::CollisionElementIterator> internalChildren1 = cm1->begin().getInternalChildren();
     std::pair<core::CollisionElementIterator,core::CollisionElementIterator> internalChildren2 = cm2->begin().getInternalChildren();
     std::pair<core::CollisionElementIterator,core::CollisionElementIterator> externalChildren1 = cm1->begin().getExternalChildren();
     std::pair<core::CollisionElementIterator,core::CollisionElementIterator> externalChildren2 = cm2->begin().getExternalChildren();
+    traversal.roots.clear();
     if (internalChildren1.first != internalChildren1.second)
     {
         if (internalChildren2.first != internalChildren2.second)
-            externalCells.push(std::make_pair(internalChildren1,internalChildren2));
+            traversal.roots.push_back(std::make_pair(internalChildren1,internalChildren2));
         if (externalChildren2.first != externalChildren2.second)
-            externalCells.push(std::make_pair(internalChildren1,externalChildren2));
+            traversal.roots.push_back(std::make_pair(internalChildren1,externalChildren2));
     }
     if (externalChildren1.first != externalChildren1.second)
     {
         if (internalChildren2.first != internalChildren2.second)
-            externalCells.push(std::make_pair(externalChildren1,internalChildren2));
+            traversal.roots.push_back(std::make_pair(externalChildren1,internalChildren2));
         if (externalChildren2.first != externalChildren2.second)
-            externalCells.push(std::make_pair(externalChildren1,externalChildren2));
+            traversal.roots.push_back(std::make_pair(externalChildren1,externalChildren2));
     }
-    //externalCells.push(std::make_pair(std::make_pair(cm1->begin(),cm1->end()),std::make_pair(cm2->begin(),cm2->end())));
+    return true;
+}
+
+core::collision::ElementIntersector* BruteForceDetection::findTraversalIntersector(core::CollisionModel* cm1, core::CollisionModel* cm2, bool& swapModels)
+{
+    return intersectionMethod->findIntersector(cm1, cm2, swapModels);
+}
+
+void BruteForceDetection::traverse(const PairTraversal& traversal, std::queue<TestPair>& externalCells, core::collision::DetectionOutputVector* outputs)
+{
+    core::CollisionModel* const finalcm1 = traversal.finalcm1;
+    core::CollisionModel* const finalcm2 = traversal.finalcm2;
+    core::collision::ElementIntersector* const finalintersector = traversal.finalintersector;
+    const bool self = traversal.self;
 
-    //core::collision::ElementIntersector* intersector = intersectionMethod->findIntersector(cm1, cm2);
     core::collision::ElementIntersector* intersector = nullptr;
     MirrorIntersector mirror;
-    cm1 = nullptr; // force later init of intersector
-    cm2 = nullptr;
+    bool swapModels = false;
+    core::CollisionModel* cm1 = nullptr; // force later init of intersector
+    core::CollisionModel* cm2 = nullptr;
 
     while (!externalCells.empty())
     {
@@ -218,7 +246,7 @@ void BruteForceDetection::addCollisionPair(const std::pair<core::CollisionModel*
             cm1 = root.first.first.getCollisionModel();
             cm2 = root.second.first.getCollisionModel();
             if (!cm1 || !cm2) continue;
-            intersector = intersectionMethod->findIntersector(cm1, cm2, swapModels);
+            intersector = findTraversalIntersector(cm1, cm2, swapModels);
 
             if (intersector == nullptr)
             {
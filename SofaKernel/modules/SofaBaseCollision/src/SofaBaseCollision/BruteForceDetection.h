@@ -24,8 +24,10 @@
 
 #include <sofa/core/collision/BroadPhaseDetection.h>
 #include <sofa/core/collision/NarrowPhaseDetection.h>
+#include <sofa/core/collision/Intersection.h>
 #include <SofaBaseCollision/CubeModel.h>
 #include <sofa/helper/vector.h>
+#include <queue>
 
 
 namespace sofa::component::collision
@@ -56,6 +58,31 @@ protected:
 
     virtual bool keepCollisionBetween(core::CollisionModel *cm1, core::CollisionModel *cm2);
 
+    typedef std::pair<core::CollisionElementIterator,core::CollisionElementIterator> ElementRange;
+    typedef std::pair<ElementRange,ElementRange> TestPair;
+
+    /// Traversal of the bounding trees of a pair of collision models
+    struct PairTraversal
+    {
+        core::CollisionModel* outputModel1 { nullptr }; ///< finest models of the pair, in the order of their intersector: the contacts are stored for this pair
+        core::CollisionModel* outputModel2 { nullptr };
+        core::collision::ElementIntersector* outputIntersector { nullptr }; ///< intersector of the finest models
+        core::CollisionModel* finalcm1 { nullptr }; ///< finest models, nullptr if they also contain the root element
+        core::CollisionModel* finalcm2 { nullptr };
+        core::collision::ElementIntersector* finalintersector { nullptr }; ///< intersector of finalcm1 and finalcm2
+        bool self { false };
+        sofa::helper::vector<TestPair> roots; ///< tests between the children of the root elements
+    };
+
+    /// Find the intersector of the finest models of a pair and the first tests of the traversal. Return false if the pair is ignored.
+    bool initTraversal(const std::pair<core::CollisionModel*, core::CollisionModel*>& cmPair, PairTraversal& traversal);
+
+    /// Find the intersector used by the traversal for the elements of two models
+    virtual core::collision::ElementIntersector* findTraversalIntersector(core::CollisionModel* cm1, core::CollisionModel* cm2, bool& swapModels);
+
+    /// Test the elements of the bounding trees, starting from the given tests, and write the contacts in outputs
+    void traverse(const PairTraversal& traversal, std::queue<TestPair>& externalCells, core::collision::DetectionOutputVector* outputs);
+
 public:
 
     void init() override;
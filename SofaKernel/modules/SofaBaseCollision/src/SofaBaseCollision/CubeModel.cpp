@@ -25,6 +25,7 @@
 #include <sofa/helper/visual/DrawTool.h>
 #include <sofa/core/ObjectFactory.h>
 #include <algorithm>
+#include <iterator>
 
 namespace sofa::component::collision
 {
@@ -38,6 +39,9 @@ int CubeCollisionModelClass = core::RegisterObject("Collision model representing
         ;
 
 CubeCollisionModel::CubeCollisionModel()
+    : builtTreeCost(0)
+    , d_rebuildThreshold(initData(&d_rebuildThreshold, (SReal)0, "rebuildThreshold", "the tree is rebuilt instead of refitted when its cost exceeds this factor times its cost when it was built (0 to always refit)"))
+    , d_parallel(initData(&d_parallel, false, "parallel", "refit the tree, and compute the leaf bounding boxes, in parallel with the TaskScheduler"))
 {
     enum_type = AABB_TYPE;
 }
@@ -99,6 +103,14 @@ void CubeCollisionModel::setLeafCube(Index cubeIndex, std::pair<core::CollisionE
     elems[cubeIndex].children = children;
 }
 
+void CubeCollisionModel::linkRefitOptions(Data<SReal>* rebuildThreshold, Data<bool>* parallel)
+{
+    if (d_rebuildThreshold.getParent() != rebuildThreshold)
+        d_rebuildThreshold.setParent(rebuildThreshold);
+    if (d_parallel.getParent() != parallel)
+        d_parallel.setParent(parallel);
+}
+
 Index CubeCollisionModel::addCube(Cube subcellsBegin, Cube subcellsEnd)
 {
     Index index = size;
@@ -163,6 +175,17 @@ void CubeCollisionModel::updateCubes()
         updateCube(i);
 }
 
+void CubeCollisionModel::updateCubes(simulation::TaskScheduler* scheduler)
+{
+    if (scheduler == nullptr || size < 2)
+    {
+        updateCubes();
+        return;
+    }
+    // the cells of a level only read the cells of the lower levels
+    simulation::parallelForEach(*scheduler, simulation::Range<Index>(0, size), 1, [this](Index i) { updateCube(i); });
+}
+
 void CubeCollisionModel::draw(const core::visual::VisualParams* vparams)
 {
     if (!isActive() || !((getNext()==nullptr)?vparams->displayFlags().getShowCollisionModels():vparams->displayFlags().getShowBoundingCollisionModels())) return;
@@ -246,7 +269,46 @@ void CubeCollisionModel::computeBoundingTree(int maxDepth)
         levels.push_front(levels.front()->createPrevious<CubeCollisionModel>());
     CubeCollisionModel* root = levels.front();
 
-    if (root->empty() || root->getPrevious() != nullptr)
+    // Summed area of the cells below the root, relative to the root cell: it grows as the refitted cells overlap
+    auto treeCost = [&levels, root]()
+    {
+        auto area = [](const CubeData& cell)
+        {
+            const Vector3 l = cell.maxBBox - cell.minBBox;
+            return 2 * (l[0]*l[1] + l[1]*l[2] + l[2]*l[0]);
+        };
+        const SReal rootArea = area(root->elems[0]);
+        if (rootArea <= 0) return (SReal)0;
+        SReal cost = 0;
+        for (std::list<CubeCollisionModel*>::const_iterator it = std::next(levels.begin()); it != levels.end(); ++it)
+            for (const CubeData& cell : (*it)->elems)
+                cost += area(cell);
+        return cost / rootArea;
+    };
+
+    bool rebuild = root->empty() || root->getPrevious() != nullptr;
+    if (!rebuild)
+    {
+        // Simply update the existing tree, starting from the bottom
+        simulation::TaskScheduler* scheduler = d_parallel.getValue() ? simulation::TaskScheduler::getInstance() : nullptr;
+        int lvl = 0;
+        for (std::list<CubeCollisionModel*>::reverse_iterator it = levels.rbegin(); it != levels.rend(); ++it)
+        {
+            dmsg_info() << "CubeCollisionModel: update level " << lvl;
+            (*it)->updateCubes(scheduler);
+            ++lvl;
+        }
+
+        const SReal rebuildThreshold = d_rebuildThreshold.getValue();
+        if (rebuildThreshold > 0 && builtTreeCost > 0)
+        {
+            const SReal cost = treeCost();
+            rebuild = cost > rebuildThreshold * builtTreeCost;
+            dmsg_info_when(rebuild) << "Tree cost " << cost << " exceeds " << rebuildThreshold << " times the cost " << builtTreeCost << " of the built tree";
+        }
+    }
+
+    if (rebuild)
     {
         // Tree must be reconstructed
         dmsg_info() << "Building Tree with depth " << maxDepth << " from " << size << " elements.";
@@ -325,17 +387,7 @@ void CubeCollisionModel::computeBoundingTree(int maxDepth)
             for (Size i=0; i<size; i++)
                 parentOf[elems[i].children.first.getIndex()] = i;
         }
-    }
-    else
-    {
-        // Simply update the existing tree, starting from the bottom
-        int lvl = 0;
-        for (std::list<CubeCollisionModel*>::reverse_iterator it = levels.rbegin(); it != levels.rend(); ++it)
-        {
-            dmsg_info() << "CubeCollisionModel: update level " << lvl;
-            (*it)->updateCubes();
-            ++lvl;
-        }
+        builtTreeCost = treeCost();
     }
     dmsg_info() << "<CubeCollisionModel::computeBoundingTree(" << maxDepth << ")";
 }
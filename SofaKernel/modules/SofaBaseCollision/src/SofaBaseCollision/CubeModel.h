@@ -24,6 +24,7 @@
 
 #include <sofa/core/CollisionModel.h>
 #include <sofa/defaulttype/VecTypes.h>
+#include <sofa/simulation/ParallelForEach.h>
 
 namespace sofa::component::collision
 {
@@ -81,7 +82,12 @@ protected:
     sofa::helper::vector<CubeData> elems;
     sofa::helper::vector<Index> parentOf; ///< Given the index of a child leaf element, store the index of the parent cube
 
+    SReal builtTreeCost; ///< cost of the tree (see computeBoundingTree) when it was last rebuilt
+
 public:
+    Data<SReal> d_rebuildThreshold; ///< the tree is rebuilt instead of refitted when its cost exceeds this factor times its cost when it was built (0 to always refit)
+    Data<bool> d_parallel; ///< refit the tree, and compute the leaf bounding boxes, in parallel with the TaskScheduler
+
     typedef core::CollisionElementIterator ChildIterator;
     typedef sofa::defaulttype::Vec3Types DataTypes;
     typedef Cube Element;
@@ -96,6 +102,24 @@ public:
     void setLeafCube(Index cubeIndex, Index childIndex);
     void setLeafCube(Index cubeIndex, std::pair<core::CollisionElementIterator,core::CollisionElementIterator> children, const sofa::defaulttype::Vector3& min, const sofa::defaulttype::Vector3& max);
 
+    /// Use the refit options of the collision model whose elements are the leaves of this tree
+    void linkRefitOptions(Data<SReal>* rebuildThreshold, Data<bool>* parallel);
+
+    /// Call function(i) for each child leaf element i in [0,n), in parallel if d_parallel is set.
+    /// Each child has its own cell, so the function can call setParentOf concurrently.
+    template<class Function>
+    void forEachLeaf(Size n, const Function& function)
+    {
+        simulation::TaskScheduler* scheduler = d_parallel.getValue() ? simulation::TaskScheduler::getInstance() : nullptr;
+        if (scheduler == nullptr || n < 2)
+        {
+            for (Index i=0; i<n; i++)
+                function(i);
+            return;
+        }
+        simulation::parallelForEach(*scheduler, simulation::Range<Index>(0, n), 0, function);
+    }
+
     Size getNumberCells() const { return Size(elems.size());}
 
     void getBoundingTree ( sofa::helper::vector< std::pair< sofa::defaulttype::Vector3, sofa::defaulttype::Vector3> > &bounding )
@@ -129,6 +153,9 @@ public:
       *The division is done only if the box contains more than 4 final CollisionElements and if the depth doesn't exceed
       *the max depth. The division is made along an axis. This axis corresponds to the biggest dimension of the current bounding box.
       *Note : a bounding box is a Cube here.
+      *Once built, the tree is only refitted: its structure is kept and the boxes are updated from the bottom. As the elements move, the
+      *refitted cells overlap more. Its cost, the summed area of the cells relative to the root cell, is compared to the one of the built
+      *tree, and the tree is rebuilt when it exceeds d_rebuildThreshold times this cost.
       */
     void computeBoundingTree(int maxDepth=0) override;
 
@@ -143,6 +170,7 @@ public:
     Index addCube(Cube subcellsBegin, Cube subcellsEnd);
     void updateCube(Index index);
     void updateCubes();
+    void updateCubes(simulation::TaskScheduler* scheduler);
 };
 
 inline Cube::Cube(CubeCollisionModel* model, Index index)
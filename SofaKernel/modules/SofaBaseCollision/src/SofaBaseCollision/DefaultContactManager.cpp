@@ -38,7 +38,12 @@ int DefaultContactManagerClass = core::RegisterObject("Default class to create r
 DefaultContactManager::DefaultContactManager()
     : response(initData(&response, "response", "contact response class"))
     , responseParams(initData(&responseParams, "responseParams", "contact response parameters (syntax: name1=value1&name2=value2&...)"))
+    , d_reuseContactPoints(initData(&d_reuseContactPoints, false, "reuseContactPoints", "reuse the contact points of the previous step for the contacts detected again between the same elements. Their barycentric coordinates are kept: the new contact positions are ignored while the contact persists"))
+    , d_nbReusedContactPoints(initData(&d_nbReusedContactPoints, 0, "nbReusedContactPoints", "number of contact points reused from the previous step"))
+    , d_nbCreatedContactPoints(initData(&d_nbCreatedContactPoints, 0, "nbCreatedContactPoints", "number of contact points created at this step"))
 {
+    d_nbReusedContactPoints.setReadOnly(true);
+    d_nbCreatedContactPoints.setReadOnly(true);
 }
 
 DefaultContactManager::~DefaultContactManager()
@@ -126,6 +131,9 @@ void DefaultContactManager::createContacts(const DetectionOutputMap& outputsMap)
     using core::collision::Contact;
 
     Size nbContact = 0;
+    const bool reuseContactPoints = d_reuseContactPoints.getValue();
+    std::size_t nbReusedContactPoints = 0;
+    std::size_t nbCreatedContactPoints = 0;
 
     // First iterate on the collision detection outputs and look for existing or new contacts
     std::stringstream errorStream;
@@ -185,7 +193,10 @@ void DefaultContactManager::createContacts(const DetectionOutputMap& outputsMap)
                     setContactTags(model1, model2, contact);
                     contact->f_printLog.setValue(notMuted());
                     contact->init();
+                    contact->setReuseContactPoints(reuseContactPoints);
                     contact->setDetectionOutputs(outputsIt->second);
+                    nbReusedContactPoints += contact->getNbReusedContactPoints();
+                    nbCreatedContactPoints += contact->getNbCreatedContactPoints();
                     ++nbContact;
                 }
             }
@@ -193,13 +204,19 @@ void DefaultContactManager::createContacts(const DetectionOutputMap& outputsMap)
         else
         {
             // pre-existing and still active contact
+            contactIt->second->setReuseContactPoints(reuseContactPoints);
             contactIt->second->setDetectionOutputs(outputsIt->second);
+            nbReusedContactPoints += contactIt->second->getNbReusedContactPoints();
+            nbCreatedContactPoints += contactIt->second->getNbCreatedContactPoints();
             ++nbContact;
         }
     }
 
     msg_error_when(!errorStream.str().empty()) << errorStream.str();
 
+    d_nbReusedContactPoints.setValue(int(nbReusedContactPoints));
+    d_nbCreatedContactPoints.setValue(int(nbCreatedContactPoints));
+
     // Then look at previous contacts
     // and remove inactive contacts
     for (ContactMap::iterator contactIt = contactMap.begin(), contactItEnd = contactMap.end();
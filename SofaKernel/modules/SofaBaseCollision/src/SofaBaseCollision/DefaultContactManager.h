@@ -38,6 +38,9 @@ public :
 
     Data<sofa::helper::OptionsGroup> response; ///< contact response class
     Data<std::string> responseParams; ///< contact response parameters (syntax: name1=value1    Data<std::string> responseParams;name2=value2    Data<std::string> responseParams;...)
+    Data<bool> d_reuseContactPoints; ///< reuse the contact points of the previous step for the contacts detected again between the same elements. Their barycentric coordinates are kept: the new contact positions are ignored while the contact persists
+    Data<int> d_nbReusedContactPoints; ///< number of contact points reused from the previous step
+    Data<int> d_nbCreatedContactPoints; ///< number of contact points created at this step
 
     /// outputsVec fixes the reproducibility problems by storing contacts in the collision detection saved order
     /// if not given, it is still working but with eventual reproducibility problems
@@ -44,6 +44,7 @@ int NewProximityIntersectionClass = core::RegisterObject("Optimized Proximity In
 NewProximityIntersection::NewProximityIntersection()
     : BaseProximityIntersection()
     , useLineLine(initData(&useLineLine, false, "useLineLine", "Line-line collision detection enabled"))
+    , d_useBatchKernels(initData(&d_useBatchKernels, false, "useBatchKernels", "Opt-in: evaluate the point-triangle and line-line tests between triangles in SIMD batches, when the AVX instructions are enabled. The contacts are the same, up to rounding errors in the last digits"))
 {
 }
 
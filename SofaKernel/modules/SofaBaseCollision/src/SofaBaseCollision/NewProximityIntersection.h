@@ -33,6 +33,7 @@ public:
     SOFA_CLASS(NewProximityIntersection,BaseProximityIntersection);
 
     Data<bool> useLineLine; ///< Line-line collision detection enabled
+    Data<bool> d_useBatchKernels; ///< Opt-in: evaluate the point-triangle and line-line tests between triangles in SIMD batches, when the AVX instructions are enabled
 protected:
     NewProximityIntersection();
 public:
@@ -0,0 +1,212 @@
+/******************************************************************************
+*                 SOFA, Simulation Open-Framework Architecture                *
+*                    (c) 2006 INRIA, USTL, UJF, CNRS, MGH                     *
+*                                                                             *
+* This program is free software; you can redistribute it and/or modify it     *
+* under the terms of the GNU Lesser General Public License as published by    *
+* the Free Software Foundation; either version 2.1 of the License, or (at     *
+* your option) any later version.                                             *
+*                                                                             *
+* This program is distributed in the hope that it will be useful, but WITHOUT *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License *
+* for more details.                                                           *
+*                                                                             *
+* You should have received a copy of the GNU Lesser General Public License    *
+* along with this program. If not, see <http://www.gnu.org/licenses/>.        *
+*******************************************************************************
+* Authors: The SOFA Team and external contributors (see Authors.txt)          *
+*                                                                             *
+* Contact information: contact@sofa-framework.org                             *
+******************************************************************************/
+#include <SofaBaseCollision/ParallelBruteForceDetection.h>
+
+#include <SofaBaseCollision/MirrorIntersector.h>
+#include <sofa/core/ObjectFactory.h>
+#include <sofa/helper/ScopedAdvancedTimer.h>
+#include <sofa/simulation/ParallelForEach.h>
+#include <algorithm>
+#include <set>
+
+namespace sofa::component::collision
+{
+
+int ParallelBruteForceDetectionClass = core::RegisterObject("Collision detection using extensive pair-wise tests, with a parallel narrow phase")
+        .add< ParallelBruteForceDetection >()
+        ;
+
+ParallelBruteForceDetection::ParallelBruteForceDetection()
+    : d_splitSize(initData(&d_splitSize, 1000u, "splitSize", "pairs of collision models with more elements than this value are split into tests between sub-trees (0 to never split)"))
+    , d_nbSubtreeTasks(initData(&d_nbSubtreeTasks, 32u, "subtreeTasks", "number of tasks a split pair of collision models is divided into"))
+{
+}
+
+core::collision::ElementIntersector* ParallelBruteForceDetection::findTraversalIntersector(core::CollisionModel* cm1, core::CollisionModel* cm2, bool& swapModels)
+{
+    std::lock_guard<std::mutex> lock(m_intersectorMutex);
+    return intersectionMethod->findIntersector(cm1, cm2, swapModels);
+}
+
+void ParallelBruteForceDetection::splitTests(const PairTraversal& traversal, sofa::helper::vector<TestPair>& tests, std::size_t nbTasks)
+{
+    MirrorIntersector mirror;
+    sofa::helper::vector<TestPair> children;
+    bool split = true;
+    while (split && tests.size() < nbTasks)
+    {
+        split = false;
+        children.clear();
+        for (const TestPair& test : tests)
+        {
+            core::CollisionModel* cm1 = test.first.first.getCollisionModel();
+            core::CollisionModel* cm2 = test.second.first.getCollisionModel();
+            if (cm1 == traversal.finalcm1 && cm2 == traversal.finalcm2)
+            {
+                // tests between the final elements are not split
+                children.push_back(test);
+                continue;
+            }
+            bool swapModels = false;
+            core::collision::ElementIntersector* intersector = intersectionMethod->findIntersector(cm1, cm2, swapModels);
+            if (intersector == nullptr)
+            {
+                children.push_back(test);
+                continue;
+            }
+            if (swapModels)
+            {
+                mirror.intersector = intersector;
+                intersector = &mirror;
+            }
+
+            // same tests as the traversal of the internal cells: the elements that do not intersect are discarded,
+            // the other ones are replaced by the tests between their internal children if both have some
+            for (core::CollisionElementIterator it1 = test.first.first; it1 != test.first.second; ++it1)
+            {
+                for (core::CollisionElementIterator it2 = test.second.first; it2 != test.second.second; ++it2)
+                {
+                    if (!intersector->canIntersect(it1, it2))
+                        continue;
+                    const ElementRange internalChildren1 = it1.getInternalChildren();
+                    const ElementRange internalChildren2 = it2.getInternalChildren();
+                    if (internalChildren1.first != internalChildren1.second && internalChildren2.first != internalChildren2.second)
+                    {
+                        children.push_back(std::make_pair(internalChildren1, internalChildren2));
+                        split = true;
+                    }
+                    else
+                    {
+                        core::CollisionElementIterator end1 = it1;
+                        core::CollisionElementIterator end2 = it2;
+                        ++end1;
+                        ++end2;
+                        children.push_back(std::make_pair(std::make_pair(it1, end1), std::make_pair(it2, end2)));
+                    }
+                }
+            }
+        }
+        tests.swap(children);
+    }
+}
+
+void ParallelBruteForceDetection::addCollisionPairs(const sofa::helper::vector< std::pair<core::CollisionModel*, core::CollisionModel*> >& v)
+{
+    sofa::helper::ScopedAdvancedTimer timer("ParallelBruteForceDetection addCollisionPairs");
+
+    struct Task
+    {
+        const PairTraversal* traversal;
+        sofa::helper::vector<TestPair> tests;
+        sofa::helper::vector<core::collision::DetectionOutput>* contacts; ///< output vector of the pair
+        core::collision::DetectionOutputVector* outputs; ///< output vector of the task, if it is not the one of the pair
+    };
+
+    sofa::helper::vector<PairTraversal> traversals(v.size());
+    sofa::helper::vector<Task> tasks;
+    std::set<core::collision::DetectionOutputVector*> usedOutputs;
+
+    // The traversals are initialized sequentially: the output vectors are created here
+    for (std::size_t i = 0; i < v.size(); ++i)
+    {
+        PairTraversal& traversal = traversals[i];
+        if (!initTraversal(v[i], traversal))
+            continue;
+
+        core::collision::DetectionOutputVector*& outputs = this->getDetectionOutputs(traversal.outputModel1, traversal.outputModel2);
+        traversal.outputIntersector->beginIntersect(traversal.outputModel1, traversal.outputModel2, outputs);//creates outputs if null
+
+        auto* contacts = dynamic_cast<sofa::helper::vector<core::collision::DetectionOutput>*>(outputs);
+        if (contacts == nullptr)
+        {
+            // the tasks outputs could not be merged
+            std::queue<TestPair> externalCells;
+            for (const TestPair& root : traversal.roots)
+                externalCells.push(root);
+            traverse(traversal, externalCells, outputs);
+            continue;
+        }
+
+        sofa::helper::vector<TestPair> tests = traversal.roots;
+        std::size_t nbTasks = 1;
+        const unsigned int splitSize = d_splitSize.getValue();
+        if (splitSize > 0 && traversal.outputModel1->getSize() + traversal.outputModel2->getSize() > splitSize)
+        {
+            nbTasks = std::max(1u, d_nbSubtreeTasks.getValue());
+            splitTests(traversal, tests, nbTasks);
+        }
+        nbTasks = std::min(nbTasks, tests.size());
+
+        for (std::size_t t = 0; t < nbTasks; ++t)
+        {
+            Task task;
+            task.traversal = &traversal;
+            task.tests.assign(tests.begin() + (t * tests.size()) / nbTasks, tests.begin() + ((t + 1) * tests.size()) / nbTasks);
+            task.contacts = contacts;
+            task.outputs = nullptr;
+            if (!usedOutputs.insert(outputs).second)
+            {
+                traversal.outputIntersector->beginIntersect(traversal.outputModel1, traversal.outputModel2, task.outputs);
+            }
+            else
+            {
+                task.outputs = outputs;
+                task.contacts = nullptr;
+            }
+            tasks.push_back(task);
+        }
+    }
+
+    auto runTask = [this, &tasks](std::size_t t)
+    {
+        Task& task = tasks[t];
+        std::queue<TestPair> externalCells;
+        for (const TestPair& test : task.tests)
+            externalCells.push(test);
+        traverse(*task.traversal, externalCells, task.outputs);
+    };
+
+    simulation::TaskScheduler* scheduler = simulation::TaskScheduler::getInstance();
+    if (scheduler == nullptr || tasks.size() < 2)
+    {
+        for (std::size_t t = 0; t < tasks.size(); ++t)
+            runTask(t);
+    }
+    else
+    {
+        simulation::parallelForEach(*scheduler, simulation::Range<std::size_t>(0, tasks.size()), 1, runTask);
+    }
+
+    // merge in the order of the tasks, independently of the scheduling
+    for (Task& task : tasks)
+    {
+        if (task.contacts == nullptr)
+            continue;
+        const auto* taskContacts = dynamic_cast<const sofa::helper::vector<core::collision::DetectionOutput>*>(task.outputs);
+        task.contacts->insert(task.contacts->end(), taskContacts->begin(), taskContacts->end());
+        task.outputs->release();
+    }
+
+    m_primitiveTestCount = m_outputsMap.size();
+}
+
+} // namespace sofa::component::collision
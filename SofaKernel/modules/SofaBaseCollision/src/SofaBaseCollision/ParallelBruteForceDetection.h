@@ -0,0 +1,63 @@
+/******************************************************************************
+*                 SOFA, Simulation Open-Framework Architecture                *
+*                    (c) 2006 INRIA, USTL, UJF, CNRS, MGH                     *
+*                                                                             *
+* This program is free software; you can redistribute it and/or modify it     *
+* under the terms of the GNU Lesser General Public License as published by    *
+* the Free Software Foundation; either version 2.1 of the License, or (at     *
+* your option) any later version.                                             *
+*                                                                             *
+* This program is distributed in the hope that it will be useful, but WITHOUT *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License *
+* for more details.                                                           *
+*                                                                             *
+* You should have received a copy of the GNU Lesser General Public License    *
+* along with this program. If not, see <http://www.gnu.org/licenses/>.        *
+*******************************************************************************
+* Authors: The SOFA Team and external contributors (see Authors.txt)          *
+*                                                                             *
+* Contact information: contact@sofa-framework.org                             *
+******************************************************************************/
+#pragma once
+#include <SofaBaseCollision/config.h>
+
+#include <SofaBaseCollision/BruteForceDetection.h>
+#include <mutex>
+
+namespace sofa::component::collision
+{
+
+/**
+ * Narrow phase of BruteForceDetection executed in parallel with the TaskScheduler.
+ *
+ * The traversals of the bounding trees of the pairs of collision models are distributed over the threads.
+ * The traversal of a pair with many elements is split into the tests between sub-trees. Each task writes its
+ * contacts in its own output vector, the vectors are then merged in the order of the pairs and of the tasks:
+ * the contacts do not depend on the thread scheduling.
+ */
+class SOFA_SOFABASECOLLISION_API ParallelBruteForceDetection : public BruteForceDetection
+{
+public:
+    SOFA_CLASS(ParallelBruteForceDetection, BruteForceDetection);
+
+    Data<unsigned int> d_splitSize; ///< pairs of collision models with more elements than this value are split into tests between sub-trees (0 to never split)
+    Data<unsigned int> d_nbSubtreeTasks; ///< number of tasks a split pair of collision models is divided into
+
+    void addCollisionPairs(const sofa::helper::vector< std::pair<core::CollisionModel*, core::CollisionModel*> >& v) override;
+
+protected:
+    ParallelBruteForceDetection();
+
+    ~ParallelBruteForceDetection() override = default;
+
+    /// The intersector map is filled on the first lookup of a pair of models: the lookups of the tasks are serialized
+    core::collision::ElementIntersector* findTraversalIntersector(core::CollisionModel* cm1, core::CollisionModel* cm2, bool& swapModels) override;
+
+    /// Replace the tests of a traversal by the tests between their intersecting children, until there are nbTasks tests
+    void splitTests(const PairTraversal& traversal, sofa::helper::vector<TestPair>& tests, std::size_t nbTasks);
+
+    std::mutex m_intersectorMutex;
+};
+
+} // namespace sofa::component::collision
@@ -0,0 +1,306 @@
+/******************************************************************************
+*                 SOFA, Simulation Open-Framework Architecture                *
+*                    (c) 2006 INRIA, USTL, UJF, CNRS, MGH                     *
+*                                                                             *
+* This program is free software; you can redistribute it and/or modify it     *
+* under the terms of the GNU Lesser General Public License as published by    *
+* the Free Software Foundation; either version 2.1 of the License, or (at     *
+* your option) any later version.                                             *
+*                                                                             *
+* This program is distributed in the hope that it will be useful, but WITHOUT *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License *
+* for more details.                                                           *
+*                                                                             *
+* You should have received a copy of the GNU Lesser General Public License    *
+* along with this program. If not, see <http://www.gnu.org/licenses/>.        *
+*******************************************************************************
+* Authors: The SOFA Team and external contributors (see Authors.txt)          *
+*                                                                             *
+* Contact information: contact@sofa-framework.org                             *
+******************************************************************************/
+#include <SofaBaseCollision/SpatialHashDetection.h>
+
+#include <SofaBaseCollision/CubeModel.h>
+#include <sofa/core/ObjectFactory.h>
+#include <sofa/core/collision/Intersection.h>
+#include <sofa/helper/AdvancedTimer.h>
+#include <sofa/helper/ScopedAdvancedTimer.h>
+#include <algorithm>
+#include <cmath>
+
+namespace sofa::component::collision
+{
+
+int SpatialHashDetectionClass = core::RegisterObject("Collision detection using a uniform grid of the element bounding boxes")
+        .add< SpatialHashDetection >()
+        ;
+
+namespace
+{
+    /// number of bits of a cell coordinate in a cell key
+    constexpr int cellBits = 21;
+    constexpr std::int64_t maxCellCoordinate = (std::int64_t(1) << cellBits) - 2;
+
+    std::uint64_t cellKey(std::int64_t x, std::int64_t y, std::int64_t z)
+    {
+        return (std::uint64_t(x) << (2 * cellBits)) | (std::uint64_t(y) << cellBits) | std::uint64_t(z);
+    }
+}
+
+SpatialHashDetection::SpatialHashDetection()
+    : d_cellSize(initData(&d_cellSize, (SReal)0, "cellSize", "size of the cells of the grid. If 0, it is estimated at each step from the size of the element bounding boxes"))
+    , d_cellSizeFactor(initData(&d_cellSizeFactor, (SReal)1, "cellSizeFactor", "ratio between the estimated cell size and the mean size of the element bounding boxes"))
+    , d_maxCellsPerElement(initData(&d_maxCellsPerElement, 64u, "maxCellsPerElement", "elements overlapping more cells are tested against all the other elements"))
+    , d_currentCellSize(initData(&d_currentCellSize, (SReal)0, "currentCellSize", "cell size used at the last step"))
+    , d_nbPairs(initData(&d_nbPairs, 0, "nbPairs", "number of pairs of elements sent to narrow phase"))
+{
+    d_currentCellSize.setReadOnly(true);
+    d_nbPairs.setReadOnly(true);
+}
+
+void SpatialHashDetection::init()
+{
+    reinit();
+}
+
+void SpatialHashDetection::reinit()
+{
+    // the models may have been replaced since: report again the ones without bounding boxes
+    m_ignoredModels.clear();
+}
+
+void SpatialHashDetection::addCollisionModel(core::CollisionModel *cm)
+{
+    if (cm == nullptr || cm->empty())
+        return;
+    m_collisionModels.push_back(cm->getLast());
+}
+
+void SpatialHashDetection::beginNarrowPhase()
+{
+    assert(intersectionMethod != nullptr);
+
+    core::collision::NarrowPhaseDetection::beginNarrowPhase();
+
+    m_nbPairs = 0;
+    m_lastModel0 = nullptr;
+    m_lastModel1 = nullptr;
+
+    collectBoxes(intersectionMethod->getAlarmDistance() / 2);
+    if (m_boxes.size() > 1)
+    {
+        const SReal cellSize = computeCellSize();
+        d_currentCellSize.setValue(cellSize);
+        fillCells(cellSize);
+        detectPairs();
+    }
+
+    d_nbPairs.setValue(m_nbPairs);
+    sofa::helper::AdvancedTimer::valSet("SpatialHash pairs", m_nbPairs);
+}
+
+void SpatialHashDetection::collectBoxes(SReal margin)
+{
+    sofa::helper::ScopedAdvancedTimer scopeTimer("SpatialHash boxes");
+    m_boxes.clear();
+    for (core::CollisionModel* cm : m_collisionModels)
+    {
+        // the leaves of the bounding tree are the bounding boxes of the elements
+        CubeCollisionModel* cubes = dynamic_cast<CubeCollisionModel*>(cm->getPrevious());
+        if (cubes == nullptr)
+        {
+            if (m_ignoredModels.insert(cm).second)
+                msg_warning() << "The collision model " << cm->getName() << " has no bounding boxes: it is ignored";
+            continue;
+        }
+        for (Index i = 0; i < cubes->getSize(); ++i)
+        {
+            const Cube cube(cubes, i);
+            ElementBox box;
+            box.minBBox = cube.minVect() - sofa::defaulttype::Vector3(margin, margin, margin);
+            box.maxBBox = cube.maxVect() + sofa::defaulttype::Vector3(margin, margin, margin);
+            box.model = cm;
+            box.element = cube.getExternalChildren().first;
+            m_boxes.push_back(box);
+        }
+    }
+}
+
+SReal SpatialHashDetection::computeCellSize() const
+{
+    sofa::defaulttype::Vector3 minBBox = m_boxes.front().minBBox;
+    sofa::defaulttype::Vector3 maxBBox = m_boxes.front().maxBBox;
+    SReal meanSize = 0;
+    for (const ElementBox& box : m_boxes)
+    {
+        for (int d = 0; d < 3; ++d)
+        {
+            minBBox[d] = std::min(minBBox[d], box.minBBox[d]);
+            maxBBox[d] = std::max(maxBBox[d], box.maxBBox[d]);
+        }
+        const sofa::defaulttype::Vector3 size = box.maxBBox - box.minBBox;
+        meanSize += std::max(size[0], std::max(size[1], size[2]));
+    }
+    meanSize /= SReal(m_boxes.size());
+
+    const sofa::defaulttype::Vector3 extent = maxBBox - minBBox;
+    const SReal maxExtent = std::max(extent[0], std::max(extent[1], extent[2]));
+
+    SReal cellSize = d_cellSize.getValue();
+    if (cellSize <= 0)
+    {
+        // cells of the size of the elements: each element overlaps a few cells, each cell contains a few elements
+        cellSize = d_cellSizeFactor.getValue() * meanSize;
+        if (cellSize <= 0)
+            cellSize = maxExtent / std::cbrt(SReal(m_boxes.size()));
+        if (cellSize <= 0)
+            cellSize = 1;
+    }
+
+    // the coordinates of the cells must fit in the cell keys
+    return std::max(cellSize, maxExtent / SReal(maxCellCoordinate));
+}
+
+void SpatialHashDetection::fillCells(SReal cellSize)
+{
+    sofa::helper::ScopedAdvancedTimer scopeTimer("SpatialHash cells");
+
+    m_origin = m_boxes.front().minBBox;
+    for (const ElementBox& box : m_boxes)
+        for (int d = 0; d < 3; ++d)
+            m_origin[d] = std::min(m_origin[d], box.minBBox[d]);
+    m_invCellSize = 1 / cellSize;
+
+    const std::int64_t maxCells = d_maxCellsPerElement.getValue();
+    m_cells.clear();
+    m_largeBoxes.clear();
+    for (Index b = 0; b < m_boxes.size(); ++b)
+    {
+        const ElementBox& box = m_boxes[b];
+        std::int64_t minCell[3], maxCell[3];
+        std::int64_t nbCells = 1;
+        for (int d = 0; d < 3; ++d)
+        {
+            minCell[d] = cellCoordinate(box.minBBox[d], d);
+            maxCell[d] = std::min(cellCoordinate(box.maxBBox[d], d), maxCellCoordinate);
+            nbCells *= maxCell[d] - minCell[d] + 1;
+        }
+        if (nbCells > maxCells)
+        {
+            m_largeBoxes.push_back(b);
+            continue;
+        }
+        for (std::int64_t x = minCell[0]; x <= maxCell[0]; ++x)
+            for (std::int64_t y = minCell[1]; y <= maxCell[1]; ++y)
+                for (std::int64_t z = minCell[2]; z <= maxCell[2]; ++z)
+                    m_cells.push_back({ cellKey(x, y, z), b });
+    }
+
+    std::sort(m_cells.begin(), m_cells.end());
+}
+
+void SpatialHashDetection::detectPairs()
+{
+    sofa::helper::ScopedAdvancedTimer scopeTimer("SpatialHash intersection");
+
+    const std::uint64_t coordinateMask = (std::uint64_t(1) << cellBits) - 1;
+    for (std::size_t begin = 0, end = 0; begin < m_cells.size(); begin = end)
+    {
+        const std::uint64_t cell = m_cells[begin].cell;
+        for (end = begin + 1; end < m_cells.size() && m_cells[end].cell == cell; ++end) {}
+        if (end - begin < 2)
+            continue;
+
+        const std::int64_t cellCoordinates[3] = { std::int64_t(cell >> (2 * cellBits)), std::int64_t((cell >> cellBits) & coordinateMask), std::int64_t(cell & coordinateMask) };
+        for (std::size_t i = begin; i < end; ++i)
+        {
+            const ElementBox& box0 = m_boxes[m_cells[i].box];
+            for (std::size_t j = i + 1; j < end; ++j)
+            {
+                const ElementBox& box1 = m_boxes[m_cells[j].box];
+
+                // a pair sharing several cells is only tested in the cell containing the min corner of the intersection of the boxes
+                bool firstCell = true;
+                for (int d = 0; d < 3 && firstCell; ++d)
+                {
+                    firstCell = box0.minBBox[d] <= box1.maxBBox[d] && box1.minBBox[d] <= box0.maxBBox[d]
+                            && cellCoordinate(std::max(box0.minBBox[d], box1.minBBox[d]), d) == cellCoordinates[d];
+                }
+                if (firstCell)
+                    testPair(m_cells[i].box, m_cells[j].box);
+            }
+        }
+    }
+
+    if (!m_largeBoxes.empty())
+    {
+        sofa::helper::vector<bool> isLarge(m_boxes.size(), false);
+        for (Index b : m_largeBoxes)
+            isLarge[b] = true;
+        for (Index large : m_largeBoxes)
+        {
+            for (Index b = 0; b < m_boxes.size(); ++b)
+            {
+                if (b == large || (isLarge[b] && b < large))
+                    continue;
+                const ElementBox& box0 = m_boxes[std::min(b, large)];
+                const ElementBox& box1 = m_boxes[std::max(b, large)];
+                bool overlap = true;
+                for (int d = 0; d < 3 && overlap; ++d)
+                    overlap = box0.minBBox[d] <= box1.maxBBox[d] && box1.minBBox[d] <= box0.maxBBox[d];
+                if (overlap)
+                    testPair(std::min(b, large), std::max(b, large));
+            }
+        }
+    }
+}
+
+void SpatialHashDetection::testPair(Index boxId0, Index boxId1)
+{
+    const ElementBox& box0 = m_boxes[boxId0];
+    const ElementBox& box1 = m_boxes[boxId1];
+    core::CollisionModel* cm0 = box0.model;
+    core::CollisionModel* cm1 = box1.model;
+
+    if (cm0 != m_lastModel0 || cm1 != m_lastModel1)
+    {
+        m_lastModel0 = cm0;
+        m_lastModel1 = cm1;
+        m_lastIntersector = nullptr;
+        m_lastOutputs = nullptr;
+        // same conditions as BruteForceDetection between the models
+        m_lastKeep = (cm0->isSimulated() || cm1->isSimulated()) && cm0->canCollideWith(cm1) && cm1->canCollideWith(cm0);
+        if (m_lastKeep)
+        {
+            m_lastSwap = false;
+            m_lastIntersector = intersectionMethod->findIntersector(cm0, cm1, m_lastSwap);
+        }
+        if (m_lastIntersector != nullptr)
+        {
+            core::collision::DetectionOutputVector*& outputs = m_lastSwap ? this->getDetectionOutputs(cm1, cm0) : this->getDetectionOutputs(cm0, cm1);
+            if (m_lastSwap)
+                m_lastIntersector->beginIntersect(cm1, cm0, outputs);//creates outputs if null
+            else
+                m_lastIntersector->beginIntersect(cm0, cm1, outputs);//creates outputs if null
+            m_lastOutputs = outputs;
+        }
+    }
+    if (m_lastIntersector == nullptr)
+        return;
+
+    core::CollisionElementIterator element0 = box0.element;
+    core::CollisionElementIterator element1 = box1.element;
+
+    // adjacent elements of a self-colliding model
+    if (cm0->getContext() == cm1->getContext() && !element0.canCollideWith(element1))
+        return;
+
+    ++m_nbPairs;
+    if (m_lastSwap)
+        m_lastIntersector->intersect(element1, element0, m_lastOutputs);
+    else
+        m_lastIntersector->intersect(element0, element1, m_lastOutputs);
+}
+
+} // namespace sofa::component::collision
@@ -0,0 +1,136 @@
+/******************************************************************************
+*                 SOFA, Simulation Open-Framework Architecture                *
+*                    (c) 2006 INRIA, USTL, UJF, CNRS, MGH                     *
+*                                                                             *
+* This program is free software; you can redistribute it and/or modify it     *
+* under the terms of the GNU Lesser General Public License as published by    *
+* the Free Software Foundation; either version 2.1 of the License, or (at     *
+* your option) any later version.                                             *
+*                                                                             *
+* This program is distributed in the hope that it will be useful, but WITHOUT *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License *
+* for more details.                                                           *
+*                                                                             *
+* You should have received a copy of the GNU Lesser General Public License    *
+* along with this program. If not, see <http://www.gnu.org/licenses/>.        *
+*******************************************************************************
+* Authors: The SOFA Team and external contributors (see Authors.txt)          *
+*                                                                             *
+* Contact information: contact@sofa-framework.org                             *
+******************************************************************************/
+#pragma once
+#include <SofaBaseCollision/config.h>
+
+#include <sofa/core/collision/BroadPhaseDetection.h>
+#include <sofa/core/collision/NarrowPhaseDetection.h>
+#include <sofa/defaulttype/Vec.h>
+#include <sofa/helper/vector.h>
+#include <cstdint>
+#include <set>
+
+namespace sofa::core::collision
+{
+    class ElementIntersector;
+}
+
+namespace sofa::component::collision
+{
+
+/**
+ * Collision detection on a uniform grid.
+ *
+ * The bounding boxes of the elements of all the collision models are inserted in the cells of a uniform grid,
+ * stored as a list of (cell, element) entries sorted by cell. The elements sharing a cell are tested in the
+ * narrow phase, each pair of elements being tested once. Elements overlapping more than maxCellsPerElement
+ * cells are tested against all the other elements.
+ * Unlike BruteForceDetection, there is no test between pairs of models: the cost does not depend on the
+ * number of models, which suits scenes with many small models (particles, sutures, debris...).
+ */
+class SOFA_SOFABASECOLLISION_API SpatialHashDetection :
+    public core::collision::BroadPhaseDetection,
+    public core::collision::NarrowPhaseDetection
+{
+public:
+    SOFA_CLASS2(SpatialHashDetection, core::collision::BroadPhaseDetection, core::collision::NarrowPhaseDetection);
+
+    Data<SReal> d_cellSize; ///< size of the cells of the grid. If 0, it is estimated at each step from the size of the element bounding boxes
+    Data<SReal> d_cellSizeFactor; ///< ratio between the estimated cell size and the mean size of the element bounding boxes
+    Data<unsigned int> d_maxCellsPerElement; ///< elements overlapping more cells are tested against all the other elements
+    Data<SReal> d_currentCellSize; ///< cell size used at the last step
+    Data<int> d_nbPairs; ///< number of pairs of elements sent to narrow phase
+
+protected:
+    SpatialHashDetection();
+
+    ~SpatialHashDetection() override = default;
+
+    /// Bounding box of an element, enlarged by half the alarm distance
+    struct ElementBox
+    {
+        sofa::defaulttype::Vector3 minBBox;
+        sofa::defaulttype::Vector3 maxBBox;
+        core::CollisionModel* model { nullptr };
+        core::CollisionElementIterator element;
+    };
+
+    /// Element whose bounding box overlaps a cell
+    struct CellEntry
+    {
+        std::uint64_t cell;
+        Index box;
+        bool operator<(const CellEntry& other) const { return cell < other.cell || (cell == other.cell && box < other.box); }
+    };
+
+    void collectBoxes(SReal margin);
+    SReal computeCellSize() const;
+    void fillCells(SReal cellSize);
+    void detectPairs();
+
+    /// Coordinate of the cell containing a point along an axis
+    std::int64_t cellCoordinate(SReal x, int axis) const { return std::int64_t(std::floor((x - m_origin[axis]) * m_invCellSize)); }
+
+    /// Test the pair of elements if their boxes overlap, and if the pair is not filtered out
+    void testPair(Index boxId0, Index boxId1);
+
+    sofa::helper::vector<core::CollisionModel*> m_collisionModels;
+    sofa::helper::vector<ElementBox> m_boxes;
+    sofa::helper::vector<CellEntry> m_cells;
+    sofa::helper::vector<Index> m_largeBoxes; ///< boxes overlapping too many cells
+    std::set<const core::CollisionModel*> m_ignoredModels; ///< models without bounding boxes, already reported
+    sofa::defaulttype::Vector3 m_origin;
+    SReal m_invCellSize { 1 };
+    int m_nbPairs { 0 };
+
+    /// last tested pair of models, most pairs of elements sharing a cell belong to the same models
+    core::CollisionModel* m_lastModel0 { nullptr };
+    core::CollisionModel* m_lastModel1 { nullptr };
+    bool m_lastKeep { false };
+    bool m_lastSwap { false };
+    core::collision::ElementIntersector* m_lastIntersector { nullptr };
+    core::collision::DetectionOutputVector* m_lastOutputs { nullptr };
+
+public:
+    void init() override;
+    void reinit() override;
+
+    void addCollisionModel (core::CollisionModel *cm) override;
+
+    /**
+      *Unuseful methods because all is done in beginNarrowPhase
+      */
+    void addCollisionPair (const std::pair<core::CollisionModel*, core::CollisionModel*>& ) override {}
+    void addCollisionPairs (const helper::vector<std::pair<core::CollisionModel*, core::CollisionModel*> >&) override {}
+
+    void beginBroadPhase() override
+    {
+        core::collision::BroadPhaseDetection::beginBroadPhase();
+        m_collisionModels.clear();
+    }
+
+    void beginNarrowPhase() override;
+
+    inline bool needsDeepBoundingTree()const override {return false;}
+};
+
+} // namespace sofa::component::collision
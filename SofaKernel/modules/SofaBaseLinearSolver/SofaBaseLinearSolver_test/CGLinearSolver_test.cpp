@@ -0,0 +1,119 @@
+/******************************************************************************
+*                 SOFA, Simulation Open-Framework Architecture                *
+*                    (c) 2006 INRIA, USTL, UJF, CNRS, MGH                     *
+*                                                                             *
+* This program is free software; you can redistribute it and/or modify it     *
+* under the terms of the GNU Lesser General Public License as published by    *
+* the Free Software Foundation; either version 2.1 of the License, or (at     *
+* your option) any later version.                                             *
+*                                                                             *
+* This program is distributed in the hope that it will be useful, but WITHOUT *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License *
+* for more details.                                                           *
+*                                                                             *
+* You should have received a copy of the GNU Lesser General Public License    *
+* along with this program. If not, see <http://www.gnu.org/licenses/>.        *
+*******************************************************************************
+* Authors: The SOFA Team and external contributors (see Authors.txt)          *
+*                                                                             *
+* Contact information: contact@sofa-framework.org                             *
+******************************************************************************/
+#include <SofaTest/Sofa_test.h>
+#include <SofaTest/TestMessageHandler.h>
+
+#include <sofa/simulation/Simulation.h>
+#include <SofaSimulationGraph/DAGSimulation.h>
+#include <sofa/simulation/Node.h>
+
+#include <sofa/defaulttype/VecTypes.h>
+#include <sofa/core/behavior/MechanicalState.h>
+
+namespace sofa
+{
+
+/** The fused and parallel matrix-vector products of the matrix-free CGLinearSolver give the same trajectories
+as the visitor-by-visitor products, with or without a projective constraint in a mapped node.
+*/
+struct CGLinearSolver_test : public Sofa_test<>
+{
+    typedef core::behavior::MechanicalState<defaulttype::Vec3Types> MState;
+    typedef helper::vector<defaulttype::Vec3Types::VecCoord> Positions;
+
+    void onSetUp() override
+    {
+        sofa::simulation::setSimulation(new sofa::simulation::graph::DAGSimulation());
+    }
+
+    /// Positions of the grids and of a mapped child after a few steps
+    static Positions simulate(const std::string& sceneName, bool fused, bool parallel)
+    {
+        const std::string fileName = std::string(SOFABASELINEARSOLVER_TEST_SCENES_DIR) + "/" + sceneName;
+        simulation::Node::SPtr root = simulation::getSimulation()->load(fileName.c_str());
+        EXPECT_NE(root.get(), nullptr) << fileName;
+        if (!root) return Positions();
+
+        core::objectmodel::BaseObject* linearSolver = root->getObject("linearSolver");
+        EXPECT_NE(linearSolver, nullptr);
+        if (!linearSolver) return Positions();
+        linearSolver->findData("fusedOperations")->read(fused ? "1" : "0");
+        linearSolver->findData("parallelProduct")->read(parallel ? "1" : "0");
+
+        simulation::getSimulation()->init(root.get());
+        for (int i = 0; i < 10; ++i)
+        {
+            simulation::getSimulation()->animate(root.get(), 0.01);
+        }
+
+        Positions positions;
+        for (const char* path : { "grid0/dofs", "grid1/dofs", "grid1/surface/dofs" })
+        {
+            MState* mstate = nullptr;
+            root->get(mstate, path);
+            EXPECT_NE(mstate, nullptr) << path;
+            if (mstate) positions.push_back(mstate->read(core::ConstVecCoordId::position())->getValue());
+        }
+        simulation::getSimulation()->unload(root);
+        return positions;
+    }
+
+    void checkFusedOperations(const std::string& sceneName)
+    {
+        const Positions reference = simulate(sceneName, false, false);
+        ASSERT_EQ(reference.size(), 3u);
+
+        for (bool parallel : { false, true })
+        {
+            const Positions fused = simulate(sceneName, true, parallel);
+            ASSERT_EQ(fused.size(), reference.size());
+            for (std::size_t s = 0; s < reference.size(); ++s)
+            {
+                ASSERT_EQ(fused[s].size(), reference[s].size());
+                for (std::size_t i = 0; i < reference[s].size(); ++i)
+                {
+                    for (int c = 0; c < 3; ++c)
+                    {
+                        EXPECT_NEAR(fused[s][i][c], reference[s][i][c], 1e-9) << "parallel " << parallel << ", state " << s << ", point " << i;
+                    }
+                }
+            }
+        }
+
+        // the grids fell under the gravity
+        EXPECT_LT(reference[0][35][1], 1.99);
+    }
+};
+
+TEST_F(CGLinearSolver_test, fusedOperations)
+{
+    EXPECT_MSG_NOEMIT(Error);
+    checkFusedOperations("CGLinearSolverFusedOperations.scn");
+}
+
+TEST_F(CGLinearSolver_test, fusedOperationsWithMappedConstraint)
+{
+    EXPECT_MSG_NOEMIT(Error);
+    checkFusedOperations("CGLinearSolverFusedOperationsMappedConstraint.scn");
+}
+
+} // namespace sofa
@@ -0,0 +1,183 @@
+/******************************************************************************
+*                 SOFA, Simulation Open-Framework Architecture                *
+*                    (c) 2006 INRIA, USTL, UJF, CNRS, MGH                     *
+*                                                                             *
+* This program is free software; you can redistribute it and/or modify it     *
+* under the terms of the GNU Lesser General Public License as published by    *
+* the Free Software Foundation; either version 2.1 of the License, or (at     *
+* your option) any later version.                                             *
+*                                                                             *
+* This program is distributed in the hope that it will be useful, but WITHOUT *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License *
+* for more details.                                                           *
+*                                                                             *
+* You should have received a copy of the GNU Lesser General Public License    *
+* along with this program. If not, see <http://www.gnu.org/licenses/>.        *
+*******************************************************************************
+* Authors: The SOFA Team and external contributors (see Authors.txt)          *
+*                                                                             *
+* Contact information: contact@sofa-framework.org                             *
+******************************************************************************/
+#include <SofaBaseLinearSolver/CompressedRowSparseMatrix.h>
+#include <SofaBaseLinearSolver/FullVector.h>
+#include <sofa/simulation/DefaultTaskScheduler.h>
+
+#include <benchmark/benchmark.h>
+
+#include <thread>
+
+using namespace sofa;
+using namespace sofa::component::linearsolver;
+
+namespace
+{
+
+/// block matrix with the pattern of a hexahedral mesh of n^3 nodes (27 neighbours per node)
+template<class Bloc>
+void createGridMatrix(int n, CompressedRowSparseMatrix<Bloc>& A)
+{
+    typedef typename CompressedRowSparseMatrix<Bloc>::Real Real;
+    const int N = CompressedRowSparseMatrix<Bloc>::NL;
+    auto node = [n](int x, int y, int z) { return (z * n + y) * n + x; };
+
+    A.resizeBloc(n * n * n, n * n * n);
+    for (int z = 0; z < n; ++z)
+    for (int y = 0; y < n; ++y)
+    for (int x = 0; x < n; ++x)
+    {
+        for (int dz = -1; dz <= 1; ++dz)
+        for (int dy = -1; dy <= 1; ++dy)
+        for (int dx = -1; dx <= 1; ++dx)
+        {
+            if (x + dx < 0 || x + dx >= n || y + dy < 0 || y + dy >= n || z + dz < 0 || z + dz >= n) continue;
+            Bloc* b = A.wbloc(node(x, y, z), node(x + dx, y + dy, z + dz), true);
+            for (int r = 0; r < N; ++r)
+                for (int c = 0; c < N; ++c)
+                    (*b)[r][c] = Real(1 + r - c) / Real(1 + dx * dx + dy * dy + dz * dz);
+        }
+    }
+    A.compress();
+}
+
+template<class Bloc>
+struct Problem
+{
+    typedef CompressedRowSparseMatrix<Bloc> Matrix;
+    typedef typename Matrix::Real Real;
+    typedef defaulttype::Vec<Matrix::NL, Real> Deriv;
+
+    Matrix A;
+    FullVector<Real> x, y;
+    helper::vector<Deriv> vx, vy;
+
+    explicit Problem(int n)
+    {
+        createGridMatrix(n, A);
+        x.resize(A.colSize());
+        vx.resize(A.colBSize());
+        for (int i = 0; i < (int)A.colSize(); ++i)
+            vx[i / Matrix::NL][i % Matrix::NL] = x[i] = Real(i % 17) / Real(17);
+    }
+
+    void setCounters(benchmark::State& state) const
+    {
+        // bytes of the blocks, of the column indices and of the input and output vectors
+        const std::size_t bytes = A.getColsValue().size() * sizeof(Bloc) + A.getColsIndex().size() * sizeof(sofa::Index)
+                                + (A.colSize() + A.rowSize()) * sizeof(Real);
+        state.SetBytesProcessed(int64_t(state.iterations()) * int64_t(bytes));
+        state.counters["blocks"] = double(A.getColsValue().size());
+    }
+};
+
+/// generic templated product, through the vectors of Vec
+template<class Bloc>
+void BM_CRS_mul_generic(benchmark::State& state)
+{
+    Problem<Bloc> p(int(state.range(0)));
+    for (auto _ : state)
+    {
+        p.A.mul(p.vy, p.vx);
+        benchmark::DoNotOptimize(p.vy.data());
+    }
+    p.setCounters(state);
+}
+
+/// block-CSR kernels
+template<class Bloc>
+void BM_CRS_mul_kernels(benchmark::State& state)
+{
+    Problem<Bloc> p(int(state.range(0)));
+    state.SetLabel(CRSBlocKernels<Bloc>::instructionSet());
+    for (auto _ : state)
+    {
+        p.A.mul(p.y, p.x);
+        benchmark::DoNotOptimize(p.y.ptr());
+    }
+    p.setCounters(state);
+}
+
+template<class Bloc>
+void BM_CRS_mulTranspose_generic(benchmark::State& state)
+{
+    Problem<Bloc> p(int(state.range(0)));
+    for (auto _ : state)
+    {
+        p.vy.clear();
+        p.A.addMultTranspose(p.vy, p.vx);
+        benchmark::DoNotOptimize(p.vy.data());
+    }
+    p.setCounters(state);
+}
+
+template<class Bloc>
+void BM_CRS_mulTranspose_kernels(benchmark::State& state)
+{
+    Problem<Bloc> p(int(state.range(0)));
+    state.SetLabel(CRSBlocKernels<Bloc>::instructionSet());
+    for (auto _ : state)
+    {
+        p.y.clear();
+        p.A.addMultTranspose(p.y, p.x);
+        benchmark::DoNotOptimize(p.y.ptr());
+    }
+    p.setCounters(state);
+}
+
+/// block-CSR kernels on the rows split between the threads of the scheduler
+template<class Bloc>
+void BM_CRS_mul_parallel(benchmark::State& state)
+{
+    Problem<Bloc> p(int(state.range(0)));
+    simulation::TaskScheduler* scheduler = simulation::TaskScheduler::create(simulation::DefaultTaskScheduler::name());
+    scheduler->init(std::thread::hardware_concurrency());
+    state.SetLabel(std::to_string(scheduler->getThreadCount()) + " threads");
+    for (auto _ : state)
+    {
+        p.A.parallelMul(*scheduler, p.y, p.x);
+        benchmark::DoNotOptimize(p.y.ptr());
+    }
+    scheduler->stop();
+    p.setCounters(state);
+}
+
+typedef defaulttype::Mat<3,3,double> Mat3d;
+typedef defaulttype::Mat<6,6,double> Mat6d;
+typedef defaulttype::Mat<3,3,float> Mat3f;
+
+} // namespace
+
+BENCHMARK_TEMPLATE(BM_CRS_mul_generic, Mat3d)->Arg(10)->Arg(30);
+BENCHMARK_TEMPLATE(BM_CRS_mul_kernels, Mat3d)->Arg(10)->Arg(30);
+BENCHMARK_TEMPLATE(BM_CRS_mul_parallel, Mat3d)->Arg(10)->Arg(30)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_CRS_mulTranspose_generic, Mat3d)->Arg(10)->Arg(30);
+BENCHMARK_TEMPLATE(BM_CRS_mulTranspose_kernels, Mat3d)->Arg(10)->Arg(30);
+BENCHMARK_TEMPLATE(BM_CRS_mul_generic, Mat3f)->Arg(30);
+BENCHMARK_TEMPLATE(BM_CRS_mul_kernels, Mat3f)->Arg(30);
+BENCHMARK_TEMPLATE(BM_CRS_mul_generic, Mat6d)->Arg(10)->Arg(20);
+BENCHMARK_TEMPLATE(BM_CRS_mul_kernels, Mat6d)->Arg(10)->Arg(20);
+BENCHMARK_TEMPLATE(BM_CRS_mul_parallel, Mat6d)->Arg(10)->Arg(20)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_CRS_mulTranspose_generic, Mat6d)->Arg(10)->Arg(20);
+BENCHMARK_TEMPLATE(BM_CRS_mulTranspose_kernels, Mat6d)->Arg(10)->Arg(20);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,147 @@
+/******************************************************************************
+*                 SOFA, Simulation Open-Framework Architecture                *
+*                    (c) 2006 INRIA, USTL, UJF, CNRS, MGH                     *
+*                                                                             *
+* This program is free software; you can redistribute it and/or modify it     *
+* under the terms of the GNU Lesser General Public License as published by    *
+* the Free Software Foundation; either version 2.1 of the License, or (at     *
+* your option) any later version.                                             *
+*                                                                             *
+* This program is distributed in the hope that it will be useful, but WITHOUT *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License *
+* for more details.                                                           *
+*                                                                             *
+* You should have received a copy of the GNU Lesser General Public License    *
+* along with this program. If not, see <http://www.gnu.org/licenses/>.        *
+*******************************************************************************
+* Authors: The SOFA Team and external contributors (see Authors.txt)          *
+*                                                                             *
+* Contact information: contact@sofa-framework.org                             *
+******************************************************************************/
+#include <SofaBaseLinearSolver/CompressedRowSparseMatrix.h>
+#include <SofaBaseLinearSolver/FullVector.h>
+#include <sofa/simulation/DefaultTaskScheduler.h>
+#include <sofa/helper/testing/BaseTest.h>
+
+#include <random>
+
+namespace sofa
+{
+
+using namespace component::linearsolver;
+
+/// The products of the block matrices with FullVector use the block-CSR kernels,
+/// they are compared to the generic products with vectors of Vec.
+template<class TBloc>
+class CompressedRowSparseMatrixKernels_test : public sofa::helper::testing::BaseTest
+{
+public:
+    typedef TBloc Bloc;
+    typedef CompressedRowSparseMatrix<Bloc> Matrix;
+    typedef typename Matrix::Real Real;
+    enum { N = Matrix::NL };
+    typedef defaulttype::Vec<N, Real> Deriv;
+    typedef helper::vector<Deriv> VecDeriv;
+
+    static_assert(CRSBlocKernels<Bloc>::enabled, "no block-CSR kernels for this block type");
+
+    Matrix A;
+    FullVector<Real> x, xt;
+    VecDeriv vx, vxt;
+
+    void onSetUp() override
+    {
+        std::mt19937 generator(42);
+        std::uniform_real_distribution<double> value(-1.0, 1.0);
+        std::uniform_int_distribution<int> column(0, nbBCols - 1);
+
+        // rectangular matrix with empty block rows and a varying number of blocks per row
+        A.resizeBloc(nbBRows, nbBCols);
+        for (int i = 0; i < nbBRows; ++i)
+        {
+            if (i % 7 == 3) continue;
+            const int nbBlocs = 1 + i % 5;
+            for (int k = 0; k < nbBlocs; ++k)
+            {
+                Bloc* b = A.wbloc(i, column(generator), true);
+                for (int r = 0; r < N; ++r)
+                    for (int c = 0; c < N; ++c)
+                        (*b)[r][c] = Real(value(generator));
+            }
+        }
+        A.compress();
+
+        x.resize(nbBCols * N);
+        vx.resize(nbBCols);
+        for (int j = 0; j < nbBCols * N; ++j)
+            vx[j / N][j % N] = x[j] = Real(value(generator));
+
+        xt.resize(nbBRows * N);
+        vxt.resize(nbBRows);
+        for (int i = 0; i < nbBRows * N; ++i)
+            vxt[i / N][i % N] = xt[i] = Real(value(generator));
+    }
+
+    void checkEqual(const FullVector<Real>& y, const VecDeriv& expected)
+    {
+        ASSERT_EQ(y.size(), (typename FullVector<Real>::Index)(expected.size() * N));
+        for (std::size_t i = 0; i < expected.size(); ++i)
+            for (int k = 0; k < N; ++k)
+                EXPECT_NEAR(y[i * N + k], expected[i][k], tolerance) << "entry " << i * N + k;
+    }
+
+    static constexpr int nbBRows = 40;
+    static constexpr int nbBCols = 30;
+    const double tolerance = std::is_same_v<Real, float> ? 1e-5 : 1e-12;
+};
+
+typedef ::testing::Types<defaulttype::Mat3x3d, defaulttype::Mat<6,6,double>, defaulttype::Mat3x3f, defaulttype::Mat<6,6,float>> BlocTypes;
+TYPED_TEST_SUITE(CompressedRowSparseMatrixKernels_test, BlocTypes);
+
+TYPED_TEST(CompressedRowSparseMatrixKernels_test, mul)
+{
+    typename TestFixture::VecDeriv expected;
+    this->A.mul(expected, this->vx);
+
+    FullVector<typename TestFixture::Real> y;
+    this->A.mul(y, this->x);
+    this->checkEqual(y, expected);
+}
+
+TYPED_TEST(CompressedRowSparseMatrixKernels_test, addMul)
+{
+    typename TestFixture::VecDeriv expected = this->vxt;
+    this->A.addMul(expected, this->vx);
+
+    FullVector<typename TestFixture::Real> y = this->xt;
+    this->A.addMul(y, this->x);
+    this->checkEqual(y, expected);
+}
+
+TYPED_TEST(CompressedRowSparseMatrixKernels_test, addMultTranspose)
+{
+    typename TestFixture::VecDeriv expected = this->vx;
+    this->A.addMultTranspose(expected, this->vxt);
+
+    FullVector<typename TestFixture::Real> y = this->x;
+    this->A.addMultTranspose(y, this->xt);
+    this->checkEqual(y, expected);
+}
+
+TYPED_TEST(CompressedRowSparseMatrixKernels_test, parallelMul)
+{
+    typename TestFixture::VecDeriv expected;
+    this->A.mul(expected, this->vx);
+
+    simulation::TaskScheduler* scheduler = simulation::TaskScheduler::create(simulation::DefaultTaskScheduler::name());
+    scheduler->init(4);
+
+    FullVector<typename TestFixture::Real> y;
+    this->A.parallelMul(*scheduler, y, this->x, 3);
+    scheduler->stop();
+
+    this->checkEqual(y, expected);
+}
+
+} // namespace sofa
@@ -0,0 +1,194 @@
+/******************************************************************************
+*                 SOFA, Simulation Open-Framework Architecture                *
+*                    (c) 2006 INRIA, USTL, UJF, CNRS, MGH                     *
+*                                                                             *
+* This program is free software; you can redistribute it and/or modify it     *
+* under the terms of the GNU Lesser General Public License as published by    *
+* the Free Software Foundation; either version 2.1 of the License, or (at     *
+* your option) any later version.                                             *
+*                                                                             *
+* This program is distributed in the hope that it will be useful, but WITHOUT *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License *
+* for more details.                                                           *
+*                                                                             *
+* You should have received a copy of the GNU Lesser General Public License    *
+* along with this program. If not, see <http://www.gnu.org/licenses/>.        *
+*******************************************************************************
+* Authors: The SOFA Team and external contributors (see Authors.txt)          *
+*                                                                             *
+* Contact information: contact@sofa-framework.org                             *
+******************************************************************************/
+#include <SofaBaseLinearSolver/CompressedRowSparseMatrix.h>
+#include <SofaBaseTopology/TetrahedronSetTopologyModifier.h>
+#include <SofaSimulationGraph/DAGSimulation.h>
+#include <sofa/simulation/Node.h>
+#include <sofa/core/behavior/LinearSolver.h>
+#include <sofa/helper/testing/BaseTest.h>
+#include <sofa/helper/testing/TestMessageHandler.h>
+
+namespace sofa
+{
+
+using namespace component::linearsolver;
+
+/// The assemblies replaying the recorded positions of the blocks must give the same matrices
+/// as the assemblies searching the blocks.
+class CompressedRowSparseMatrixPattern_test : public sofa::helper::testing::BaseTest
+{
+public:
+    typedef CompressedRowSparseMatrix<defaulttype::Mat3x3d> Matrix;
+
+    Matrix cached, reference;
+
+    void onSetUp() override
+    {
+        cached.setPatternCache(true);
+    }
+
+    /// Chain of 3x3 blocks with a scalar coupling, optionally with an additional block
+    static void assemble(Matrix& m, Matrix::Index nbNodes, double step, bool extraBloc)
+    {
+        m.resize(3 * nbNodes, 3 * nbNodes);
+        m.clear();
+        for (Matrix::Index n = 0; n + 1 < nbNodes; ++n)
+        {
+            defaulttype::Mat3x3d k;
+            for (int r = 0; r < 3; ++r)
+                for (int c = 0; c < 3; ++c)
+                    k[r][c] = step + n + 0.1 * r - 0.01 * c;
+            m.add(3 * n, 3 * n, k);
+            m.add(3 * n, 3 * n + 3, -k);
+            m.add(3 * n + 3, 3 * n, -k);
+            m.add(3 * n + 3, 3 * n + 3, k);
+            m.add(3 * n + 1, 3 * n + 5, step);
+        }
+        if (extraBloc)
+            m.add(0, 3 * nbNodes - 1, step);
+        m.compress();
+    }
+
+    void checkEqual()
+    {
+        ASSERT_EQ(cached.rowSize(), reference.rowSize());
+        for (Matrix::Index i = 0; i < reference.rowSize(); ++i)
+            for (Matrix::Index j = 0; j < reference.colSize(); ++j)
+                ASSERT_EQ(cached.element(i, j), reference.element(i, j)) << i << " " << j;
+    }
+
+    void assembleBoth(Matrix::Index nbNodes, double step, bool extraBloc)
+    {
+        assemble(cached, nbNodes, step, extraBloc);
+        assemble(reference, nbNodes, step, extraBloc);
+        checkEqual();
+    }
+};
+
+TEST_F(CompressedRowSparseMatrixPattern_test, replay)
+{
+    // the blocks are created, then their positions are recorded
+    assembleBoth(10, 1, false);
+    EXPECT_FALSE(cached.isPatternReplayed());
+    assembleBoth(10, 2, false);
+    EXPECT_FALSE(cached.isPatternReplayed());
+
+    for (int step = 3; step < 6; ++step)
+    {
+        assembleBoth(10, step, false);
+        EXPECT_TRUE(cached.isPatternReplayed());
+    }
+}
+
+TEST_F(CompressedRowSparseMatrixPattern_test, changedPattern)
+{
+    for (int step = 0; step < 3; ++step)
+        assembleBoth(10, step, false);
+    ASSERT_TRUE(cached.isPatternReplayed());
+
+    // a new block falls back to the search
+    assembleBoth(10, 3, true);
+    EXPECT_FALSE(cached.isPatternReplayed());
+    assembleBoth(10, 4, true);
+    assembleBoth(10, 5, true);
+    EXPECT_TRUE(cached.isPatternReplayed());
+
+    // an assembly writing only the first recorded blocks is still replayed
+    assembleBoth(10, 6, false);
+    EXPECT_TRUE(cached.isPatternReplayed());
+
+    // a new size wipes the structure
+    assembleBoth(12, 8, false);
+    EXPECT_FALSE(cached.isPatternReplayed());
+    assembleBoth(12, 9, false);
+    assembleBoth(12, 10, false);
+    EXPECT_TRUE(cached.isPatternReplayed());
+}
+
+TEST_F(CompressedRowSparseMatrixPattern_test, resetPattern)
+{
+    for (int step = 0; step < 3; ++step)
+        assembleBoth(10, step, true);
+    ASSERT_TRUE(cached.isPatternReplayed());
+
+    // the block which is not written anymore stays in the structure, until it is reset
+    assembleBoth(10, 3, false);
+    const std::size_t nbBlocs = reference.getColsValue().size();
+    EXPECT_EQ(cached.getColsValue().size(), nbBlocs + 1);
+
+    cached.resetPattern();
+    assembleBoth(10, 4, false);
+    EXPECT_EQ(cached.getColsValue().size(), nbBlocs);
+    assembleBoth(10, 5, false);
+    assembleBoth(10, 6, false);
+    EXPECT_TRUE(cached.isPatternReplayed());
+}
+
+/// The structure kept by the pattern cache of the system matrix follows the topological changes
+class MatrixLinearSolverPattern_test : public sofa::helper::testing::BaseTest
+{
+public:
+    typedef CompressedRowSparseMatrix<defaulttype::Mat3x3d> Matrix;
+
+    void onSetUp() override
+    {
+        sofa::simulation::setSimulation(new sofa::simulation::graph::DAGSimulation());
+    }
+};
+
+TEST_F(MatrixLinearSolverPattern_test, removedElement)
+{
+    EXPECT_MSG_NOEMIT(Error);
+
+    const std::string fileName = std::string(SOFABASELINEARSOLVER_TEST_SCENES_DIR) + "/CachedPatternTopologyChange.scn";
+    simulation::Node::SPtr root = simulation::getSimulation()->load(fileName.c_str());
+    ASSERT_NE(root.get(), nullptr) << fileName;
+    simulation::getSimulation()->init(root.get());
+
+    core::behavior::LinearSolver* linearSolver = dynamic_cast<core::behavior::LinearSolver*>(root->getObject("linearSolver"));
+    component::topology::TetrahedronSetTopologyModifier* modifier = nullptr;
+    root->get(modifier);
+    ASSERT_NE(linearSolver, nullptr);
+    ASSERT_NE(modifier, nullptr);
+
+    // the blocks are created, their positions recorded, then replayed
+    for (int i = 0; i < 3; ++i)
+        simulation::getSimulation()->animate(root.get(), 0.01);
+    Matrix* matrix = dynamic_cast<Matrix*>(linearSolver->getSystemBaseMatrix());
+    ASSERT_NE(matrix, nullptr);
+    EXPECT_TRUE(matrix->isPatternReplayed());
+    // the nodes of each tetrahedron are coupled
+    EXPECT_EQ(matrix->getColsValue().size(), 23u);
+
+    // the blocks coupling the last node with the others are not kept, the isolated node keeps its mass
+    modifier->removeTetrahedra({ 1 }, false);
+    simulation::getSimulation()->animate(root.get(), 0.01);
+    EXPECT_EQ(matrix->getColsValue().size(), 17u);
+
+    for (int i = 0; i < 2; ++i)
+        simulation::getSimulation()->animate(root.get(), 0.01);
+    EXPECT_TRUE(matrix->isPatternReplayed());
+
+    simulation::getSimulation()->unload(root);
+}
+
+} // namespace sofa
@@ -26,6 +26,7 @@
 #include <SofaBaseLinearSolver/SparseMatrix.h>
 #include <SofaBaseLinearSolver/CompressedRowSparseMatrix.h>
 #include <sofa/core/ObjectFactory.h>
+#include <sofa/simulation/TaskScheduler.h>
 
 namespace sofa::component::linearsolver
 {
@@ -59,6 +60,81 @@ inline void CGLinearSolver<component::linearsolver::GraphScatteredMatrix,compone
 #endif
 }
 
+namespace
+{
+
+/// x += p*alpha, r -= q*alpha as MechanicalVMultiOpVisitor, and accumulates r.r in the same traversal
+class MechanicalVMultiOpDotVisitor : public simulation::MechanicalVMultiOpVisitor
+{
+public:
+    core::ConstMultiVecDerivId r;
+    SReal dot;
+
+    MechanicalVMultiOpDotVisitor(const core::ExecParams* params, const VMultiOp& ops, core::ConstMultiVecDerivId r)
+        : simulation::MechanicalVMultiOpVisitor(params, ops), r(r), dot(0)
+    {
+    }
+
+    Result fwdMechanicalState(VisitorContext* ctx, core::behavior::BaseMechanicalState* mm) override
+    {
+        Result res = simulation::MechanicalVMultiOpVisitor::fwdMechanicalState(ctx, mm);
+        dot += mm->vDot(this->params, r.getId(mm), r.getId(mm));
+        return res;
+    }
+
+    const char* getClassName() const override { return "MechanicalVMultiOpDotVisitor"; }
+    bool isThreadSafe() const override { return false; }
+};
+
+} // namespace
+
+template<> SOFA_SOFABASELINEARSOLVER_API
+SReal CGLinearSolver<component::linearsolver::GraphScatteredMatrix,component::linearsolver::GraphScatteredVector>::cgstep_product(const core::ExecParams* /*params*/, Matrix& M, Vector& p, Vector& q)
+{
+    if (!d_fusedOperations.getValue())
+    {
+        q = M*p;
+        return p.dot(q);
+    }
+    // first product of the solve: the graph may have changed since the previous one
+    M.collectForceFields();
+    return M.applyDot(q, p, d_parallelProduct.getValue() ? simulation::TaskScheduler::getInstance() : nullptr);
+}
+
+template<> SOFA_SOFABASELINEARSOLVER_API
+SReal CGLinearSolver<component::linearsolver::GraphScatteredMatrix,component::linearsolver::GraphScatteredVector>::cgstep_beta_product(const core::ExecParams* params, Matrix& M, Vector& p, Vector& r, Vector& q, SReal beta)
+{
+    if (!d_fusedOperations.getValue())
+    {
+        cgstep_beta(params, p,r,beta);
+        q = M*p;
+        return p.dot(q);
+    }
+    return M.applyDot(q, p, r, beta, d_parallelProduct.getValue() ? simulation::TaskScheduler::getInstance() : nullptr);
+}
+
+template<> SOFA_SOFABASELINEARSOLVER_API
+SReal CGLinearSolver<component::linearsolver::GraphScatteredMatrix,component::linearsolver::GraphScatteredVector>::cgstep_alpha_dot(const core::ExecParams* params, Vector& x, Vector& r, Vector& p, Vector& q, SReal alpha)
+{
+    if (!d_fusedOperations.getValue())
+    {
+        cgstep_alpha(params, x,r,p,q,alpha);
+        return r.dot(r);
+    }
+    typedef sofa::core::behavior::BaseMechanicalState::VMultiOp VMultiOp;
+    VMultiOp ops;
+    ops.resize(2);
+    ops[0].first = (MultiVecDerivId)x;
+    ops[0].second.push_back(std::make_pair((MultiVecDerivId)x,1.0));
+    ops[0].second.push_back(std::make_pair((MultiVecDerivId)p,alpha));
+    ops[1].first = (MultiVecDerivId)r;
+    ops[1].second.push_back(std::make_pair((MultiVecDerivId)r,1.0));
+    ops[1].second.push_back(std::make_pair((MultiVecDerivId)q,-alpha));
+    MechanicalVMultiOpDotVisitor visitor(params, ops, (MultiVecDerivId)r);
+    this->executeVisitor(&visitor);
+    return visitor.dot;
+}
+
 int CGLinearSolverClass = core::RegisterObject("Linear system solver using the conjugate gradient iterative algorithm")
         .add< CGLinearSolver< GraphScatteredMatrix, GraphScatteredVector > >(true)
         .add< CGLinearSolver< FullMatrix<double>, FullVector<double> > >()
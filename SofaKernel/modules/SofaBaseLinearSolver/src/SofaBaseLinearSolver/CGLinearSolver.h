@@ -44,6 +44,8 @@ public:
     Data<bool> f_warmStart; ///< Use previous solution as initial solution
     Data<bool> f_verbose; ///< Dump system state at each iteration
     Data<std::map < std::string, sofa::helper::vector<SReal> > > f_graph; ///< Graph of residuals at each iteration
+    Data<bool> d_fusedOperations; ///< Fuse the vector operations, the dot products and the matrix-vector product of the iterations in fewer traversals of the graph
+    Data<bool> d_parallelProduct; ///< Compute the force fields contributions of the different mechanical states to the matrix-vector product in parallel
 
 protected:
 
@@ -55,6 +57,15 @@ protected:
     /// This method is separated from the rest to be able to use custom/optimized versions depending on the types of vectors.
     /// It computes: x += p*alpha, r -= q*alpha
     inline void cgstep_alpha(const core::ExecParams* params, Vector& x, Vector& r, Vector& p, Vector& q, SReal alpha);
+    /// This method is separated from the rest to be able to use custom/optimized versions depending on the types of vectors.
+    /// It computes: q = M p, and returns p.q
+    SReal cgstep_product(const core::ExecParams* params, Matrix& M, Vector& p, Vector& q);
+    /// This method is separated from the rest to be able to use custom/optimized versions depending on the types of vectors.
+    /// It computes: p = p*beta + r, q = M p, and returns p.q
+    SReal cgstep_beta_product(const core::ExecParams* params, Matrix& M, Vector& p, Vector& r, Vector& q, SReal beta);
+    /// This method is separated from the rest to be able to use custom/optimized versions depending on the types of vectors.
+    /// It computes: x += p*alpha, r -= q*alpha, and returns r.r
+    SReal cgstep_alpha_dot(const core::ExecParams* params, Vector& x, Vector& r, Vector& p, Vector& q, SReal alpha);
 
     int timeStepCount;
     bool equilibriumReached;
@@ -78,6 +89,15 @@ inline void CGLinearSolver<component::linearsolver::GraphScatteredMatrix,compone
 template<>
 inline void CGLinearSolver<component::linearsolver::GraphScatteredMatrix,component::linearsolver::GraphScatteredVector>::cgstep_alpha(const core::ExecParams* params, Vector& x, Vector& r, Vector& p, Vector& q, SReal alpha);
 
+template<> SOFA_SOFABASELINEARSOLVER_API
+SReal CGLinearSolver<component::linearsolver::GraphScatteredMatrix,component::linearsolver::GraphScatteredVector>::cgstep_product(const core::ExecParams* params, Matrix& M, Vector& p, Vector& q);
+
+template<> SOFA_SOFABASELINEARSOLVER_API
+SReal CGLinearSolver<component::linearsolver::GraphScatteredMatrix,component::linearsolver::GraphScatteredVector>::cgstep_beta_product(const core::ExecParams* params, Matrix& M, Vector& p, Vector& r, Vector& q, SReal beta);
+
+template<> SOFA_SOFABASELINEARSOLVER_API
+SReal CGLinearSolver<component::linearsolver::GraphScatteredMatrix,component::linearsolver::GraphScatteredVector>::cgstep_alpha_dot(const core::ExecParams* params, Vector& x, Vector& r, Vector& p, Vector& q, SReal alpha);
+
 #if  !defined(SOFA_COMPONENT_LINEARSOLVER_CGLINEARSOLVER_CPP)
 extern template class SOFA_SOFABASELINEARSOLVER_API CGLinearSolver< GraphScatteredMatrix, GraphScatteredVector >;
 extern template class SOFA_SOFABASELINEARSOLVER_API CGLinearSolver< FullMatrix<double>, FullVector<double> >;
@@ -39,6 +39,8 @@ CGLinearSolver<TMatrix,TVector>::CGLinearSolver()
     , f_warmStart( initData(&f_warmStart,false,"warmStart","Use previous solution as initial solution") )
     , f_verbose( initData(&f_verbose,false,"verbose","Dump system state at each iteration") )
     , f_graph( initData(&f_graph,"graph","Graph of residuals at each iteration") )
+    , d_fusedOperations( initData(&d_fusedOperations,false,"fusedOperations","Fuse the vector operations, the dot products and the matrix-vector product of the iterations in fewer traversals of the graph") )
+    , d_parallelProduct( initData(&d_parallelProduct,false,"parallelProduct","Compute the force fields contributions of the different mechanical states to the matrix-vector product in parallel (requires fusedOperations)") )
 {
     f_graph.setWidget("graph");
     f_maxIter.setRequired(true);
@@ -115,7 +117,7 @@ void CGLinearSolver<TMatrix,TVector>::solve(Matrix& M, Vector& x, Vector& b)
     Vector& r = *vtmp.createTempVector();
 
     const bool verbose  = f_verbose.getValue();
-    double rho, rho_1=0, alpha, beta;
+    double rho, rho_1=0, rho_next=0, alpha, beta;
 
 
     msg_info_when(verbose) << "b = " << b ;
@@ -165,8 +167,8 @@ void CGLinearSolver<TMatrix,TVector>::solve(Matrix& M, Vector& x, Vector& b)
             }
 #endif
 
-            /// Compute p = r^2
-            rho = r.dot(r);
+            /// Compute p = r^2 (computed at the end of the previous step otherwise)
+            rho = (nb_iter==1) ? r.dot(r) : rho_next;
 
             /// Compute the error from the norm of ρ and b
             double normr = sqrt(rho);
@@ -211,33 +213,28 @@ void CGLinearSolver<TMatrix,TVector>::solve(Matrix& M, Vector& x, Vector& b)
             }
 
 
-            /// Compute the value of p, conjugate with x
+            /// Compute the value of p, conjugate with x,
+            /// the matrix-vector product : M p and the denominator : p M p
+            double den;
             if( nb_iter==1 )    // FIRST step
+            {
                 p = r;
+                den = cgstep_product(params, M,p,q);
+            }
             else                // ALL other steps
             {
                 beta = rho / rho_1;
 
                 /// Update p = p*beta + r;
-                cgstep_beta(params, p,r,beta);
+                den = cgstep_beta_product(params, M,p,r,q,beta);
             }
 
             if( verbose )
             {
                 msg_info() << "p : " << p;
-            }
-
-            /// Compute the matrix-vector product : M p
-            q = M*p;
-
-            if( verbose )
-            {
                 msg_info() << "q = M p : " << q;
             }
 
-            /// Compute the denominator : p M p
-            double den = p.dot(q);
-
             graph_den.push_back(den);
 
             if(den != 0.0)
@@ -281,8 +278,8 @@ void CGLinearSolver<TMatrix,TVector>::solve(Matrix& M, Vector& x, Vector& b)
                 /// Compute the coefficient α for the conjugate direction
                 alpha = rho/den;
 
-                /// End of the CG step : update x and r
-                cgstep_alpha(params, x,r,p,q,alpha);
+                /// End of the CG step : update x and r, and compute the next r^2
+                rho_next = cgstep_alpha_dot(params, x,r,p,q,alpha);
 
                 if( verbose )
                 {
@@ -363,4 +360,25 @@ inline void CGLinearSolver<TMatrix,TVector>::cgstep_alpha(const core::ExecParams
     r.peq(q,-alpha);
 }
 
+template<class TMatrix, class TVector>
+SReal CGLinearSolver<TMatrix,TVector>::cgstep_product(const core::ExecParams* /*params*/, Matrix& M, Vector& p, Vector& q)
+{
+    q = M*p;
+    return p.dot(q);
+}
+
+template<class TMatrix, class TVector>
+SReal CGLinearSolver<TMatrix,TVector>::cgstep_beta_product(const core::ExecParams* params, Matrix& M, Vector& p, Vector& r, Vector& q, SReal beta)
+{
+    cgstep_beta(params, p,r,beta);
+    return cgstep_product(params, M,p,q);
+}
+
+template<class TMatrix, class TVector>
+SReal CGLinearSolver<TMatrix,TVector>::cgstep_alpha_dot(const core::ExecParams* params, Vector& x, Vector& r, Vector& p, Vector& q, SReal alpha)
+{
+    cgstep_alpha(params, x,r,p,q,alpha);
+    return r.dot(r);
+}
+
 } // namespace sofa::component::linearsolver
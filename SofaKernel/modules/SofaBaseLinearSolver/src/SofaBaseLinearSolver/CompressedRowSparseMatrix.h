@@ -26,6 +26,8 @@
 #include <SofaBaseLinearSolver/MatrixExpr.h>
 #include <SofaBaseLinearSolver/matrix_bloc_traits.h>
 #include <SofaBaseLinearSolver/FullMatrix.h>
+#include <SofaBaseLinearSolver/CompressedRowSparseMatrixKernels.h>
+#include <sofa/simulation/ParallelForEach.h>
 #include <sofa/helper/vector.h>
 #include <sofa/helper/rmath.h>
 #include <sofa/defaulttype/typeinfo/TypeInfo_Mat.h>
@@ -164,9 +166,22 @@ public :
     VecIndex oldRowBegin;
     VecIndex oldColsIndex;
     VecBloc  oldColsValue;
+
+    // positions of the blocks written between two calls to clear(), see setPatternCache()
+    struct PatternSlot
+    {
+        Index l,c; ///< indices of the block
+        Index id;  ///< position of the block in colsValue, or -1 if it was not found
+    };
+    enum PatternState { PATTERN_NONE, PATTERN_RECORD, PATTERN_REPLAY };
+    bool patternCache;                        ///< true if the positions of the written blocks are recorded and replayed
+    PatternState patternState;                ///< use of patternSlots by the writes since the last clear()
+    helper::vector<PatternSlot> patternSlots; ///< blocks written during the recorded assembly, in order
+    std::size_t patternPos;                   ///< number of writes since the last clear()
 public:
     CompressedRowSparseMatrix()
         : nRow(0), nCol(0), nBlocRow(0), nBlocCol(0), compressed(true)
+        , patternCache(false), patternState(PATTERN_NONE), patternPos(0)
     {
     }
 
@@ -174,6 +189,7 @@ public:
         : nRow(nbRow), nCol(nbCol),
           nBlocRow((nbRow + NL-1) / NL), nBlocCol((nbCol + NC-1) / NC),
           compressed(true)
+        , patternCache(false), patternState(PATTERN_NONE), patternPos(0)
     {
     }
 
@@ -200,15 +216,41 @@ public:
     const VecIndex& getColsIndex() const { return colsIndex; }
     const VecBloc& getColsValue() const { return colsValue; }
 
+    /// Keep the structure of the matrix in clear() and record the positions of the blocks written by
+    /// the next assembly. The following assemblies writing the same blocks in the same order then
+    /// access them directly instead of searching them. Any other write, block creation or change of
+    /// structure falls back to the search and a new recording.
+    void setPatternCache(bool enable)
+    {
+        if (patternCache == enable) return;
+        patternCache = enable;
+        invalidatePattern();
+    }
+
+    bool getPatternCache() const { return patternCache; }
+
+    /// Forget the structure kept by the pattern cache, and the recorded positions: the next assembly builds
+    /// the structure again, without the blocks which are not written anymore (e.g. after a topological change)
+    void resetPattern()
+    {
+        rowIndex.clear();
+        rowBegin.clear();
+        colsIndex.clear();
+        colsValue.clear();
+        compressed = true;
+        btemp.clear();
+        invalidatePattern();
+    }
+
+    /// \returns true if the writes since the last clear() used the recorded positions
+    bool isPatternReplayed() const { return patternState == PATTERN_REPLAY; }
+
     void resizeBloc(Index nbBRow, Index nbBCol)
     {
         if (nBlocRow == nbBRow && nBlocRow == nbBCol)
         {
             // just clear the matrix
-            for (Index i=0; i < (Index)colsValue.size(); ++i)
-                traits::clear(colsValue[i]);
-            compressed = colsValue.empty();
-            btemp.clear();
+            clear();
         }
         else
         {
@@ -225,12 +267,14 @@ public:
             colsValue.clear();
             compressed = true;
             btemp.clear();
+            invalidatePattern();
         }
     }
 
     void compress() override
     {
         if (compressed && btemp.empty()) return;
+        invalidatePattern();
         if (!btemp.empty())
         {
             dmsg_info_when(EMIT_EXTRA_MESSAGE)
@@ -381,6 +425,10 @@ public:
         colsIndex.swap(m.colsIndex);
         colsValue.swap(m.colsValue);
         btemp.swap(m.btemp);
+        std::swap(patternCache, m.patternCache);
+        std::swap(patternState, m.patternState);
+        patternSlots.swap(m.patternSlots);
+        std::swap(patternPos, m.patternPos);
     }
 
     /// Make sure all rows have an entry even if they are empty
@@ -388,6 +436,7 @@ public:
     {
         compress();
         if (rowIndex.size() >= nRow) return;
+        invalidatePattern();
         oldRowIndex.swap(rowIndex);
         oldRowBegin.swap(rowBegin);
         rowIndex.resize(nRow);
@@ -401,7 +450,7 @@ public:
             for (; j<=oldRowIndex[i]; ++j)
                 rowBegin[j] = b;
         }
-        b = oldRowBegin[oldRowBegin.size()-1];
+        b = oldRowBegin.empty() ? 0 : oldRowBegin[oldRowBegin.size()-1];
         for (; j<=nRow; ++j)
             rowBegin[j] = b;
     }
@@ -428,6 +477,7 @@ public:
             if (b<e) ++ndiag;
         }
         if (ndiag == nRow) return;
+        invalidatePattern();
 
         oldRowIndex.swap(rowIndex);
         oldRowBegin.swap(rowBegin);
@@ -489,6 +539,7 @@ public:
     /// to call again with -1 as base to undo it.
     void shiftIndices(Index base)
     {
+        invalidatePattern();
         for (Index i=0; i<rowIndex.size(); ++i)
             rowIndex[i] += base;
         for (Index i=0; i<rowBegin.size(); ++i)
@@ -546,6 +597,7 @@ public:
         colsValue.clear();
         compressed = true;
         btemp.clear();
+        invalidatePattern();
         rowIndex.reserve(M.rowIndex.size());
         rowBegin.reserve(M.rowBegin.size());
         colsIndex.reserve(M.colsIndex.size());
@@ -640,6 +692,20 @@ public:
 
     Bloc* wbloc(Index i, Index j, bool create = false)
     {
+        if (patternState == PATTERN_REPLAY)
+        {
+            if (patternPos < patternSlots.size())
+            {
+                const PatternSlot& slot = patternSlots[patternPos];
+                if (slot.l == i && slot.c == j && (slot.id >= 0 || !create))
+                {
+                    ++patternPos;
+                    return (slot.id >= 0) ? &colsValue[slot.id] : nullptr;
+                }
+            }
+            // not the recorded assembly anymore
+            patternState = PATTERN_NONE;
+        }
         Index rowId = i * (Index)rowIndex.size() / nBlocRow;
         if (sortedFind(rowIndex, i, rowId))
         {
@@ -651,9 +717,17 @@ public:
                 dmsg_info_when(EMIT_EXTRA_MESSAGE)
                         << "("<<rowBSize()<<"*"<<NL<<","<<colBSize()<<"*"<<NC<<"): bloc("<<i<<","<<j<<") found at "<<colId<<" (line "<<rowId<<")." ;
 
+                if (patternState == PATTERN_RECORD)
+                    recordPattern(i, j, colId);
                 return &colsValue[colId];
             }
         }
+        if (patternState == PATTERN_RECORD)
+        {
+            // a new block changes the structure: the positions are recorded again after the next clear()
+            if (create) patternState = PATTERN_NONE;
+            else recordPattern(i, j, -1);
+        }
         if (create)
         {
             if (btemp.empty() || btemp.back().l != i || btemp.back().c != j)
@@ -748,6 +822,11 @@ public:
         traits::v(*wbloc(i,j,true), bi, bj) += (Real)v;
     }
 
+    void add(Index i, Index j, const defaulttype::Mat3x3d& m) override { addMat(i, j, m); }
+    void add(Index i, Index j, const defaulttype::Mat3x3f& m) override { addMat(i, j, m); }
+    void add(Index i, Index j, const defaulttype::Mat2x2d& m) override { addMat(i, j, m); }
+    void add(Index i, Index j, const defaulttype::Mat2x2f& m) override { addMat(i, j, m); }
+
     void clear(Index i, Index j) override
     {
         dmsg_info_when(EMIT_EXTRA_MESSAGE)
@@ -870,8 +949,17 @@ public:
     {
         for (Index i=0; i < (Index)colsValue.size(); ++i)
             traits::clear(colsValue[i]);
-        compressed = colsValue.empty();
         btemp.clear();
+        if (patternCache)
+        {
+            // keep the structure, including the blocks which stay empty, for the next assembly
+            compressed = true;
+            restartPattern();
+        }
+        else
+        {
+            compressed = colsValue.empty();
+        }
     }
 
     /// @name Get information about the content and structure of this matrix (diagonal, band, sparse, full, block size, ...)
@@ -903,6 +991,57 @@ public:
 
     /// @}
 
+protected:
+    /// Forget the recorded positions, after a change of the structure
+    void invalidatePattern()
+    {
+        patternState = PATTERN_NONE;
+        patternSlots.clear();
+        patternPos = 0;
+    }
+
+    /// Start a new assembly: replay the positions of the previous one if it was entirely found in
+    /// the structure, otherwise record them again
+    void restartPattern()
+    {
+        if (patternPos == 0 && patternState != PATTERN_NONE) return; // nothing written since the last clear()
+        if (patternState == PATTERN_NONE)
+        {
+            patternSlots.clear();
+            // the blocks are created in btemp until the first compression
+            patternState = colsValue.empty() ? PATTERN_NONE : PATTERN_RECORD;
+        }
+        else
+        {
+            patternState = PATTERN_REPLAY;
+        }
+        patternPos = 0;
+    }
+
+    void recordPattern(Index i, Index j, Index colId)
+    {
+        patternSlots.push_back({i, j, colId});
+        ++patternPos;
+    }
+
+    /// Add a small matrix in a single block access when it matches a block of this matrix
+    template<sofa::Size N, class R>
+    void addMat(Index i, Index j, const defaulttype::Mat<N,N,R>& m)
+    {
+        if ((sofa::Size)NL == N && (sofa::Size)NC == N && i % N == 0 && j % N == 0)
+        {
+            Bloc& b = *wbloc(i / N, j / N, true);
+            for (Index bi = 0; bi < (Index)N; ++bi)
+                for (Index bj = 0; bj < (Index)N; ++bj)
+                    traits::v(b, bi, bj) += (Real)m[bi][bj];
+        }
+        else
+        {
+            defaulttype::BaseMatrix::add(i, j, m);
+        }
+    }
+
+public:
     /// @name Virtual iterator classes and methods
     /// @{
 
@@ -1251,6 +1390,22 @@ protected:
     template<class Vec> static void vresize(Vec& vec, Index /*blockSize*/, Index totalSize) { vec.resize( totalSize ); }
     template<class Vec> static void vresize(helper::vector<Vec>&vec, Index blockSize, Index /*totalSize*/) { vec.resize( blockSize ); }
 
+    /// resize the result of res += this * vec, FullVector::resize clears the values even if the size does not change
+    template<class Vec> static void vresizeAdd(Vec& vec, Index blockSize, Index totalSize) { vresize( vec, blockSize, totalSize ); }
+    template<class Real2> static void vresizeAdd(FullVector<Real2>& vec, Index /*blockSize*/, Index totalSize) { if (vec.size() != totalSize) vec.resize( totalSize ); }
+
+    /// the products with dense vectors of the same real type use the block-CSR kernels when they exist for the block type
+    template<class Real2, class V1, class V2>
+    static constexpr bool useBlocKernels = CRSBlocKernels<Bloc>::enabled && std::is_same_v<Real2, Real>
+                                           && std::is_same_v<V1, FullVector<Real> > && std::is_same_v<V2, FullVector<Real> >;
+
+    /// y (+)= this * x for the non-empty block rows [xiBegin,xiEnd) using the block-CSR kernels
+    template<bool Add>
+    void blocKernelsMul(const Real* x, Real* y, sofa::Index xiBegin, sofa::Index xiEnd) const
+    {
+        CRSBlocKernels<Bloc>::template mul<Add>(rowIndex.data(), rowBegin.data(), colsIndex.data(), colsValue.data(), xiBegin, xiEnd, x, y);
+    }
+
 
 
       /** Product of the matrix with a templated vector res = this * vec*/
@@ -1261,6 +1416,11 @@ protected:
 
           ((Matrix*)this)->compress();
           vresize( res, rowBSize(), rowSize() );
+          if constexpr (useBlocKernels<Real2, V1, V2>)
+          {
+              blocKernelsMul<false>(vec.ptr(), res.ptr(), 0, (sofa::Index)rowIndex.size());
+              return;
+          }
           for (Index xi = 0; xi < (Index)rowIndex.size(); ++xi)  // for each non-empty block row
           {
               defaulttype::Vec<NL,Real2> r;  // local block-sized vector to accumulate the product of the block row  with the large vector
@@ -1297,7 +1457,12 @@ protected:
           assert( vec.size()%bColSize() == 0 ); // vec.size() must be a multiple of block size.
 
           ((Matrix*)this)->compress();
-          vresize( res, rowBSize(), rowSize() );
+          vresizeAdd( res, rowBSize(), rowSize() );
+          if constexpr (useBlocKernels<Real2, V1, V2>)
+          {
+              blocKernelsMul<true>(vec.ptr(), res.ptr(), 0, (sofa::Index)rowIndex.size());
+              return;
+          }
           for (Index xi = 0; xi < (Index)rowIndex.size(); ++xi)  // for each non-empty block row
           {
               defaulttype::Vec<NL,Real2> r;  // local block-sized vector to accumulate the product of the block row  with the large vector
@@ -1334,7 +1499,7 @@ protected:
           assert( vec.size() == NC ); // vec.size() must have the block size.
 
           ((Matrix*)this)->compress();
-          vresize( res, rowBSize(), rowSize() );
+          vresizeAdd( res, rowBSize(), rowSize() );
           for (Index xi = 0; xi < (Index)rowIndex.size(); ++xi)  // for each non-empty block row
           {
               defaulttype::Vec<NL,Real2> r;  // local block-sized vector to accumulate the product of the block row  with the large vector
@@ -1364,7 +1529,13 @@ protected:
           assert( vec.size()%bRowSize() == 0 ); // vec.size() must be a multiple of block size.
 
           ((Matrix*)this)->compress();
-          vresize( res, colBSize(), colSize() );
+          vresizeAdd( res, colBSize(), colSize() );
+          if constexpr (useBlocKernels<Real2, V1, V2>)
+          {
+              CRSBlocKernels<Bloc>::mulTranspose(rowIndex.data(), rowBegin.data(), colsIndex.data(), colsValue.data(),
+                                                 sofa::Index(0), (sofa::Index)rowIndex.size(), vec.ptr(), res.ptr());
+              return;
+          }
           for (Index xi = 0; xi < rowIndex.size(); ++xi) // for each non-empty block row (i.e. column of the transpose)
           {
               // copy the corresponding chunk of the input to a local vector
@@ -1536,6 +1707,32 @@ public:
     }
 
 
+    /// equal result = this * v, the non-empty block rows being split between the threads of the scheduler
+    /// The block-CSR kernels are used when they exist for the block and vector types, the sequential product otherwise.
+    /// @warning The block sizes must be compatible ie v.size() must be a multiple of block size.
+    template< typename V1, typename V2 >
+    void parallelMul( simulation::TaskScheduler& scheduler, V2& result, const V1& v, std::size_t grainSize = 0 ) const
+    {
+        if constexpr (useBlocKernels< Real, V2, V1 >)
+        {
+            assert( v.size()%bColSize() == 0 );
+
+            ((Matrix*)this)->compress();
+            vresize( result, rowBSize(), rowSize() );
+            const Real* x = v.ptr();
+            Real* y = result.ptr();
+            simulation::parallelForEachRange(scheduler, simulation::Range<sofa::Index>(0, (sofa::Index)rowIndex.size()), grainSize,
+                [this, x, y](const simulation::Range<sofa::Index>& range)
+                {
+                    blocKernelsMul<false>(x, y, range.start(), range.end());
+                });
+        }
+        else
+        {
+            mul(result, v);
+        }
+    }
+
     /// equal result += this^T * v
     /// @warning The block sizes must be compatible ie v.size() must be a multiple of block size.
     template< typename V1, typename V2 >
@@ -0,0 +1,354 @@
+/******************************************************************************
+*                 SOFA, Simulation Open-Framework Architecture                *
+*                    (c) 2006 INRIA, USTL, UJF, CNRS, MGH                     *
+*                                                                             *
+* This program is free software; you can redistribute it and/or modify it     *
+* under the terms of the GNU Lesser General Public License as published by    *
+* the Free Software Foundation; either version 2.1 of the License, or (at     *
+* your option) any later version.                                             *
+*                                                                             *
+* This program is distributed in the hope that it will be useful, but WITHOUT *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License *
+* for more details.                                                           *
+*                                                                             *
+* You should have received a copy of the GNU Lesser General Public License    *
+* along with this program. If not, see <http://www.gnu.org/licenses/>.        *
+*******************************************************************************
+* Authors: The SOFA Team and external contributors (see Authors.txt)          *
+*                                                                             *
+* Contact information: contact@sofa-framework.org                             *
+******************************************************************************/
+#pragma once
+#include <SofaBaseLinearSolver/config.h>
+
+#include <sofa/defaulttype/Mat.h>
+
+#include <type_traits>
+
+#if (defined(__AVX2__) && defined(__FMA__)) || defined(__AVX512F__)
+#include <immintrin.h>
+#endif
+
+#if defined(__AVX2__) && defined(__FMA__)
+#define SOFA_CRS_KERNELS_AVX2
+#endif
+#if defined(__AVX512F__)
+#define SOFA_CRS_KERNELS_AVX512
+#endif
+
+namespace sofa::component::linearsolver
+{
+
+/** Block-CSR kernels of the products of CompressedRowSparseMatrix with dense vectors.
+ *
+ *  The kernels work on the raw arrays of the compressed matrix and of the vectors. They are
+ *  provided for the square 3x3 and 6x6 blocks of the deformable and rigid mechanical systems:
+ *  the other block types keep the generic templated products of the matrix (enabled == false).
+ *  AVX2/FMA and AVX-512 versions are selected at compile time according to the instruction set
+ *  targeted by the compiler (see SOFA_VECTORIZE), with a scalar fallback.
+ */
+template<class TBloc>
+struct CRSBlocKernels
+{
+    static constexpr bool enabled = false;
+};
+
+namespace crskernels
+{
+
+#ifdef SOFA_CRS_KERNELS_AVX2
+inline double hsum(__m128d v)
+{
+    return _mm_cvtsd_f64(_mm_add_sd(v, _mm_unpackhi_pd(v, v)));
+}
+
+inline double hsum(__m256d v)
+{
+    return hsum(_mm_add_pd(_mm256_castpd256_pd128(v), _mm256_extractf128_pd(v, 1)));
+}
+
+inline float hsum(__m128 v)
+{
+    v = _mm_add_ps(v, _mm_movehl_ps(v, v));
+    return _mm_cvtss_f32(_mm_add_ss(v, _mm_shuffle_ps(v, v, 1)));
+}
+
+inline float hsum(__m256 v)
+{
+    return hsum(_mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1)));
+}
+#endif
+
+} // namespace crskernels
+
+template<sofa::Size N, class TReal>
+struct CRSBlocKernels< defaulttype::Mat<N, N, TReal> >
+{
+    typedef TReal Real;
+    typedef defaulttype::Mat<N, N, TReal> Bloc;
+
+    static constexpr bool enabled = (N == 3 || N == 6) && (std::is_same_v<Real, double> || std::is_same_v<Real, float>);
+
+    /// Instruction set used by the kernels of this block type
+    static const char* instructionSet()
+    {
+#ifdef SOFA_CRS_KERNELS_AVX512
+        if constexpr (N == 6 && std::is_same_v<Real, double>) return "AVX-512";
+#endif
+#ifdef SOFA_CRS_KERNELS_AVX2
+        return "AVX2";
+#else
+        return "scalar";
+#endif
+    }
+
+    /// y = A x (Add == false) or y += A x (Add == true) for the block rows [xiBegin,xiEnd) of A.
+    /// y is not modified for the block rows which are not stored in A.
+    template<bool Add, class Index>
+    static void mul(const Index* rowIndex, const Index* rowBegin, const Index* colsIndex, const Bloc* colsValue,
+                    Index xiBegin, Index xiEnd, const Real* x, Real* y)
+    {
+        for (Index xi = xiBegin; xi < xiEnd; ++xi)
+        {
+            Real r[N] = {};
+            rowProduct(colsValue + rowBegin[xi], colsIndex + rowBegin[xi], rowBegin[xi+1] - rowBegin[xi], x, r);
+
+            Real* yi = y + rowIndex[xi] * N;
+            for (sofa::Size i = 0; i < N; ++i)
+            {
+                if constexpr (Add) yi[i] += r[i];
+                else yi[i] = r[i];
+            }
+        }
+    }
+
+    /// y += A^T x for the block rows [xiBegin,xiEnd) of A
+    template<class Index>
+    static void mulTranspose(const Index* rowIndex, const Index* rowBegin, const Index* colsIndex, const Bloc* colsValue,
+                             Index xiBegin, Index xiEnd, const Real* x, Real* y)
+    {
+        for (Index xi = xiBegin; xi < xiEnd; ++xi)
+        {
+            columnProduct(colsValue + rowBegin[xi], colsIndex + rowBegin[xi], rowBegin[xi+1] - rowBegin[xi], x + rowIndex[xi] * N, y);
+        }
+    }
+
+protected:
+
+    /// r += sum_k b[k] * x[cols[k]]
+    template<class Index>
+    static void rowProduct(const Bloc* b, const Index* cols, Index n, const Real* x, Real* r)
+    {
+#ifdef SOFA_CRS_KERNELS_AVX512
+        if constexpr (N == 6 && std::is_same_v<Real, double>)
+        {
+            const __mmask8 mask = 0x3F;
+            __m512d acc[6];
+            for (auto& a : acc) a = _mm512_setzero_pd();
+            for (Index k = 0; k < n; ++k)
+            {
+                const double* bk = b[k].ptr();
+                const __m512d xk = _mm512_maskz_loadu_pd(mask, x + cols[k] * 6);
+                for (int i = 0; i < 6; ++i)
+                    acc[i] = _mm512_fmadd_pd(_mm512_maskz_loadu_pd(mask, bk + 6 * i), xk, acc[i]);
+            }
+            for (int i = 0; i < 6; ++i)
+                r[i] += _mm512_reduce_add_pd(acc[i]);
+            return;
+        }
+#endif
+#ifdef SOFA_CRS_KERNELS_AVX2
+        if constexpr (N == 3 && std::is_same_v<Real, double>)
+        {
+            const __m256i mask = _mm256_set_epi64x(0, -1, -1, -1);
+            __m256d a0 = _mm256_setzero_pd(), a1 = _mm256_setzero_pd(), a2 = _mm256_setzero_pd();
+            for (Index k = 0; k < n; ++k)
+            {
+                const double* bk = b[k].ptr();
+                const __m256d xk = _mm256_maskload_pd(x + cols[k] * 3, mask);
+                a0 = _mm256_fmadd_pd(_mm256_maskload_pd(bk    , mask), xk, a0);
+                a1 = _mm256_fmadd_pd(_mm256_maskload_pd(bk + 3, mask), xk, a1);
+                a2 = _mm256_fmadd_pd(_mm256_maskload_pd(bk + 6, mask), xk, a2);
+            }
+            r[0] += crskernels::hsum(a0);
+            r[1] += crskernels::hsum(a1);
+            r[2] += crskernels::hsum(a2);
+            return;
+        }
+        else if constexpr (N == 6 && std::is_same_v<Real, double>)
+        {
+            // each row of the block is split in 4+2 lanes
+            __m256d lo[6];
+            __m128d hi[6];
+            for (int i = 0; i < 6; ++i)
+            {
+                lo[i] = _mm256_setzero_pd();
+                hi[i] = _mm_setzero_pd();
+            }
+            for (Index k = 0; k < n; ++k)
+            {
+                const double* bk = b[k].ptr();
+                const double* xk = x + cols[k] * 6;
+                const __m256d xlo = _mm256_loadu_pd(xk);
+                const __m128d xhi = _mm_loadu_pd(xk + 4);
+                for (int i = 0; i < 6; ++i)
+                {
+                    lo[i] = _mm256_fmadd_pd(_mm256_loadu_pd(bk + 6 * i), xlo, lo[i]);
+                    hi[i] = _mm_fmadd_pd(_mm_loadu_pd(bk + 6 * i + 4), xhi, hi[i]);
+                }
+            }
+            for (int i = 0; i < 6; ++i)
+                r[i] += crskernels::hsum(_mm_add_pd(_mm_add_pd(_mm256_castpd256_pd128(lo[i]), _mm256_extractf128_pd(lo[i], 1)), hi[i]));
+            return;
+        }
+        else if constexpr (N == 3 && std::is_same_v<Real, float>)
+        {
+            const __m128i mask = _mm_set_epi32(0, -1, -1, -1);
+            __m128 a0 = _mm_setzero_ps(), a1 = _mm_setzero_ps(), a2 = _mm_setzero_ps();
+            for (Index k = 0; k < n; ++k)
+            {
+                const float* bk = b[k].ptr();
+                const __m128 xk = _mm_maskload_ps(x + cols[k] * 3, mask);
+                a0 = _mm_fmadd_ps(_mm_maskload_ps(bk    , mask), xk, a0);
+                a1 = _mm_fmadd_ps(_mm_maskload_ps(bk + 3, mask), xk, a1);
+                a2 = _mm_fmadd_ps(_mm_maskload_ps(bk + 6, mask), xk, a2);
+            }
+            r[0] += crskernels::hsum(a0);
+            r[1] += crskernels::hsum(a1);
+            r[2] += crskernels::hsum(a2);
+            return;
+        }
+        else if constexpr (N == 6 && std::is_same_v<Real, float>)
+        {
+            const __m256i mask = _mm256_set_epi32(0, 0, -1, -1, -1, -1, -1, -1);
+            __m256 acc[6];
+            for (auto& a : acc) a = _mm256_setzero_ps();
+            for (Index k = 0; k < n; ++k)
+            {
+                const float* bk = b[k].ptr();
+                const __m256 xk = _mm256_maskload_ps(x + cols[k] * 6, mask);
+                for (int i = 0; i < 6; ++i)
+                    acc[i] = _mm256_fmadd_ps(_mm256_maskload_ps(bk + 6 * i, mask), xk, acc[i]);
+            }
+            for (int i = 0; i < 6; ++i)
+                r[i] += crskernels::hsum(acc[i]);
+            return;
+        }
+#endif
+        // local copies: the compiler cannot assume that the output does not alias the input
+        Real acc[N] = {};
+        for (Index k = 0; k < n; ++k)
+        {
+            const Real* bk = b[k].ptr();
+            Real xk[N];
+            for (sofa::Size j = 0; j < N; ++j)
+                xk[j] = x[cols[k] * N + j];
+            for (sofa::Size i = 0; i < N; ++i)
+                for (sofa::Size j = 0; j < N; ++j)
+                    acc[i] += bk[i * N + j] * xk[j];
+        }
+        for (sofa::Size i = 0; i < N; ++i)
+            r[i] += acc[i];
+    }
+
+    /// y[cols[k]] += b[k]^T v for each block k of a row
+    /// The partial vectors are added to y with scalar instructions: the same chunks of y are updated
+    /// from consecutive rows and masked stores would prevent the store-to-load forwarding.
+    template<class Index>
+    static void columnProduct(const Bloc* b, const Index* cols, Index n, const Real* v, Real* y)
+    {
+#ifdef SOFA_CRS_KERNELS_AVX2
+        if constexpr (N == 3 && std::is_same_v<Real, double>)
+        {
+            const __m256i mask = _mm256_set_epi64x(0, -1, -1, -1);
+            const __m256d v0 = _mm256_set1_pd(v[0]), v1 = _mm256_set1_pd(v[1]), v2 = _mm256_set1_pd(v[2]);
+            for (Index k = 0; k < n; ++k)
+            {
+                const double* bk = b[k].ptr();
+                __m256d acc = _mm256_mul_pd(_mm256_maskload_pd(bk, mask), v0);
+                acc = _mm256_fmadd_pd(_mm256_maskload_pd(bk + 3, mask), v1, acc);
+                acc = _mm256_fmadd_pd(_mm256_maskload_pd(bk + 6, mask), v2, acc);
+                alignas(32) double t[4];
+                _mm256_store_pd(t, acc);
+                double* yk = y + cols[k] * 3;
+                yk[0] += t[0];
+                yk[1] += t[1];
+                yk[2] += t[2];
+            }
+            return;
+        }
+        else if constexpr (N == 6 && std::is_same_v<Real, double>)
+        {
+            for (Index k = 0; k < n; ++k)
+            {
+                const double* bk = b[k].ptr();
+                double* yk = y + cols[k] * 6;
+                __m256d lo = _mm256_loadu_pd(yk);
+                __m128d hi = _mm_loadu_pd(yk + 4);
+                for (int i = 0; i < 6; ++i)
+                {
+                    lo = _mm256_fmadd_pd(_mm256_loadu_pd(bk + 6 * i), _mm256_set1_pd(v[i]), lo);
+                    hi = _mm_fmadd_pd(_mm_loadu_pd(bk + 6 * i + 4), _mm_set1_pd(v[i]), hi);
+                }
+                _mm256_storeu_pd(yk, lo);
+                _mm_storeu_pd(yk + 4, hi);
+            }
+            return;
+        }
+        else if constexpr (N == 3 && std::is_same_v<Real, float>)
+        {
+            const __m128i mask = _mm_set_epi32(0, -1, -1, -1);
+            const __m128 v0 = _mm_set1_ps(v[0]), v1 = _mm_set1_ps(v[1]), v2 = _mm_set1_ps(v[2]);
+            for (Index k = 0; k < n; ++k)
+            {
+                const float* bk = b[k].ptr();
+                __m128 acc = _mm_mul_ps(_mm_maskload_ps(bk, mask), v0);
+                acc = _mm_fmadd_ps(_mm_maskload_ps(bk + 3, mask), v1, acc);
+                acc = _mm_fmadd_ps(_mm_maskload_ps(bk + 6, mask), v2, acc);
+                alignas(16) float t[4];
+                _mm_store_ps(t, acc);
+                float* yk = y + cols[k] * 3;
+                yk[0] += t[0];
+                yk[1] += t[1];
+                yk[2] += t[2];
+            }
+            return;
+        }
+        else if constexpr (N == 6 && std::is_same_v<Real, float>)
+        {
+            const __m256i mask = _mm256_set_epi32(0, 0, -1, -1, -1, -1, -1, -1);
+            for (Index k = 0; k < n; ++k)
+            {
+                const float* bk = b[k].ptr();
+                __m256 acc = _mm256_setzero_ps();
+                for (int i = 0; i < 6; ++i)
+                    acc = _mm256_fmadd_ps(_mm256_maskload_ps(bk + 6 * i, mask), _mm256_set1_ps(v[i]), acc);
+                alignas(32) float t[8];
+                _mm256_store_ps(t, acc);
+                float* yk = y + cols[k] * 6;
+                for (int j = 0; j < 6; ++j)
+                    yk[j] += t[j];
+            }
+            return;
+        }
+#endif
+        Real vi[N];
+        for (sofa::Size i = 0; i < N; ++i)
+            vi[i] = v[i];
+        for (Index k = 0; k < n; ++k)
+        {
+            const Real* bk = b[k].ptr();
+            Real acc[N] = {};
+            for (sofa::Size i = 0; i < N; ++i)
+                for (sofa::Size j = 0; j < N; ++j)
+                    acc[j] += bk[i * N + j] * vi[i];
+
+            Real* yk = y + cols[k] * N;
+            for (sofa::Size j = 0; j < N; ++j)
+                yk[j] += acc[j];
+        }
+    }
+};
+
+} // namespace sofa::component::linearsolver
@@ -22,6 +22,14 @@
 #include <SofaBaseLinearSolver/GraphScatteredTypes.h>
 
 #include <sofa/simulation/MechanicalOperations.h>
+#include <sofa/simulation/ParallelForEach.h>
+#include <sofa/simulation/Node.h>
+#include <sofa/core/behavior/BaseForceField.h>
+#include <sofa/core/behavior/BaseInteractionForceField.h>
+#include <sofa/core/behavior/BaseInteractionProjectiveConstraintSet.h>
+#include <sofa/core/BaseMapping.h>
+
+#include <map>
 
 
 namespace sofa::component::linearsolver
@@ -41,6 +49,208 @@ void GraphScatteredMatrix::apply(GraphScatteredVector& res, GraphScatteredVector
     parent->projectResponse(res);     // q is projected to the constrained space
 }
 
+namespace
+{
+
+using core::behavior::BaseMechanicalState;
+using core::behavior::BaseForceField;
+using simulation::Visitor;
+
+/// Collect the force fields reached by MechanicalAddMBKdxVisitor, and detect the configurations where the
+/// projective constraints cannot be applied while the forces are accumulated through the mappings
+class CollectForceFieldsVisitor : public simulation::MechanicalVisitor
+{
+public:
+    helper::vector< helper::vector<BaseForceField*> >& groups;
+    helper::vector<BaseForceField*>& interactions;
+    bool separateProjection;
+    std::map<BaseMechanicalState*, std::size_t> groupIndex;
+
+    CollectForceFieldsVisitor(const core::MechanicalParams* mparams, helper::vector< helper::vector<BaseForceField*> >& groups, helper::vector<BaseForceField*>& interactions)
+        : simulation::MechanicalVisitor(mparams), groups(groups), interactions(interactions), separateProjection(false)
+    {
+        groups.clear();
+        interactions.clear();
+    }
+
+    void add(BaseMechanicalState* mstate, BaseForceField* ff)
+    {
+        if (mstate == nullptr)
+        {
+            interactions.push_back(ff);
+            return;
+        }
+        auto it = groupIndex.find(mstate);
+        if (it == groupIndex.end())
+        {
+            it = groupIndex.emplace(mstate, groups.size()).first;
+            groups.emplace_back();
+        }
+        groups[it->second].push_back(ff);
+    }
+
+    Result fwdMechanicalMapping(simulation::Node* /*node*/, core::BaseMapping* map) override
+    {
+        if (map->getFrom().size() > 1) separateProjection = true;
+        return RESULT_CONTINUE;
+    }
+    Result fwdForceField(simulation::Node* /*node*/, BaseForceField* ff) override
+    {
+        add(ff->getContext()->getMechanicalState(), ff);
+        return RESULT_CONTINUE;
+    }
+    Result fwdInteractionForceField(simulation::Node* /*node*/, core::behavior::BaseInteractionForceField* ff) override
+    {
+        if (ff->getMechModel1() == ff->getMechModel2())
+            add(ff->getMechModel1(), ff);
+        else
+            interactions.push_back(ff);
+        return RESULT_CONTINUE;
+    }
+    Result fwdProjectiveConstraintSet(simulation::Node* node, core::behavior::BaseProjectiveConstraintSet* c) override
+    {
+        if (node->mechanicalState == nullptr || node->mechanicalMapping != nullptr
+            || dynamic_cast<core::behavior::BaseInteractionProjectiveConstraintSet*>(c) != nullptr)
+            separateProjection = true;
+        return RESULT_CONTINUE;
+    }
+
+    const char* getClassName() const override { return "CollectForceFieldsVisitor"; }
+    bool isThreadSafe() const override { return false; }
+};
+
+/// x = r + beta * x on the independent DOFs (when r is given), then the same as MechanicalPropagateDxAndResetForceVisitor
+class UpdatePropagateDxAndResetForceVisitor : public simulation::MechanicalPropagateDxAndResetForceVisitor
+{
+public:
+    core::MultiVecDerivId r;
+    SReal beta;
+    bool update;
+
+    UpdatePropagateDxAndResetForceVisitor(const core::MechanicalParams* mparams, core::MultiVecDerivId dx, core::MultiVecDerivId f, core::MultiVecDerivId r, SReal beta)
+        : simulation::MechanicalPropagateDxAndResetForceVisitor(mparams, dx, f, false), r(r), beta(beta), update(!r.isNull())
+    {
+    }
+
+    Result fwdMechanicalState(simulation::Node* node, BaseMechanicalState* mm) override
+    {
+        if (update)
+        {
+            if (beta == 0)
+                mm->vOp(this->params, dx.getId(mm), r.getId(mm));
+            else
+                mm->vOp(this->params, dx.getId(mm), r.getId(mm), dx.getId(mm), beta);
+        }
+        return simulation::MechanicalPropagateDxAndResetForceVisitor::fwdMechanicalState(node, mm);
+    }
+
+    const char* getClassName() const override { return "UpdatePropagateDxAndResetForceVisitor"; }
+};
+
+/// Same as MechanicalAddMBKdxVisitor (optionally without the force fields, already computed), followed by the
+/// projective constraints on the independent DOFs and the dot product dx.res
+class AddMBKdxProjectDotVisitor : public simulation::MechanicalAddMBKdxVisitor
+{
+public:
+    bool addForceFields;
+    bool project;
+    SReal dot;
+
+    AddMBKdxProjectDotVisitor(const core::MechanicalParams* mparams, core::MultiVecDerivId res, bool addForceFields, bool project)
+        : simulation::MechanicalAddMBKdxVisitor(mparams, res, true), addForceFields(addForceFields), project(project), dot(0)
+    {
+    }
+
+    Result fwdForceField(simulation::Node* node, BaseForceField* ff) override
+    {
+        if (!addForceFields) return RESULT_CONTINUE;
+        return simulation::MechanicalAddMBKdxVisitor::fwdForceField(node, ff);
+    }
+    void bwdProjectiveConstraintSet(simulation::Node* node, core::behavior::BaseProjectiveConstraintSet* c) override
+    {
+        // the independent DOFs are visited after the accumulation of all their mapped children
+        if (project && node->mechanicalMapping == nullptr)
+            c->projectResponse(mparams, res);
+    }
+    void bwdMechanicalState(simulation::Node* node, BaseMechanicalState* mm) override
+    {
+        simulation::MechanicalAddMBKdxVisitor::bwdMechanicalState(node, mm);
+        if (project)
+            dot += mm->vDot(this->params, mparams->dx().getId(mm), res.getId(mm));
+    }
+
+    const char* getClassName() const override { return "AddMBKdxProjectDotVisitor"; }
+    bool isThreadSafe() const override { return false; }
+};
+
+} // namespace
+
+void GraphScatteredMatrix::collectForceFields()
+{
+    CollectForceFieldsVisitor visitor(&parent->mparams, forceFieldGroups, interactionForceFields);
+    simulation::common::VisitorExecuteFunc executeVisitor(*parent->ctx);
+    executeVisitor(&visitor);
+    separateProjection = visitor.separateProjection;
+}
+
+SReal GraphScatteredMatrix::applyDot(GraphScatteredVector& res, GraphScatteredVector& x, simulation::TaskScheduler* scheduler)
+{
+    return fusedApplyDot(res, x, nullptr, 0, scheduler);
+}
+
+SReal GraphScatteredMatrix::applyDot(GraphScatteredVector& res, GraphScatteredVector& x, GraphScatteredVector& r, SReal beta, simulation::TaskScheduler* scheduler)
+{
+    return fusedApplyDot(res, x, &r, beta, scheduler);
+}
+
+SReal GraphScatteredMatrix::fusedApplyDot(GraphScatteredVector& res, GraphScatteredVector& x, GraphScatteredVector* r, SReal beta, simulation::TaskScheduler* scheduler)
+{
+    core::MultiVecDerivId dx = x;
+    core::MultiVecDerivId df = res;
+    if (dx.getDefaultId().isNull()) dx.setDefaultId(core::VecDerivId::dx());
+    if (df.getDefaultId().isNull()) df.setDefaultId(core::VecDerivId::dforce());
+
+    core::MechanicalParams& mp = parent->mparams;
+    mp.setDx(dx);
+    mp.setDf(df);
+    mp.setMFactor(mparams.mFactor());
+    mp.setBFactor(mparams.bFactor());
+    mp.setKFactor(mparams.kFactor());
+
+    simulation::common::VisitorExecuteFunc executeVisitor(*parent->ctx);
+
+    // x = r + beta x, propagated through the mappings, and df reset
+    executeVisitor(UpdatePropagateDxAndResetForceVisitor(&mp, dx, df, r ? core::MultiVecDerivId(*r) : core::MultiVecDerivId::null(), beta));
+
+    // the force fields write in the df of their own state: the groups are independent
+    const bool parallel = scheduler != nullptr && forceFieldGroups.size() > 1;
+    if (parallel)
+    {
+        core::MechanicalParams mpWithoutStiffness = mp;
+        mpWithoutStiffness.setKFactor(0);
+        auto addMBKdx = [&](BaseForceField* ff)
+        {
+            ff->addMBKdx(ff->isCompliance.getValue() ? &mpWithoutStiffness : &mp, df);
+        };
+        simulation::parallelForEach(*scheduler, simulation::Range<std::size_t>(0, forceFieldGroups.size()), 1, [&](std::size_t i)
+        {
+            for (BaseForceField* ff : forceFieldGroups[i]) addMBKdx(ff);
+        });
+        for (BaseForceField* ff : interactionForceFields) addMBKdx(ff);
+    }
+
+    // df accumulated through the mappings, projected and dotted with x
+    AddMBKdxProjectDotVisitor visitor(&mp, df, !parallel, !separateProjection);
+    executeVisitor(&visitor);
+    if (!separateProjection)
+        return visitor.dot;
+
+    parent->projectResponse(df);
+    SReal dot = 0;
+    executeVisitor(simulation::MechanicalVDotVisitor(&mp, dx, df, &dot));
+    return dot;
+}
+
 sofa::Size GraphScatteredMatrix::rowSize()
 {
     sofa::Size nbRow=0, nbCol=0;
@@ -25,6 +25,12 @@
 #include <sofa/simulation/fwd.h>
 #include <sofa/core/behavior/MultiVec.h>
 #include <sofa/core/MechanicalParams.h>
+#include <sofa/helper/vector.h>
+
+namespace sofa::simulation
+{
+class TaskScheduler;
+}
 
 namespace sofa::component::linearsolver
 {
@@ -58,6 +64,23 @@ public:
     }
     void apply(GraphScatteredVector& res, GraphScatteredVector& x);
 
+    /// @name Fused matrix-vector products
+    /// The products below fuse the vector update, the propagation, the force fields, the projection and the
+    /// dot product in as few traversals of the graph as possible. With a task scheduler, the force fields of
+    /// the different mechanical states are evaluated in parallel before the accumulation through the mappings.
+    /// @{
+
+    /// Collect the force fields of the graph used by the fused products. It must be called when the graph changes.
+    void collectForceFields();
+
+    /// res = this * x, and returns the dot product x.res
+    SReal applyDot(GraphScatteredVector& res, GraphScatteredVector& x, simulation::TaskScheduler* scheduler = nullptr);
+
+    /// x = r + beta * x, res = this * x, and returns the dot product x.res
+    SReal applyDot(GraphScatteredVector& res, GraphScatteredVector& x, GraphScatteredVector& r, SReal beta, simulation::TaskScheduler* scheduler = nullptr);
+
+    /// @}
+
 
     // compatibility with baseMatrix
     sofa::Size rowSize(); /// provides the number of rows of the Graph Scattered Matrix
@@ -65,6 +88,16 @@ public:
     sofa::Size colSize();  /// provides the number of columns of the Graph Scattered Matrix
 
     static const char* Name() { return "GraphScattered"; }
+
+protected:
+    SReal fusedApplyDot(GraphScatteredVector& res, GraphScatteredVector& x, GraphScatteredVector* r, SReal beta, simulation::TaskScheduler* scheduler);
+
+    /// force fields applied to a single mechanical state, grouped by state
+    helper::vector< helper::vector<core::behavior::BaseForceField*> > forceFieldGroups;
+    /// force fields between different mechanical states, evaluated sequentially
+    helper::vector<core::behavior::BaseForceField*> interactionForceFields;
+    /// the projective constraints cannot be applied during the accumulation through the mappings
+    bool separateProjection = true;
 };
 
 class SOFA_SOFABASELINEARSOLVER_API GraphScatteredVector : public sofa::core::behavior::MultiVecDeriv
@@ -171,6 +171,8 @@ public:
     typedef typename MatrixLinearSolverInternalData<Vector>::JMatrixType JMatrixType;
     typedef typename MatrixLinearSolverInternalData<Vector>::ResMatrixType ResMatrixType;
 
+    Data<bool> d_cachedPattern; ///< Record the positions of the blocks written by the assembly and write directly to them in the next assemblies, as long as the same blocks are written in the same order (compressed row sparse matrices only)
+
     MatrixLinearSolver();
     ~MatrixLinearSolver() override ;
 
@@ -320,10 +322,16 @@ protected:
 
     virtual MatrixInvertData * createInvertData();
 
+    /// Enable the pattern cache of the system matrix according to d_cachedPattern, and reset the structure it
+    /// keeps when the topologies or the size of the system changed since it was built
+    void updateMatrixPattern();
+
     class GroupData
     {
     public:
         Size systemSize;
+        Size patternSystemSize; ///< size of the system when the structure kept by the pattern cache was built
+        int patternTopologyRevision; ///< sum of the revisions of the topologies when the structure kept by the pattern cache was built
         bool needInvert;
         Matrix* systemMatrix;
         Vector* systemRHVector;
@@ -336,7 +344,7 @@ protected:
         DefaultMultiMatrixAccessor matrixAccessor;
 #endif
         GroupData()
-            : systemSize(0), needInvert(true), systemMatrix(nullptr), systemRHVector(nullptr), systemLHVector(nullptr), solutionVecId(core::MultiVecDerivId::null())
+            : systemSize(0), patternSystemSize(0), patternTopologyRevision(0), needInvert(true), systemMatrix(nullptr), systemRHVector(nullptr), systemLHVector(nullptr), solutionVecId(core::MultiVecDerivId::null())
         {}
         ~GroupData()
         {
@@ -21,13 +21,38 @@
 ******************************************************************************/
 #pragma once
 #include <SofaBaseLinearSolver/MatrixLinearSolver.h>
+#include <sofa/core/topology/BaseMeshTopology.h>
 
 namespace sofa::component::linearsolver {
 
 
+/// Only the compressed row sparse matrices can keep the positions of their blocks between assemblies
+template<class TMatrix>
+inline void setMatrixPatternCache(TMatrix* /*matrix*/, bool /*enable*/)
+{
+}
+
+template<class TBloc, class TVecBloc, class TVecIndex>
+inline void setMatrixPatternCache(CompressedRowSparseMatrix<TBloc,TVecBloc,TVecIndex>* matrix, bool enable)
+{
+    matrix->setPatternCache(enable);
+}
+
+template<class TMatrix>
+inline void resetMatrixPattern(TMatrix* /*matrix*/)
+{
+}
+
+template<class TBloc, class TVecBloc, class TVecIndex>
+inline void resetMatrixPattern(CompressedRowSparseMatrix<TBloc,TVecBloc,TVecIndex>* matrix)
+{
+    matrix->resetPattern();
+}
+
 template<class Matrix, class Vector>
 MatrixLinearSolver<Matrix,Vector>::MatrixLinearSolver()
     : Inherit()
+    , d_cachedPattern( initData(&d_cachedPattern, false, "cachedPattern", "Record the positions of the blocks written by the assembly and write directly to them in the next assemblies, as long as the same blocks are written in the same order (compressed row sparse matrices only)") )
     , currentGroup(&defaultGroup)
 {
     invertData = nullptr;
@@ -113,6 +138,7 @@ void MatrixLinearSolver<Matrix,Vector>::setSystemMBKMatrix(const core::Mechanica
 
         simulation::common::MechanicalOperations mops(mparams, this->getContext());
         if (!currentGroup->systemMatrix) currentGroup->systemMatrix = createMatrix();
+        updateMatrixPattern();
         currentGroup->matrixAccessor.setGlobalMatrix(currentGroup->systemMatrix);
         currentGroup->matrixAccessor.clear();
 
@@ -126,6 +152,27 @@ void MatrixLinearSolver<Matrix,Vector>::setSystemMBKMatrix(const core::Mechanica
 
 }
 
+template<class Matrix, class Vector>
+void MatrixLinearSolver<Matrix,Vector>::updateMatrixPattern()
+{
+    setMatrixPatternCache(currentGroup->systemMatrix, d_cachedPattern.getValue());
+    if (!d_cachedPattern.getValue()) return;
+
+    // the blocks of the removed elements would be kept in the structure, as empty blocks
+    helper::vector<core::topology::BaseMeshTopology*> topologies;
+    this->getContext()->template getObjects<core::topology::BaseMeshTopology>(&topologies, core::objectmodel::BaseContext::SearchDown);
+    int topologyRevision = 0;
+    for (const core::topology::BaseMeshTopology* topology : topologies)
+        topologyRevision += topology->getRevision();
+
+    if (topologyRevision != currentGroup->patternTopologyRevision || currentGroup->systemSize != currentGroup->patternSystemSize)
+    {
+        resetMatrixPattern(currentGroup->systemMatrix);
+        currentGroup->patternTopologyRevision = topologyRevision;
+        currentGroup->patternSystemSize = currentGroup->systemSize;
+    }
+}
+
 template<class Matrix, class Vector>
 void MatrixLinearSolver<Matrix,Vector>::rebuildSystem(double massFactor, double forceFactor)
 {
@@ -137,6 +184,7 @@ void MatrixLinearSolver<Matrix,Vector>::rebuildSystem(double massFactor, double
     {
         simulation::common::MechanicalOperations mops(&mparams, this->getContext());
         if (!currentGroup->systemMatrix) currentGroup->systemMatrix = createMatrix();
+        updateMatrixPattern();
         currentGroup->matrixAccessor.setGlobalMatrix(currentGroup->systemMatrix);
         currentGroup->matrixAccessor.clear();
         mops.getMatrixDimension(&(currentGroup->matrixAccessor));
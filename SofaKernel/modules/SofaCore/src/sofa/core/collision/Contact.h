@@ -82,6 +82,15 @@ public:
     /// Control the keepAlive flag of the contact. Note that not all contacts support this method
     virtual void setKeepAlive(bool /* val */) {}
 
+    /// Control the reuse of the contact points of the previous step for the detection outputs with the same id. Note that not all contacts support this method
+    virtual void setReuseContactPoints(bool /* val */) {}
+
+    /// Number of contact points reused from the previous step by the last call to setDetectionOutputs
+    virtual std::size_t getNbReusedContactPoints() const { return 0; }
+
+    /// Number of contact points created by the last call to setDetectionOutputs
+    virtual std::size_t getNbCreatedContactPoints() const { return 0; }
+
     //Todo adding TPtr parameter
     class Factory : public helper::Factory< std::string, Contact, std::pair<std::pair<core::CollisionModel*,core::CollisionModel*>,Intersection*>, Contact::SPtr >
     {
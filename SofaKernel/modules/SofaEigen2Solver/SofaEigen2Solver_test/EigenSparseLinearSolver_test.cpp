@@ -0,0 +1,188 @@
+/******************************************************************************
+*                 SOFA, Simulation Open-Framework Architecture                *
+*                    (c) 2006 INRIA, USTL, UJF, CNRS, MGH                     *
+*                                                                             *
+* This program is free software; you can redistribute it and/or modify it     *
+* under the terms of the GNU Lesser General Public License as published by    *
+* the Free Software Foundation; either version 2.1 of the License, or (at     *
+* your option) any later version.                                             *
+*                                                                             *
+* This program is distributed in the hope that it will be useful, but WITHOUT *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License *
+* for more details.                                                           *
+*                                                                             *
+* You should have received a copy of the GNU Lesser General Public License    *
+* along with this program. If not, see <http://www.gnu.org/licenses/>.        *
+*******************************************************************************
+* Authors: The SOFA Team and external contributors (see Authors.txt)          *
+*                                                                             *
+* Contact information: contact@sofa-framework.org                             *
+******************************************************************************/
+#include <SofaEigen2Solver/EigenCompressedRowSparseMatrixMap.h>
+#include <SofaEigen2Solver/initSofaEigen2Solver.h>
+#include <SofaBaseLinearSolver/FullVector.h>
+#include <SofaBaseLinearSolver/MatrixLinearSolver.h>
+#include <SofaSimulationGraph/SimpleApi.h>
+#include <sofa/simulation/Node.h>
+#include <sofa/testing/BaseTest.h>
+
+#include <cmath>
+
+namespace sofa
+{
+
+using namespace component::linearsolver;
+
+typedef CompressedRowSparseMatrix<double> Matrix;
+typedef FullVector<double> Vector;
+typedef MatrixLinearSolver<Matrix, Vector> Solver;
+
+class EigenSparseLinearSolver_test : public testing::BaseTest
+{
+public:
+    Matrix M;
+    Vector b;
+
+    simulation::Simulation::SPtr m_simulation;
+    simulation::Node::SPtr m_root;
+
+    void onSetUp() override
+    {
+        component::initSofaEigen2Solver();
+        m_simulation = simpleapi::createSimulation("DAG");
+        m_root = simpleapi::createRootNode(m_simulation, "root");
+    }
+
+    void onTearDown() override
+    {
+        m_simulation->unload(m_root);
+    }
+
+    /// Symmetric positive definite matrix of a 1D Laplacian plus a mass term, with couplings between distant rows
+    void createSystem(int n)
+    {
+        M.resize(n, n);
+        for (int i = 0; i < n; ++i)
+        {
+            M.add(i, i, 2.1);
+            if (i > 0) M.add(i, i - 1, -1.0);
+            if (i + 1 < n) M.add(i, i + 1, -1.0);
+            if (i + 7 < n)
+            {
+                M.add(i, i + 7, 0.05);
+                M.add(i + 7, i, 0.05);
+            }
+        }
+        M.compress();
+
+        b.resize(n);
+        for (int i = 0; i < n; ++i)
+        {
+            b[i] = std::sin(double(i));
+        }
+    }
+
+    Solver* createSolver(const std::string& backend)
+    {
+        auto solver = simpleapi::createObject(m_root, "EigenSparseLinearSolver", {{"backend", backend}, {"iterations", "1000"}, {"tolerance", "1e-12"}});
+        return dynamic_cast<Solver*>(solver.get());
+    }
+
+    /// max norm of M x - b
+    double residual(const Vector& x)
+    {
+        Vector r;
+        r.resize(b.size());
+        M.opMulV(&r, &x);
+        double norm = 0;
+        for (Matrix::Index i = 0; i < b.size(); ++i)
+        {
+            norm = std::max(norm, std::abs(r[i] - b[i]));
+        }
+        return norm;
+    }
+};
+
+TEST_F(EigenSparseLinearSolver_test, mapCompressedRowSparseMatrix)
+{
+    createSystem(40);
+    // a non symmetric entry, and an empty row
+    M.add(3, 20, 0.5);
+    M.clearRowCol(30);
+    M.compress();
+
+    const auto rows = mapCompressedRowSparseMatrix<Eigen::RowMajor>(M);
+    const auto cols = mapCompressedRowSparseMatrix<Eigen::ColMajor>(M);
+    EXPECT_EQ(rows.valuePtr(), M.getColsValue().data());
+    ASSERT_EQ(rows.rows(), M.rowSize());
+    ASSERT_EQ(rows.cols(), M.colSize());
+    for (Matrix::Index i = 0; i < M.rowSize(); ++i)
+    {
+        for (Matrix::Index j = 0; j < M.colSize(); ++j)
+        {
+            EXPECT_EQ(rows.coeff(i, j), M.element(i, j));
+            EXPECT_EQ(cols.coeff(j, i), M.element(i, j));
+        }
+    }
+
+    Vector product;
+    product.resize(M.rowSize());
+    M.opMulV(&product, &b);
+    const Eigen::VectorXd eigenProduct = rows * Eigen::Map<const Eigen::VectorXd>(b.ptr(), b.size());
+    for (Matrix::Index i = 0; i < M.rowSize(); ++i)
+    {
+        EXPECT_NEAR(eigenProduct[i], product[i], 1e-14);
+    }
+}
+
+TEST_F(EigenSparseLinearSolver_test, mapEmptyMatrix)
+{
+    M.resize(5, 5);
+    M.compress();
+    const auto rows = mapCompressedRowSparseMatrix<Eigen::RowMajor>(M);
+    EXPECT_EQ(rows.rows(), 5);
+    EXPECT_EQ(rows.nonZeros(), 0);
+    EXPECT_EQ(rows.coeff(2, 2), 0.0);
+}
+
+TEST_F(EigenSparseLinearSolver_test, simplicialLDLT)
+{
+    createSystem(200);
+    Solver* solver = createSolver("SimplicialLDLT");
+    ASSERT_NE(solver, nullptr);
+
+    Vector x;
+    x.resize(b.size());
+    solver->invert(M);
+    solver->solve(M, x, b);
+    EXPECT_LT(residual(x), 1e-12);
+
+    // same structure, other values
+    for (int i = 0; i < 200; ++i)
+    {
+        M.add(i, i, 1.0);
+    }
+    M.compress();
+    solver->invert(M);
+    solver->solve(M, x, b);
+    EXPECT_LT(residual(x), 1e-12);
+}
+
+TEST_F(EigenSparseLinearSolver_test, conjugateGradient)
+{
+    createSystem(200);
+    Solver* solver = createSolver("ConjugateGradient");
+    ASSERT_NE(solver, nullptr);
+
+    Vector x;
+    x.resize(b.size());
+    solver->invert(M);
+    solver->solve(M, x, b);
+    EXPECT_LT(residual(x), 1e-9);
+    const auto* iterations = dynamic_cast<Data<unsigned>*>(solver->findData("nbIterations"));
+    ASSERT_NE(iterations, nullptr);
+    EXPECT_GT(iterations->getValue(), 0u);
+}
+
+} // namespace sofa
@@ -0,0 +1,61 @@
+/******************************************************************************
+*                 SOFA, Simulation Open-Framework Architecture                *
+*                    (c) 2006 INRIA, USTL, UJF, CNRS, MGH                     *
+*                                                                             *
+* This program is free software; you can redistribute it and/or modify it     *
+* under the terms of the GNU Lesser General Public License as published by    *
+* the Free Software Foundation; either version 2.1 of the License, or (at     *
+* your option) any later version.                                             *
+*                                                                             *
+* This program is distributed in the hope that it will be useful, but WITHOUT *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License *
+* for more details.                                                           *
+*                                                                             *
+* You should have received a copy of the GNU Lesser General Public License    *
+* along with this program. If not, see <http://www.gnu.org/licenses/>.        *
+*******************************************************************************
+* Authors: The SOFA Team and external contributors (see Authors.txt)          *
+*                                                                             *
+* Contact information: contact@sofa-framework.org                             *
+******************************************************************************/
+#pragma once
+#include <SofaEigen2Solver/config.h>
+
+#include <SofaBaseLinearSolver/CompressedRowSparseMatrix.h>
+#include <Eigen/SparseCore>
+#include <type_traits>
+
+namespace sofa::component::linearsolver
+{
+
+/// Eigen view sharing the storage of a CompressedRowSparseMatrix with scalar blocks
+template<class TMatrix, int Options = Eigen::RowMajor>
+using EigenCompressedRowSparseMatrixMap = Eigen::Map< const Eigen::SparseMatrix<typename TMatrix::Real, Options, int> >;
+
+/** Map a CompressedRowSparseMatrix with scalar blocks as an Eigen sparse matrix, without copying it.
+  The matrix is compressed and its empty rows are given an entry (see CompressedRowSparseMatrix::fullRows),
+  so that its row pointers, column indices and values are directly the arrays of an Eigen compressed row matrix.
+  Mapping as Eigen::ColMajor gives the transpose, which is the matrix itself when it is symmetric.
+  The view stays valid as long as the structure of the matrix is not modified.
+  */
+template<int Options = Eigen::RowMajor, class TMatrix>
+EigenCompressedRowSparseMatrixMap<TMatrix, Options> mapCompressedRowSparseMatrix(TMatrix& M)
+{
+    typedef typename TMatrix::VecIndex::value_type Index;
+    static_assert(std::is_same<typename TMatrix::Bloc, typename TMatrix::Real>::value, "only matrices with scalar blocks can be mapped");
+    static_assert(std::is_integral<Index>::value && sizeof(Index) == sizeof(int), "the indices must have the size of the Eigen storage indices");
+
+    M.fullRows();
+
+    static const int emptyRows[1] = { 0 };
+    const int* rowBegin = M.getRowBegin().empty() ? emptyRows : reinterpret_cast<const int*>(M.getRowBegin().data());
+    const int* colsIndex = reinterpret_cast<const int*>(M.getColsIndex().data());
+    const int rows = (Options & Eigen::RowMajor) ? M.rowSize() : M.colSize();
+    const int cols = (Options & Eigen::RowMajor) ? M.colSize() : M.rowSize();
+
+    return EigenCompressedRowSparseMatrixMap<TMatrix, Options>(rows, cols, (int)M.getColsValue().size(),
+                                                               rowBegin, colsIndex, M.getColsValue().data());
+}
+
+} // namespace sofa::component::linearsolver
@@ -0,0 +1,170 @@
+/******************************************************************************
+*                 SOFA, Simulation Open-Framework Architecture                *
+*                    (c) 2006 INRIA, USTL, UJF, CNRS, MGH                     *
+*                                                                             *
+* This program is free software; you can redistribute it and/or modify it     *
+* under the terms of the GNU Lesser General Public License as published by    *
+* the Free Software Foundation; either version 2.1 of the License, or (at     *
+* your option) any later version.                                             *
+*                                                                             *
+* This program is distributed in the hope that it will be useful, but WITHOUT *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License *
+* for more details.                                                           *
+*                                                                             *
+* You should have received a copy of the GNU Lesser General Public License    *
+* along with this program. If not, see <http://www.gnu.org/licenses/>.        *
+*******************************************************************************
+* Authors: The SOFA Team and external contributors (see Authors.txt)          *
+*                                                                             *
+* Contact information: contact@sofa-framework.org                             *
+******************************************************************************/
+#include <SofaEigen2Solver/EigenSparseLinearSolver.h>
+
+#include <SofaBaseLinearSolver/CompressedRowSparseMatrix.h>
+#include <SofaBaseLinearSolver/FullVector.h>
+#include <sofa/helper/ScopedAdvancedTimer.h>
+#include <sofa/core/ObjectFactory.h>
+
+namespace sofa::component::linearsolver
+{
+
+template<class TMatrix, class TVector>
+EigenSparseLinearSolver<TMatrix,TVector>::EigenSparseLinearSolver()
+    : d_backend( initData(&d_backend, "backend", "Eigen solver used on the system: SimplicialLDLT, ConjugateGradient, and Cholmod or PardisoLDLT when available") )
+    , d_maxIter( initData(&d_maxIter, 25u, "iterations", "maximum number of iterations of the ConjugateGradient backend") )
+    , d_tolerance( initData(&d_tolerance, (Real)1e-5, "tolerance", "relative residual under which the ConjugateGradient backend stops") )
+    , d_nbIterations( initData(&d_nbIterations, 0u, "nbIterations", "output: iterations of the ConjugateGradient backend in the last solve") )
+    , d_error( initData(&d_error, (Real)0, "error", "output: relative residual of the ConjugateGradient backend after the last solve") )
+    , factorizedBackend(SIMPLICIAL_LDLT)
+    , analyzed(false)
+    , info(Eigen::Success)
+{
+    helper::vector<std::string> backends { "SimplicialLDLT", "ConjugateGradient" };
+#if SOFAEIGEN2SOLVER_HAVE_CHOLMOD
+    backends.push_back("Cholmod");
+#endif
+#if SOFAEIGEN2SOLVER_HAVE_MKL
+    backends.push_back("PardisoLDLT");
+#endif
+    helper::OptionsGroup backend(backends);
+    backend.setSelectedItem(0);
+    d_backend.setValue(backend);
+
+    d_nbIterations.setReadOnly(true);
+    d_error.setReadOnly(true);
+}
+
+template<class TMatrix, class TVector>
+typename EigenSparseLinearSolver<TMatrix,TVector>::Backend EigenSparseLinearSolver<TMatrix,TVector>::getSelectedBackend() const
+{
+    const std::string& backend = d_backend.getValue().getSelectedItem();
+    if (backend == "ConjugateGradient") return CONJUGATE_GRADIENT;
+    if (backend == "Cholmod") return CHOLMOD;
+    if (backend == "PardisoLDLT") return PARDISO_LDLT;
+    return SIMPLICIAL_LDLT;
+}
+
+template<class TMatrix, class TVector>
+void EigenSparseLinearSolver<TMatrix,TVector>::invert(Matrix& M)
+{
+    sofa::helper::ScopedAdvancedTimer timer("Invert-Eigen");
+
+    const Backend backend = getSelectedBackend();
+    // the structure of the matrix is the one of the last analysis only if its assembly was replayed
+    const bool samePattern = analyzed && backend == factorizedBackend && M.isPatternReplayed();
+    factorizedBackend = backend;
+    analyzed = true;
+
+    switch (backend)
+    {
+    case SIMPLICIAL_LDLT:
+    {
+        const SymmetricMap A = mapCompressedRowSparseMatrix<Eigen::ColMajor>(M);
+        if (!samePattern) simplicialLDLT.analyzePattern(A);
+        simplicialLDLT.factorize(A);
+        info = simplicialLDLT.info();
+        break;
+    }
+    case CONJUGATE_GRADIENT:
+    {
+        // the solver keeps a reference to the storage of M, only the diagonal preconditioner is computed here
+        conjugateGradient.setMaxIterations(d_maxIter.getValue());
+        conjugateGradient.setTolerance(d_tolerance.getValue());
+        conjugateGradient.compute(mapCompressedRowSparseMatrix<Eigen::RowMajor>(M));
+        info = conjugateGradient.info();
+        break;
+    }
+#if SOFAEIGEN2SOLVER_HAVE_CHOLMOD
+    case CHOLMOD:
+    {
+        const SymmetricMap A = mapCompressedRowSparseMatrix<Eigen::ColMajor>(M);
+        if (!samePattern) cholmod.analyzePattern(A);
+        cholmod.factorize(A);
+        info = cholmod.info();
+        break;
+    }
+#endif
+#if SOFAEIGEN2SOLVER_HAVE_MKL
+    case PARDISO_LDLT:
+    {
+        const RowMajorMap A = mapCompressedRowSparseMatrix<Eigen::RowMajor>(M);
+        if (!samePattern) pardisoLDLT.analyzePattern(A);
+        pardisoLDLT.factorize(A);
+        info = pardisoLDLT.info();
+        break;
+    }
+#endif
+    default:
+        break;
+    }
+
+    msg_error_when(info != Eigen::Success) << d_backend.getValue().getSelectedItem() << " failed on the system matrix of size " << M.rowSize();
+}
+
+template<class TMatrix, class TVector>
+void EigenSparseLinearSolver<TMatrix,TVector>::solve(Matrix& M, Vector& x, Vector& b)
+{
+    SOFA_UNUSED(M);
+    sofa::helper::ScopedAdvancedTimer timer("Solve-Eigen");
+
+    const Eigen::Map<const EigenVector> rhs(b.ptr(), b.size());
+    Eigen::Map<EigenVector> solution(x.ptr(), x.size());
+
+    if (info != Eigen::Success)
+    {
+        solution.setZero();
+        return;
+    }
+
+    switch (factorizedBackend)
+    {
+    case SIMPLICIAL_LDLT:
+        solution = simplicialLDLT.solve(rhs);
+        break;
+    case CONJUGATE_GRADIENT:
+        solution = conjugateGradient.solve(rhs);
+        d_nbIterations.setValue((unsigned)conjugateGradient.iterations());
+        d_error.setValue((Real)conjugateGradient.error());
+        break;
+#if SOFAEIGEN2SOLVER_HAVE_CHOLMOD
+    case CHOLMOD:
+        solution = cholmod.solve(rhs);
+        break;
+#endif
+#if SOFAEIGEN2SOLVER_HAVE_MKL
+    case PARDISO_LDLT:
+        solution = pardisoLDLT.solve(rhs);
+        break;
+#endif
+    default:
+        break;
+    }
+}
+
+
+int EigenSparseLinearSolverClass = core::RegisterObject("Linear system solver using the sparse solvers of the Eigen library on the assembled system, without copying it")
+        .add< EigenSparseLinearSolver< CompressedRowSparseMatrix<double>, FullVector<double> > >(true)
+        ;
+
+} // namespace sofa::component::linearsolver
@@ -0,0 +1,100 @@
+/******************************************************************************
+*                 SOFA, Simulation Open-Framework Architecture                *
+*                    (c) 2006 INRIA, USTL, UJF, CNRS, MGH                     *
+*                                                                             *
+* This program is free software; you can redistribute it and/or modify it     *
+* under the terms of the GNU Lesser General Public License as published by    *
+* the Free Software Foundation; either version 2.1 of the License, or (at     *
+* your option) any later version.                                             *
+*                                                                             *
+* This program is distributed in the hope that it will be useful, but WITHOUT *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License *
+* for more details.                                                           *
+*                                                                             *
+* You should have received a copy of the GNU Lesser General Public License    *
+* along with this program. If not, see <http://www.gnu.org/licenses/>.        *
+*******************************************************************************
+* Authors: The SOFA Team and external contributors (see Authors.txt)          *
+*                                                                             *
+* Contact information: contact@sofa-framework.org                             *
+******************************************************************************/
+#pragma once
+#include <SofaEigen2Solver/config.h>
+
+#include <SofaBaseLinearSolver/MatrixLinearSolver.h>
+#include <SofaEigen2Solver/EigenCompressedRowSparseMatrixMap.h>
+#include <sofa/helper/OptionsGroup.h>
+
+#include <Eigen/SparseCholesky>
+#include <Eigen/IterativeLinearSolvers>
+#if SOFAEIGEN2SOLVER_HAVE_CHOLMOD
+#include <Eigen/CholmodSupport>
+#endif
+#if SOFAEIGEN2SOLVER_HAVE_MKL
+#include <Eigen/PardisoSupport>
+#endif
+
+namespace sofa::component::linearsolver
+{
+
+/** Linear system solver running the sparse solvers of the Eigen library (http://eigen.tuxfamily.org/) on the assembled system.
+  The CompressedRowSparseMatrix of the system is not converted: Eigen works on a view of its storage (see mapCompressedRowSparseMatrix),
+  as a column major matrix for the direct backends since the system is symmetric.
+  Backends: SimplicialLDLT, ConjugateGradient (Jacobi preconditioned), and, when found at compilation, Cholmod (CHOLMOD supernodal or
+  simplicial factorization) and PardisoLDLT (Intel MKL). These two copy the matrix in their own format, as their Eigen wrappers require.
+  The symbolic analysis of the direct backends is kept as long as the system matrix replays the same assembly pattern (see cachedPattern).
+  */
+template<class TMatrix, class TVector>
+class EigenSparseLinearSolver : public sofa::component::linearsolver::MatrixLinearSolver<TMatrix,TVector>
+{
+public:
+    SOFA_CLASS(SOFA_TEMPLATE2(EigenSparseLinearSolver,TMatrix,TVector),SOFA_TEMPLATE2(sofa::component::linearsolver::MatrixLinearSolver,TMatrix,TVector));
+
+    typedef TMatrix Matrix;
+    typedef TVector Vector;
+    typedef typename TMatrix::Real Real;
+    typedef sofa::component::linearsolver::MatrixLinearSolver<TMatrix,TVector> Inherit;
+
+    typedef EigenCompressedRowSparseMatrixMap<TMatrix, Eigen::RowMajor> RowMajorMap;
+    typedef EigenCompressedRowSparseMatrixMap<TMatrix, Eigen::ColMajor> SymmetricMap;
+    typedef Eigen::SparseMatrix<Real, Eigen::RowMajor, int> RowMajorMatrix;
+    typedef Eigen::SparseMatrix<Real, Eigen::ColMajor, int> ColMajorMatrix;
+    typedef Eigen::Matrix<Real, Eigen::Dynamic, 1> EigenVector;
+
+    Data<helper::OptionsGroup> d_backend; ///< Eigen solver used on the system: SimplicialLDLT, ConjugateGradient, and Cholmod or PardisoLDLT when available
+    Data<unsigned> d_maxIter; ///< maximum number of iterations of the ConjugateGradient backend
+    Data<Real> d_tolerance; ///< relative residual under which the ConjugateGradient backend stops
+    Data<unsigned> d_nbIterations; ///< output: iterations of the ConjugateGradient backend in the last solve
+    Data<Real> d_error; ///< output: relative residual of the ConjugateGradient backend after the last solve
+
+protected:
+    EigenSparseLinearSolver();
+
+public:
+    /// Factorize M, or prepare the preconditioner of the iterative backend
+    void invert(Matrix& M) override;
+
+    /// Solve Mx=b
+    void solve(Matrix& M, Vector& x, Vector& b) override;
+
+protected:
+    enum Backend { SIMPLICIAL_LDLT, CONJUGATE_GRADIENT, CHOLMOD, PARDISO_LDLT };
+
+    Backend getSelectedBackend() const;
+
+    Eigen::SimplicialLDLT<SymmetricMap> simplicialLDLT;
+    Eigen::ConjugateGradient<RowMajorMatrix, Eigen::Lower|Eigen::Upper> conjugateGradient;
+#if SOFAEIGEN2SOLVER_HAVE_CHOLMOD
+    Eigen::CholmodDecomposition<ColMajorMatrix> cholmod;
+#endif
+#if SOFAEIGEN2SOLVER_HAVE_MKL
+    Eigen::PardisoLDLT<RowMajorMatrix> pardisoLDLT;
+#endif
+
+    Backend factorizedBackend; ///< backend used at the last invert
+    bool analyzed; ///< the symbolic analysis of factorizedBackend is done
+    Eigen::ComputationInfo info; ///< status of the last invert
+};
+
+} // namespace sofa::component::linearsolver
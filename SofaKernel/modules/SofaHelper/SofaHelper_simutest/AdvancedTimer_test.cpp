@@ -29,6 +29,10 @@ using sofa::core::ExecParams;
 #include <SofaSimulationGraph/testing/BaseSimulationTest.h>
 using sofa::helper::testing::BaseSimulationTest ;
 
+#include <thread>
+#include <fstream>
+#include <cstdio>
+
 namespace sofa {
 
 /**
@@ -105,5 +109,106 @@ TEST_F(AdvancedTimerTest, End)
 	EXPECT_NO_FATAL_FAILURE(AdvancedTimer::end("validId"));
 }
 
+TEST_F(AdvancedTimerTest, IdZero)
+{
+	using namespace sofa::helper;
+	const std::size_t lastID = AdvancedTimer::IdTimer::IdFactory::getLastID();
+	ASSERT_EQ((unsigned int)AdvancedTimer::IdTimer("0"), 0u);
+	ASSERT_EQ((unsigned int)AdvancedTimer::IdTimer(""), 0u);
+	ASSERT_EQ(AdvancedTimer::IdTimer::IdFactory::getLastID(), lastID);
+}
+
+TEST_F(AdvancedTimerTest, ThreadSteps)
+{
+	using namespace sofa::helper;
+	AdvancedTimer::setEnabled("threadID", true);
+	AdvancedTimer::setInterval("threadID", 1000);
+
+	const auto iteration = []
+	{
+		AdvancedTimer::begin("threadID");
+		AdvancedTimer::stepBegin("mainStep");
+		std::thread thread([]
+		{
+			ScopedAdvancedTimer step("threadStep");
+			AdvancedTimer::valSet("threadVal", 1.0);
+		});
+		thread.join();
+		AdvancedTimer::stepEnd("mainStep");
+		std::ostringstream report;
+		AdvancedTimer::end("threadID", report);
+		return report.str();
+	};
+	iteration();
+	iteration();
+
+	// the main thread does not see the step of the other threads
+	const auto stepData = AdvancedTimer::getStepData("threadID");
+	EXPECT_EQ(stepData.count(AdvancedTimer::IdStep("threadStep")), 0u);
+	EXPECT_EQ(stepData.at(AdvancedTimer::IdStep("mainStep")).num, 2);
+
+	// a new thread was started for each iteration
+	const auto threadStepData = AdvancedTimer::getThreadStepData("threadID");
+	ASSERT_EQ(threadStepData.size(), 2u);
+	for (const auto& thread : threadStepData)
+	{
+		ASSERT_EQ(thread.second.count(AdvancedTimer::IdStep("threadStep")), 1u);
+		EXPECT_EQ(thread.second.at(AdvancedTimer::IdStep("threadStep")).num, 1);
+	}
+
+	// without timer, nothing is recorded by the other threads
+	std::thread thread([] { ScopedAdvancedTimer step("threadStep"); });
+	thread.join();
+	EXPECT_EQ(AdvancedTimer::getThreadStepData("threadID").size(), 2u);
+
+	AdvancedTimer::setInterval("threadID", 3);
+	const std::string report = iteration();
+	EXPECT_NE(report.find("Thread 3 Steps"), std::string::npos);
+	EXPECT_NE(report.find("All Threads Steps"), std::string::npos);
+}
+
+TEST_F(AdvancedTimerTest, Statistics)
+{
+	using namespace sofa::helper;
+	AdvancedTimer::setEnabled("statsID", true);
+	AdvancedTimer::setInterval("statsID", 1000);
+	AdvancedTimer::setStatistics("statsID", 8);
+	const std::string fileName = "AdvancedTimerTest_Statistics.csv";
+	AdvancedTimer::setStatisticsFile("statsID", fileName, 5);
+
+	for (int i = 0; i < 10; ++i)
+	{
+		AdvancedTimer::begin("statsID");
+		AdvancedTimer::stepBegin("statsStep");
+		AdvancedTimer::stepEnd("statsStep");
+		AdvancedTimer::end("statsID");
+	}
+
+	const auto statistics = AdvancedTimer::getStatistics("statsID");
+	ASSERT_EQ(statistics.size(), 2u);
+	EXPECT_EQ(statistics[0].label, "TOTAL");
+	EXPECT_EQ(statistics[1].label, "statsStep");
+	for (const StepStatistics& step : statistics)
+	{
+		// the window holds between 3 and 4 slices of 2 iterations
+		EXPECT_GE(step.count, 6u);
+		EXPECT_LE(step.count, 8u);
+		EXPECT_LE(step.p50, step.p99);
+		EXPECT_LE(step.p99, step.max);
+	}
+
+	// one line per step for the iterations 5 and 10
+	AdvancedTimer::setStatisticsFile("statsID", "", 1);
+	std::ifstream file(fileName);
+	std::string line;
+	int nbLines = 0;
+	while (std::getline(file, line)) ++nbLines;
+	EXPECT_EQ(nbLines, 5);
+	file.close();
+	std::remove(fileName.c_str());
+
+	AdvancedTimer::setStatistics("statsID", 0);
+	EXPECT_TRUE(AdvancedTimer::getStatistics("statsID").empty());
+}
 
 } //namespace sofa
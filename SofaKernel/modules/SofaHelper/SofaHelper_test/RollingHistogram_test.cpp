@@ -0,0 +1,97 @@
+/******************************************************************************
+*                 SOFA, Simulation Open-Framework Architecture                *
+*                    (c) 2006 INRIA, USTL, UJF, CNRS, MGH                     *
+*                                                                             *
+* This program is free software; you can redistribute it and/or modify it     *
+* under the terms of the GNU Lesser General Public License as published by    *
+* the Free Software Foundation; either version 2.1 of the License, or (at     *
+* your option) any later version.                                             *
+*                                                                             *
+* This program is distributed in the hope that it will be useful, but WITHOUT *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License *
+* for more details.                                                           *
+*                                                                             *
+* You should have received a copy of the GNU Lesser General Public License    *
+* along with this program. If not, see <http://www.gnu.org/licenses/>.        *
+*******************************************************************************
+* Authors: The SOFA Team and external contributors (see Authors.txt)          *
+*                                                                             *
+* Contact information: contact@sofa-framework.org                             *
+******************************************************************************/
+#include <sofa/helper/RollingHistogram.h>
+#include <gtest/gtest.h>
+#include <cmath>
+#include <limits>
+
+using sofa::helper::RollingHistogram;
+
+TEST(RollingHistogramTest, empty)
+{
+    RollingHistogram histogram;
+    EXPECT_EQ(histogram.getCount(), 0u);
+    EXPECT_EQ(histogram.getPercentile(50), 0.0);
+    EXPECT_EQ(histogram.getMax(), 0.0);
+}
+
+TEST(RollingHistogramTest, percentiles)
+{
+    RollingHistogram histogram;
+    for (int i = 1; i <= 1000; ++i)
+    {
+        histogram.add(0.01 * i);
+    }
+
+    EXPECT_EQ(histogram.getCount(), 1000u);
+    EXPECT_NEAR(histogram.getPercentile(50), 5.0, 5.0 / 32);
+    EXPECT_NEAR(histogram.getPercentile(95), 9.5, 9.5 / 32);
+    EXPECT_NEAR(histogram.getPercentile(99), 9.9, 9.9 / 32);
+    EXPECT_DOUBLE_EQ(histogram.getMax(), 10.0);
+    EXPECT_LE(histogram.getPercentile(100), histogram.getMax());
+
+    // small and large values keep the same relative precision
+    RollingHistogram extremes;
+    extremes.add(2e-5);
+    extremes.add(3e5);
+    EXPECT_NEAR(extremes.getPercentile(1), 2e-5, 2e-5 / 32);
+    EXPECT_NEAR(extremes.getPercentile(100), 3e5, 3e5 / 32);
+}
+
+TEST(RollingHistogramTest, invalidValues)
+{
+    RollingHistogram histogram;
+    histogram.add(std::numeric_limits<double>::quiet_NaN());
+    histogram.add(-1.0);
+    EXPECT_EQ(histogram.getCount(), 2u);
+    EXPECT_EQ(histogram.getMax(), 0.0);
+    EXPECT_LT(histogram.getPercentile(100), 1e-6);
+
+    // the values too large for the buckets are counted in the last one
+    histogram.add(1e300);
+    histogram.add(std::numeric_limits<double>::infinity());
+    EXPECT_EQ(histogram.getCount(), 4u);
+    EXPECT_TRUE(std::isfinite(histogram.getMax()));
+    EXPECT_TRUE(std::isfinite(histogram.getPercentile(100)));
+    EXPECT_GT(histogram.getPercentile(100), 1e6);
+    EXPECT_LE(histogram.getPercentile(100), histogram.getMax());
+}
+
+TEST(RollingHistogramTest, slices)
+{
+    RollingHistogram histogram(2);
+    histogram.add(100.0);
+    histogram.nextSlice();
+    histogram.add(1.0);
+    EXPECT_EQ(histogram.getCount(), 2u);
+    EXPECT_DOUBLE_EQ(histogram.getMax(), 100.0);
+
+    // the slice of 100 is replaced
+    histogram.nextSlice();
+    histogram.add(2.0);
+    EXPECT_EQ(histogram.getCount(), 2u);
+    EXPECT_DOUBLE_EQ(histogram.getMax(), 2.0);
+    EXPECT_NEAR(histogram.getPercentile(50), 1.0, 1.0 / 32);
+
+    histogram.clear();
+    EXPECT_EQ(histogram.getCount(), 0u);
+}
@@ -0,0 +1,227 @@
+/******************************************************************************
+*                 SOFA, Simulation Open-Framework Architecture                *
+*                    (c) 2006 INRIA, USTL, UJF, CNRS, MGH                     *
+*                                                                             *
+* This program is free software; you can redistribute it and/or modify it     *
+* under the terms of the GNU Lesser General Public License as published by    *
+* the Free Software Foundation; either version 2.1 of the License, or (at     *
+* your option) any later version.                                             *
+*                                                                             *
+* This program is distributed in the hope that it will be useful, but WITHOUT *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License *
+* for more details.                                                           *
+*                                                                             *
+* You should have received a copy of the GNU Lesser General Public License    *
+* along with this program. If not, see <http://www.gnu.org/licenses/>.        *
+*******************************************************************************
+* Authors: The SOFA Team and external contributors (see Authors.txt)          *
+*                                                                             *
+* Contact information: contact@sofa-framework.org                             *
+******************************************************************************/
+#include <sofa/helper/Tracer.h>
+#include <sofa/helper/AdvancedTimer.h>
+#include <gtest/gtest.h>
+
+#include <json.h>
+
+#include <atomic>
+#include <map>
+#include <sstream>
+#include <thread>
+
+using sofa::helper::Tracer;
+using json = sofa::helper::json;
+
+namespace
+{
+
+/// write the trace and parse it
+json readTrace()
+{
+    std::stringstream trace;
+    Tracer::writeChromeTrace(trace);
+    return json::parse(trace.str());
+}
+
+struct TracedTask {};
+
+} // namespace
+
+TEST(TracerTest, disabled)
+{
+    Tracer::stop();
+    Tracer::clear();
+    Tracer::begin("nothing");
+    Tracer::end();
+
+    const json trace = readTrace();
+    EXPECT_TRUE(trace["traceEvents"].empty());
+}
+
+TEST(TracerTest, threads)
+{
+    Tracer::start("", 1);
+
+    Tracer::setThreadName("main");
+    Tracer::begin("outer");
+    Tracer::begin(typeid(TracedTask));
+    Tracer::end();
+    Tracer::instant("milestone");
+    Tracer::end();
+
+    std::thread worker([]()
+    {
+        Tracer::setThreadName("worker");
+        sofa::helper::AdvancedTimer::stepBegin("step");
+        sofa::helper::AdvancedTimer::stepEnd("step");
+    });
+    worker.join();
+
+    const json trace = readTrace();
+    Tracer::stop();
+
+    std::map<std::string, int> threads;
+    std::map<std::string, std::string> phases;
+    int depth = 0;
+    for (const json& event : trace["traceEvents"])
+    {
+        const std::string phase = event["ph"];
+        if (phase == "M")
+        {
+            threads[event["args"]["name"]] = event["tid"];
+            continue;
+        }
+        phases[event["name"]] += phase;
+        depth += (phase == "B") - (phase == "E");
+    }
+
+    ASSERT_EQ(threads.size(), 2u);
+    EXPECT_NE(threads["main"], threads["worker"]);
+    EXPECT_EQ(depth, 0);
+    EXPECT_EQ(phases["outer"], "BE");
+    EXPECT_EQ(phases["milestone"], "i");
+    EXPECT_EQ(phases["step"], "BE");
+
+    // the task is named after its type
+    bool hasTask = false;
+    for (const auto& phase : phases)
+    {
+        hasTask |= (phase.first.find("TracedTask") != std::string::npos && phase.second == "BE");
+    }
+    EXPECT_TRUE(hasTask);
+
+    // the events are written once
+    Tracer::start("", 1);
+    EXPECT_TRUE(readTrace()["traceEvents"].empty());
+    Tracer::stop();
+}
+
+TEST(TracerTest, openEvents)
+{
+    Tracer::start("", 1);
+
+    // an event running while the trace is written is continued in the next trace
+    Tracer::begin("running");
+    json trace = readTrace();
+    std::string phases;
+    for (const json& event : trace["traceEvents"])
+    {
+        if (event["ph"] != "M") phases += event["ph"].get<std::string>();
+    }
+    EXPECT_EQ(phases, "BE");
+
+    Tracer::end();
+    trace = readTrace();
+    phases.clear();
+    for (const json& event : trace["traceEvents"])
+    {
+        if (event["ph"] != "M") phases += event["ph"].get<std::string>();
+    }
+    EXPECT_EQ(phases, "BE");
+
+    Tracer::stop();
+}
+
+TEST(TracerTest, overwrittenEvents)
+{
+    Tracer::start("", 1);
+
+    // more events than the ring buffer holds: the oldest are lost, the trace stays balanced
+    Tracer::begin("lost");
+    for (int i = 0; i < 100000; ++i)
+    {
+        Tracer::begin("event");
+        Tracer::end();
+    }
+    Tracer::end();
+
+    const json trace = readTrace();
+    Tracer::stop();
+
+    int depth = 0;
+    for (const json& event : trace["traceEvents"])
+    {
+        const std::string phase = event["ph"];
+        depth += (phase == "B") - (phase == "E");
+        EXPECT_GE(depth, 0);
+    }
+    EXPECT_EQ(depth, 0);
+}
+
+TEST(TracerTest, nameBeforeStart)
+{
+    Tracer::stop();
+
+    // the name given while the tracer is stopped is kept for the first event of the thread
+    std::thread worker([]()
+    {
+        Tracer::setThreadName("early");
+        Tracer::start("", 1);
+        Tracer::instant("started");
+    });
+    worker.join();
+
+    const json trace = readTrace();
+    Tracer::stop();
+
+    std::string name;
+    for (const json& event : trace["traceEvents"])
+    {
+        if (event["ph"] == "M") name = event["args"]["name"];
+    }
+    EXPECT_EQ(name, "early");
+}
+
+TEST(TracerTest, writeWhileRecording)
+{
+    Tracer::start("", 1);
+
+    std::atomic<bool> done(false);
+    std::thread worker([&done]()
+    {
+        Tracer::setThreadName("recording");
+        for (unsigned int i = 0; !done.load(); ++i)
+        {
+            Tracer::begin(i % 2 ? "odd" : "even");
+            Tracer::end();
+        }
+    });
+
+    for (int i = 0; i < 20; ++i)
+    {
+        const json trace = readTrace();
+        int depth = 0;
+        for (const json& event : trace["traceEvents"])
+        {
+            const std::string phase = event["ph"];
+            depth += (phase == "B") - (phase == "E");
+            EXPECT_GE(depth, 0);
+        }
+        EXPECT_EQ(depth, 0);
+    }
+
+    done.store(true);
+    worker.join();
+    Tracer::stop();
+}
@@ -23,6 +23,8 @@
 
 #include <sofa/helper/logging/Messaging.h>
 #include <sofa/helper/AdvancedTimer.h>
+#include <sofa/helper/Tracer.h>
+#include <sofa/helper/RollingHistogram.h>
 #include <sofa/helper/vector.h>
 #include <json.h>
 
@@ -33,7 +35,10 @@
 #include <algorithm>
 #include <cctype>
 #include <iostream>
+#include <fstream>
 #include <atomic>
+#include <memory>
+#include <mutex>
 
 #define DEFAULT_INTERVAL 100
 
@@ -53,6 +58,41 @@ template class SOFA_HELPER_API AdvancedTimer::Id<AdvancedTimer::Step>;
 template class SOFA_HELPER_API AdvancedTimer::Id<AdvancedTimer::Obj>;
 template class SOFA_HELPER_API AdvancedTimer::Id<AdvancedTimer::Val>;
 
+class ThreadRecords;
+
+/// Rolling statistics of the durations of the steps over the last iterations of a timer
+class TimerStatistics
+{
+public:
+    static constexpr unsigned int NbSlices = 4;
+
+    explicit TimerStatistics(unsigned int window)
+        : window(window), nbIter(0), samplingInterval(0)
+    {
+    }
+
+    /// add the durations of the steps during the iteration which ends
+    void endIteration(const std::string& timerName);
+    helper::vector<StepStatistics> getStatistics();
+    void setFile(const std::string& fileName, unsigned int samplingInterval);
+
+    std::mutex mutex;
+    unsigned int window;
+    unsigned int nbIter;
+    std::map<AdvancedTimer::IdStep, RollingHistogram> histograms;
+    helper::vector<AdvancedTimer::IdStep> steps;
+
+    /// durations of the steps during the current iteration
+    std::map<AdvancedTimer::IdStep, ctime_t> iterationTimes;
+
+    std::ofstream file;
+    bool csv = false;
+    unsigned int samplingInterval;
+
+protected:
+    void writeSample(const std::string& timerName);
+};
+
 class TimerData
 {
 public:
@@ -82,6 +122,19 @@ public:
     std::map<AdvancedTimer::IdVal, ValData> valData;
     helper::vector<AdvancedTimer::IdVal> vals;
 
+    /// iteration during which the other threads record for this timer
+    std::atomic<unsigned int> iteration { 0 };
+
+    /// records of the other threads during the current iteration, registered by the threads themselves
+    /// (shared, to be kept if a thread ends before the timer)
+    std::mutex threadMutex;
+    helper::vector< std::shared_ptr<ThreadRecords> > threadRecords;
+
+    /// statistics of the other threads, indexed by thread index
+    helper::vector< std::unique_ptr<TimerData> > threadData;
+
+    std::unique_ptr<TimerStatistics> statistics;
+
     TimerData()
         : nbIter(0), interval(0), defaultInterval(DEFAULT_INTERVAL), timerOutputType(AdvancedTimer::STDOUT)
     {
@@ -103,19 +156,71 @@ public:
     }
     void clear();
     void process();
+    void processThreads();
     void print();
     void print(std::ostream& result);
+    void printSteps(std::ostream& out);
+    void printThreads(std::ostream& out);
     json getJson(std::string stepNumber);
     json getLightJson(std::string stepNumber);
     json createJSONArray(int s, json jsonObject, StepData& data);
 };
 
 std::map< AdvancedTimer::IdTimer, TimerData > timers;
+std::mutex timersMutex;
+
+TimerData& getTimerData(AdvancedTimer::IdTimer id)
+{
+    std::lock_guard<std::mutex> lock(timersMutex);
+    return timers[id];
+}
 
 std::atomic<int> activeTimers;
 SOFA_THREAD_SPECIFIC_PTR(std::stack<AdvancedTimer::IdTimer>, curTimerThread);
 SOFA_THREAD_SPECIFIC_PTR(helper::vector<Record>, curRecordsThread);
 
+/// Records of a thread without timer, for the timer begun on another thread
+class ThreadRecords
+{
+public:
+    helper::vector<Record> records;
+    const TimerData* timer = nullptr; ///< shared timer the records belong to
+    unsigned int iteration = 0; ///< iteration of this timer
+    int index = 0; ///< index of the thread in the reports, from 1
+};
+
+/// timer recording the steps of the threads without timer
+std::atomic<TimerData*> sharedTimer { nullptr };
+std::atomic<int> nbRecordingThreads { 0 };
+
+helper::vector<Record>* getThreadRecords()
+{
+    TimerData* timer = sharedTimer.load(std::memory_order_acquire);
+    if (!timer) return nullptr;
+
+    static thread_local std::shared_ptr<ThreadRecords> threadRecords = std::make_shared<ThreadRecords>();
+    const unsigned int iteration = timer->iteration.load(std::memory_order_relaxed);
+    if (threadRecords->timer != timer || threadRecords->iteration != iteration)
+    {
+        // first record of this thread in this iteration: only then the timer is locked
+        if (!threadRecords->index) threadRecords->index = ++nbRecordingThreads;
+        threadRecords->records.clear();
+        threadRecords->timer = timer;
+        threadRecords->iteration = iteration;
+        std::lock_guard<std::mutex> lock(timer->threadMutex);
+        timer->threadRecords.push_back(threadRecords);
+    }
+    return &threadRecords->records;
+}
+
+void shareTimer(TimerData* timer)
+{
+    if (sharedTimer.load(std::memory_order_relaxed)) return; // the timer of another thread is recording them
+    timer->iteration.fetch_add(1, std::memory_order_relaxed);
+    TimerData* expected = nullptr;
+    sharedTimer.compare_exchange_strong(expected, timer, std::memory_order_release);
+}
+
 std::stack<AdvancedTimer::IdTimer>& getCurTimer()
 {
     std::stack<AdvancedTimer::IdTimer>* ptr = curTimerThread;
@@ -129,8 +234,12 @@ std::stack<AdvancedTimer::IdTimer>& getCurTimer()
 
 helper::vector<Record>* getCurRecords()
 {
-    if (!activeTimers) return nullptr;
-    return curRecordsThread;
+    if (!activeTimers.load(std::memory_order_relaxed)) return nullptr;
+    helper::vector<Record>* ptr = curRecordsThread;
+    if (ptr) return ptr;
+    std::stack<AdvancedTimer::IdTimer>* curTimer = curTimerThread;
+    if (curTimer && !curTimer->empty()) return nullptr;
+    return getThreadRecords();
 }
 
 void setCurRecords(helper::vector<Record>* ptr)
@@ -162,12 +271,16 @@ void AdvancedTimer::clear()
         while (!ptr->empty())
             ptr->pop();
     if (activeTimers == 0)
+    {
+        std::lock_guard<std::mutex> lock(timersMutex);
+        sharedTimer.store(nullptr);
         timers.clear();
+    }
 }
 
 bool AdvancedTimer::isEnabled(IdTimer id)
 {
-    TimerData& data = timers[id];
+    TimerData& data = getTimerData(id);
     if (!data.id)
     {
         data.init(id);
@@ -177,7 +290,7 @@ bool AdvancedTimer::isEnabled(IdTimer id)
 
 void AdvancedTimer::setEnabled(IdTimer id, bool val)
 {
-    TimerData& data = timers[id];
+    TimerData& data = getTimerData(id);
     if (!data.id)
     {
         data.init(id);
@@ -190,7 +303,7 @@ void AdvancedTimer::setEnabled(IdTimer id, bool val)
 
 int  AdvancedTimer::getInterval(IdTimer id)
 {
-    TimerData& data = timers[id];
+    TimerData& data = getTimerData(id);
     if (!data.id)
     {
         data.init(id);
@@ -200,7 +313,7 @@ int  AdvancedTimer::getInterval(IdTimer id)
 
 void AdvancedTimer::setInterval(IdTimer id, int val)
 {
-    TimerData& data = timers[id];
+    TimerData& data = getTimerData(id);
     if (!data.id)
     {
         data.init(id);
@@ -211,9 +324,10 @@ void AdvancedTimer::setInterval(IdTimer id, int val)
 
 void AdvancedTimer::begin(IdTimer id)
 {
+    if (Tracer::isEnabled()) Tracer::beginTimer(id);
     std::stack<AdvancedTimer::IdTimer>& curTimer = getCurTimer();
     curTimer.push(id);
-    TimerData& data = timers[curTimer.top()];
+    TimerData& data = getTimerData(curTimer.top());
     if (!data.id)
     {
         data.init(id);
@@ -226,6 +340,7 @@ void AdvancedTimer::begin(IdTimer id)
     helper::vector<Record>* curRecords = &(data.records);
     setCurRecords(curRecords);
     curRecords->clear();
+    if (curTimer.size() == 1) shareTimer(&data);
     if (syncCallBack) (*syncCallBack)(syncCallBackData);
     Record r;
     r.time = CTime::getTime();
@@ -248,6 +363,7 @@ void AdvancedTimer::end(IdTimer id, std::ostream& result)
         msg_error("AdvancedTimer::end") << "timer[" << id << "] does not correspond to last call to begin(" << curTimer.top() << ")" ;
         return;
     }
+    if (Tracer::isEnabled()) Tracer::end();
     helper::vector<Record>* curRecords = getCurRecords();
     if (curRecords)
     {
@@ -258,8 +374,9 @@ void AdvancedTimer::end(IdTimer id, std::ostream& result)
         r.id = id;
         curRecords->push_back(r);
 
-        TimerData& data = timers[curTimer.top()];
+        TimerData& data = getTimerData(curTimer.top());
         data.process();
+        data.processThreads();
         if (data.nbIter == data.interval)
         {
             data.print(result);
@@ -273,7 +390,7 @@ void AdvancedTimer::end(IdTimer id, std::ostream& result)
     }
     else
     {
-        TimerData& data = timers[curTimer.top()];
+        TimerData& data = getTimerData(curTimer.top());
         setCurRecords((data.interval == 0) ? nullptr : &(data.records));
     }
 }
@@ -292,8 +409,9 @@ void AdvancedTimer::end(IdTimer id)
         msg_error("AdvancedTimer::end") << "timer[" << id << "] does not correspond to last call to begin(" << curTimer.top() << ")" ;
         return;
     }
+    if (Tracer::isEnabled()) Tracer::end();
 
-    TimerData& dataT = timers[id];
+    TimerData& dataT = getTimerData(id);
     if (dataT.timerOutputType == GUI || dataT.timerOutputType == LJSON || dataT.timerOutputType == JSON)
     {
         dataT.clear();
@@ -310,8 +428,9 @@ void AdvancedTimer::end(IdTimer id)
         r.id = id;
         curRecords->push_back(r);
 
-        TimerData& data = timers[curTimer.top()];
+        TimerData& data = getTimerData(curTimer.top());
         data.process();
+        data.processThreads();
         if (data.nbIter == data.interval)
         {
             data.print();
@@ -325,14 +444,14 @@ void AdvancedTimer::end(IdTimer id)
     }
     else
     {
-        TimerData& data = timers[curTimer.top()];
+        TimerData& data = getTimerData(curTimer.top());
         setCurRecords((data.interval == 0) ? nullptr : &(data.records));
     }
 }
 
 std::string AdvancedTimer::end(IdTimer id, double time, double dt)
 {
-    TimerData& data = timers[id];
+    TimerData& data = getTimerData(id);
     if(!data.id)
     {
         return std::string("");
@@ -359,6 +478,7 @@ bool AdvancedTimer::isActive()
 
 void AdvancedTimer::stepBegin(IdStep id)
 {
+    if (Tracer::isEnabled()) Tracer::beginStep(id);
     helper::vector<Record>* curRecords = getCurRecords();
     if (!curRecords) return;
     Record r;
@@ -370,6 +490,7 @@ void AdvancedTimer::stepBegin(IdStep id)
 
 void AdvancedTimer::stepBegin(IdStep id, IdObj obj)
 {
+    if (Tracer::isEnabled()) Tracer::beginStep(id);
     helper::vector<Record>* curRecords = getCurRecords();
     if (!curRecords) return;
     Record r;
@@ -382,6 +503,7 @@ void AdvancedTimer::stepBegin(IdStep id, IdObj obj)
 
 void AdvancedTimer::stepEnd  (IdStep id)
 {
+    if (Tracer::isEnabled()) Tracer::end();
     helper::vector<Record>* curRecords = getCurRecords();
     if (!curRecords) return;
     if (syncCallBack) (*syncCallBack)(syncCallBackData);
@@ -394,6 +516,7 @@ void AdvancedTimer::stepEnd  (IdStep id)
 
 void AdvancedTimer::stepEnd  (IdStep id, IdObj obj)
 {
+    if (Tracer::isEnabled()) Tracer::end();
     helper::vector<Record>* curRecords = getCurRecords();
     if (!curRecords) return;
     Record r;
@@ -406,6 +529,11 @@ void AdvancedTimer::stepEnd  (IdStep id, IdObj obj)
 
 void AdvancedTimer::stepNext (IdStep prevId, IdStep nextId)
 {
+    if (Tracer::isEnabled())
+    {
+        Tracer::end();
+        Tracer::beginStep(nextId);
+    }
     helper::vector<Record>* curRecords = getCurRecords();
     if (!curRecords) return;
     Record r;
@@ -483,49 +611,82 @@ void AdvancedTimer::end(const char* idStr)
 void AdvancedTimer::stepBegin(const char* idStr)
 {
     helper::vector<Record>* curRecords = getCurRecords();
-    if (!curRecords) return;
+    if (!curRecords)
+    {
+        // the threads without active timer are traced all the same
+        if (Tracer::isEnabled()) Tracer::begin(idStr);
+        return;
+    }
     stepBegin(IdStep(idStr));
 }
 
 void AdvancedTimer::stepBegin(const char* idStr, const char* objStr)
 {
     helper::vector<Record>* curRecords = getCurRecords();
-    if (!curRecords) return;
+    if (!curRecords)
+    {
+        if (Tracer::isEnabled()) Tracer::begin(idStr);
+        return;
+    }
     stepBegin(IdStep(idStr), IdObj(objStr));
 }
 
 void AdvancedTimer::stepBegin(const char* idStr, const std::string& objStr)
 {
     helper::vector<Record>* curRecords = getCurRecords();
-    if (!curRecords) return;
+    if (!curRecords)
+    {
+        if (Tracer::isEnabled()) Tracer::begin(idStr);
+        return;
+    }
     stepBegin(IdStep(idStr), IdObj(objStr));
 }
 
 void AdvancedTimer::stepEnd  (const char* idStr)
 {
     helper::vector<Record>* curRecords = getCurRecords();
-    if (!curRecords) return;
+    if (!curRecords)
+    {
+        if (Tracer::isEnabled()) Tracer::end();
+        return;
+    }
     stepEnd  (IdStep(idStr));
 }
 
 void AdvancedTimer::stepEnd  (const char* idStr, const char* objStr)
 {
     helper::vector<Record>* curRecords = getCurRecords();
-    if (!curRecords) return;
+    if (!curRecords)
+    {
+        if (Tracer::isEnabled()) Tracer::end();
+        return;
+    }
     stepEnd  (IdStep(idStr), IdObj(objStr));
 }
 
 void AdvancedTimer::stepEnd  (const char* idStr, const std::string& objStr)
 {
     helper::vector<Record>* curRecords = getCurRecords();
-    if (!curRecords) return;
+    if (!curRecords)
+    {
+        if (Tracer::isEnabled()) Tracer::end();
+        return;
+    }
     stepEnd  (IdStep(idStr), IdObj(objStr));
 }
 
 void AdvancedTimer::stepNext (const char* prevIdStr, const char* nextIdStr)
 {
     helper::vector<Record>* curRecords = getCurRecords();
-    if (!curRecords) return;
+    if (!curRecords)
+    {
+        if (Tracer::isEnabled())
+        {
+            Tracer::end();
+            Tracer::begin(nextIdStr);
+        }
+        return;
+    }
     stepNext (IdStep(prevIdStr), IdStep(nextIdStr));
 }
 
@@ -571,6 +732,10 @@ void TimerData::clear()
     stepData.clear();
     vals.clear();
     valData.clear();
+    for (auto& data : threadData)
+    {
+        if (data) data->clear();
+    }
 }
 
 void TimerData::process()
@@ -622,6 +787,7 @@ void TimerData::process()
             if (data.lastIt == nbIter)
             {
                 ctime_t dur = t - data.lastTime;
+                if (statistics) statistics->iterationTimes[id] += dur;
                 data.ttotal += dur;
                 data.ttotal2 += dur*dur;
                 data.label = std::string(id);
@@ -683,6 +849,165 @@ void TimerData::process()
             if (data.num == 1 || data.vtotalIt > data.vmax) data.vmax = data.vtotalIt;
         }
     }
+
+    if (statistics) statistics->endIteration(std::string(id));
+}
+
+void TimerData::processThreads()
+{
+    TimerData* timer = this;
+    if (!sharedTimer.compare_exchange_strong(timer, nullptr)) return;
+
+    std::lock_guard<std::mutex> lock(threadMutex);
+    for (const auto& t : threadRecords)
+    {
+        if (threadData.size() < std::size_t(t->index))
+            threadData.resize(t->index);
+        std::unique_ptr<TimerData>& data = threadData[t->index-1];
+        if (!data)
+        {
+            data.reset(new TimerData);
+            data->id = id;
+        }
+    }
+
+    // the records of each thread span the whole iteration of this timer, idle time included
+    for (auto& data : threadData)
+    {
+        if (!data) continue;
+        data->records.clear();
+        data->records.push_back(records.front());
+    }
+    for (const auto& t : threadRecords)
+    {
+        helper::vector<Record>& dataRecords = threadData[t->index-1]->records;
+        dataRecords.insert(dataRecords.end(), t->records.begin(), t->records.end());
+    }
+    for (auto& data : threadData)
+    {
+        if (!data) continue;
+        data->records.push_back(records.back());
+        data->process();
+    }
+    threadRecords.clear();
+}
+
+void TimerStatistics::endIteration(const std::string& timerName)
+{
+    static const double msPerTick = 1000.0 / (double)CTime::getTicksPerSec();
+    std::lock_guard<std::mutex> lock(mutex);
+    if (window == 0)
+    {
+        iterationTimes.clear();
+        return;
+    }
+
+    // the window is made of NbSlices slices of iterations, the oldest one being forgotten as a whole
+    const unsigned int sliceSize = std::max(1u, window / NbSlices);
+    if (nbIter > 0 && nbIter % sliceSize == 0)
+    {
+        for (auto& histogram : histograms)
+            histogram.second.nextSlice();
+    }
+    ++nbIter;
+
+    for (const auto& time : iterationTimes)
+    {
+        auto it = histograms.find(time.first);
+        if (it == histograms.end())
+        {
+            steps.push_back(time.first);
+            it = histograms.emplace(time.first, RollingHistogram(NbSlices)).first;
+        }
+        it->second.add(msPerTick * (double)time.second);
+    }
+    iterationTimes.clear();
+
+    if (file.is_open() && nbIter % samplingInterval == 0)
+        writeSample(timerName);
+}
+
+helper::vector<StepStatistics> TimerStatistics::getStatistics()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    helper::vector<StepStatistics> statistics;
+    for (const AdvancedTimer::IdStep& step : steps)
+    {
+        const RollingHistogram& histogram = histograms.at(step);
+        StepStatistics stepStatistics;
+        stepStatistics.label = step ? std::string(step) : std::string("TOTAL");
+        stepStatistics.count = std::size_t(histogram.getCount());
+        stepStatistics.p50 = histogram.getPercentile(50);
+        stepStatistics.p95 = histogram.getPercentile(95);
+        stepStatistics.p99 = histogram.getPercentile(99);
+        stepStatistics.max = histogram.getMax();
+        statistics.push_back(stepStatistics);
+    }
+    return statistics;
+}
+
+void TimerStatistics::setFile(const std::string& fileName, unsigned int interval)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (file.is_open()) file.close();
+    samplingInterval = std::max(1u, interval);
+    if (fileName.empty()) return;
+
+    file.open(fileName.c_str());
+    if (!file.is_open())
+    {
+        msg_error("AdvancedTimer") << "Unable to write the statistics in " << fileName;
+        return;
+    }
+    csv = fileName.size() < 5 || fileName.compare(fileName.size() - 5, 5, ".json") != 0;
+    if (csv)
+        file << "iteration,timer,step,count,p50,p95,p99,max\n";
+}
+
+void TimerStatistics::writeSample(const std::string& timerName)
+{
+    // called with the mutex locked
+    const auto quoted = [](const std::string& name)
+    {
+        std::string str = "\"";
+        for (char c : name)
+        {
+            if (c == '"') str += '"';
+            str += c;
+        }
+        return str + "\"";
+    };
+
+    json sample;
+    for (const AdvancedTimer::IdStep& step : steps)
+    {
+        const RollingHistogram& histogram = histograms.at(step);
+        const std::string label = step ? std::string(step) : std::string("TOTAL");
+        if (csv)
+        {
+            file << nbIter << ',' << quoted(timerName) << ',' << quoted(label) << ',' << histogram.getCount() << ','
+                 << histogram.getPercentile(50) << ',' << histogram.getPercentile(95) << ','
+                 << histogram.getPercentile(99) << ',' << histogram.getMax() << '\n';
+        }
+        else
+        {
+            json stepSample;
+            stepSample["step"] = label;
+            stepSample["count"] = histogram.getCount();
+            stepSample["p50"] = histogram.getPercentile(50);
+            stepSample["p95"] = histogram.getPercentile(95);
+            stepSample["p99"] = histogram.getPercentile(99);
+            stepSample["max"] = histogram.getMax();
+            sample["steps"].push_back(stepSample);
+        }
+    }
+    if (!csv)
+    {
+        sample["iteration"] = nbIter;
+        sample["timer"] = timerName;
+        file << sample.dump() << '\n';
+    }
+    file.flush();
 }
 
 void printVal(std::ostream& out, double v)
@@ -791,6 +1116,90 @@ void printTime(std::ostream& out, ctime_t t, int niter=1)
     printVal(out, 1000.0 * (double)t / (double)(niter*timer_freq));
 }
 
+void TimerData::printSteps(std::ostream& out)
+{
+    out << " LEVEL\t START\t  NUM\t   MIN\t   MAX\t MEAN\t  DEV\t TOTAL\tPERCENT\tID\n";
+    ctime_t ttotal = stepData[AdvancedTimer::IdStep()].ttotal;
+    for (unsigned int s=0; s<steps.size(); ++s)
+    {
+        StepData& data = stepData[steps[s]];
+        printVal(out, data.level);
+        out << '\t';
+        printTime(out, data.tstart, data.numIt);
+        out << '\t';
+        printVal(out, data.num, (s == 0) ? 1 : nbIter);
+        out << '\t';
+        printTime(out, data.tmin);
+        out << '\t';
+        printTime(out, data.tmax);
+        out << '\t';
+        double mean = (double)data.ttotal / data.num;
+        printTime(out, (ctime_t)mean);
+        out << '\t';
+        printTime(out, (ctime_t)(sqrt((double)data.ttotal2/data.num - mean*mean)));
+        out << '\t';
+        printTime(out, data.ttotal, (s == 0) ? 1 : nbIter);
+        out << '\t';
+        printVal(out, 100.0*data.ttotal / (double) ttotal);
+        out << '\t';
+        if (s == 0)
+            out << "TOTAL";
+        else
+        {
+            for(int ii=0; ii<data.level; ii++) out<<".";  // indentation to show the hierarchy level
+            out << steps[s];
+        }
+        out << std::endl;
+    }
+}
+
+void TimerData::printThreads(std::ostream& out)
+{
+    // aggregated statistics of the steps of all the threads
+    TimerData total;
+    total.nbIter = nbIter;
+    total.steps = steps;
+    total.stepData = stepData;
+    bool hasThreads = false;
+
+    for (std::size_t i = 0; i < threadData.size(); ++i)
+    {
+        TimerData* data = threadData[i].get();
+        if (!data || data->steps.size() <= 1) continue; // no step, only the iterations of the timer
+        hasThreads = true;
+
+        out << "\nThread " << i+1 << " Steps Duration Statistics (in ms) :\n";
+        data->printSteps(out);
+
+        for (unsigned int s=1; s<data->steps.size(); ++s)
+        {
+            const StepData& threadStepData = data->stepData[data->steps[s]];
+            auto it = total.stepData.find(data->steps[s]);
+            if (it == total.stepData.end())
+            {
+                total.steps.push_back(data->steps[s]);
+                total.stepData[data->steps[s]] = threadStepData;
+                continue;
+            }
+            StepData& totalData = it->second;
+            if (threadStepData.num == 0) continue;
+            if (totalData.num == 0 || threadStepData.tmin < totalData.tmin) totalData.tmin = threadStepData.tmin;
+            if (totalData.num == 0 || threadStepData.tmax > totalData.tmax) totalData.tmax = threadStepData.tmax;
+            totalData.num += threadStepData.num;
+            totalData.numIt = std::max(totalData.numIt, threadStepData.numIt);
+            totalData.ttotal += threadStepData.ttotal;
+            totalData.ttotal2 += threadStepData.ttotal2;
+        }
+    }
+
+    if (hasThreads)
+    {
+        // the percentages are relative to the duration of the timer: above 100% the step ran in parallel
+        out << "\nAll Threads Steps Duration Statistics (in ms) :\n";
+        total.printSteps(out);
+    }
+}
+
 void TimerData::print()
 {
     static ctime_t tmargin = CTime::getTicksPerSec() / 100000;
@@ -862,40 +1271,9 @@ void TimerData::print()
     if (!steps.empty())
     {
         out << "\nSteps Duration Statistics (in ms) :\n";
-        out << " LEVEL\t START\t  NUM\t   MIN\t   MAX\t MEAN\t  DEV\t TOTAL\tPERCENT\tID\n";
-        ctime_t ttotal = stepData[AdvancedTimer::IdStep()].ttotal;
-        for (unsigned int s=0; s<steps.size(); ++s)
-        {
-            StepData& data = stepData[steps[s]];
-            printVal(out, data.level);
-            out << '\t';
-            printTime(out, data.tstart, data.numIt);
-            out << '\t';
-            printVal(out, data.num, (s == 0) ? 1 : nbIter);
-            out << '\t';
-            printTime(out, data.tmin);
-            out << '\t';
-            printTime(out, data.tmax);
-            out << '\t';
-            double mean = (double)data.ttotal / data.num;
-            printTime(out, (ctime_t)mean);
-            out << '\t';
-            printTime(out, (ctime_t)(sqrt((double)data.ttotal2/data.num - mean*mean)));
-            out << '\t';
-            printTime(out, data.ttotal, (s == 0) ? 1 : nbIter);
-            out << '\t';
-            printVal(out, 100.0*data.ttotal / (double) ttotal);
-            out << '\t';
-            if (s == 0)
-                out << "TOTAL";
-            else
-            {
-                for(int ii=0; ii<data.level; ii++) out<<".";  // indentation to show the hierarchy level
-                out << steps[s];
-            }
-            out << std::endl;
-        }
+        printSteps(out);
     }
+    printThreads(out);
     if (!vals.empty())
     {
         out << "\nValues Statistics :\n";
@@ -948,7 +1326,7 @@ AdvancedTimer::outputType AdvancedTimer::convertOutputType(std::string type)
 void AdvancedTimer::setOutputType(IdTimer id, const std::string& type)
 {
     // Seek for the timer
-    TimerData& data = timers[id];
+    TimerData& data = getTimerData(id);
     if (!data.id)
     {
         data.init(id);
@@ -959,7 +1337,7 @@ void AdvancedTimer::setOutputType(IdTimer id, const std::string& type)
 
 AdvancedTimer::outputType AdvancedTimer::getOutputType(IdTimer id)
 {
-	TimerData& data = timers[id];
+	TimerData& data = getTimerData(id);
 	return data.timerOutputType;
 }
 
@@ -1157,6 +1535,7 @@ void TimerData::print(std::ostream& result)
             out << std::endl;
         }
     }
+    printThreads(out);
 
     //out << "\n==== END ====\n";
     out << std::endl;
@@ -1389,7 +1768,7 @@ json TimerData::getLightJson(std::string stepNumber)
 
 helper::vector<AdvancedTimer::IdStep> AdvancedTimer::getSteps(IdTimer id, bool processData)
 {
-    TimerData& data = timers[id];
+    TimerData& data = getTimerData(id);
     if (processData)
         data.process();
     return data.steps;
@@ -1397,15 +1776,67 @@ helper::vector<AdvancedTimer::IdStep> AdvancedTimer::getSteps(IdTimer id, bool p
 
 std::map<AdvancedTimer::IdStep, StepData> AdvancedTimer::getStepData(IdTimer id, bool processData)
 {
-    TimerData& data = timers[id];
+    TimerData& data = getTimerData(id);
     if (processData)
         data.process();
     return data.stepData;
 }
 
+std::map<int, std::map<AdvancedTimer::IdStep, StepData> > AdvancedTimer::getThreadStepData(IdTimer id)
+{
+    TimerData& data = getTimerData(id);
+    std::map<int, std::map<AdvancedTimer::IdStep, StepData> > threadStepData;
+    for (std::size_t i = 0; i < data.threadData.size(); ++i)
+    {
+        if (data.threadData[i])
+            threadStepData[int(i+1)] = data.threadData[i]->stepData;
+    }
+    return threadStepData;
+}
+
+void AdvancedTimer::setStatistics(IdTimer id, unsigned int window)
+{
+    TimerData& data = getTimerData(id);
+    if (!data.statistics)
+    {
+        if (window > 0)
+            data.statistics.reset(new TimerStatistics(window));
+        return;
+    }
+
+    // the statistics are kept (and emptied when the window is 0) as the timer may be ending an iteration
+    std::lock_guard<std::mutex> lock(data.statistics->mutex);
+    data.statistics->window = window;
+    if (window == 0)
+    {
+        data.statistics->nbIter = 0;
+        data.statistics->histograms.clear();
+        data.statistics->steps.clear();
+    }
+}
+
+helper::vector<StepStatistics> AdvancedTimer::getStatistics(IdTimer id)
+{
+    TimerData& data = getTimerData(id);
+    if (!data.statistics)
+        return helper::vector<StepStatistics>();
+    return data.statistics->getStatistics();
+}
+
+void AdvancedTimer::setStatisticsFile(IdTimer id, const std::string& fileName, unsigned int samplingInterval)
+{
+    TimerData& data = getTimerData(id);
+    if (!data.statistics)
+    {
+        msg_error("AdvancedTimer") << "No statistics for timer[" << id << "]: call setStatistics first";
+        return;
+    }
+    data.statistics->setFile(fileName, samplingInterval);
+}
+
 helper::vector<Record> AdvancedTimer::getRecords(IdTimer id)
 {
-    TimerData& data = timers[id];
+    TimerData& data = getTimerData(id);
     for (Record & r : data.records) {
         switch (r.type) {
             case Record::RBEGIN: // Timer begins
@@ -1438,7 +1869,7 @@ helper::vector<Record> AdvancedTimer::getRecords(IdTimer id)
 
 void AdvancedTimer::clearData(IdTimer id)
 {
-    TimerData& data = timers[id];
+    TimerData& data = getTimerData(id);
     data.clear();
 }
 
@@ -1477,8 +1908,9 @@ std::string AdvancedTimer::getTimeAnalysis(IdTimer id, double time, double delta
         r.id = id;
         curRecords->push_back(r);
 
-        TimerData& data = timers[curTimer.top()];
+        TimerData& data = getTimerData(curTimer.top());
         data.process();
+        data.processThreads();
         if (data.nbIter == data.interval)
         {
             // Get values and create the JSON output
@@ -1500,7 +1932,7 @@ std::string AdvancedTimer::getTimeAnalysis(IdTimer id, double time, double delta
     }
     else
     {
-        TimerData& data = timers[curTimer.top()];
+        TimerData& data = getTimerData(curTimer.top());
         setCurRecords((data.interval == 0) ? nullptr : &(data.records));
     }
 
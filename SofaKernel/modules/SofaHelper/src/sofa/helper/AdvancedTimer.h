@@ -30,6 +30,9 @@
 #include <istream>
 #include <string>
 #include <map>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
 
 namespace sofa::simulation
 {
@@ -81,6 +84,10 @@ namespace sofa::helper
   * When reloading/reseting the simulation:
     AdvancedTimer::clear();
 
+  * The steps and values of the threads which did not begin a timer (i.e. the
+    task scheduler workers) are recorded in a buffer of their own for the
+    timer begun first, and reported per thread and aggregated when it ends.
+
 
   The produced stats will looks like:
 
@@ -152,6 +159,19 @@ public:
     StepData() : level(0), num(0), numIt(0), tstart(0), tmin(0), tmax(0), ttotal(0), ttotal2(0), lastIt(-1), lastTime(0) {}
 };
 
+/// Rolling statistics of the durations of a step (in ms) over the last iterations of a timer
+class StepStatistics
+{
+public:
+    std::string label;
+    std::size_t count; ///< number of iterations with this step in the window
+    double p50;
+    double p95;
+    double p99;
+    double max;
+    StepStatistics() : count(0), p50(0), p95(0), p99(0), max(0) {}
+};
+
 class SOFA_HELPER_API AdvancedTimer
 {
 public:
@@ -168,9 +188,16 @@ public:
             /// the list of the id names. the Ids are the indices in the vector
             std::vector<std::string> idsList;
 
+            /// the Ids of the names, to find them without going through idsList
+            std::unordered_map<std::string, unsigned int> ids;
+
+            /// the Ids are shared by all the threads, so that the records of the threads can be merged
+            mutable std::shared_mutex mutex;
+
             IdFactory()
             {
                 idsList.push_back(std::string("0")); // ID 0 == "0" or empty string
+                ids.emplace(idsList.back(), 0u);
             }
             
         public:
@@ -184,34 +211,34 @@ public:
                 if (name.empty())
                     return 0;
                 IdFactory& idfac = getInstance();
-                std::vector<std::string>::iterator it = idfac.idsList.begin();
-                unsigned int i = 0;
-
-                while (it != idfac.idsList.end() && (*it) != name)
                 {
-                    ++it;
-                    i++;
+                    std::shared_lock<std::shared_mutex> lock(idfac.mutex);
+                    auto it = idfac.ids.find(name);
+                    if (it != idfac.ids.end())
+                        return it->second;
                 }
 
-                if (it!=idfac.idsList.end())
-                    return i;
-                else
-                {
+                std::unique_lock<std::shared_mutex> lock(idfac.mutex);
+                auto inserted = idfac.ids.emplace(name, (unsigned int)idfac.idsList.size());
+                if (inserted.second)
                     idfac.idsList.push_back(name);
-                    return i;
-                }
+                return inserted.first->second;
             }
 
             static std::size_t getLastID()
             {
-                return getInstance().idsList.size()-1;
+                IdFactory& idfac = getInstance();
+                std::shared_lock<std::shared_mutex> lock(idfac.mutex);
+                return idfac.idsList.size()-1;
             }
 
             /// return the name corresponding to the id in parameter
             static std::string getName(unsigned int id)
             {
-                if (id < getInstance().idsList.size())
-                    return getInstance().idsList[id];
+                IdFactory& idfac = getInstance();
+                std::shared_lock<std::shared_mutex> lock(idfac.mutex);
+                if (id < idfac.idsList.size())
+                    return idfac.idsList[id];
                 else
                     return "";
             }
@@ -219,12 +246,8 @@ public:
             /// return the instance of the factory. Creates it if doesn't exist yet.
             static IdFactory& getInstance()
             {
-                SOFA_THREAD_SPECIFIC_PTR(IdFactory, instance);
-                if (instance == nullptr)
-                {
-                    instance = new IdFactory;
-                }
-                return *instance;
+                static IdFactory instance;
+                return instance;
             }
         };
 
@@ -352,6 +375,36 @@ public:
      */
     static std::map<AdvancedTimer::IdStep, StepData> getStepData(IdTimer id, bool processData = false);
 
+    /**
+     * @brief getThreadStepData Return the StepData recorded by the other threads during the AdvancedTimer given execution
+     * @param id IdTimer, id of the timer
+     * @return The timer StepData of each timer step inside a map, for each thread index
+     */
+    static std::map<int, std::map<AdvancedTimer::IdStep, StepData> > getThreadStepData(IdTimer id);
+
+    /**
+     * @brief setStatistics Compute the rolling percentiles of the durations of the steps of the
+     * AdvancedTimer over its last iterations, in a fixed memory, while the timer is enabled
+     * @param id IdTimer, id of the timer
+     * @param window unsigned int, number of iterations in the statistics, 0 to stop and clear them
+     */
+    static void setStatistics(IdTimer id, unsigned int window);
+
+    /**
+     * @brief getStatistics Return the rolling statistics of the AdvancedTimer, to watch them during the simulation
+     * @param id IdTimer, id of the timer
+     * @return The statistics of the durations of the timer (TOTAL) then of each step, per iteration
+     */
+    static helper::vector<StepStatistics> getStatistics(IdTimer id);
+
+    /**
+     * @brief setStatisticsFile Write the rolling statistics of the AdvancedTimer every samplingInterval iterations
+     * @param id IdTimer, id of the timer
+     * @param fileName std::string, .csv file (one line per step) or .json file (one JSON object per sample and line), empty to stop writing
+     * @param samplingInterval unsigned int, number of iterations between two samples
+     */
+    static void setStatisticsFile(IdTimer id, const std::string& fileName, unsigned int samplingInterval);
+
     /**
      * @brief getRecords the vector of Record of the AdvancedTimer given execution id.
      * @param id IdTimer, id of the timer
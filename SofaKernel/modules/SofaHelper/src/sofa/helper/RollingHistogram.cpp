@@ -0,0 +1,128 @@
+/******************************************************************************
+*                 SOFA, Simulation Open-Framework Architecture                *
+*                    (c) 2006 INRIA, USTL, UJF, CNRS, MGH                     *
+*                                                                             *
+* This program is free software; you can redistribute it and/or modify it     *
+* under the terms of the GNU Lesser General Public License as published by    *
+* the Free Software Foundation; either version 2.1 of the License, or (at     *
+* your option) any later version.                                             *
+*                                                                             *
+* This program is distributed in the hope that it will be useful, but WITHOUT *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License *
+* for more details.                                                           *
+*                                                                             *
+* You should have received a copy of the GNU Lesser General Public License    *
+* along with this program. If not, see <http://www.gnu.org/licenses/>.        *
+*******************************************************************************
+* Authors: The SOFA Team and external contributors (see Authors.txt)          *
+*                                                                             *
+* Contact information: contact@sofa-framework.org                             *
+******************************************************************************/
+#include <sofa/helper/RollingHistogram.h>
+
+#include <algorithm>
+#include <cmath>
+
+namespace sofa::helper
+{
+
+namespace
+{
+    /// the values are counted in units of 1e-6
+    constexpr double UnitsPerValue = 1e6;
+    /// 64 linear buckets for the values below 64 units, then 32 per power of two
+    constexpr unsigned int SubBucketBits = 6;
+    constexpr unsigned int SubBucketCount = 1u << SubBucketBits;
+    constexpr unsigned int HalfSubBucketCount = SubBucketCount / 2;
+    /// values up to 2^41 units (2.2e6)
+    constexpr unsigned int MaxBit = 40;
+    constexpr unsigned int NbBuckets = SubBucketCount + (MaxBit - SubBucketBits + 1) * HalfSubBucketCount;
+    /// largest value which can be converted to units
+    constexpr double MaxValue = double((std::uint64_t(1) << (MaxBit + 1)) - 1) / UnitsPerValue;
+}
+
+RollingHistogram::RollingHistogram(unsigned int nbSlices)
+    : m_counts(std::size_t(std::max(nbSlices, 1u)) * NbBuckets, 0)
+    , m_maxs(std::max(nbSlices, 1u), 0.0)
+    , m_current(0)
+{
+}
+
+unsigned int RollingHistogram::getBucket(std::uint64_t units)
+{
+    if (units < SubBucketCount)
+        return unsigned(units);
+
+    units = std::min(units, (std::uint64_t(1) << (MaxBit + 1)) - 1);
+    unsigned int msb = 0;
+    while (units >> (msb + 1)) ++msb;
+    const unsigned int shift = msb - (SubBucketBits - 1);
+    return SubBucketCount + (shift - 1) * HalfSubBucketCount + unsigned(units >> shift) - HalfSubBucketCount;
+}
+
+double RollingHistogram::getBucketValue(unsigned int bucket)
+{
+    if (bucket < SubBucketCount)
+        return (bucket + 0.5) / UnitsPerValue;
+
+    const unsigned int shift = (bucket - SubBucketCount) / HalfSubBucketCount + 1;
+    const std::uint64_t lowest = std::uint64_t((bucket - SubBucketCount) % HalfSubBucketCount + HalfSubBucketCount) << shift;
+    return (double(lowest) + 0.5 * double(std::uint64_t(1) << shift)) / UnitsPerValue;
+}
+
+void RollingHistogram::add(double value)
+{
+    // clamped before the conversion to units, NaN being counted as 0
+    if (!(value > 0.0)) value = 0.0;
+    value = std::min(value, MaxValue);
+    ++m_counts[std::size_t(m_current) * NbBuckets + getBucket(std::uint64_t(value * UnitsPerValue))];
+    m_maxs[m_current] = std::max(m_maxs[m_current], value);
+}
+
+void RollingHistogram::nextSlice()
+{
+    m_current = (m_current + 1) % getNbSlices();
+    std::fill_n(m_counts.begin() + std::size_t(m_current) * NbBuckets, NbBuckets, 0u);
+    m_maxs[m_current] = 0.0;
+}
+
+void RollingHistogram::clear()
+{
+    std::fill(m_counts.begin(), m_counts.end(), 0u);
+    std::fill(m_maxs.begin(), m_maxs.end(), 0.0);
+}
+
+std::uint64_t RollingHistogram::getCount() const
+{
+    std::uint64_t count = 0;
+    for (std::uint32_t c : m_counts)
+        count += c;
+    return count;
+}
+
+double RollingHistogram::getPercentile(double percentile) const
+{
+    const std::uint64_t count = getCount();
+    if (count == 0)
+        return 0.0;
+
+    // rank of the value in the window, from 1
+    const std::uint64_t rank = std::max<std::uint64_t>(1, std::uint64_t(std::ceil(std::clamp(percentile, 0.0, 100.0) / 100.0 * double(count))));
+    std::uint64_t cumulated = 0;
+    for (unsigned int bucket = 0; bucket < NbBuckets; ++bucket)
+    {
+        for (unsigned int slice = 0; slice < getNbSlices(); ++slice)
+            cumulated += m_counts[std::size_t(slice) * NbBuckets + bucket];
+        if (cumulated >= rank)
+            return std::min(getBucketValue(bucket), getMax());
+    }
+    return getMax();
+}
+
+double RollingHistogram::getMax() const
+{
+    return *std::max_element(m_maxs.begin(), m_maxs.end());
+}
+
+} // namespace sofa::helper
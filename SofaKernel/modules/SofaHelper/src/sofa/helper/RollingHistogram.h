@@ -0,0 +1,78 @@
+/******************************************************************************
+*                 SOFA, Simulation Open-Framework Architecture                *
+*                    (c) 2006 INRIA, USTL, UJF, CNRS, MGH                     *
+*                                                                             *
+* This program is free software; you can redistribute it and/or modify it     *
+* under the terms of the GNU Lesser General Public License as published by    *
+* the Free Software Foundation; either version 2.1 of the License, or (at     *
+* your option) any later version.                                             *
+*                                                                             *
+* This program is distributed in the hope that it will be useful, but WITHOUT *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License *
+* for more details.                                                           *
+*                                                                             *
+* You should have received a copy of the GNU Lesser General Public License    *
+* along with this program. If not, see <http://www.gnu.org/licenses/>.        *
+*******************************************************************************
+* Authors: The SOFA Team and external contributors (see Authors.txt)          *
+*                                                                             *
+* Contact information: contact@sofa-framework.org                             *
+******************************************************************************/
+#pragma once
+#include <sofa/helper/config.h>
+
+#include <cstdint>
+#include <vector>
+
+namespace sofa::helper
+{
+
+/**
+  Histogram of the values added during the last iterations, in a fixed memory, to get their
+  percentiles (i.e. the median, the 99th percentile) over a rolling window.
+
+  As in HDR histograms, the buckets are linear within each power of two, so the relative error of
+  a percentile is below 1/32 whatever its magnitude, for values from 1e-6 to 1e6 (i.e. ms).
+
+  The window is split into slices: nextSlice() starts a new slice, forgetting the values of the
+  oldest one. The maximum is exact.
+ */
+class SOFA_HELPER_API RollingHistogram
+{
+public:
+
+    /// histogram of the values of the last nbSlices slices
+    explicit RollingHistogram(unsigned int nbSlices = 4);
+
+    void add(double value);
+
+    /// start a new slice, replacing the oldest one
+    void nextSlice();
+
+    /// forget all the values
+    void clear();
+
+    /// number of values in the window
+    std::uint64_t getCount() const;
+
+    /// value below which lie percentile % of the values of the window (0 if there is none)
+    double getPercentile(double percentile) const;
+
+    /// largest value of the window (0 if there is none)
+    double getMax() const;
+
+    unsigned int getNbSlices() const { return unsigned(m_maxs.size()); }
+
+protected:
+
+    static unsigned int getBucket(std::uint64_t units);
+    static double getBucketValue(unsigned int bucket);
+
+    /// counts of each slice, one after the other
+    std::vector<std::uint32_t> m_counts;
+    std::vector<double> m_maxs;
+    unsigned int m_current;
+};
+
+} // namespace sofa::helper
@@ -0,0 +1,522 @@
+/******************************************************************************
+*                 SOFA, Simulation Open-Framework Architecture                *
+*                    (c) 2006 INRIA, USTL, UJF, CNRS, MGH                     *
+*                                                                             *
+* This program is free software; you can redistribute it and/or modify it     *
+* under the terms of the GNU Lesser General Public License as published by    *
+* the Free Software Foundation; either version 2.1 of the License, or (at     *
+* your option) any later version.                                             *
+*                                                                             *
+* This program is distributed in the hope that it will be useful, but WITHOUT *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License *
+* for more details.                                                           *
+*                                                                             *
+* You should have received a copy of the GNU Lesser General Public License    *
+* along with this program. If not, see <http://www.gnu.org/licenses/>.        *
+*******************************************************************************
+* Authors: The SOFA Team and external contributors (see Authors.txt)          *
+*                                                                             *
+* Contact information: contact@sofa-framework.org                             *
+******************************************************************************/
+#include <sofa/helper/Tracer.h>
+#include <sofa/helper/AdvancedTimer.h>
+#include <sofa/helper/NameDecoder.h>
+#include <sofa/helper/logging/Messaging.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace sofa::helper
+{
+
+std::atomic<bool> Tracer::s_enabled(false);
+
+namespace
+{
+
+typedef std::chrono::steady_clock Clock;
+
+enum class EventType : std::uint8_t { Begin, End, Instant };
+
+struct Event
+{
+    std::int64_t time; ///< ns since the start of the tracer
+    std::uint32_t name; ///< index in the names of the thread
+    EventType type;
+};
+
+/// events per thread, a power of 2
+constexpr std::uint64_t BufferSize = 1 << 16;
+
+/// Events of one thread. Written by its thread only, while the trace may be written by another thread:
+/// the events are published by count (release), the names and the thread name are shared under namesMutex.
+class ThreadBuffer
+{
+public:
+
+    ThreadBuffer(int tid, const std::string& name)
+        : events(BufferSize)
+        , count(0)
+        , first(0)
+        , tid(tid)
+        , threadName(name.empty() ? "Thread " + std::to_string(tid) : name)
+        , alive(true)
+    {
+    }
+
+    void push(EventType type, std::uint32_t name, std::int64_t time)
+    {
+        const std::uint64_t c = count.load(std::memory_order_relaxed);
+        events[c & (BufferSize - 1)] = { time, name, type };
+        count.store(c + 1, std::memory_order_release);
+    }
+
+    std::uint32_t addName(std::string name)
+    {
+        std::lock_guard<std::mutex> lock(namesMutex);
+        names.push_back(std::move(name));
+        return std::uint32_t(names.size() - 1);
+    }
+
+    void setThreadName(const std::string& name)
+    {
+        std::lock_guard<std::mutex> lock(namesMutex);
+        threadName = name;
+    }
+
+    std::uint32_t getName(const char* name)
+    {
+        // the pointer is usually a literal: check the cached index before hashing the string
+        auto cached = pointerNames.find(name);
+        if (cached != pointerNames.end() && names[cached->second] == name)
+        {
+            return cached->second;
+        }
+
+        std::uint32_t index;
+        auto it = stringNames.find(name);
+        if (it != stringNames.end())
+        {
+            index = it->second;
+        }
+        else
+        {
+            index = addName(name);
+            stringNames.emplace(name, index);
+        }
+        pointerNames[name] = index;
+        return index;
+    }
+
+    std::vector<Event> events;
+    std::atomic<std::uint64_t> count; ///< number of events written since the creation
+    std::uint64_t first; ///< first event not exported yet
+
+    /// added by the thread of the buffer only, which reads them without lock
+    std::vector<std::string> names;
+    std::mutex namesMutex;
+    std::unordered_map<const void*, std::uint32_t> pointerNames;
+    std::unordered_map<std::string, std::uint32_t> stringNames;
+    std::unordered_map<const std::type_info*, std::uint32_t> typeNames;
+    std::unordered_map<unsigned int, std::uint32_t> stepNames;
+    std::unordered_map<unsigned int, std::uint32_t> timerNames;
+
+    /// events begun in a previous trace and not ended yet, continued in the next trace
+    std::vector<std::uint32_t> openEvents;
+
+    const int tid;
+    std::string threadName;
+    std::atomic<bool> alive;
+};
+
+struct TracerState
+{
+    std::mutex mutex;
+    std::vector< std::unique_ptr<ThreadBuffer> > buffers;
+    int nextTid = 0;
+
+    Clock::time_point epoch = Clock::now();
+    std::int64_t lastWriteTime = 0;
+
+    std::string fileName;
+    unsigned int stepsPerFile = 1;
+    unsigned int nbSteps = 0;
+    unsigned int nbFiles = 0;
+};
+
+TracerState& getState()
+{
+    static TracerState state;
+    return state;
+}
+
+std::int64_t now()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - getState().epoch).count();
+}
+
+/// buffer of the calling thread, created at its first event and kept by the tracer after the end of
+/// the thread until its events are written
+class ThreadBufferRef
+{
+public:
+    ~ThreadBufferRef()
+    {
+        if (buffer)
+        {
+            buffer->alive.store(false, std::memory_order_release);
+        }
+    }
+
+    ThreadBuffer& get()
+    {
+        if (!buffer)
+        {
+            TracerState& state = getState();
+            std::lock_guard<std::mutex> lock(state.mutex);
+            state.buffers.emplace_back(new ThreadBuffer(state.nextTid++, threadName));
+            buffer = state.buffers.back().get();
+        }
+        return *buffer;
+    }
+
+    ThreadBuffer* buffer = nullptr;
+    std::string threadName; ///< name given before the creation of the buffer
+};
+
+ThreadBufferRef& getThreadBufferRef()
+{
+    static thread_local ThreadBufferRef ref;
+    return ref;
+}
+
+ThreadBuffer& getThreadBuffer()
+{
+    return getThreadBufferRef().get();
+}
+
+void writeString(std::ostream& out, const std::string& str)
+{
+    out << '"';
+    for (char c : str)
+    {
+        switch (c)
+        {
+        case '"': out << "\\\""; break;
+        case '\\': out << "\\\\"; break;
+        case '\n': out << "\\n"; break;
+        case '\t': out << "\\t"; break;
+        default:
+            if (static_cast<unsigned char>(c) >= 0x20)
+            {
+                out << c;
+            }
+        }
+    }
+    out << '"';
+}
+
+void writeEvent(std::ostream& out, bool& firstEvent, char phase, const std::string& name, std::int64_t time, int tid)
+{
+    out << (firstEvent ? "\n" : ",\n");
+    firstEvent = false;
+    out << "{\"name\":";
+    writeString(out, name);
+    out << ",\"ph\":\"" << phase << "\",\"ts\":" << (time / 1000) << '.' << std::setw(3) << std::setfill('0') << (time % 1000)
+        << ",\"pid\":0,\"tid\":" << tid;
+    if (phase == 'i')
+    {
+        out << ",\"s\":\"t\"";
+    }
+    out << '}';
+}
+
+/// to call with the mutex of the state locked. The threads may keep on recording: the events
+/// published before the call are copied, and the copies overwritten meanwhile are dropped.
+void writeTrace(TracerState& state, std::ostream& out)
+{
+    const std::int64_t time = now();
+    bool firstEvent = true;
+    std::vector<Event> events;
+
+    out << "{\"traceEvents\":[";
+    for (const auto& buffer : state.buffers)
+    {
+        const std::uint64_t count = buffer->count.load(std::memory_order_acquire);
+        if (count == buffer->first && buffer->openEvents.empty())
+        {
+            continue;
+        }
+
+        std::uint64_t first = std::max(buffer->first, count > BufferSize ? count - BufferSize : 0);
+        events.clear();
+        for (std::uint64_t i = first; i < count; ++i)
+        {
+            events.push_back(buffer->events[i & (BufferSize - 1)]);
+        }
+        // the slots reused by the thread during the copy are not valid
+        const std::uint64_t written = buffer->count.load(std::memory_order_acquire);
+        const std::uint64_t valid = written > BufferSize ? written - BufferSize : 0;
+        if (valid > first)
+        {
+            events.erase(events.begin(), events.begin() + std::ptrdiff_t(std::min(valid, count) - first));
+            first = std::min(valid, count);
+        }
+        if (first != buffer->first)
+        {
+            // the ring buffer has been overwritten: the events still open are not known anymore
+            buffer->openEvents.clear();
+        }
+
+        std::lock_guard<std::mutex> namesLock(buffer->namesMutex);
+
+        out << (firstEvent ? "\n" : ",\n");
+        firstEvent = false;
+        out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":" << buffer->tid << ",\"args\":{\"name\":";
+        writeString(out, buffer->threadName);
+        out << "}}";
+
+        // events continued from the previous trace
+        std::vector<std::uint32_t>& open = buffer->openEvents;
+        for (std::uint32_t name : open)
+        {
+            writeEvent(out, firstEvent, 'B', buffer->names[name], state.lastWriteTime, buffer->tid);
+        }
+
+        for (const Event& event : events)
+        {
+            switch (event.type)
+            {
+            case EventType::Begin:
+                open.push_back(event.name);
+                writeEvent(out, firstEvent, 'B', buffer->names[event.name], event.time, buffer->tid);
+                break;
+            case EventType::End:
+                // the beginning may have been overwritten
+                if (!open.empty())
+                {
+                    writeEvent(out, firstEvent, 'E', buffer->names[open.back()], event.time, buffer->tid);
+                    open.pop_back();
+                }
+                break;
+            case EventType::Instant:
+                writeEvent(out, firstEvent, 'i', buffer->names[event.name], event.time, buffer->tid);
+                break;
+            }
+        }
+
+        // close the events still running, they are begun again in the next trace
+        for (auto it = open.rbegin(); it != open.rend(); ++it)
+        {
+            writeEvent(out, firstEvent, 'E', buffer->names[*it], time, buffer->tid);
+        }
+
+        buffer->first = count;
+    }
+    out << "\n],\"displayTimeUnit\":\"ms\"}\n";
+
+    state.lastWriteTime = time;
+
+    // the buffers of the threads which have ended are not needed anymore
+    state.buffers.erase(std::remove_if(state.buffers.begin(), state.buffers.end(),
+        [](const std::unique_ptr<ThreadBuffer>& buffer) { return !buffer->alive.load(std::memory_order_acquire); }),
+        state.buffers.end());
+}
+
+/// to call with the mutex of the state locked
+void writeFile(TracerState& state)
+{
+    std::string fileName = state.fileName;
+    if (fileName.size() > 5 && fileName.compare(fileName.size() - 5, 5, ".json") == 0)
+    {
+        fileName.resize(fileName.size() - 5);
+    }
+    fileName += "_" + std::to_string(state.nbFiles++) + ".json";
+
+    std::ofstream out(fileName);
+    if (!out)
+    {
+        msg_error("Tracer") << "cannot write the trace file " << fileName;
+        return;
+    }
+    writeTrace(state, out);
+}
+
+/// starts the tracer from SOFA_TRACE_FILE and SOFA_TRACE_STEPS, and writes the last steps at exit
+struct EnvironmentTracer
+{
+    EnvironmentTracer()
+    {
+        const char* file = std::getenv("SOFA_TRACE_FILE");
+        if (file == nullptr || *file == 0)
+        {
+            return;
+        }
+        const char* steps = std::getenv("SOFA_TRACE_STEPS");
+        const int nbSteps = (steps != nullptr) ? std::atoi(steps) : 0;
+        Tracer::start(file, nbSteps > 0 ? unsigned(nbSteps) : 100u);
+        started = true;
+    }
+
+    ~EnvironmentTracer()
+    {
+        if (started)
+        {
+            Tracer::stop();
+        }
+    }
+
+    bool started = false;
+};
+
+EnvironmentTracer environmentTracer;
+
+} // namespace
+
+
+void Tracer::start(const std::string& fileName, unsigned int stepsPerFile)
+{
+    TracerState& state = getState();
+    {
+        std::lock_guard<std::mutex> lock(state.mutex);
+        state.fileName = fileName;
+        state.stepsPerFile = (stepsPerFile > 0) ? stepsPerFile : 1;
+        state.nbSteps = 0;
+        state.nbFiles = 0;
+    }
+    clear();
+    s_enabled.store(true, std::memory_order_relaxed);
+}
+
+void Tracer::stop()
+{
+    if (!isEnabled())
+    {
+        return;
+    }
+    s_enabled.store(false, std::memory_order_relaxed);
+
+    TracerState& state = getState();
+    std::lock_guard<std::mutex> lock(state.mutex);
+    if (state.nbSteps % state.stepsPerFile != 0 && !state.fileName.empty())
+    {
+        writeFile(state);
+    }
+}
+
+void Tracer::endStep()
+{
+    if (!isEnabled())
+    {
+        return;
+    }
+
+    TracerState& state = getState();
+    std::lock_guard<std::mutex> lock(state.mutex);
+    if (++state.nbSteps % state.stepsPerFile == 0 && !state.fileName.empty())
+    {
+        writeFile(state);
+    }
+}
+
+void Tracer::writeChromeTrace(std::ostream& out)
+{
+    TracerState& state = getState();
+    std::lock_guard<std::mutex> lock(state.mutex);
+    writeTrace(state, out);
+}
+
+void Tracer::clear()
+{
+    TracerState& state = getState();
+    std::lock_guard<std::mutex> lock(state.mutex);
+    for (const auto& buffer : state.buffers)
+    {
+        buffer->first = buffer->count.load(std::memory_order_acquire);
+        buffer->openEvents.clear();
+    }
+    state.lastWriteTime = now();
+}
+
+void Tracer::setThreadName(const std::string& name)
+{
+    // the buffer is only created by the first event, when the tracer is enabled
+    ThreadBufferRef& ref = getThreadBufferRef();
+    if (ref.buffer)
+    {
+        ref.buffer->setThreadName(name);
+    }
+    else
+    {
+        ref.threadName = name;
+    }
+}
+
+void Tracer::begin(const char* name)
+{
+    if (!isEnabled()) return;
+    ThreadBuffer& buffer = getThreadBuffer();
+    buffer.push(EventType::Begin, buffer.getName(name), now());
+}
+
+void Tracer::begin(const std::type_info& type)
+{
+    if (!isEnabled()) return;
+    ThreadBuffer& buffer = getThreadBuffer();
+    auto it = buffer.typeNames.find(&type);
+    if (it == buffer.typeNames.end())
+    {
+        it = buffer.typeNames.emplace(&type, buffer.addName(NameDecoder::decodeTypeName(type))).first;
+    }
+    buffer.push(EventType::Begin, it->second, now());
+}
+
+void Tracer::beginStep(unsigned int stepId)
+{
+    if (!isEnabled()) return;
+    ThreadBuffer& buffer = getThreadBuffer();
+    // the ids of AdvancedTimer are given per thread, as the names of the buffer
+    auto it = buffer.stepNames.find(stepId);
+    if (it == buffer.stepNames.end())
+    {
+        it = buffer.stepNames.emplace(stepId, buffer.addName(AdvancedTimer::IdStep::IdFactory::getName(stepId))).first;
+    }
+    buffer.push(EventType::Begin, it->second, now());
+}
+
+void Tracer::beginTimer(unsigned int timerId)
+{
+    if (!isEnabled()) return;
+    ThreadBuffer& buffer = getThreadBuffer();
+    auto it = buffer.timerNames.find(timerId);
+    if (it == buffer.timerNames.end())
+    {
+        it = buffer.timerNames.emplace(timerId, buffer.addName(AdvancedTimer::IdTimer::IdFactory::getName(timerId))).first;
+    }
+    buffer.push(EventType::Begin, it->second, now());
+}
+
+void Tracer::end()
+{
+    if (!isEnabled()) return;
+    getThreadBuffer().push(EventType::End, 0, now());
+}
+
+void Tracer::instant(const char* name)
+{
+    if (!isEnabled()) return;
+    ThreadBuffer& buffer = getThreadBuffer();
+    buffer.push(EventType::Instant, buffer.getName(name), now());
+}
+
+} // namespace sofa::helper
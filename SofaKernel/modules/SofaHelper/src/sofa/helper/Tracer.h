@@ -0,0 +1,93 @@
+/******************************************************************************
+*                 SOFA, Simulation Open-Framework Architecture                *
+*                    (c) 2006 INRIA, USTL, UJF, CNRS, MGH                     *
+*                                                                             *
+* This program is free software; you can redistribute it and/or modify it     *
+* under the terms of the GNU Lesser General Public License as published by    *
+* the Free Software Foundation; either version 2.1 of the License, or (at     *
+* your option) any later version.                                             *
+*                                                                             *
+* This program is distributed in the hope that it will be useful, but WITHOUT *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License *
+* for more details.                                                           *
+*                                                                             *
+* You should have received a copy of the GNU Lesser General Public License    *
+* along with this program. If not, see <http://www.gnu.org/licenses/>.        *
+*******************************************************************************
+* Authors: The SOFA Team and external contributors (see Authors.txt)          *
+*                                                                             *
+* Contact information: contact@sofa-framework.org                             *
+******************************************************************************/
+#pragma once
+#include <sofa/helper/config.h>
+
+#include <atomic>
+#include <ostream>
+#include <string>
+#include <typeinfo>
+
+namespace sofa::helper
+{
+
+/**
+  Low-overhead tracer recording timed events on all the threads, exported in the Chrome trace event
+  format (open the files in chrome://tracing or https://ui.perfetto.dev).
+
+  Each thread writes its events in its own ring buffer without any lock: when a buffer is full the
+  oldest events are overwritten. The task scheduler records the tasks, the steals and the idle time
+  of its workers, and AdvancedTimer records its timers and steps, on any thread.
+
+  The traces are written every N time steps by endStep(), called by Simulation::animate():
+   - from the code: Tracer::start("trace", 100);
+   - or without rebuilding: SOFA_TRACE_FILE=trace SOFA_TRACE_STEPS=100 runSofa ...
+  produce the files trace_0.json, trace_1.json, ... each one holding 100 steps.
+
+  When the tracer is not started, recording an event costs a relaxed atomic load.
+ */
+class SOFA_HELPER_API Tracer
+{
+public:
+
+    static bool isEnabled() { return s_enabled.load(std::memory_order_relaxed); }
+
+    /// start recording, the trace being written every stepsPerFile steps in fileName_<n>.json
+    /// (with an empty fileName, the events are only written by writeChromeTrace())
+    static void start(const std::string& fileName, unsigned int stepsPerFile);
+
+    /// write the events not written yet and stop recording
+    static void stop();
+
+    /// to call once per time step, when no task is running: writes the trace every stepsPerFile steps
+    static void endStep();
+
+    /// write the recorded events of all the threads and clear them. The events recorded during the call are
+    /// written by the next one, or dropped if they overwrote events being written.
+    static void writeChromeTrace(std::ostream& out);
+
+    /// discard the recorded events of all the threads
+    static void clear();
+
+    /// name of the calling thread in the trace
+    static void setThreadName(const std::string& name);
+
+    /// beginning of an event on the calling thread, name being stored at the first use
+    static void begin(const char* name);
+    /// beginning of an event named after a type, e.g. the type of a task
+    static void begin(const std::type_info& type);
+    /// beginning of an AdvancedTimer step or timer, given by its id on the calling thread
+    static void beginStep(unsigned int stepId);
+    static void beginTimer(unsigned int timerId);
+
+    /// end of the last event begun on the calling thread
+    static void end();
+
+    /// event without duration
+    static void instant(const char* name);
+
+private:
+
+    static std::atomic<bool> s_enabled;
+};
+
+} // namespace sofa::helper
@@ -0,0 +1,141 @@
+/******************************************************************************
+*                 SOFA, Simulation Open-Framework Architecture                *
+*                    (c) 2006 INRIA, USTL, UJF, CNRS, MGH                     *
+*                                                                             *
+* This program is free software; you can redistribute it and/or modify it     *
+* under the terms of the GNU Lesser General Public License as published by    *
+* the Free Software Foundation; either version 2.1 of the License, or (at     *
+* your option) any later version.                                             *
+*                                                                             *
+* This program is distributed in the hope that it will be useful, but WITHOUT *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License *
+* for more details.                                                           *
+*                                                                             *
+* You should have received a copy of the GNU Lesser General Public License    *
+* along with this program. If not, see <http://www.gnu.org/licenses/>.        *
+*******************************************************************************
+* Authors: The SOFA Team and external contributors (see Authors.txt)          *
+*                                                                             *
+* Contact information: contact@sofa-framework.org                             *
+******************************************************************************/
+#include <SofaTest/Sofa_test.h>
+using sofa::Sofa_test;
+
+#include <SofaBaseCollision/DefaultContactManager.h>
+using sofa::component::collision::DefaultContactManager;
+
+#include <SofaBaseMechanics/MechanicalObject.h>
+#include <SofaObjectInteraction/PenalityContactForceField.h>
+#include <SofaSimulationCommon/SceneLoaderXML.h>
+using sofa::simulation::SceneLoaderXML;
+using sofa::simulation::Node;
+
+#include <sofa/core/fwd.h>
+
+namespace sofa
+{
+
+struct BarycentricPenalityContact_test : public Sofa_test<>
+{
+    typedef defaulttype::Vec3Types DataTypes;
+    typedef component::container::MechanicalObject<DataTypes> MechanicalObject3;
+    typedef component::interactionforcefield::PenalityContactForceField<DataTypes> PenalityContactForceField3;
+
+    /// three spheres resting on a square of two triangles
+    static Node::SPtr loadScene(bool reuse)
+    {
+        std::stringstream scene;
+        scene << "<?xml version='1.0'?>\n"
+                 "<Node name='root' dt='0.01'>\n"
+                 "  <DefaultPipeline/>\n"
+                 "  <BruteForceDetection/>\n"
+                 "  <NewProximityIntersection alarmDistance='0.2' contactDistance='0.05'/>\n"
+                 "  <DefaultContactManager name='contactManager' response='default' reuseContactPoints='" << reuse << "'/>\n"
+                 "  <Node name='floor'>\n"
+                 "    <MeshTopology position='-1 -1 0  1 -1 0  1 1 0  -1 1 0' triangles='0 1 2  0 2 3'/>\n"
+                 "    <MechanicalObject/>\n"
+                 "    <TriangleCollisionModel simulated='0' moving='0'/>\n"
+                 "  </Node>\n"
+                 "  <Node name='spheres'>\n"
+                 "    <MechanicalObject position='-0.5 -0.2 0.1  0.3 0.5 0.1  0.5 -0.5 0.1'/>\n"
+                 "    <SphereCollisionModel radius='0.1'/>\n"
+                 "  </Node>\n"
+                 "</Node>\n";
+
+        Node::SPtr root = SceneLoaderXML::loadFromMemory("testscene", scene.str().c_str(), scene.str().size());
+        EXPECT_NE(root.get(), nullptr);
+        if (root)
+            simulation::getSimulation()->init(root.get());
+        return root;
+    }
+};
+
+TEST_F(BarycentricPenalityContact_test, reuseContactPoints)
+{
+    Node::SPtr rebuilt = loadScene(false);
+    Node::SPtr reused = loadScene(true);
+    ASSERT_NE(rebuilt.get(), nullptr);
+    ASSERT_NE(reused.get(), nullptr);
+    DefaultContactManager* rebuiltManager = nullptr;
+    rebuilt->get(rebuiltManager);
+    DefaultContactManager* reusedManager = nullptr;
+    reused->get(reusedManager);
+    ASSERT_NE(rebuiltManager, nullptr);
+    ASSERT_NE(reusedManager, nullptr);
+
+    for (int step = 0; step < 3; ++step)
+    {
+        simulation::getSimulation()->animate(rebuilt.get(), 0.01);
+        simulation::getSimulation()->animate(reused.get(), 0.01);
+
+        EXPECT_EQ(rebuiltManager->d_nbReusedContactPoints.getValue(), 0) << "step " << step;
+        EXPECT_EQ(rebuiltManager->d_nbCreatedContactPoints.getValue(), 3) << "step " << step;
+        EXPECT_EQ(reusedManager->d_nbReusedContactPoints.getValue(), step > 0 ? 3 : 0) << "step " << step;
+        EXPECT_EQ(reusedManager->d_nbCreatedContactPoints.getValue(), step > 0 ? 0 : 3) << "step " << step;
+
+        // the elements do not move: the reused contact points must give the same response as the rebuilt ones
+        helper::vector<PenalityContactForceField3*> rebuiltForceFields, reusedForceFields;
+        rebuilt->get<PenalityContactForceField3>(&rebuiltForceFields, core::objectmodel::BaseContext::SearchDown);
+        reused->get<PenalityContactForceField3>(&reusedForceFields, core::objectmodel::BaseContext::SearchDown);
+        ASSERT_EQ(rebuiltForceFields.size(), 1u);
+        ASSERT_EQ(reusedForceFields.size(), 1u);
+        const auto& rebuiltContacts = rebuiltForceFields[0]->getContact();
+        const auto& reusedContacts = reusedForceFields[0]->getContact();
+        ASSERT_EQ(reusedContacts.size(), 3u);
+        ASSERT_EQ(reusedContacts.size(), rebuiltContacts.size());
+        for (std::size_t i = 0; i < rebuiltContacts.size(); ++i)
+        {
+            EXPECT_EQ(reusedContacts[i].m1, rebuiltContacts[i].m1);
+            EXPECT_EQ(reusedContacts[i].m2, rebuiltContacts[i].m2);
+            EXPECT_EQ(reusedContacts[i].index1, rebuiltContacts[i].index1);
+            EXPECT_EQ(reusedContacts[i].index2, rebuiltContacts[i].index2);
+            EXPECT_LT((reusedContacts[i].norm - rebuiltContacts[i].norm).norm(), 1e-12);
+            EXPECT_NEAR(reusedContacts[i].dist, rebuiltContacts[i].dist, 1e-12);
+            EXPECT_NEAR(reusedContacts[i].ks, rebuiltContacts[i].ks, 1e-12);
+            EXPECT_EQ(reusedContacts[i].age, rebuiltContacts[i].age);
+        }
+
+        // mapped states of the contact points
+        helper::vector<MechanicalObject3*> rebuiltStates, reusedStates;
+        rebuilt->get<MechanicalObject3>(&rebuiltStates, core::objectmodel::BaseContext::SearchDown);
+        reused->get<MechanicalObject3>(&reusedStates, core::objectmodel::BaseContext::SearchDown);
+        ASSERT_EQ(reusedStates.size(), rebuiltStates.size());
+        EXPECT_GT(reusedStates.size(), 2u);
+        for (std::size_t s = 0; s < rebuiltStates.size(); ++s)
+        {
+            const MechanicalObject3::VecCoord& rebuiltPositions = rebuiltStates[s]->x.getValue();
+            const MechanicalObject3::VecCoord& reusedPositions = reusedStates[s]->x.getValue();
+            ASSERT_EQ(reusedPositions.size(), rebuiltPositions.size()) << rebuiltStates[s]->getPathName();
+            for (std::size_t i = 0; i < rebuiltPositions.size(); ++i)
+            {
+                EXPECT_LT((reusedPositions[i] - rebuiltPositions[i]).norm(), 1e-12) << rebuiltStates[s]->getPathName();
+            }
+        }
+    }
+
+    simulation::getSimulation()->unload(rebuilt);
+    simulation::getSimulation()->unload(reused);
+}
+
+} // namespace sofa
@@ -0,0 +1,234 @@
+/******************************************************************************
+*                 SOFA, Simulation Open-Framework Architecture                *
+*                    (c) 2006 INRIA, USTL, UJF, CNRS, MGH                     *
+*                                                                             *
+* This program is free software; you can redistribute it and/or modify it     *
+* under the terms of the GNU Lesser General Public License as published by    *
+* the Free Software Foundation; either version 2.1 of the License, or (at     *
+* your option) any later version.                                             *
+*                                                                             *
+* This program is distributed in the hope that it will be useful, but WITHOUT *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License *
+* for more details.                                                           *
+*                                                                             *
+* You should have received a copy of the GNU Lesser General Public License    *
+* along with this program. If not, see <http://www.gnu.org/licenses/>.        *
+*******************************************************************************
+* Authors: The SOFA Team and external contributors (see Authors.txt)          *
+*                                                                             *
+* Contact information: contact@sofa-framework.org                             *
+******************************************************************************/
+#include <SofaTest/Sofa_test.h>
+using sofa::Sofa_test;
+
+#include <SofaMeshCollision/MeshNewProximityIntersection.inl>
+#include <SofaMeshCollision/MeshProximityBatch.h>
+using sofa::component::collision::MeshNewProximityIntersection;
+using sofa::component::collision::TrianglePointBatch;
+using sofa::component::collision::SegmentSegmentBatch;
+
+#include <SofaBaseCollision/BruteForceDetection.h>
+using sofa::component::collision::BruteForceDetection;
+
+#include <SofaBaseCollision/NewProximityIntersection.h>
+using sofa::component::collision::NewProximityIntersection;
+
+#include <SofaMeshCollision/LineModel.h>
+using sofa::component::collision::LineCollisionModel;
+
+#include <SofaMeshCollision/TriangleModel.h>
+using sofa::component::collision::TriangleCollisionModel;
+
+#include <SofaBaseMechanics/MechanicalObject.h>
+#include <SofaBaseTopology/MeshTopology.h>
+#include <SofaSimulationGraph/DAGNode.h>
+#include <sofa/helper/random.h>
+
+using sofa::core::objectmodel::New;
+
+namespace sofa
+{
+
+struct MeshProximityBatch_test : public Sofa_test<>
+{
+    typedef defaulttype::Vector3 Vec3;
+    typedef defaulttype::Vec3Types DataTypes;
+    typedef component::container::MechanicalObject<DataTypes> MechanicalObject3;
+    typedef helper::vector<core::collision::DetectionOutput> OutputVector;
+    typedef helper::vector< std::pair<core::CollisionModel*, core::CollisionModel*> > Pairs;
+
+    simulation::Node::SPtr root;
+    NewProximityIntersection::SPtr intersection;
+    BruteForceDetection::SPtr detection;
+
+    void onSetUp() override
+    {
+        root = New<simulation::graph::DAGNode>();
+        intersection = New<NewProximityIntersection>();
+        intersection->setAlarmDistance(0.3);
+        intersection->setContactDistance(0.05);
+        intersection->useLineLine.setValue(true);
+        root->addObject(intersection);
+        intersection->init();
+        detection = New<BruteForceDetection>();
+        root->addObject(detection);
+    }
+
+    static Vec3 randomPoint()
+    {
+        return Vec3(helper::drand(1.0), helper::drand(1.0), helper::drand(1.0));
+    }
+
+    static void compareOutputs(const OutputVector& batch, const OutputVector& reference)
+    {
+        ASSERT_EQ(batch.size(), reference.size());
+        for (std::size_t i = 0; i < reference.size(); ++i)
+        {
+            EXPECT_EQ(batch[i].id, reference[i].id) << "contact " << i;
+            EXPECT_NEAR(batch[i].value, reference[i].value, 1e-12) << "contact " << i;
+            for (int c = 0; c < 3; ++c)
+            {
+                EXPECT_NEAR(batch[i].point[0][c], reference[i].point[0][c], 1e-12) << "contact " << i;
+                EXPECT_NEAR(batch[i].point[1][c], reference[i].point[1][c], 1e-12) << "contact " << i;
+                EXPECT_NEAR(batch[i].normal[c], reference[i].normal[c], 1e-9) << "contact " << i;
+            }
+        }
+    }
+
+    /// triangulated n x n grid of unit size, with its triangles and its edges
+    std::pair<core::CollisionModel*, core::CollisionModel*> makeGrid(int n, const Vec3& origin, bool simulated)
+    {
+        simulation::Node::SPtr node = root->createChild("grid");
+        MechanicalObject3::VecCoord points;
+        component::topology::MeshTopology::SPtr topology = New<component::topology::MeshTopology>();
+        for (int i = 0; i < n; ++i)
+            for (int j = 0; j < n; ++j)
+                points.push_back(origin + Vec3(SReal(i) / (n - 1), SReal(j) / (n - 1), 0));
+        for (int i = 0; i + 1 < n; ++i)
+        {
+            for (int j = 0; j + 1 < n; ++j)
+            {
+                const Index p = i * n + j;
+                topology->addTriangle(p, p + n, p + n + 1);
+                topology->addTriangle(p, p + n + 1, p + 1);
+            }
+        }
+        MechanicalObject3::SPtr dofs = New<MechanicalObject3>();
+        dofs->resize(points.size());
+        dofs->x.setValue(points);
+        node->addObject(dofs);
+        node->addObject(topology);
+        topology->init();
+
+        TriangleCollisionModel<DataTypes>::SPtr triangles = New<TriangleCollisionModel<DataTypes> >();
+        triangles->setSimulated(simulated);
+        node->addObject(triangles);
+        triangles->init();
+        triangles->computeBoundingTree(6);
+        LineCollisionModel<DataTypes>::SPtr lines = New<LineCollisionModel<DataTypes> >();
+        lines->setSimulated(simulated);
+        node->addObject(lines);
+        lines->init();
+        lines->computeBoundingTree(6);
+        return std::make_pair(triangles->getFirst(), lines->getFirst());
+    }
+
+    std::map<std::pair<core::CollisionModel*, core::CollisionModel*>, OutputVector> detect(const Pairs& pairs, bool batch)
+    {
+        intersection->d_useBatchKernels.setValue(batch);
+        detection->setIntersectionMethod(intersection.get());
+        detection->beginNarrowPhase();
+        detection->addCollisionPairs(pairs);
+        detection->endNarrowPhase();
+
+        std::map<std::pair<core::CollisionModel*, core::CollisionModel*>, OutputVector> outputs;
+        for (const auto& it : detection->getDetectionOutputs())
+        {
+            const auto* contacts = dynamic_cast<const OutputVector*>(it.second);
+            EXPECT_NE(contacts, nullptr);
+            if (contacts) outputs[it.first] = *contacts;
+        }
+        return outputs;
+    }
+};
+
+TEST_F(MeshProximityBatch_test, trianglePoint)
+{
+    // random triangles and points, some of them on the vertices and edges of the triangles
+    const SReal dist2 = 0.3*0.3;
+    for (int t = 0; t < 200; ++t)
+    {
+        const Vec3 p1 = randomPoint(), p2 = randomPoint(), p3 = randomPoint();
+        const int flags = t % 64;
+
+        OutputVector reference, batch;
+        TrianglePointBatch<8> points(dist2);
+        for (int i = 0; i < 8; ++i)
+        {
+            Vec3 q = randomPoint();
+            if (i == 6) q = p2 + (p2 - p1) * 0.1;
+            if (i == 7) q = (p3 + p1) * 0.5 + ((p3 + p1) * 0.5 - p2) * 0.2 + (p3 - p1).cross(p2 - p1) * 0.1;
+            MeshNewProximityIntersection::doIntersectionTrianglePoint(dist2, flags, p1, p2, p3, Vec3(), q, &reference, i, i % 2 == 0);
+            points.add(flags, p1, p2, p3, q, i, i % 2 == 0);
+        }
+        points.compute();
+        const int n = points.writeOutputs(&batch);
+        EXPECT_EQ(n, int(batch.size()));
+        compareOutputs(batch, reference);
+    }
+}
+
+TEST_F(MeshProximityBatch_test, segmentSegment)
+{
+    // random segments, some of them parallel
+    const SReal dist2 = 0.3*0.3;
+    for (int t = 0; t < 200; ++t)
+    {
+        OutputVector reference, batch;
+        SegmentSegmentBatch<8> edges(dist2);
+        for (int i = 0; i < 8; ++i)
+        {
+            const Vec3 p1 = randomPoint(), p2 = randomPoint();
+            Vec3 q1 = randomPoint(), q2 = randomPoint();
+            if (i >= 6)
+            {
+                q1 = p1 + Vec3(0.1, 0.05, 0.0) + (p2 - p1) * (i == 6 ? 0.3 : -0.2);
+                q2 = q1 + (p2 - p1) * 0.5;
+            }
+            MeshNewProximityIntersection::doIntersectionLineLine(dist2, p1, p2, q1, q2, &reference, i);
+            edges.add(p1, p2, q1, q2, i);
+        }
+        edges.compute();
+        const int n = edges.writeOutputs(&batch);
+        EXPECT_EQ(n, int(batch.size()));
+        compareOutputs(batch, reference);
+    }
+}
+
+TEST_F(MeshProximityBatch_test, triangleGrids)
+{
+    // two overlapping grids, the second one being simulated, with the line-line tests
+    const auto grid0 = makeGrid(6, Vec3(0, 0, 0), false);
+    const auto grid1 = makeGrid(6, Vec3(0.13, 0.07, 0.1), true);
+    const Pairs pairs { std::make_pair(grid0.first, grid1.first), std::make_pair(grid0.second, grid1.first),
+                        std::make_pair(grid0.first, grid1.second), std::make_pair(grid0.second, grid1.second) };
+
+    const auto reference = detect(pairs, false);
+    const auto batch = detect(pairs, true);
+    ASSERT_EQ(batch.size(), reference.size());
+
+    std::size_t nbTriangleContacts = 0;
+    for (const auto& it : reference)
+    {
+        const auto found = batch.find(it.first);
+        ASSERT_NE(found, batch.end());
+        SCOPED_TRACE(it.first.first->getClassName() + "-" + it.first.second->getClassName());
+        compareOutputs(found->second, it.second);
+        if (it.first.first->getClassName() == it.first.second->getClassName() && it.first.first->getClassName() == "TriangleCollisionModel")
+            nbTriangleContacts += it.second.size();
+    }
+    EXPECT_GT(nbTriangleContacts, 0u);
+}
+
+} // namespace sofa
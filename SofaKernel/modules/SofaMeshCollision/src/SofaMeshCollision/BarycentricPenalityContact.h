@@ -72,6 +72,22 @@ protected:
     /// This allows to ignore duplicate contacts, and preserve information associated with each contact point over time
     ContactIndexMap contactIndex;
 
+    /// Mapped points of a contact, kept to be reused while the contact is detected between the same elements
+    struct ContactPoint
+    {
+        Index elem1;
+        Index elem2;
+        Index point1;
+        Index point2;
+        typename DataTypes1::Real r1;
+        typename DataTypes2::Real r2;
+    };
+    typedef std::map<core::collision::DetectionOutput::ContactId, ContactPoint> ContactPointMap;
+    ContactPointMap contactPoints;
+    bool reuseContactPoints;
+    std::size_t nbReusedContactPoints;
+    std::size_t nbCreatedContactPoints;
+
     BarycentricPenalityContact(CollisionModel1* model1, CollisionModel2* model2, Intersection* intersectionMethod);
     ~BarycentricPenalityContact() override;
 
@@ -84,6 +100,12 @@ public:
 
     void setDetectionOutputs(OutputVector* outputs) override;
 
+    void setReuseContactPoints(bool val) override { reuseContactPoints = val; }
+
+    std::size_t getNbReusedContactPoints() const override { return nbReusedContactPoints; }
+
+    std::size_t getNbCreatedContactPoints() const override { return nbCreatedContactPoints; }
+
     void createResponse(core::objectmodel::BaseContext* group) override;
 
     void removeResponse() override;
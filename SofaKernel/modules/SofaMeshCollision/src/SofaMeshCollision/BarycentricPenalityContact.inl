@@ -34,6 +34,9 @@ BarycentricPenalityContact<TCollisionModel1,TCollisionModel2,ResponseDataTypes>:
     , intersectionMethod(_intersectionMethod)
     , ff(nullptr)
     , parent(nullptr)
+    , reuseContactPoints(false)
+    , nbReusedContactPoints(0)
+    , nbCreatedContactPoints(0)
 {
     mapper1.setCollisionModel(model1);
     mapper2.setCollisionModel(model2);
@@ -57,6 +60,7 @@ void BarycentricPenalityContact<TCollisionModel1,TCollisionModel2,ResponseDataTy
         ff = nullptr;
         mapper1.cleanup();
         mapper2.cleanup();
+        contactPoints.clear();
     }
 }
 
@@ -151,9 +155,27 @@ void BarycentricPenalityContact<TCollisionModel1,TCollisionModel2,ResponseDataTy
     }
     dmsg_info() << " "<<insize<<" input contacts, "<<size<<" contacts used for response ("<<nbnew<<" new).";
 
+    // When the same contacts are detected again between the same elements, the mapped points of the previous step,
+    // and their barycentric coordinates, are kept: only the parameters of the force field are updated
+    bool reuse = reuseContactPoints && std::size_t(size) == contactPoints.size();
+    for (int i=0; i<insize && reuse; i++)
+    {
+        if (oldIndex[i] <= 0) { reuse = (oldIndex[i] < 0); continue; } // ignored or new contact
+        const core::collision::DetectionOutput* o = &outputs[i];
+        typename ContactPointMap::const_iterator it = contactPoints.find(o->id);
+        reuse = it != contactPoints.end()
+                && it->second.elem1 == o->elem.first.getIndex() && it->second.elem2 == o->elem.second.getIndex();
+    }
+    if (!reuse)
+    {
+        mapper1.resize(size);
+        mapper2.resize(size);
+        contactPoints.clear();
+    }
+    nbReusedContactPoints = reuse ? size : 0;
+    nbCreatedContactPoints = reuse ? 0 : size;
+
     ff->clear(size);
-    mapper1.resize(size);
-    mapper2.resize(size);
     const double d0 = intersectionMethod->getContactDistance() + model1->getProximity() + model2->getProximity(); // - 0.001;
     for (int i=0; i<insize; i++)
     {
@@ -167,8 +189,21 @@ void BarycentricPenalityContact<TCollisionModel1,TCollisionModel2,ResponseDataTy
         typename DataTypes1::Real r1 = 0.0;
         typename DataTypes2::Real r2 = 0.0;
 
-        index1 = mapper1.addPoint(o->point[0], index1, r1);
-        index2 = mapper2.addPoint(o->point[1], index2, r2);
+        if (reuse)
+        {
+            const ContactPoint& point = contactPoints[o->id];
+            index1 = point.point1;
+            index2 = point.point2;
+            r1 = point.r1;
+            r2 = point.r2;
+        }
+        else
+        {
+            index1 = mapper1.addPoint(o->point[0], index1, r1);
+            index2 = mapper2.addPoint(o->point[1], index2, r2);
+            if (reuseContactPoints)
+                contactPoints[o->id] = ContactPoint{ elem1.getIndex(), elem2.getIndex(), Index(index1), Index(index2), r1, r2 };
+        }
 
         double distance = d0 + r1 + r2;
         double stiffness = (elem1.getContactStiffness() * elem2.getContactStiffness());
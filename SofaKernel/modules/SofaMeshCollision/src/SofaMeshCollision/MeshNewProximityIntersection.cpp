@@ -20,6 +20,7 @@
 * Contact information: contact@sofa-framework.org                             *
 ******************************************************************************/
 #include <SofaMeshCollision/MeshNewProximityIntersection.inl>
+#include <SofaMeshCollision/MeshProximityBatch.h>
 #include <sofa/core/collision/Intersection.inl>
 #include <sofa/core/collision/IntersectorFactory.h>
 
@@ -59,6 +60,12 @@ MeshNewProximityIntersection::MeshNewProximityIntersection(NewProximityIntersect
     }
 }
 
+bool MeshNewProximityIntersection::useBatchKernels() const
+{
+    // the branchless evaluation of the batches is only faster when several tests are computed by each instruction
+    return proximitybatch::Pack<SReal>::Size > 1 && intersection->d_useBatchKernels.getValue();
+}
+
 int MeshNewProximityIntersection::computeIntersection(Point& e1, Point& e2, OutputVector* contacts)
 {
     const SReal alarmDist = intersection->getAlarmDistance() + e1.getProximity() + e2.getProximity();
@@ -158,17 +165,41 @@ int MeshNewProximityIntersection::computeIntersection(Triangle& e1, Line& e2, Ou
         n += doIntersectionLinePoint(dist2, q1, q2, p3, contacts, e2.getIndex(), true);
     }
 
-    n += doIntersectionTrianglePoint(dist2, f1, p1, p2, p3, pn, q1, contacts, e2.getIndex(), false);
-    n += doIntersectionTrianglePoint(dist2, f1, p1, p2, p3, pn, q2, contacts, e2.getIndex(), false);
+    if (useBatchKernels())
+    {
+        TrianglePointBatch<2> points(dist2);
+        points.add(f1, p1, p2, p3, q1, e2.getIndex(), false);
+        points.add(f1, p1, p2, p3, q2, e2.getIndex(), false);
+        points.compute();
+        n += points.writeOutputs(contacts);
 
-    if (intersection->useLineLine.getValue())
+        if (intersection->useLineLine.getValue())
+        {
+            SegmentSegmentBatch<3> edges(dist2);
+            if (f1&TriangleCollisionModel<sofa::defaulttype::Vec3Types>::FLAG_E12)
+                edges.add(p1, p2, q1, q2, e2.getIndex());
+            if (f1&TriangleCollisionModel<sofa::defaulttype::Vec3Types>::FLAG_E23)
+                edges.add(p2, p3, q1, q2, e2.getIndex());
+            if (f1&TriangleCollisionModel<sofa::defaulttype::Vec3Types>::FLAG_E31)
+                edges.add(p3, p1, q1, q2, e2.getIndex());
+            edges.compute();
+            n += edges.writeOutputs(contacts);
+        }
+    }
+    else
     {
-        if (f1&TriangleCollisionModel<sofa::defaulttype::Vec3Types>::FLAG_E12)
-            n += doIntersectionLineLine(dist2, p1, p2, q1, q2, contacts, e2.getIndex());
-        if (f1&TriangleCollisionModel<sofa::defaulttype::Vec3Types>::FLAG_E23)
-            n += doIntersectionLineLine(dist2, p2, p3, q1, q2, contacts, e2.getIndex());
-        if (f1&TriangleCollisionModel<sofa::defaulttype::Vec3Types>::FLAG_E31)
-            n += doIntersectionLineLine(dist2, p3, p1, q1, q2, contacts, e2.getIndex());
+        n += doIntersectionTrianglePoint(dist2, f1, p1, p2, p3, pn, q1, contacts, e2.getIndex(), false);
+        n += doIntersectionTrianglePoint(dist2, f1, p1, p2, p3, pn, q2, contacts, e2.getIndex(), false);
+
+        if (intersection->useLineLine.getValue())
+        {
+            if (f1&TriangleCollisionModel<sofa::defaulttype::Vec3Types>::FLAG_E12)
+                n += doIntersectionLineLine(dist2, p1, p2, q1, q2, contacts, e2.getIndex());
+            if (f1&TriangleCollisionModel<sofa::defaulttype::Vec3Types>::FLAG_E23)
+                n += doIntersectionLineLine(dist2, p2, p3, q1, q2, contacts, e2.getIndex());
+            if (f1&TriangleCollisionModel<sofa::defaulttype::Vec3Types>::FLAG_E31)
+                n += doIntersectionLineLine(dist2, p3, p1, q1, q2, contacts, e2.getIndex());
+        }
     }
 
     if (n>0)
@@ -212,11 +243,12 @@ int MeshNewProximityIntersection::computeIntersection(Triangle& e1, Triangle& e2
     const Vector3& p1 = e1.p1();
     const Vector3& p2 = e1.p2();
     const Vector3& p3 = e1.p3();
-    Vector3& pn = e1.n();
+    // copies of the normals, which are oriented for this test only: the models may be tested by several threads
+    Vector3 pn = e1.n();
     const Vector3& q1 = e2.p1();
     const Vector3& q2 = e2.p2();
     const Vector3& q3 = e2.p3();
-    Vector3& qn = e2.n();
+    Vector3 qn = e2.n();
 
     
     if(neighbor)
@@ -243,49 +275,93 @@ int MeshNewProximityIntersection::computeIntersection(Triangle& e1, Triangle& e2
                 pn = -qn;
 
     int n = 0;
-        n += doIntersectionTrianglePoint(dist2, f2, q1, q2, q3, qn, p1, contacts, id1+0, true, useNormal);
-    if (f1&TriangleCollisionModel<sofa::defaulttype::Vec3Types>::FLAG_P2)
-        n += doIntersectionTrianglePoint(dist2, f2, q1, q2, q3, qn, p2, contacts, id1+1, true, useNormal);
-    if (f1&TriangleCollisionModel<sofa::defaulttype::Vec3Types>::FLAG_P3)
-        n += doIntersectionTrianglePoint(dist2, f2, q1, q2, q3, qn, p3, contacts, id1+2, true, useNormal);
-
-    if (f2&TriangleCollisionModel<sofa::defaulttype::Vec3Types>::FLAG_P1)
-        n += doIntersectionTrianglePoint(dist2, f1, p1, p2, p3, pn, q1, contacts, id2+0, false, useNormal);
-    if (f2&TriangleCollisionModel<sofa::defaulttype::Vec3Types>::FLAG_P2)
-        n += doIntersectionTrianglePoint(dist2, f1, p1, p2, p3, pn, q2, contacts, id2+1, false, useNormal);
-    if (f2&TriangleCollisionModel<sofa::defaulttype::Vec3Types>::FLAG_P3)
-        n += doIntersectionTrianglePoint(dist2, f1, p1, p2, p3, pn, q3, contacts, id2+2, false, useNormal);
-
-    if (intersection->useLineLine.getValue())
+    if (useBatchKernels())
     {
-        if (f1&TriangleCollisionModel<sofa::defaulttype::Vec3Types>::FLAG_E12)
-        {
-            if (f2&TriangleCollisionModel<sofa::defaulttype::Vec3Types>::FLAG_E12)
-                n += doIntersectionLineLine(dist2, p1, p2, q1, q2, contacts, id2+3, pn, useNormal);
-            if (f2&TriangleCollisionModel<sofa::defaulttype::Vec3Types>::FLAG_E23)
-                n += doIntersectionLineLine(dist2, p1, p2, q2, q3, contacts, id2+4, pn, useNormal);
-            if (f2&TriangleCollisionModel<sofa::defaulttype::Vec3Types>::FLAG_E31)
-                n += doIntersectionLineLine(dist2, p1, p2, q3, q1, contacts, id2+5, pn, useNormal);
-        }
-
-        if (f1&TriangleCollisionModel<sofa::defaulttype::Vec3Types>::FLAG_E23)
+        // the six point-triangle tests, then the nine line-line tests, in the order of the scalar tests below
+        TrianglePointBatch<6> points(dist2);
+        points.add(f2, q1, q2, q3, p1, id1+0, true);
+        if (f1&TriangleCollisionModel<sofa::defaulttype::Vec3Types>::FLAG_P2)
+            points.add(f2, q1, q2, q3, p2, id1+1, true);
+        if (f1&TriangleCollisionModel<sofa::defaulttype::Vec3Types>::FLAG_P3)
+            points.add(f2, q1, q2, q3, p3, id1+2, true);
+
+        if (f2&TriangleCollisionModel<sofa::defaulttype::Vec3Types>::FLAG_P1)
+            points.add(f1, p1, p2, p3, q1, id2+0, false);
+        if (f2&TriangleCollisionModel<sofa::defaulttype::Vec3Types>::FLAG_P2)
+            points.add(f1, p1, p2, p3, q2, id2+1, false);
+        if (f2&TriangleCollisionModel<sofa::defaulttype::Vec3Types>::FLAG_P3)
+            points.add(f1, p1, p2, p3, q3, id2+2, false);
+
+        points.compute();
+        n += points.writeOutputs(contacts);
+
+        if (intersection->useLineLine.getValue())
         {
-            if (f2&TriangleCollisionModel<sofa::defaulttype::Vec3Types>::FLAG_E12)
-                n += doIntersectionLineLine(dist2, p2, p3, q1, q2, contacts, id2+6, pn, useNormal);
-            if (f2&TriangleCollisionModel<sofa::defaulttype::Vec3Types>::FLAG_E23)
-                n += doIntersectionLineLine(dist2, p2, p3, q2, q3, contacts, id2+7, pn, useNormal);
-            if (f2&TriangleCollisionModel<sofa::defaulttype::Vec3Types>::FLAG_E31)
-                n += doIntersectionLineLine(dist2, p2, p3, q3, q1, contacts, id2+8, pn, useNormal);
+            const defaulttype::Vector3* edges1[3][2] = { {&p1, &p2}, {&p2, &p3}, {&p3, &p1} };
+            const defaulttype::Vector3* edges2[3][2] = { {&q1, &q2}, {&q2, &q3}, {&q3, &q1} };
+            const int edgeFlags[3] = { TriangleCollisionModel<sofa::defaulttype::Vec3Types>::FLAG_E12, TriangleCollisionModel<sofa::defaulttype::Vec3Types>::FLAG_E23, TriangleCollisionModel<sofa::defaulttype::Vec3Types>::FLAG_E31 };
+
+            SegmentSegmentBatch<9> edges(dist2);
+            for (int i = 0; i < 3; ++i)
+            {
+                if (!(f1&edgeFlags[i]))
+                    continue;
+                for (int j = 0; j < 3; ++j)
+                {
+                    if (f2&edgeFlags[j])
+                        edges.add(*edges1[i][0], *edges1[i][1], *edges2[j][0], *edges2[j][1], id2+3+3*i+j);
+                }
+            }
+            edges.compute();
+            n += edges.writeOutputs(contacts);
         }
-
-        if (f1&TriangleCollisionModel<sofa::defaulttype::Vec3Types>::FLAG_E31)
+    }
+    else
+    {
+        n += doIntersectionTrianglePoint(dist2, f2, q1, q2, q3, qn, p1, contacts, id1+0, true, useNormal);
+        if (f1&TriangleCollisionModel<sofa::defaulttype::Vec3Types>::FLAG_P2)
+            n += doIntersectionTrianglePoint(dist2, f2, q1, q2, q3, qn, p2, contacts, id1+1, true, useNormal);
+        if (f1&TriangleCollisionModel<sofa::defaulttype::Vec3Types>::FLAG_P3)
+            n += doIntersectionTrianglePoint(dist2, f2, q1, q2, q3, qn, p3, contacts, id1+2, true, useNormal);
+
+        if (f2&TriangleCollisionModel<sofa::defaulttype::Vec3Types>::FLAG_P1)
+            n += doIntersectionTrianglePoint(dist2, f1, p1, p2, p3, pn, q1, contacts, id2+0, false, useNormal);
+        if (f2&TriangleCollisionModel<sofa::defaulttype::Vec3Types>::FLAG_P2)
+            n += doIntersectionTrianglePoint(dist2, f1, p1, p2, p3, pn, q2, contacts, id2+1, false, useNormal);
+        if (f2&TriangleCollisionModel<sofa::defaulttype::Vec3Types>::FLAG_P3)
+            n += doIntersectionTrianglePoint(dist2, f1, p1, p2, p3, pn, q3, contacts, id2+2, false, useNormal);
+
+        if (intersection->useLineLine.getValue())
         {
-            if (f2&TriangleCollisionModel<sofa::defaulttype::Vec3Types>::FLAG_E12)
-                n += doIntersectionLineLine(dist2, p3, p1, q1, q2, contacts, id2+9, pn, useNormal);
-            if (f2&TriangleCollisionModel<sofa::defaulttype::Vec3Types>::FLAG_E23)
-                n += doIntersectionLineLine(dist2, p3, p1, q2, q3, contacts, id2+10, pn, useNormal);
-            if (f2&TriangleCollisionModel<sofa::defaulttype::Vec3Types>::FLAG_E31)
-                n += doIntersectionLineLine(dist2, p3, p1, q3, q1, contacts, id2+11, pn, useNormal);
+            if (f1&TriangleCollisionModel<sofa::defaulttype::Vec3Types>::FLAG_E12)
+            {
+                if (f2&TriangleCollisionModel<sofa::defaulttype::Vec3Types>::FLAG_E12)
+                    n += doIntersectionLineLine(dist2, p1, p2, q1, q2, contacts, id2+3, pn, useNormal);
+                if (f2&TriangleCollisionModel<sofa::defaulttype::Vec3Types>::FLAG_E23)
+                    n += doIntersectionLineLine(dist2, p1, p2, q2, q3, contacts, id2+4, pn, useNormal);
+                if (f2&TriangleCollisionModel<sofa::defaulttype::Vec3Types>::FLAG_E31)
+                    n += doIntersectionLineLine(dist2, p1, p2, q3, q1, contacts, id2+5, pn, useNormal);
+            }
+
+            if (f1&TriangleCollisionModel<sofa::defaulttype::Vec3Types>::FLAG_E23)
+            {
+                if (f2&TriangleCollisionModel<sofa::defaulttype::Vec3Types>::FLAG_E12)
+                    n += doIntersectionLineLine(dist2, p2, p3, q1, q2, contacts, id2+6, pn, useNormal);
+                if (f2&TriangleCollisionModel<sofa::defaulttype::Vec3Types>::FLAG_E23)
+                    n += doIntersectionLineLine(dist2, p2, p3, q2, q3, contacts, id2+7, pn, useNormal);
+                if (f2&TriangleCollisionModel<sofa::defaulttype::Vec3Types>::FLAG_E31)
+                    n += doIntersectionLineLine(dist2, p2, p3, q3, q1, contacts, id2+8, pn, useNormal);
+            }
+
+            if (f1&TriangleCollisionModel<sofa::defaulttype::Vec3Types>::FLAG_E31)
+            {
+                if (f2&TriangleCollisionModel<sofa::defaulttype::Vec3Types>::FLAG_E12)
+                    n += doIntersectionLineLine(dist2, p3, p1, q1, q2, contacts, id2+9, pn, useNormal);
+                if (f2&TriangleCollisionModel<sofa::defaulttype::Vec3Types>::FLAG_E23)
+                    n += doIntersectionLineLine(dist2, p3, p1, q2, q3, contacts, id2+10, pn, useNormal);
+                if (f2&TriangleCollisionModel<sofa::defaulttype::Vec3Types>::FLAG_E31)
+                    n += doIntersectionLineLine(dist2, p3, p1, q3, q1, contacts, id2+11, pn, useNormal);
+            }
         }
     }
 
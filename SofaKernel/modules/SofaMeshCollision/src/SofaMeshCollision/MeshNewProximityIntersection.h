@@ -73,6 +73,9 @@ public:
 
 protected:
 
+    /// Return true if the point-triangle and line-line tests between triangles are evaluated by TrianglePointBatch and SegmentSegmentBatch
+    bool useBatchKernels() const;
+
     NewProximityIntersection* intersection;
 };
 
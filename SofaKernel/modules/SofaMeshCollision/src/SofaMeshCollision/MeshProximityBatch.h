@@ -0,0 +1,514 @@
+/******************************************************************************
+*                 SOFA, Simulation Open-Framework Architecture                *
+*                    (c) 2006 INRIA, USTL, UJF, CNRS, MGH                     *
+*                                                                             *
+* This program is free software; you can redistribute it and/or modify it     *
+* under the terms of the GNU Lesser General Public License as published by    *
+* the Free Software Foundation; either version 2.1 of the License, or (at     *
+* your option) any later version.                                             *
+*                                                                             *
+* This program is distributed in the hope that it will be useful, but WITHOUT *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License *
+* for more details.                                                           *
+*                                                                             *
+* You should have received a copy of the GNU Lesser General Public License    *
+* along with this program. If not, see <http://www.gnu.org/licenses/>.        *
+*******************************************************************************
+* Authors: The SOFA Team and external contributors (see Authors.txt)          *
+*                                                                             *
+* Contact information: contact@sofa-framework.org                             *
+******************************************************************************/
+#pragma once
+#include <SofaMeshCollision/config.h>
+
+#include <SofaMeshCollision/TriangleModel.h>
+#include <SofaBaseCollision/IntrUtility3.h>
+#include <sofa/core/collision/DetectionOutput.h>
+#include <sofa/helper/rmath.h>
+
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define SOFA_PROXIMITY_BATCH_AVX
+#endif
+
+namespace sofa::component::collision
+{
+
+namespace proximitybatch
+{
+
+/// One lane of a batch, used when the AVX instructions are not targeted by the compiler (see SOFA_VECTORIZE)
+template<class TReal>
+struct ScalarPack
+{
+    typedef TReal Real;
+    typedef TReal Value;
+    typedef bool Mask;
+    static constexpr std::size_t Size = 1;
+
+    static Value load(const Real* p) { return *p; }
+    static void store(Real* p, Value v) { *p = v; }
+    static Value set(Real r) { return r; }
+    static Value add(Value a, Value b) { return a + b; }
+    static Value sub(Value a, Value b) { return a - b; }
+    static Value mul(Value a, Value b) { return a * b; }
+    static Value div(Value a, Value b) { return a / b; }
+    static Mask lt(Value a, Value b) { return a < b; }
+    static Mask gt(Value a, Value b) { return a > b; }
+    static Mask ge(Value a, Value b) { return a >= b; }
+    static Mask andMask(Mask a, Mask b) { return a && b; }
+    static Mask orMask(Mask a, Mask b) { return a || b; }
+    static Mask notMask(Mask a) { return !a; }
+    static Value select(Mask m, Value a, Value b) { return m ? a : b; }
+    static unsigned bits(Mask m) { return m ? 1u : 0u; }
+};
+
+#ifdef SOFA_PROXIMITY_BATCH_AVX
+template<class TReal>
+struct AVXPack;
+
+/// 4 lanes of a batch in double precision
+template<>
+struct AVXPack<double>
+{
+    typedef double Real;
+    typedef __m256d Value;
+    typedef __m256d Mask;
+    static constexpr std::size_t Size = 4;
+
+    static Value load(const Real* p) { return _mm256_load_pd(p); }
+    static void store(Real* p, Value v) { _mm256_store_pd(p, v); }
+    static Value set(Real r) { return _mm256_set1_pd(r); }
+    static Value add(Value a, Value b) { return _mm256_add_pd(a, b); }
+    static Value sub(Value a, Value b) { return _mm256_sub_pd(a, b); }
+    static Value mul(Value a, Value b) { return _mm256_mul_pd(a, b); }
+    static Value div(Value a, Value b) { return _mm256_div_pd(a, b); }
+    static Mask lt(Value a, Value b) { return _mm256_cmp_pd(a, b, _CMP_LT_OQ); }
+    static Mask gt(Value a, Value b) { return _mm256_cmp_pd(a, b, _CMP_GT_OQ); }
+    static Mask ge(Value a, Value b) { return _mm256_cmp_pd(a, b, _CMP_GE_OQ); }
+    static Mask andMask(Mask a, Mask b) { return _mm256_and_pd(a, b); }
+    static Mask orMask(Mask a, Mask b) { return _mm256_or_pd(a, b); }
+    static Mask notMask(Mask a) { return _mm256_xor_pd(a, _mm256_castsi256_pd(_mm256_set1_epi64x(-1))); }
+    static Value select(Mask m, Value a, Value b) { return _mm256_blendv_pd(b, a, m); }
+    static unsigned bits(Mask m) { return unsigned(_mm256_movemask_pd(m)); }
+};
+
+/// 8 lanes of a batch in single precision
+template<>
+struct AVXPack<float>
+{
+    typedef float Real;
+    typedef __m256 Value;
+    typedef __m256 Mask;
+    static constexpr std::size_t Size = 8;
+
+    static Value load(const Real* p) { return _mm256_load_ps(p); }
+    static void store(Real* p, Value v) { _mm256_store_ps(p, v); }
+    static Value set(Real r) { return _mm256_set1_ps(r); }
+    static Value add(Value a, Value b) { return _mm256_add_ps(a, b); }
+    static Value sub(Value a, Value b) { return _mm256_sub_ps(a, b); }
+    static Value mul(Value a, Value b) { return _mm256_mul_ps(a, b); }
+    static Value div(Value a, Value b) { return _mm256_div_ps(a, b); }
+    static Mask lt(Value a, Value b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+    static Mask gt(Value a, Value b) { return _mm256_cmp_ps(a, b, _CMP_GT_OQ); }
+    static Mask ge(Value a, Value b) { return _mm256_cmp_ps(a, b, _CMP_GE_OQ); }
+    static Mask andMask(Mask a, Mask b) { return _mm256_and_ps(a, b); }
+    static Mask orMask(Mask a, Mask b) { return _mm256_or_ps(a, b); }
+    static Mask notMask(Mask a) { return _mm256_xor_ps(a, _mm256_castsi256_ps(_mm256_set1_epi32(-1))); }
+    static Value select(Mask m, Value a, Value b) { return _mm256_blendv_ps(b, a, m); }
+    static unsigned bits(Mask m) { return unsigned(_mm256_movemask_ps(m)); }
+};
+
+template<class TReal>
+using Pack = AVXPack<TReal>;
+#else
+template<class TReal>
+using Pack = ScalarPack<TReal>;
+#endif
+
+/// Largest number of lanes of the packs, the arrays of the batches are padded to a multiple of it
+static constexpr std::size_t MaxPackSize = 8;
+
+/// a*b for 3D vectors stored by components
+template<class P>
+inline typename P::Value dot(typename P::Value ax, typename P::Value ay, typename P::Value az,
+                             typename P::Value bx, typename P::Value by, typename P::Value bz)
+{
+    return P::add(P::add(P::mul(ax, bx), P::mul(ay, by)), P::mul(az, bz));
+}
+
+} // namespace proximitybatch
+
+/** Batches of the point-triangle proximity tests of MeshNewProximityIntersection.
+ *
+ *  The tests of a pair of elements are stored in structure-of-arrays form by add(), then
+ *  evaluated together by compute(): the region of the triangle holding the closest point is
+ *  selected without branches, 4 doubles or 8 floats at a time when the compiler targets AVX
+ *  (see SOFA_VECTORIZE), one at a time otherwise. writeOutputs() then appends the detected
+ *  contacts in the order of the tests, with the same values as
+ *  MeshNewProximityIntersection::doIntersectionTrianglePoint.
+ */
+template<std::size_t Capacity>
+class TrianglePointBatch
+{
+public:
+    typedef sofa::helper::vector<sofa::core::collision::DetectionOutput> OutputVector;
+    typedef TriangleCollisionModel<sofa::defaulttype::Vec3Types> TriangleModel;
+    static_assert(Capacity < 32, "the detected tests are stored as the bits of a 32-bit mask");
+
+    explicit TrianglePointBatch(SReal dist2) : m_dist2(dist2) {}
+
+    std::size_t size() const { return m_size; }
+
+    /// Add the test of the point q against the triangle (p1,p2,p3) whose features are given by flags
+    void add(int flags, const defaulttype::Vector3& p1, const defaulttype::Vector3& p2, const defaulttype::Vector3& p3,
+             const defaulttype::Vector3& q, int id, bool swapElems)
+    {
+        assert(m_size < Capacity);
+        const std::size_t i = m_size++;
+        for (int c = 0; c < 3; ++c)
+        {
+            m_p1[c][i] = p1[c];
+            m_ab[c][i] = p2[c] - p1[c];
+            m_ac[c][i] = p3[c] - p1[c];
+            m_q[c][i] = q[c];
+        }
+        for (int f = 0; f < NbFeatures; ++f)
+        {
+            m_features[f][i] = (flags & featureFlag(f)) ? SReal(1) : SReal(0);
+        }
+        m_id[i] = id;
+        m_swap[i] = swapElems;
+    }
+
+    /// Compute the closest points of all the tests
+    void compute()
+    {
+        typedef proximitybatch::Pack<SReal> P;
+        const std::size_t end = (m_size + P::Size - 1) / P::Size * P::Size;
+        for (std::size_t i = m_size; i < end; ++i)
+        {
+            // unused lanes of the last pack
+            for (int c = 0; c < 3; ++c)
+            {
+                m_p1[c][i] = m_ab[c][i] = m_ac[c][i] = m_q[c][i] = 0;
+            }
+            for (int f = 0; f < NbFeatures; ++f)
+            {
+                m_features[f][i] = 0;
+            }
+        }
+
+        m_detected = 0;
+        for (std::size_t i = 0; i < end; i += P::Size)
+        {
+            m_detected |= computePack<P>(i) << i;
+        }
+        m_detected &= (std::uint32_t(1) << m_size) - 1;
+    }
+
+    /// Append the contacts detected by compute(), return their number
+    int writeOutputs(OutputVector* contacts) const
+    {
+        int n = 0;
+        for (std::size_t i = 0; i < m_size; ++i)
+        {
+            if (!(m_detected & (std::uint32_t(1) << i)))
+                continue;
+
+            const defaulttype::Vector3 p(m_p[0][i], m_p[1][i], m_p[2][i]);
+            const defaulttype::Vector3 q(m_q[0][i], m_q[1][i], m_q[2][i]);
+            const defaulttype::Vector3 pq = q-p;
+
+            contacts->resize(contacts->size()+1);
+            core::collision::DetectionOutput *detection = &*(contacts->end()-1);
+            detection->id = m_id[i];
+            detection->value = helper::rsqrt(m_norm2[i]);
+            if (m_swap[i])
+            {
+                detection->point[0]=q;
+                detection->point[1]=p;
+                detection->normal = -pq / detection->value;
+            }
+            else
+            {
+                detection->point[0]=p;
+                detection->point[1]=q;
+                detection->normal = pq / detection->value;
+            }
+            ++n;
+        }
+        return n;
+    }
+
+protected:
+    /// features of the triangle, in the order of the tests of doIntersectionTrianglePoint
+    enum { FeatureA = 0, FeatureAB, FeatureAC, FeatureB, FeatureC, FeatureBC, NbFeatures };
+    static constexpr std::size_t PaddedCapacity = (Capacity + proximitybatch::MaxPackSize - 1) / proximitybatch::MaxPackSize * proximitybatch::MaxPackSize;
+
+    static int featureFlag(int feature)
+    {
+        static const int flags[NbFeatures] = { TriangleModel::FLAG_P1, TriangleModel::FLAG_E12, TriangleModel::FLAG_E31,
+                                               TriangleModel::FLAG_P2, TriangleModel::FLAG_P3, TriangleModel::FLAG_E23 };
+        return flags[feature];
+    }
+
+    /// Compute the lanes [i,i+P::Size), return the mask of the detected contacts
+    template<class P>
+    std::uint32_t computePack(std::size_t i)
+    {
+        typedef typename P::Value V;
+        typedef typename P::Mask M;
+        const V zero = P::set(0);
+        const V one = P::set(1);
+        const V half = P::set(SReal(0.5));
+        const V epsilon = P::set(std::numeric_limits<SReal>::epsilon());
+        const V oneMinusEpsilon = P::set(1 - std::numeric_limits<SReal>::epsilon());
+
+        const V abx = P::load(m_ab[0]+i), aby = P::load(m_ab[1]+i), abz = P::load(m_ab[2]+i);
+        const V acx = P::load(m_ac[0]+i), acy = P::load(m_ac[1]+i), acz = P::load(m_ac[2]+i);
+        const V p1x = P::load(m_p1[0]+i), p1y = P::load(m_p1[1]+i), p1z = P::load(m_p1[2]+i);
+        const V qx = P::load(m_q[0]+i), qy = P::load(m_q[1]+i), qz = P::load(m_q[2]+i);
+        const V aqx = P::sub(qx, p1x), aqy = P::sub(qy, p1y), aqz = P::sub(qz, p1z);
+
+        const V a00 = proximitybatch::dot<P>(abx, aby, abz, abx, aby, abz);
+        const V a11 = proximitybatch::dot<P>(acx, acy, acz, acx, acy, acz);
+        const V a01 = proximitybatch::dot<P>(abx, aby, abz, acx, acy, acz);
+        const V b0 = proximitybatch::dot<P>(aqx, aqy, aqz, abx, aby, abz);
+        const V b1 = proximitybatch::dot<P>(aqx, aqy, aqz, acx, acy, acz);
+        const V det = P::sub(P::mul(a00, a11), P::mul(a01, a01));
+
+        const V alpha = P::div(P::sub(P::mul(b0, a11), P::mul(b1, a01)), det);
+        const V beta = P::div(P::sub(P::mul(b1, a00), P::mul(b0, a01)), det);
+        const V pAB = P::div(b0, a00);
+        const V pAC = P::div(b1, a11);
+        const V pBC = P::div(P::sub(P::add(P::sub(b1, b0), a00), a01), P::sub(P::add(a00, a11), P::mul(P::set(2), a01)));
+
+        // same sequence of tests as doIntersectionTrianglePoint
+        const M inside = P::notMask(P::orMask(P::orMask(P::lt(alpha, epsilon), P::lt(beta, epsilon)), P::gt(P::add(alpha, beta), oneMinusEpsilon)));
+        const M onA = P::andMask(P::lt(pAB, epsilon), P::lt(pAC, epsilon));
+        M remaining = P::notMask(onA);
+        const M onAB = P::andMask(remaining, P::andMask(P::andMask(P::lt(pAB, oneMinusEpsilon), P::ge(pAB, epsilon)), P::lt(beta, epsilon)));
+        remaining = P::andMask(remaining, P::notMask(onAB));
+        const M onAC = P::andMask(remaining, P::andMask(P::andMask(P::lt(pAC, oneMinusEpsilon), P::ge(pAC, epsilon)), P::lt(alpha, epsilon)));
+        remaining = P::andMask(remaining, P::notMask(onAC));
+        const M onB = P::andMask(remaining, P::lt(pBC, epsilon));
+        remaining = P::andMask(remaining, P::notMask(onB));
+        const M onC = P::andMask(remaining, P::gt(pBC, oneMinusEpsilon));
+        const M onBC = P::andMask(remaining, P::notMask(onC));
+
+        const V u = P::select(inside, alpha, P::select(onAB, pAB, P::select(onB, one, P::select(onBC, P::sub(one, pBC), zero))));
+        const V v = P::select(inside, beta, P::select(onAC, pAC, P::select(onC, one, P::select(onBC, pBC, zero))));
+
+        const M regions[NbFeatures] = { onA, onAB, onAC, onB, onC, onBC };
+        M feature = P::andMask(onA, P::gt(P::load(m_features[FeatureA]+i), half));
+        for (int f = FeatureAB; f < NbFeatures; ++f)
+        {
+            feature = P::orMask(feature, P::andMask(regions[f], P::gt(P::load(m_features[f]+i), half)));
+        }
+
+        const V px = P::add(P::add(p1x, P::mul(abx, u)), P::mul(acx, v));
+        const V py = P::add(P::add(p1y, P::mul(aby, u)), P::mul(acy, v));
+        const V pz = P::add(P::add(p1z, P::mul(abz, u)), P::mul(acz, v));
+        const V pqx = P::sub(qx, px), pqy = P::sub(qy, py), pqz = P::sub(qz, pz);
+        const V norm2 = proximitybatch::dot<P>(pqx, pqy, pqz, pqx, pqy, pqz);
+
+        P::store(m_p[0]+i, px);
+        P::store(m_p[1]+i, py);
+        P::store(m_p[2]+i, pz);
+        P::store(m_norm2+i, norm2);
+        return P::bits(P::andMask(P::orMask(inside, feature), P::notMask(P::ge(norm2, P::set(m_dist2)))));
+    }
+
+    SReal m_dist2;
+    std::size_t m_size { 0 };
+    std::uint32_t m_detected { 0 };
+
+    alignas(32) SReal m_p1[3][PaddedCapacity];
+    alignas(32) SReal m_ab[3][PaddedCapacity];
+    alignas(32) SReal m_ac[3][PaddedCapacity];
+    alignas(32) SReal m_q[3][PaddedCapacity];
+    alignas(32) SReal m_features[NbFeatures][PaddedCapacity]; ///< 1 if the feature is attached to the triangle
+    alignas(32) SReal m_p[3][PaddedCapacity]; ///< closest points on the triangles
+    alignas(32) SReal m_norm2[PaddedCapacity];
+    int m_id[Capacity];
+    bool m_swap[Capacity];
+};
+
+/** Batches of the segment-segment proximity tests of MeshNewProximityIntersection.
+ *
+ *  Same organization as TrianglePointBatch, the closest points being those of
+ *  IntrUtil::segNearestPoints. The rare tests between parallel segments, whose closest
+ *  points are found by projecting the extremities, are computed by IntrUtil after the batch.
+ */
+template<std::size_t Capacity>
+class SegmentSegmentBatch
+{
+public:
+    typedef sofa::helper::vector<sofa::core::collision::DetectionOutput> OutputVector;
+    static_assert(Capacity < 32, "the parallel segments are stored as the bits of a 32-bit mask");
+
+    explicit SegmentSegmentBatch(SReal dist2) : m_dist2(dist2) {}
+
+    std::size_t size() const { return m_size; }
+
+    /// Add the test between the segments (p1,p2) and (q1,q2)
+    void add(const defaulttype::Vector3& p1, const defaulttype::Vector3& p2, const defaulttype::Vector3& q1, const defaulttype::Vector3& q2, int id)
+    {
+        assert(m_size < Capacity);
+        const std::size_t i = m_size++;
+        for (int c = 0; c < 3; ++c)
+        {
+            m_p1[c][i] = p1[c];
+            m_p2[c][i] = p2[c];
+            m_q1[c][i] = q1[c];
+            m_q2[c][i] = q2[c];
+        }
+        m_id[i] = id;
+    }
+
+    /// Compute the closest points of all the tests
+    void compute()
+    {
+        typedef proximitybatch::Pack<SReal> P;
+        const std::size_t end = (m_size + P::Size - 1) / P::Size * P::Size;
+        for (std::size_t i = m_size; i < end; ++i)
+        {
+            // unused lanes of the last pack
+            for (int c = 0; c < 3; ++c)
+            {
+                m_p1[c][i] = m_p2[c][i] = m_q1[c][i] = m_q2[c][i] = 0;
+            }
+        }
+
+        std::uint32_t parallel = 0;
+        for (std::size_t i = 0; i < end; i += P::Size)
+        {
+            parallel |= computePack<P>(i) << i;
+        }
+        parallel &= (std::uint32_t(1) << m_size) - 1;
+
+        for (std::size_t i = 0; parallel != 0; ++i, parallel >>= 1)
+        {
+            if (!(parallel & 1))
+                continue;
+
+            defaulttype::Vector3 p, q;
+            IntrUtil<SReal>::segNearestPoints(defaulttype::Vector3(m_p1[0][i], m_p1[1][i], m_p1[2][i]), defaulttype::Vector3(m_p2[0][i], m_p2[1][i], m_p2[2][i]),
+                                              defaulttype::Vector3(m_q1[0][i], m_q1[1][i], m_q1[2][i]), defaulttype::Vector3(m_q2[0][i], m_q2[1][i], m_q2[2][i]), p, q);
+            for (int c = 0; c < 3; ++c)
+            {
+                m_p[c][i] = p[c];
+                m_q[c][i] = q[c];
+            }
+            m_norm2[i] = (q-p).norm2();
+        }
+    }
+
+    /// Append the contacts detected by compute(), return their number
+    int writeOutputs(OutputVector* contacts) const
+    {
+        int n = 0;
+        for (std::size_t i = 0; i < m_size; ++i)
+        {
+            if (m_norm2[i] >= m_dist2)
+                continue;
+
+            const defaulttype::Vector3 p(m_p[0][i], m_p[1][i], m_p[2][i]);
+            const defaulttype::Vector3 q(m_q[0][i], m_q[1][i], m_q[2][i]);
+
+            contacts->resize(contacts->size()+1);
+            core::collision::DetectionOutput *detection = &*(contacts->end()-1);
+            detection->id = m_id[i];
+            detection->point[0]=p;
+            detection->point[1]=q;
+            detection->value = helper::rsqrt(m_norm2[i]);
+            detection->normal = (q-p) / detection->value;
+            ++n;
+        }
+        return n;
+    }
+
+protected:
+    static constexpr std::size_t PaddedCapacity = (Capacity + proximitybatch::MaxPackSize - 1) / proximitybatch::MaxPackSize * proximitybatch::MaxPackSize;
+
+    /// Compute the lanes [i,i+P::Size), return the mask of the parallel segments
+    template<class P>
+    std::uint32_t computePack(std::size_t i)
+    {
+        typedef typename P::Value V;
+        typedef typename P::Mask M;
+        const V zero = P::set(0);
+        const V one = P::set(1);
+        const V tolerance = P::set(IntrUtil<SReal>::ZERO_TOLERANCE());
+
+        const V p1x = P::load(m_p1[0]+i), p1y = P::load(m_p1[1]+i), p1z = P::load(m_p1[2]+i);
+        const V p2x = P::load(m_p2[0]+i), p2y = P::load(m_p2[1]+i), p2z = P::load(m_p2[2]+i);
+        const V q1x = P::load(m_q1[0]+i), q1y = P::load(m_q1[1]+i), q1z = P::load(m_q1[2]+i);
+        const V q2x = P::load(m_q2[0]+i), q2y = P::load(m_q2[1]+i), q2z = P::load(m_q2[2]+i);
+
+        const V abx = P::sub(p2x, p1x), aby = P::sub(p2y, p1y), abz = P::sub(p2z, p1z);
+        const V cdx = P::sub(q2x, q1x), cdy = P::sub(q2y, q1y), cdz = P::sub(q2z, q1z);
+        const V acx = P::sub(q1x, p1x), acy = P::sub(q1y, p1y), acz = P::sub(q1z, p1z);
+        const V dcx = P::sub(zero, cdx), dcy = P::sub(zero, cdy), dcz = P::sub(zero, cdz);
+
+        const V a00 = proximitybatch::dot<P>(abx, aby, abz, abx, aby, abz);
+        const V a11 = proximitybatch::dot<P>(cdx, cdy, cdz, cdx, cdy, cdz);
+        const V a01 = proximitybatch::dot<P>(dcx, dcy, dcz, abx, aby, abz);
+        const V b0 = proximitybatch::dot<P>(abx, aby, abz, acx, acy, acz);
+        const V b1 = proximitybatch::dot<P>(dcx, dcy, dcz, acx, acy, acz);
+        const V det = P::sub(P::mul(a00, a11), P::mul(a01, a01));
+
+        V alpha = P::div(P::sub(P::mul(b0, a11), P::mul(b1, a01)), det);
+        V beta = P::div(P::sub(P::mul(b1, a00), P::mul(b0, a01)), det);
+
+        // clamping of segNearestPoints
+        const V beta0 = P::div(proximitybatch::dot<P>(cdx, cdy, cdz, P::sub(p1x, q1x), P::sub(p1y, q1y), P::sub(p1z, q1z)), a11);
+        const V beta1 = P::div(proximitybatch::dot<P>(cdx, cdy, cdz, P::sub(p2x, q1x), P::sub(p2y, q1y), P::sub(p2z, q1z)), a11);
+        M low = P::lt(alpha, zero);
+        M high = P::gt(alpha, one);
+        beta = P::select(low, beta0, P::select(high, beta1, beta));
+        alpha = P::select(low, zero, P::select(high, one, alpha));
+
+        const V alpha0 = P::div(proximitybatch::dot<P>(abx, aby, abz, acx, acy, acz), a00);
+        const V alpha1 = P::div(proximitybatch::dot<P>(abx, aby, abz, P::sub(q2x, p1x), P::sub(q2y, p1y), P::sub(q2z, p1z)), a00);
+        low = P::lt(beta, zero);
+        high = P::gt(beta, one);
+        alpha = P::select(low, alpha0, P::select(high, alpha1, alpha));
+        beta = P::select(low, zero, P::select(high, one, beta));
+
+        alpha = P::select(P::lt(alpha, zero), zero, P::select(P::gt(alpha, one), one, alpha));
+
+        const V px = P::add(p1x, P::mul(abx, alpha)), py = P::add(p1y, P::mul(aby, alpha)), pz = P::add(p1z, P::mul(abz, alpha));
+        const V qx = P::add(q1x, P::mul(cdx, beta)), qy = P::add(q1y, P::mul(cdy, beta)), qz = P::add(q1z, P::mul(cdz, beta));
+        const V pqx = P::sub(qx, px), pqy = P::sub(qy, py), pqz = P::sub(qz, pz);
+
+        P::store(m_p[0]+i, px);
+        P::store(m_p[1]+i, py);
+        P::store(m_p[2]+i, pz);
+        P::store(m_q[0]+i, qx);
+        P::store(m_q[1]+i, qy);
+        P::store(m_q[2]+i, qz);
+        P::store(m_norm2+i, proximitybatch::dot<P>(pqx, pqy, pqz, pqx, pqy, pqz));
+        return P::bits(P::notMask(P::orMask(P::lt(det, P::sub(zero, tolerance)), P::gt(det, tolerance))));
+    }
+
+    SReal m_dist2;
+    std::size_t m_size { 0 };
+
+    alignas(32) SReal m_p1[3][PaddedCapacity];
+    alignas(32) SReal m_p2[3][PaddedCapacity];
+    alignas(32) SReal m_q1[3][PaddedCapacity];
+    alignas(32) SReal m_q2[3][PaddedCapacity];
+    alignas(32) SReal m_p[3][PaddedCapacity]; ///< closest points on the first segments
+    alignas(32) SReal m_q[3][PaddedCapacity]; ///< closest points on the second segments
+    alignas(32) SReal m_norm2[PaddedCapacity];
+    int m_id[Capacity];
+};
+
+} //namespace sofa::component::collision
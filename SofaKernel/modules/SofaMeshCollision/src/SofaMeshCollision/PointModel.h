@@ -107,6 +107,8 @@ public:
     const Deriv& velocity(Index index) const;
 
     Data<bool> bothSide; ///< to activate collision on both side of the point model (when surface normals are defined on these points)
+    Data<SReal> d_bvhRebuildThreshold; ///< rebuild the bounding tree when its cost exceeds this factor times its cost when it was built, instead of refitting it (0 to always refit)
+    Data<bool> d_parallelBoundingTree; ///< compute the bounding boxes of the points and refit the bounding tree in parallel
 
     /// Pre-construction check method called by ObjectFactory.
     /// Check that DataTypes matches the MechanicalState.
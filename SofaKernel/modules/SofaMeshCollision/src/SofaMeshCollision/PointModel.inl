@@ -37,6 +37,8 @@ namespace sofa::component::collision
 template<class DataTypes>
 PointCollisionModel<DataTypes>::PointCollisionModel()
     : bothSide(initData(&bothSide, false, "bothSide", "activate collision on both side of the point model (when surface normals are defined on these points)") )
+    , d_bvhRebuildThreshold(initData(&d_bvhRebuildThreshold, (SReal)0, "bvhRebuildThreshold", "rebuild the bounding tree when its cost exceeds this factor times its cost when it was built, instead of refitting it (0 to always refit)"))
+    , d_parallelBoundingTree(initData(&d_parallelBoundingTree, false, "parallelBoundingTree", "compute the bounding boxes of the points and refit the bounding tree in parallel"))
     , mstate(nullptr)
     , computeNormals( initData(&computeNormals, false, "computeNormals", "activate computation of normal vectors (required for some collision detection algorithms)") )
     , m_lmdFilter( nullptr )
@@ -125,6 +127,7 @@ template<class DataTypes>
 void PointCollisionModel<DataTypes>::computeBoundingTree(int maxDepth)
 {
     CubeCollisionModel* cubeModel = createPrevious<CubeCollisionModel>();
+    cubeModel->linkRefitOptions(&d_bvhRebuildThreshold, &d_parallelBoundingTree);
     const auto npoints = mstate->getSize();
     bool updated = false;
     if (npoints != size)
@@ -142,12 +145,12 @@ void PointCollisionModel<DataTypes>::computeBoundingTree(int maxDepth)
     {
         //VecCoord& x =mstate->read(core::ConstVecCoordId::position())->getValue();
         const SReal distance = this->proximity.getValue();
-        for (Size i=0; i<size; i++)
+        cubeModel->forEachLeaf(size, [&](Index i)
         {
             TPoint<DataTypes> p(this,i);
             const defaulttype::Vector3& pt = p.p();
             cubeModel->setParentOf(i, pt - defaulttype::Vector3(distance,distance,distance), pt + defaulttype::Vector3(distance,distance,distance));
-        }
+        });
         cubeModel->computeBoundingTree(maxDepth);
     }
 
@@ -161,6 +164,7 @@ template<class DataTypes>
 void PointCollisionModel<DataTypes>::computeContinuousBoundingTree(double dt, int maxDepth)
 {
     CubeCollisionModel* cubeModel = createPrevious<CubeCollisionModel>();
+    cubeModel->linkRefitOptions(&d_bvhRebuildThreshold, &d_parallelBoundingTree);
     const auto npoints = mstate->getSize();
     bool updated = false;
     if (npoints != size)
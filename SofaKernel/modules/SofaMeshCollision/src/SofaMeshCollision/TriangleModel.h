@@ -138,6 +138,8 @@ public:
     Data<bool> d_bothSide; ///< to activate collision on both side of the triangle model
     Data<bool> d_computeNormals; ///< set to false to disable computation of triangles normal
     Data<bool> d_useCurvature; ///< use the curvature of the mesh to avoid some self-intersection test
+    Data<SReal> d_bvhRebuildThreshold; ///< rebuild the bounding tree when its cost exceeds this factor times its cost when it was built, instead of refitting it (0 to always refit)
+    Data<bool> d_parallelBoundingTree; ///< compute the bounding boxes of the triangles and refit the bounding tree in parallel
     
     /// Link to be set to the topology container in the component graph.
     SingleLink<TriangleCollisionModel<DataTypes>, sofa::core::topology::BaseMeshTopology, BaseLink::FLAG_STOREPATH | BaseLink::FLAG_STRONGLINK> l_topology;
@@ -41,6 +41,8 @@ TriangleCollisionModel<DataTypes>::TriangleCollisionModel()
     : d_bothSide(initData(&d_bothSide, false, "bothSide", "activate collision on both side of the triangle model") )
     , d_computeNormals(initData(&d_computeNormals, true, "computeNormals", "set to false to disable computation of triangles normal"))
     , d_useCurvature(initData(&d_useCurvature, false, "useCurvature", "use the curvature of the mesh to avoid some self-intersection test"))
+    , d_bvhRebuildThreshold(initData(&d_bvhRebuildThreshold, (SReal)0, "bvhRebuildThreshold", "rebuild the bounding tree when its cost exceeds this factor times its cost when it was built, instead of refitting it (0 to always refit)"))
+    , d_parallelBoundingTree(initData(&d_parallelBoundingTree, false, "parallelBoundingTree", "compute the bounding boxes of the triangles and refit the bounding tree in parallel"))
     , l_topology(initLink("topology", "link to the topology container"))
     , m_mstate(nullptr)
     , m_topology(nullptr)
@@ -227,6 +229,7 @@ template<class DataTypes>
 void TriangleCollisionModel<DataTypes>::computeBoundingTree(int maxDepth)
 {
     CubeCollisionModel* cubeModel = createPrevious<CubeCollisionModel>();
+    cubeModel->linkRefitOptions(&d_bvhRebuildThreshold, &d_parallelBoundingTree);
 
     // check first that topology didn't changed
     if (m_topology->getRevision() != m_topologyRevision)
@@ -241,17 +244,18 @@ void TriangleCollisionModel<DataTypes>::computeBoundingTree(int maxDepth)
     // set to false to avoid excesive loop
     m_needsUpdate=false;
 
-    defaulttype::Vector3 minElem, maxElem;
     const VecCoord& x = this->m_mstate->read(core::ConstVecCoordId::position())->getValue();
 
     const bool calcNormals = d_computeNormals.getValue();
+    const bool useCurvature = d_useCurvature.getValue();
 
     cubeModel->resize(size);  // size = number of triangles
     if (!empty())
     {
         const SReal distance = (SReal)this->proximity.getValue();
-        for (Size i=0; i<size; i++)
+        cubeModel->forEachLeaf(size, [&](Index i)
         {
+            defaulttype::Vector3 minElem, maxElem;
             Element t(this,i);
 
             const defaulttype::Vector3& pt1 = x[t.p1Index()];
@@ -276,11 +280,11 @@ void TriangleCollisionModel<DataTypes>::computeBoundingTree(int maxDepth)
                 t.n().normalize();
             }
 
-            if(d_useCurvature.getValue())
+            if(useCurvature)
                 cubeModel->setParentOf(i, minElem, maxElem, t.n()); // define the bounding box of the current triangle
             else
                 cubeModel->setParentOf(i, minElem, maxElem);
-        }
+        });
         cubeModel->computeBoundingTree(maxDepth);
     }
 
@@ -295,6 +299,7 @@ template<class DataTypes>
 void TriangleCollisionModel<DataTypes>::computeContinuousBoundingTree(double dt, int maxDepth)
 {
     CubeCollisionModel* cubeModel = createPrevious<CubeCollisionModel>();
+    cubeModel->linkRefitOptions(&d_bvhRebuildThreshold, &d_parallelBoundingTree);
 
     // check first that topology didn't changed
     if (m_topology->getRevision() != m_topologyRevision)
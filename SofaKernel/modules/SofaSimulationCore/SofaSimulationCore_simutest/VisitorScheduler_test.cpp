@@ -0,0 +1,106 @@
+/******************************************************************************
+*                 SOFA, Simulation Open-Framework Architecture                *
+*                    (c) 2006 INRIA, USTL, UJF, CNRS, MGH                     *
+*                                                                             *
+* This program is free software; you can redistribute it and/or modify it     *
+* under the terms of the GNU Lesser General Public License as published by    *
+* the Free Software Foundation; either version 2.1 of the License, or (at     *
+* your option) any later version.                                             *
+*                                                                             *
+* This program is distributed in the hope that it will be useful, but WITHOUT *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License *
+* for more details.                                                           *
+*                                                                             *
+* You should have received a copy of the GNU Lesser General Public License    *
+* along with this program. If not, see <http://www.gnu.org/licenses/>.        *
+*******************************************************************************
+* Authors: The SOFA Team and external contributors (see Authors.txt)          *
+*                                                                             *
+* Contact information: contact@sofa-framework.org                             *
+******************************************************************************/
+#include <sofa/core/ExecParams.h>
+#include <sofa/simulation/Node.h>
+#include <sofa/simulation/Simulation.h>
+#include <sofa/simulation/Visitor.h>
+#include <sofa/simulation/VisitorScheduler.h>
+using sofa::simulation::Node ;
+using sofa::simulation::Visitor ;
+using sofa::simulation::VisitorScheduler ;
+
+#include <SofaSimulationGraph/testing/BaseSimulationTest.h>
+using sofa::helper::testing::BaseSimulationTest ;
+
+namespace sofa
+{
+
+/// Counts the visitors it executes
+class CountingVisitorScheduler : public VisitorScheduler
+{
+public:
+    SOFA_CLASS(CountingVisitorScheduler, VisitorScheduler);
+
+    void executeVisitor(Node* node, Visitor* action) override
+    {
+        ++nbVisitors;
+        doExecuteVisitor(node, action);
+    }
+
+    int nbVisitors {0};
+};
+
+/// Counts the visited nodes
+class CountingVisitor : public Visitor
+{
+public:
+    CountingVisitor() : Visitor(sofa::core::ExecParams::defaultInstance()) {}
+
+    Result processNodeTopDown(Node*) override
+    {
+        ++nbNodes;
+        return RESULT_CONTINUE;
+    }
+
+    int nbNodes {0};
+};
+
+struct VisitorScheduler_test : public BaseSimulationTest
+{
+    void testExecuteVisitor()
+    {
+        Node::SPtr root = sofa::simulation::getSimulation()->createNewNode("root");
+        Node::SPtr child1 = root->createChild("child1");
+        Node::SPtr child2 = child1->createChild("child2");
+
+        CountingVisitorScheduler::SPtr scheduler = sofa::core::objectmodel::New<CountingVisitorScheduler>();
+        child1->addObject(scheduler);
+
+        EXPECT_EQ(root->getVisitorScheduler(), nullptr);
+        EXPECT_EQ(child1->getVisitorScheduler(), scheduler.get());
+        EXPECT_EQ(child2->getVisitorScheduler(), scheduler.get());
+
+        // visitors started above the scheduler are not scheduled by it
+        CountingVisitor fromRoot;
+        root->executeVisitor(&fromRoot);
+        EXPECT_EQ(fromRoot.nbNodes, 3);
+        EXPECT_EQ(scheduler->nbVisitors, 0);
+
+        // visitors started from the node of the scheduler or its descendants are
+        CountingVisitor fromChild2;
+        child2->executeVisitor(&fromChild2);
+        EXPECT_EQ(fromChild2.nbNodes, 1);
+        EXPECT_EQ(scheduler->nbVisitors, 1);
+
+        child1->removeObject(scheduler);
+        EXPECT_EQ(child2->getVisitorScheduler(), nullptr);
+
+        CountingVisitor afterRemoval;
+        child1->executeVisitor(&afterRemoval);
+        EXPECT_EQ(afterRemoval.nbNodes, 2);
+        EXPECT_EQ(scheduler->nbVisitors, 1);
+    }
+};
+
+TEST_F(VisitorScheduler_test, testExecuteVisitor ) { testExecuteVisitor(); }
+
+}
@@ -0,0 +1,120 @@
+#include <sofa/simulation/ArenaAllocator.h>
+#include <sofa/helper/testing/BaseTest.h>
+
+#include <cstdint>
+#include <vector>
+
+namespace sofa
+{
+
+    using simulation::ArenaAllocator;
+    
+    TEST(ArenaAllocatorTests, Alignment)
+    {
+        ArenaAllocator arena(256);
+        
+        for (std::size_t alignment : { 1, 2, 8, 16, 64 })
+        {
+            arena.allocate(3);
+            void* ptr = arena.allocate(10, alignment);
+            EXPECT_EQ(reinterpret_cast<std::uintptr_t>(ptr) % alignment, 0u);
+        }
+    }
+    
+    TEST(ArenaAllocatorTests, ResetMergesBlocks)
+    {
+        ArenaAllocator arena(128);
+        
+        for (int i = 0; i < 20; ++i)
+            arena.allocate(100);
+        EXPECT_GT(arena.getNbBlocks(), 1u);
+        
+        arena.reset();
+        EXPECT_EQ(arena.getNbBlocks(), 1u);
+        EXPECT_EQ(arena.getUsedSize(), 0u);
+        
+        // the same workload now fits in the merged block
+        const std::size_t capacity = arena.getCapacity();
+        for (int i = 0; i < 20; ++i)
+            arena.allocate(100);
+        EXPECT_EQ(arena.getNbBlocks(), 1u);
+        EXPECT_EQ(arena.getCapacity(), capacity);
+    }
+    
+    TEST(ArenaAllocatorTests, Rewind)
+    {
+        ArenaAllocator arena(128);
+        arena.allocate(16);
+        const std::size_t used = arena.getUsedSize();
+        
+        const ArenaAllocator::Marker marker = arena.getMarker();
+        for (int i = 0; i < 10; ++i)
+            arena.allocate(100);
+        arena.rewind(marker);
+        
+        EXPECT_EQ(arena.getUsedSize(), used);
+    }
+    
+    TEST(ArenaAllocatorTests, ArenaScope)
+    {
+        ArenaAllocator& arena = simulation::getThreadArena();
+        const std::size_t used = arena.getUsedSize();
+        {
+            simulation::ArenaScope scope;
+            int* value = simulation::newInThreadArena<int>(42);
+            EXPECT_EQ(*value, 42);
+            EXPECT_GT(arena.getUsedSize(), used);
+        }
+        EXPECT_EQ(arena.getUsedSize(), used);
+    }
+    
+    TEST(ArenaAllocatorTests, RewindAfterReset)
+    {
+        ArenaAllocator arena(128);
+        for (int i = 0; i < 5; ++i)
+            arena.allocate(100);
+        const ArenaAllocator::Marker marker = arena.getMarker();
+        
+        // the marker is past the allocations made after the reset, which must not be released
+        arena.reset();
+        arena.allocate(100);
+        const std::size_t used = arena.getUsedSize();
+#ifdef NDEBUG
+        arena.rewind(marker);
+        EXPECT_EQ(arena.getUsedSize(), used);
+#else
+        EXPECT_DEATH(arena.rewind(marker), "reset");
+        EXPECT_EQ(arena.getUsedSize(), used);
+#endif
+    }
+    
+    TEST(ArenaAllocatorTests, ArenaScopeAcrossReset)
+    {
+        ArenaAllocator arena(128);
+        const auto scopeAcrossReset = [&arena]()
+        {
+            simulation::ArenaScope scope(arena);
+            arena.allocate(100);
+            arena.reset();
+            arena.allocate(100);
+        };
+#ifdef NDEBUG
+        scopeAcrossReset();
+        EXPECT_GE(arena.getUsedSize(), 100u);
+#else
+        EXPECT_DEATH(scopeAcrossReset(), "reset");
+#endif
+    }
+    
+    TEST(ArenaAllocatorTests, StlAllocator)
+    {
+        simulation::ArenaScope scope;
+        std::vector<int, simulation::ArenaStlAllocator<int> > values;
+        for (int i = 0; i < 1000; ++i)
+            values.push_back(i);
+        
+        for (int i = 0; i < 1000; ++i)
+            EXPECT_EQ(values[i], i);
+    }
+
+} // namespace sofa
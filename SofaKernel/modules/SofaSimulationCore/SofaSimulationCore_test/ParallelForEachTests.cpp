@@ -0,0 +1,132 @@
+#include <sofa/simulation/TaskScheduler.h>
+#include <sofa/simulation/DefaultTaskScheduler.h>
+#include <sofa/simulation/ParallelForEach.h>
+#include <sofa/helper/testing/BaseTest.h>
+
+#include <functional>
+#include <numeric>
+#include <vector>
+
+namespace sofa
+{
+
+    using simulation::Range;
+    
+    // x[i] = 2*i for each i, every index is visited exactly once
+    static void ForEachDouble(const std::size_t N, const std::size_t grainSize, int nbThread = 0)
+    {
+        simulation::TaskScheduler* scheduler = simulation::TaskScheduler::create(simulation::DefaultTaskScheduler::name());
+        scheduler->init(nbThread);
+        
+        std::vector<int> visits(N, 0);
+        std::vector<std::size_t> x(N, 0);
+        
+        simulation::parallelForEach(*scheduler, Range<std::size_t>(0, N), grainSize, [&](std::size_t i)
+        {
+            x[i] = 2 * i;
+            ++visits[i];
+        });
+        
+        scheduler->stop();
+        
+        for (std::size_t i = 0; i < N; ++i)
+        {
+            EXPECT_EQ(visits[i], 1);
+            EXPECT_EQ(x[i], 2 * i);
+        }
+    }
+    
+    // sum of integers from 1 to N
+    static int64_t ReduceSum1ToN(const int64_t N, const std::size_t grainSize, int nbThread = 0)
+    {
+        simulation::TaskScheduler* scheduler = simulation::TaskScheduler::create(simulation::DefaultTaskScheduler::name());
+        scheduler->init(nbThread);
+        
+        const int64_t result = simulation::parallelReduce(*scheduler, Range<int64_t>(1, N + 1), grainSize, int64_t(0),
+            [](const Range<int64_t>& range, int64_t sum)
+            {
+                for (int64_t i = range.start(); i != range.end(); ++i)
+                {
+                    sum += i;
+                }
+                return sum;
+            },
+            std::plus<int64_t>());
+        
+        scheduler->stop();
+        return result;
+    }
+    
+    
+    TEST(ParallelForEachTests, ForEachSingle)
+    {
+        ForEachDouble(10007, 64, 1);
+    }
+    
+    TEST(ParallelForEachTests, ForEachMulti)
+    {
+        ForEachDouble(10007, 64);
+    }
+    
+    TEST(ParallelForEachTests, ForEachAutomaticGrainSize)
+    {
+        ForEachDouble(10007, 0);
+        ForEachDouble(1, 0);
+        ForEachDouble(0, 0);
+    }
+    
+    // iterators are split the same way as indices
+    TEST(ParallelForEachTests, ForEachIterator)
+    {
+        std::vector<double> x(1000, 1.0);
+        simulation::parallelForEach(Range<std::vector<double>::iterator>(x.begin(), x.end()), 10, [](std::vector<double>::iterator it)
+        {
+            *it *= 3.0;
+        });
+        EXPECT_EQ(std::accumulate(x.begin(), x.end(), 0.0), 3000.0);
+    }
+    
+    TEST(ParallelForEachTests, ReduceSingle)
+    {
+        const int64_t N = 1 << 20;
+        EXPECT_EQ(ReduceSum1ToN(N, 1000, 1), N * (N + 1) / 2);
+    }
+    
+    TEST(ParallelForEachTests, ReduceMulti)
+    {
+        const int64_t N = 1 << 20;
+        EXPECT_EQ(ReduceSum1ToN(N, 1000), N * (N + 1) / 2);
+        EXPECT_EQ(ReduceSum1ToN(N, 0), N * (N + 1) / 2);
+    }
+    
+    // the floating point result is independent from the number of threads
+    TEST(ParallelForEachTests, ReduceDeterministic)
+    {
+        std::vector<double> x(100000);
+        for (std::size_t i = 0; i < x.size(); ++i)
+        {
+            x[i] = 1.0 / double(i + 1);
+        }
+        
+        auto dotProduct = [&](int nbThread)
+        {
+            simulation::TaskScheduler* scheduler = simulation::TaskScheduler::create(simulation::DefaultTaskScheduler::name());
+            scheduler->init(nbThread);
+            const double result = simulation::parallelReduce(*scheduler, Range<std::size_t>(0, x.size()), 128, 0.0,
+                [&](const Range<std::size_t>& range, double sum)
+                {
+                    for (std::size_t i = range.start(); i != range.end(); ++i)
+                    {
+                        sum += x[i] * x[i];
+                    }
+                    return sum;
+                },
+                std::plus<double>());
+            scheduler->stop();
+            return result;
+        };
+        
+        EXPECT_EQ(dotProduct(1), dotProduct(4));
+    }
+
+} // namespace sofa
@@ -2,8 +2,12 @@
 
 #include <sofa/simulation/TaskScheduler.h>
 #include <sofa/simulation/DefaultTaskScheduler.h>
+#include <sofa/simulation/WorkStealingDeque.h>
 #include <sofa/helper/testing/BaseTest.h>
 
+#include <thread>
+#include <vector>
+
 namespace sofa
 {
 
@@ -98,5 +102,77 @@ namespace sofa
         return;
     }
     
+    // the task queue grows beyond its initial capacity, the owner pops in LIFO order and thieves steal in FIFO order
+    TEST(TaskSchedulerTests, WorkStealingDequeGrow)
+    {
+        simulation::WorkStealingDeque<int64_t> deque(4);
+        for (int64_t i = 0; i < 1000; ++i)
+        {
+            deque.push(i);
+        }
+        EXPECT_EQ(deque.size(), 1000);
+        EXPECT_GE(deque.capacity(), 1000);
+        
+        int64_t item = -1;
+        EXPECT_TRUE(deque.steal(item));
+        EXPECT_EQ(item, 0);
+        EXPECT_TRUE(deque.pop(item));
+        EXPECT_EQ(item, 999);
+        
+        while (deque.pop(item)) {}
+        EXPECT_TRUE(deque.empty());
+        EXPECT_FALSE(deque.steal(item));
+        return;
+    }
+    
+    // every item is either popped by the owner or stolen by a thief, exactly once
+    TEST(TaskSchedulerTests, WorkStealingDequeConcurrentSteal)
+    {
+        const int64_t N = 1 << 16;
+        simulation::WorkStealingDeque<int64_t> deque;
+        std::atomic<int64_t> stolenSum(0);
+        std::atomic<bool> done(false);
+        
+        std::vector<std::thread> thieves;
+        for (int t = 0; t < 4; ++t)
+        {
+            thieves.emplace_back([&]()
+            {
+                int64_t item;
+                while (!done.load() || !deque.empty())
+                {
+                    if (deque.steal(item))
+                    {
+                        stolenSum += item;
+                    }
+                }
+            });
+        }
+        
+        int64_t poppedSum = 0;
+        int64_t item;
+        for (int64_t i = 1; i <= N; ++i)
+        {
+            deque.push(i);
+            if ((i % 3) == 0 && deque.pop(item))
+            {
+                poppedSum += item;
+            }
+        }
+        while (deque.pop(item))
+        {
+            poppedSum += item;
+        }
+        done = true;
+        
+        for (auto& thief : thieves)
+        {
+            thief.join();
+        }
+        
+        EXPECT_EQ(poppedSum + stolenSum.load(), N * (N + 1) / 2);
+        return;
+    }
+    
 
 } // namespace sofa
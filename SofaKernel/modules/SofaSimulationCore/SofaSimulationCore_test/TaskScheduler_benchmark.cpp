@@ -0,0 +1,60 @@
+/******************************************************************************
+*                 SOFA, Simulation Open-Framework Architecture                *
+*                    (c) 2006 INRIA, USTL, UJF, CNRS, MGH                     *
+*                                                                             *
+* This program is free software; you can redistribute it and/or modify it     *
+* under the terms of the GNU Lesser General Public License as published by    *
+* the Free Software Foundation; either version 2.1 of the License, or (at     *
+* your option) any later version.                                             *
+*                                                                             *
+* This program is distributed in the hope that it will be useful, but WITHOUT *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License *
+* for more details.                                                           *
+*                                                                             *
+* You should have received a copy of the GNU Lesser General Public License    *
+* along with this program. If not, see <http://www.gnu.org/licenses/>.        *
+*******************************************************************************
+* Authors: The SOFA Team and external contributors (see Authors.txt)          *
+*                                                                             *
+* Contact information: contact@sofa-framework.org                             *
+******************************************************************************/
+#include "TaskSchedulerTestTasks.h"
+
+#include <sofa/simulation/TaskScheduler.h>
+#include <sofa/simulation/DefaultTaskScheduler.h>
+
+#include <benchmark/benchmark.h>
+
+namespace
+{
+
+using namespace sofa;
+
+/// task throughput of the scheduler on arg 0 threads
+/// IntSumTask splits [1,N] recursively: it generates 2N-1 tasks
+void BM_TaskScheduler_IntSum(benchmark::State& state)
+{
+    const int64_t N = 1 << 16;
+    simulation::TaskScheduler* scheduler = simulation::TaskScheduler::create(simulation::DefaultTaskScheduler::name());
+    scheduler->init(unsigned(state.range(0)));
+
+    for (auto _ : state)
+    {
+        simulation::CpuTask::Status status;
+        int64_t result = 0;
+        IntSumTask task(1, N, &result, &status);
+        scheduler->addTask(&task);
+        scheduler->workUntilDone(&status);
+        benchmark::DoNotOptimize(result);
+    }
+    state.SetItemsProcessed(int64_t(state.iterations()) * (2 * N - 1));
+
+    scheduler->stop();
+}
+
+} // namespace
+
+BENCHMARK(BM_TaskScheduler_IntSum)->RangeMultiplier(2)->Range(1, 64)->UseRealTime();
+
+BENCHMARK_MAIN();
@@ -0,0 +1,98 @@
+#include <sofa/simulation/ThreadAffinity.h>
+#include <sofa/simulation/TaskScheduler.h>
+#include <sofa/simulation/DefaultTaskScheduler.h>
+#include <sofa/simulation/ParallelForEach.h>
+#include <sofa/helper/testing/BaseTest.h>
+
+#include <algorithm>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace sofa
+{
+
+    using simulation::ThreadAffinity;
+    
+    TEST(ThreadAffinityTests, Read)
+    {
+        ThreadAffinity affinity;
+        EXPECT_FALSE(affinity.isEnabled());
+        EXPECT_EQ(affinity.toString(), "none");
+        
+        EXPECT_TRUE(affinity.read("cores"));
+        EXPECT_TRUE(affinity.pinThreads());
+        EXPECT_EQ(affinity.getNumaNode(), -1);
+        EXPECT_EQ(affinity.toString(), "cores");
+        
+        EXPECT_TRUE(affinity.read(" cores, node:1 "));
+        EXPECT_TRUE(affinity.pinThreads());
+        EXPECT_EQ(affinity.getNumaNode(), 1);
+        EXPECT_EQ(affinity.toString(), "cores,node:1");
+        
+        EXPECT_TRUE(affinity.read("node:0"));
+        EXPECT_FALSE(affinity.pinThreads());
+        EXPECT_EQ(affinity, ThreadAffinity(false, 0));
+        
+        // invalid strings leave the affinity unchanged
+        EXPECT_FALSE(affinity.read("sockets"));
+        EXPECT_FALSE(affinity.read("node:"));
+        EXPECT_FALSE(affinity.read("node:-1"));
+        EXPECT_EQ(affinity.toString(), "node:0");
+        
+        EXPECT_TRUE(affinity.read("none"));
+        EXPECT_FALSE(affinity.isEnabled());
+    }
+    
+#if defined(__linux__)
+    TEST(ThreadAffinityTests, PinThread)
+    {
+        const ThreadAffinity affinity(true, -1);
+        const std::vector<int> cpus = affinity.getCpus();
+        const std::vector<int> allowed = ThreadAffinity::getCurrentThreadCpus();
+        ASSERT_FALSE(cpus.empty());
+        EXPECT_EQ(cpus.size(), allowed.size());
+        
+        std::vector<int> threadCpus;
+        std::thread thread([&]()
+        {
+            affinity.applyToCurrentThread(cpus, 1);
+            threadCpus = ThreadAffinity::getCurrentThreadCpus();
+        });
+        thread.join();
+        
+        ASSERT_EQ(threadCpus.size(), 1u);
+        EXPECT_EQ(threadCpus[0], cpus[1 % cpus.size()]);
+        
+        // the calling thread is not affected
+        EXPECT_EQ(ThreadAffinity::getCurrentThreadCpus(), allowed);
+    }
+    
+    TEST(ThreadAffinityTests, SchedulerPinsWorkers)
+    {
+        const std::vector<int> allowed = ThreadAffinity::getCurrentThreadCpus();
+        
+        simulation::TaskScheduler* scheduler = simulation::TaskScheduler::create(simulation::DefaultTaskScheduler::name());
+        scheduler->setThreadAffinity(ThreadAffinity(true, -1));
+        scheduler->init(2);
+        
+        std::mutex mutex;
+        std::vector<std::size_t> nbCpus;
+        simulation::parallelForEach(*scheduler, simulation::Range<int>(0, 64), 1, [&](int)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            nbCpus.push_back(ThreadAffinity::getCurrentThreadCpus().size());
+        });
+        
+        for (std::size_t n : nbCpus)
+        {
+            EXPECT_EQ(n, 1u);
+        }
+        
+        // the main thread gets its cpus back
+        scheduler->stop();
+        EXPECT_EQ(ThreadAffinity::getCurrentThreadCpus(), allowed);
+    }
+#endif
+
+} // namespace sofa
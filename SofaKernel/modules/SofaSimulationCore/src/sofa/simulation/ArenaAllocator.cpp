@@ -0,0 +1,193 @@
+/******************************************************************************
+*                 SOFA, Simulation Open-Framework Architecture                *
+*                    (c) 2006 INRIA, USTL, UJF, CNRS, MGH                     *
+*                                                                             *
+* This program is free software; you can redistribute it and/or modify it     *
+* under the terms of the GNU Lesser General Public License as published by    *
+* the Free Software Foundation; either version 2.1 of the License, or (at     *
+* your option) any later version.                                             *
+*                                                                             *
+* This program is distributed in the hope that it will be useful, but WITHOUT *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License *
+* for more details.                                                           *
+*                                                                             *
+* You should have received a copy of the GNU Lesser General Public License    *
+* along with this program. If not, see <http://www.gnu.org/licenses/>.        *
+*******************************************************************************
+* Authors: The SOFA Team and external contributors (see Authors.txt)          *
+*                                                                             *
+* Contact information: contact@sofa-framework.org                             *
+******************************************************************************/
+#include <sofa/simulation/ArenaAllocator.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+
+
+namespace sofa
+{
+    namespace simulation
+    {
+        
+        ArenaAllocator::ArenaAllocator(std::size_t blockSize)
+        : m_current(0)
+        , m_offset(0)
+        , m_epoch(0)
+        , m_blockSize(blockSize)
+        {
+        }
+        
+        ArenaAllocator::~ArenaAllocator()
+        {
+            releaseBlocks();
+        }
+        
+        void* ArenaAllocator::allocate(std::size_t size, std::size_t alignment)
+        {
+            while (true)
+            {
+                if (m_current >= m_blocks.size())
+                {
+                    addBlock(std::max(m_blockSize, size + alignment));
+                }
+                
+                Block& block = m_blocks[m_current];
+                const std::uintptr_t base = reinterpret_cast<std::uintptr_t>(block.data);
+                const std::size_t offset = std::size_t(((base + m_offset + alignment - 1) & ~std::uintptr_t(alignment - 1)) - base);
+                if (offset + size <= block.size)
+                {
+                    m_offset = offset + size;
+                    return block.data + offset;
+                }
+                
+                // next block, possibly kept from a previous step but too small
+                ++m_current;
+                m_offset = 0;
+            }
+        }
+        
+        void ArenaAllocator::reserve(std::size_t size)
+        {
+            if (m_blocks.empty())
+            {
+                addBlock(std::max(m_blockSize, size));
+                std::memset(m_blocks.front().data, 0, m_blocks.front().size);
+            }
+        }
+        
+        void ArenaAllocator::reset()
+        {
+            if (m_current > 0)
+            {
+                // several blocks were needed: use a single one large enough from now on
+                const std::size_t capacity = getCapacity();
+                releaseBlocks();
+                addBlock(capacity);
+            }
+            m_current = 0;
+            m_offset = 0;
+            ++m_epoch;
+        }
+        
+        void ArenaAllocator::rewind(const Marker& marker)
+        {
+            // the position of a marker taken before a reset() may be used by the allocations made since
+            assert(marker.epoch == m_epoch && "the arena was reset after the marker was taken");
+            if (marker.epoch != m_epoch)
+                return; // the memory allocated after the marker is already released
+            m_current = marker.block;
+            m_offset = marker.offset;
+        }
+        
+        std::size_t ArenaAllocator::getUsedSize() const
+        {
+            std::size_t size = 0;
+            for (std::size_t i = 0; i < m_current && i < m_blocks.size(); ++i)
+            {
+                size += m_blocks[i].size;
+            }
+            return size + m_offset;
+        }
+        
+        std::size_t ArenaAllocator::getCapacity() const
+        {
+            std::size_t capacity = 0;
+            for (const Block& block : m_blocks)
+            {
+                capacity += block.size;
+            }
+            return capacity;
+        }
+        
+        void ArenaAllocator::addBlock(std::size_t size)
+        {
+            m_blocks.push_back({ static_cast<char*>(::operator new(size)), size });
+        }
+        
+        void ArenaAllocator::releaseBlocks()
+        {
+            for (const Block& block : m_blocks)
+            {
+                ::operator delete(block.data);
+            }
+            m_blocks.clear();
+        }
+        
+        
+        namespace
+        {
+            std::mutex& threadArenasMutex()
+            {
+                static std::mutex mutex;
+                return mutex;
+            }
+            
+            std::vector<ArenaAllocator*>& threadArenas()
+            {
+                static std::vector<ArenaAllocator*> arenas;
+                return arenas;
+            }
+            
+            // arena registered for resetThreadArenas() during the lifetime of its thread
+            class ThreadArena
+            {
+            public:
+                ThreadArena()
+                {
+                    std::lock_guard<std::mutex> lock(threadArenasMutex());
+                    threadArenas().push_back(&m_arena);
+                }
+                
+                ~ThreadArena()
+                {
+                    std::lock_guard<std::mutex> lock(threadArenasMutex());
+                    auto& arenas = threadArenas();
+                    arenas.erase(std::remove(arenas.begin(), arenas.end(), &m_arena), arenas.end());
+                }
+                
+                ArenaAllocator m_arena;
+            };
+        }
+        
+        ArenaAllocator& getThreadArena()
+        {
+            static thread_local ThreadArena threadArena;
+            return threadArena.m_arena;
+        }
+        
+        void resetThreadArenas()
+        {
+            std::lock_guard<std::mutex> lock(threadArenasMutex());
+            for (ArenaAllocator* arena : threadArenas())
+            {
+                arena->reset();
+            }
+        }
+        
+    } // namespace simulation
+    
+} // namespace sofa
@@ -0,0 +1,183 @@
+/******************************************************************************
+*                 SOFA, Simulation Open-Framework Architecture                *
+*                    (c) 2006 INRIA, USTL, UJF, CNRS, MGH                     *
+*                                                                             *
+* This program is free software; you can redistribute it and/or modify it     *
+* under the terms of the GNU Lesser General Public License as published by    *
+* the Free Software Foundation; either version 2.1 of the License, or (at     *
+* your option) any later version.                                             *
+*                                                                             *
+* This program is distributed in the hope that it will be useful, but WITHOUT *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License *
+* for more details.                                                           *
+*                                                                             *
+* You should have received a copy of the GNU Lesser General Public License    *
+* along with this program. If not, see <http://www.gnu.org/licenses/>.        *
+*******************************************************************************
+* Authors: The SOFA Team and external contributors (see Authors.txt)          *
+*                                                                             *
+* Contact information: contact@sofa-framework.org                             *
+******************************************************************************/
+#ifndef MultiThreadingArenaAllocator_h__
+#define MultiThreadingArenaAllocator_h__
+
+#include <sofa/simulation/config.h>
+
+#include <cstddef>
+#include <new>
+#include <utility>
+#include <vector>
+
+namespace sofa
+{
+
+	namespace simulation
+	{
+
+        
+        /** Bump allocator: memory is taken sequentially from large blocks and never freed individually.
+         *  reset() releases everything at once and keeps the blocks for the next use,
+         *  so that a steady workload does not call malloc anymore.
+         *  Destructors of the objects created in the arena are not called.
+         *  Not thread-safe: each thread uses its own arena (see getThreadArena()).
+         */
+        class SOFA_SIMULATION_CORE_API ArenaAllocator
+        {
+        public:
+            
+            /// position in the arena, to release the memory allocated after it
+            struct Marker
+            {
+                std::size_t block;
+                std::size_t offset;
+                std::size_t epoch; ///< number of resets of the arena when the marker was taken
+            };
+            
+            explicit ArenaAllocator(std::size_t blockSize = 64 * 1024);
+            
+            ~ArenaAllocator();
+            
+            ArenaAllocator(const ArenaAllocator&) = delete;
+            ArenaAllocator& operator=(const ArenaAllocator&) = delete;
+            
+            void* allocate(std::size_t size, std::size_t alignment = alignof(std::max_align_t));
+            
+            /// allocate a first block of at least size bytes if the arena is empty, and write to it
+            /// so that its pages are placed now on the NUMA node of the calling thread (first touch)
+            void reserve(std::size_t size);
+            
+            /// release all the allocations; the blocks used since the last reset are merged into a single one
+            void reset();
+            
+            Marker getMarker() const { return { m_current, m_offset, m_epoch }; }
+            
+            /// release the allocations made after the marker was taken;
+            /// the arena must not have been reset since (asserted, and ignored without the assertions)
+            void rewind(const Marker& marker);
+            
+            /// memory currently allocated in the arena
+            std::size_t getUsedSize() const;
+            
+            /// memory reserved by the arena
+            std::size_t getCapacity() const;
+            
+            std::size_t getNbBlocks() const { return m_blocks.size(); }
+            
+        private:
+            
+            struct Block
+            {
+                char* data;
+                std::size_t size;
+            };
+            
+            void addBlock(std::size_t size);
+            
+            void releaseBlocks();
+            
+            std::vector<Block> m_blocks;
+            std::size_t m_current;
+            std::size_t m_offset;
+            std::size_t m_epoch;
+            const std::size_t m_blockSize;
+        };
+        
+        
+        /// Arena of the calling thread, valid until the end of the current time step.
+        /// It is reset by Simulation::animate() after the AnimateEndEvent, when no task is running.
+        SOFA_SIMULATION_CORE_API ArenaAllocator& getThreadArena();
+        
+        /// Reset the arenas of all threads. Must not be called while tasks are running.
+        SOFA_SIMULATION_CORE_API void resetThreadArenas();
+        
+        /// Create an object in the arena of the calling thread. Its destructor is never called.
+        template<class T, class... Args>
+        T* newInThreadArena(Args&&... args)
+        {
+            void* ptr = getThreadArena().allocate(sizeof(T), alignof(T));
+            return ::new (ptr) T(std::forward<Args>(args)...);
+        }
+        
+        
+        /// Release the allocations made in the arena of the calling thread during the lifetime of the scope.
+        /// Used by functions creating temporaries which may be called outside of the time steps.
+        /// The scope must not contain a reset of the arena, e.g. the end of a time step (see rewind()).
+        class ArenaScope
+        {
+        public:
+            ArenaScope()
+            : m_arena(getThreadArena())
+            , m_marker(m_arena.getMarker())
+            {}
+            
+            /// Scope in an arena owned by the caller, e.g. for a thread running outside of the time steps
+            explicit ArenaScope(ArenaAllocator& arena)
+            : m_arena(arena)
+            , m_marker(m_arena.getMarker())
+            {}
+            
+            ~ArenaScope() { m_arena.rewind(m_marker); }
+            
+            ArenaScope(const ArenaScope&) = delete;
+            ArenaScope& operator=(const ArenaScope&) = delete;
+            
+        private:
+            ArenaAllocator& m_arena;
+            const ArenaAllocator::Marker m_marker;
+        };
+        
+        
+        /// STL allocator taking its memory in the arena of the calling thread,
+        /// e.g. std::vector<T, ArenaStlAllocator<T> > for the temporaries of a time step.
+        template<class T>
+        class ArenaStlAllocator
+        {
+        public:
+            typedef T value_type;
+            
+            ArenaStlAllocator() = default;
+            
+            template<class U>
+            ArenaStlAllocator(const ArenaStlAllocator<U>&) {}
+            
+            T* allocate(std::size_t n)
+            {
+                return static_cast<T*>(getThreadArena().allocate(n * sizeof(T), alignof(T)));
+            }
+            
+            void deallocate(T*, std::size_t) {}
+            
+            template<class U>
+            bool operator==(const ArenaStlAllocator<U>&) const { return true; }
+            
+            template<class U>
+            bool operator!=(const ArenaStlAllocator<U>&) const { return false; }
+        };
+        
+	} // namespace simulation
+
+} // namespace sofa
+
+
+#endif // MultiThreadingArenaAllocator_h__
@@ -114,8 +114,7 @@ void DefaultAnimationLoop::step(const core::ExecParams* params, SReal dt)
 
 
     sofa::helper::AdvancedTimer::stepBegin("AnimateVisitor");
-    AnimateVisitor act(params, dt);
-    gnode->execute ( act );
+    animate(params, dt);
     sofa::helper::AdvancedTimer::stepEnd("AnimateVisitor");
 
 
@@ -153,6 +152,12 @@ void DefaultAnimationLoop::step(const core::ExecParams* params, SReal dt)
 
 }
 
+void DefaultAnimationLoop::animate(const core::ExecParams* params, SReal dt)
+{
+    AnimateVisitor act(params, dt);
+    gnode->execute ( act );
+}
+
 
 } // namespace simulation
 
@@ -81,6 +81,9 @@ public:
 
 protected :
 
+    /// integration of the step, by the AnimateVisitor
+    virtual void animate(const sofa::core::ExecParams* params, SReal dt);
+
     simulation::Node* gnode;  ///< the node controlled by the loop
 
 };
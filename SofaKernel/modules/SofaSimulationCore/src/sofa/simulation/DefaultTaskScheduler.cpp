@@ -1,4 +1,6 @@
 #include <sofa/simulation/DefaultTaskScheduler.h>
+#include <sofa/simulation/ArenaAllocator.h>
+#include <sofa/helper/Tracer.h>
 
 #include <sofa/helper/system/thread/thread_specific_ptr.h>
 
@@ -56,7 +58,9 @@ namespace sofa
             
             // init global static thread local var
             workerThreadIndex = new WorkerThread(this, 0, "Main  ");
+            helper::Tracer::setThreadName(workerThreadIndex->getName());
             _threads[std::this_thread::get_id()] = workerThreadIndex;// new WorkerThread(this, 0, "Main  ");
+            m_workerThreads.push_back(workerThreadIndex);
             
         }
         
@@ -90,11 +94,22 @@ namespace sofa
             return &defaultTaskAllocator;
         }
         
+        void DefaultTaskScheduler::setThreadAffinity(const ThreadAffinity& affinity)
+        {
+            m_affinity = affinity;
+        }
+        
+        ThreadAffinity DefaultTaskScheduler::getEffectiveAffinity() const
+        {
+            return ThreadAffinity::hasProcessAffinity() ? ThreadAffinity::getProcessAffinity() : m_affinity;
+        }
+        
         void DefaultTaskScheduler::init(const unsigned int NbThread )
         {
             if ( m_isInitialized )
             {
-                if ( (NbThread == m_threadCount) || (NbThread==0 && m_threadCount==GetHardwareThreadsCount()) )
+                const bool sameThreadCount = (NbThread == m_threadCount) || (NbThread==0 && m_threadCount==GetHardwareThreadsCount());
+                if ( sameThreadCount && getEffectiveAffinity() == m_appliedAffinity )
                 {
                     return;
                 }
@@ -120,12 +135,25 @@ namespace sofa
                 m_threadCount = NbThread;
             }
             
+            m_workerThreads.reserve(m_threadCount);
+            
+            // the workers restrict themselves to their cpus when they start (see WorkerThread::run)
+            m_appliedAffinity = getEffectiveAffinity();
+            m_cpus.clear();
+            if (m_appliedAffinity.isEnabled())
+            {
+                m_mainThreadCpus = ThreadAffinity::getCurrentThreadCpus();
+                m_cpus = m_appliedAffinity.getCpus();
+                m_appliedAffinity.applyToCurrentThread(m_cpus, 0);
+            }
+            
             /* start worker threads */
             for( unsigned int i=1; i<m_threadCount; ++i)
             {
                 WorkerThread* thread = new WorkerThread(this, int(i));
                 thread->create_and_attach(this);
                 _threads[thread->getId()] = thread;
+                m_workerThreads.push_back(thread);
                 thread->start(this);
             }
             
@@ -171,10 +199,19 @@ namespace sofa
                 m_threadCount = 1;
                 m_workerThreadCount = 1;
                 
+                if (m_appliedAffinity.isEnabled())
+                {
+                    ThreadAffinity::setCurrentThreadCpus(m_mainThreadCpus);
+                }
+                m_appliedAffinity = ThreadAffinity();
+                m_cpus.clear();
+                
                 auto mainThreadIt = _threads.find(std::this_thread::get_id());
                 WorkerThread* mainThread = mainThreadIt->second;
                 _threads.clear();
                 _threads[std::this_thread::get_id()] = mainThread;
+                m_workerThreads.clear();
+                m_workerThreads.push_back(mainThread);
             }
             
             return;
@@ -229,7 +266,10 @@ namespace sofa
         WorkerThread::WorkerThread(DefaultTaskScheduler* const& pScheduler, const int index, const std::string& name)
         : m_name(name + std::to_string(index))
         , m_type(0)
-        , m_tasks()
+        , m_index(index)
+        , m_tasks(Initial_TasksPerThread)
+        , m_randomState(2654435769u * std::uint32_t(index + 1))
+        , m_traceIdle(false)
         , m_taskScheduler(pScheduler)
         {
             assert(pScheduler);
@@ -268,6 +308,17 @@ namespace sofa
             return &m_stdThread;
         }
         
+        void* WorkerThread::allocate(std::size_t size)
+        {
+            // the arena of the calling thread: this worker when called from its own thread
+            return getThreadArena().allocate(size);
+        }
+        
+        void WorkerThread::free(void* ptr)
+        {
+            SOFA_UNUSED(ptr);
+        }
+        
         WorkerThread* WorkerThread::getCurrent()
         {
             //return workerThreadIndex;
@@ -285,22 +336,38 @@ namespace sofa
             //workerThreadIndex = this;
             //TaskSchedulerDefault::_threads[std::this_thread::get_id()] = this;
             
+            helper::Tracer::setThreadName(m_name);
+            
+            if (m_taskScheduler->m_appliedAffinity.applyToCurrentThread(m_taskScheduler->m_cpus, unsigned(m_index)))
+            {
+                // first touch once placed: the pages of the arena are allocated on the NUMA node of this thread
+                getThreadArena().reserve(DefaultTaskScheduler::ARENA_FIRST_TOUCH_SIZE);
+            }
+            
             // main loop
             while ( !m_taskScheduler->isClosing() )
             {
                 Idle();
                 
+                unsigned spinCount = 1;
                 while ( m_taskScheduler->m_mainTaskStatus != nullptr)
                 {
                     
-                    doWork(nullptr);
-                    
+                    if (doWork(nullptr))
+                    {
+                        spinCount = 1;
+                    }
+                    else
+                    {
+                        backOff(spinCount);
+                    }
                     
                     if (m_taskScheduler->isClosing() )
                     {
                         break;
                     }
                 }
+                traceIdleEnd();
             }
             
             m_finished.store(true, std::memory_order_relaxed);
@@ -321,13 +388,17 @@ namespace sofa
                 //	return;
                 //}
                 // cpu free wait
+                const bool trace = helper::Tracer::isEnabled();
+                if (trace) helper::Tracer::begin("Sleep");
                 m_taskScheduler->m_wakeUpEvent.wait(lock, [&] {return !m_taskScheduler->m_workerThreadsIdle; });
+                if (trace) helper::Tracer::end();
             }
             return;
         }
         
-        void WorkerThread::doWork(Task::Status* status)
+        bool WorkerThread::doWork(Task::Status* status)
         {
+            bool hasWorked = false;
             
             for (;;)// do
             {
@@ -337,25 +408,71 @@ namespace sofa
                 {
                     // run task in the queue
                     runTask(task);
-                    
+                    hasWorked = true;
                     
                     if (status && !status->isBusy())
-                        return;
+                        return hasWorked;
                 }
                 
                 // check if main work is finished 
                 if (m_taskScheduler->m_mainTaskStatus == nullptr)
-                    return;
+                    return hasWorked;
                 
                 if (!stealTask(&task))
-                    return;
+                    return hasWorked;
                 
                 // run the stolen task
                 runTask(task);
+                hasWorked = true;
                 
             } //;;while (stealTasks());	
-
+        }
+        
+        void WorkerThread::backOff(unsigned& spinCount)
+        {
+            traceIdleBegin();
             
+            if (spinCount <= Max_SpinCount)
+            {
+                for (unsigned i = 0; i < spinCount; ++i)
+                {
+                    cpuRelax();
+                }
+                spinCount <<= 1;
+            }
+            else
+            {
+                // still nothing to do: give the core away
+                std::this_thread::yield();
+            }
+        }
+        
+        std::uint32_t WorkerThread::random()
+        {
+            std::uint32_t x = m_randomState;
+            x ^= x << 13;
+            x ^= x >> 17;
+            x ^= x << 5;
+            m_randomState = x;
+            return x;
+        }
+        
+        void WorkerThread::traceIdleBegin()
+        {
+            if (!m_traceIdle && helper::Tracer::isEnabled())
+            {
+                helper::Tracer::begin("Idle");
+                m_traceIdle = true;
+            }
+        }
+        
+        void WorkerThread::traceIdleEnd()
+        {
+            if (m_traceIdle)
+            {
+                helper::Tracer::end();
+                m_traceIdle = false;
+            }
         }
         
         void WorkerThread::runTask(Task* task)
@@ -363,6 +480,10 @@ namespace sofa
             Task::Status* prevStatus = m_currentStatus;
             m_currentStatus = task->getStatus();
             
+            traceIdleEnd();
+            const bool trace = helper::Tracer::isEnabled();
+            if (trace) helper::Tracer::begin(typeid(*task));
+            
             {
                 if (task->run() & Task::MemoryAlloc::Dynamic)
                 {
@@ -373,16 +494,27 @@ namespace sofa
                 }
             }
             
+            if (trace) helper::Tracer::end();
+            
             m_currentStatus->setBusy(false);
             m_currentStatus = prevStatus;
         }
         
         void WorkerThread::workUntilDone(Task::Status* status)
         {
+            unsigned spinCount = 1;
             while (status->isBusy())
             {
-                doWork(status);
+                if (doWork(status))
+                {
+                    spinCount = 1;
+                }
+                else if (status->isBusy())
+                {
+                    backOff(spinCount);
+                }
             }
+            traceIdleEnd();
             
             if (m_taskScheduler->m_mainTaskStatus == status)
             {
@@ -395,11 +527,8 @@ namespace sofa
         {
             TASK_SCHEDULER_PROFILER(Pop);
             
-            simulation::ScopedLock lock( m_taskMutex );
-            if (!m_tasks.empty() )
+            if (m_tasks.pop(*task))
             {
-                *task = m_tasks.back();
-                m_tasks.pop_back();
                 return true;
             }
             *task = nullptr;
@@ -418,10 +547,9 @@ namespace sofa
             {
                 TASK_SCHEDULER_PROFILER(Push);
                 
-                simulation::ScopedLock lock(m_taskMutex);
                 int taskId = task->getStatus()->setBusy(true);
                 task->m_id = taskId;
-                m_tasks.push_back(task);
+                m_tasks.push(task);
             }
             
             
@@ -452,24 +580,31 @@ namespace sofa
             {
                 //TASK_SCHEDULER_PROFILER(StealTask);
                 
-                for (auto it : m_taskScheduler->_threads)
+                const std::vector<WorkerThread*>& workerThreads = m_taskScheduler->m_workerThreads;
+                const std::size_t nbThreads = workerThreads.size();
+                if (nbThreads < 2)
                 {
-                    // if this is the main thread continue
-                    if (std::this_thread::get_id() == it.first)
+                    return false;
+                }
+                
+                // start from a random victim so that thieves do not all hit the same queue
+                const std::size_t first = random() % nbThreads;
+                for (std::size_t i = 0; i < nbThreads; ++i)
+                {
+                    WorkerThread* otherThread = workerThreads[(first + i) % nbThreads];
+                    
+                    // skip the current thread
+                    if (otherThread == this)
                     {
                         continue;
                     }
                     
-                    WorkerThread* otherThread = it.second;
-                    
                     {
                         TASK_SCHEDULER_PROFILER(Steal);
                         
-                        simulation::ScopedLock lock(otherThread->m_taskMutex);
-                        if (!otherThread->m_tasks.empty())
+                        if (otherThread->m_tasks.steal(*task))
                         {
-                            *task = otherThread->m_tasks.front();
-                            otherThread->m_tasks.pop_front();
+                            if (helper::Tracer::isEnabled()) helper::Tracer::instant("Steal");
                             return true;
                         }
                     }
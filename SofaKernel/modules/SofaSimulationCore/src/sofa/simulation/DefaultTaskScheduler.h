@@ -33,13 +33,14 @@
 #include <condition_variable>
 #include <memory>
 #include <map>
-#include <deque>
+#include <vector>
 #include <string> 
 #include <mutex>
 
 
 // workerthread
 #include <sofa/simulation/Locks.h>
+#include <sofa/simulation/WorkStealingDeque.h>
 
 
 namespace sofa  {
@@ -91,14 +92,16 @@ namespace sofa  {
             
             const std::thread::id getId();
             
-            const std::deque<Task*>* getTasksQueue() { return &m_tasks; }
+            const WorkStealingDeque<Task*>* getTasksQueue() { return &m_tasks; }
             
-            std::uint64_t getTaskCount() { return m_tasks.size(); }
+            std::uint64_t getTaskCount() { return std::uint64_t(m_tasks.size()); }
             
-            int GetWorkerIndex();
+            int GetWorkerIndex() const { return m_index; }
             
-            void* allocate();
+            // per-step memory of this thread, released at the end of the time step (see ArenaAllocator.h)
+            void* allocate(std::size_t size);
             
+            // nothing to do: the memory is released when the arena is reset
             void free(void* ptr);
             
             
@@ -116,10 +119,21 @@ namespace sofa  {
             // pop task from queue
             bool popTask(Task** ppTask);
             
-            // steal and queue some task from another thread
+            // steal a task from a randomly chosen thread
             bool stealTask(Task** task);
             
-            void doWork(Task::Status* status);
+            // return false if no task has been run
+            bool doWork(Task::Status* status);
+            
+            // exponential back-off when there is nothing to steal
+            void backOff(unsigned& spinCount);
+            
+            // the time spent looking for a task is traced as Idle (see helper::Tracer)
+            void traceIdleBegin();
+            void traceIdleEnd();
+            
+            // xorshift random number used for the victim selection
+            std::uint32_t random();
             
             // boost thread main loop
             void run(void);
@@ -133,16 +147,23 @@ namespace sofa  {
             
             enum
             {
-                Max_TasksPerThread = 256
+                Initial_TasksPerThread = 256,
+                Max_SpinCount = 1 << 10
             };
             
             const std::string m_name;
             
             const int m_type;
             
-            simulation::SpinLock m_taskMutex;
+            // index of the thread in the scheduler, 0 for the main thread
+            const int m_index;
+            
+            // lock-free: owner pushes and pops at the bottom, other threads steal at the top
+            WorkStealingDeque<Task*> m_tasks;
+            
+            std::uint32_t m_randomState;
             
-            std::deque<Task*> m_tasks;
+            bool m_traceIdle;
             
             std::thread  m_stdThread;
             
@@ -164,6 +185,7 @@ namespace sofa  {
             {
                 MAX_THREADS = 16,
                 STACKSIZE = 64 * 1024 /* 64K */,
+                ARENA_FIRST_TOUCH_SIZE = 1024 * 1024 /* 1M */,
             };
             
         public:
@@ -180,6 +202,7 @@ namespace sofa  {
             bool addTask(Task* task) override final;
             void workUntilDone(Task::Status* status) override final;
             Task::Allocator* getTaskAllocator() override final;
+            void setThreadAffinity(const ThreadAffinity& affinity) override final;
             
         public:
             
@@ -206,6 +229,9 @@ namespace sofa  {
             
             const WorkerThread* getWorkerThread(const std::thread::id id);
             
+            // the process affinity if any, the one set on the scheduler otherwise
+            ThreadAffinity getEffectiveAffinity() const;
+            
             
         private:
             
@@ -215,6 +241,9 @@ namespace sofa  {
             //static thread_local WorkerThread* _workerThreadIndex;
             static std::map< std::thread::id, WorkerThread*> _threads;
             
+            // same threads as _threads, indexed for the random victim selection
+            std::vector<WorkerThread*> m_workerThreads;
+            
             const Task::Status*	m_mainTaskStatus;
             
             std::mutex  m_wakeUpMutex;
@@ -241,6 +270,14 @@ namespace sofa  {
             
             unsigned m_threadCount;
             
+            // affinity requested by setThreadAffinity() and affinity of the running threads
+            ThreadAffinity m_affinity;
+            ThreadAffinity m_appliedAffinity;
+            
+            // cpus of the running threads, and cpus of the main thread before it was restricted
+            std::vector<int> m_cpus;
+            std::vector<int> m_mainThreadCpus;
+            
             
             friend class WorkerThread;
         };
@@ -25,12 +25,25 @@
 #include <thread>
 #include <atomic>
 
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#include <immintrin.h>
+#define SOFA_SIMULATION_CPU_PAUSE() _mm_pause()
+#else
+#define SOFA_SIMULATION_CPU_PAUSE() std::this_thread::yield()
+#endif
+
 namespace sofa
 {
 
 	namespace simulation
 	{
 
+        // hint the cpu that we are in a spin-wait loop
+        inline void cpuRelax()
+        {
+            SOFA_SIMULATION_CPU_PAUSE();
+        }
+        
 
         class SpinLock
         {
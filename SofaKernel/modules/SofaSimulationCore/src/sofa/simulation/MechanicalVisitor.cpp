@@ -312,7 +312,11 @@ void BaseMechanicalVisitor::processNodeBottomUp(simulation::Node* node, LocalSto
     processNodeBottomUp(node, &ctx);
 
     if (writeData && parentData != ctx.nodeData)
+    {
         addNodeData(node, parentData, ctx.nodeData);
+        // release the temporary accumulation buffer created in processNodeTopDown
+        delete ctx.nodeData;
+    }
 }
 
 
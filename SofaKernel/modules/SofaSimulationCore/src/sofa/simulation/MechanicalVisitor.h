@@ -861,9 +861,10 @@ public:
     virtual std::string getInfos() const override;
 
     /// Specify whether this action can be parallelized.
+    /// The norm is accumulated in a single member, not in the node-specific data.
     bool isThreadSafe() const override
     {
-        return true;
+        return false;
     }
     bool writeNodeData() const override
     {
@@ -117,6 +117,7 @@ Node::Node(const std::string& name)
 
     , debug_(false)
     , initialized(false)
+    , m_visitorScheduler(nullptr)
 {
     _context = this;
     setName(name);
@@ -718,6 +719,21 @@ core::visual::VisualLoop* Node::getVisualLoop() const
         return get<core::visual::VisualLoop>(SearchParents);
 }
 
+void Node::setVisitorScheduler(VisitorScheduler* scheduler)
+{
+    m_visitorScheduler = scheduler;
+}
+
+VisitorScheduler* Node::getVisitorScheduler() const
+{
+    for (const Node* node = this; node != nullptr; node = static_cast<const Node*>(node->getFirstParent()))
+    {
+        if (node->m_visitorScheduler)
+            return node->m_visitorScheduler;
+    }
+    return nullptr;
+}
+
 /// Find a child node given its name
 Node* Node::getChild(const std::string& name) const
 {
@@ -894,7 +910,12 @@ void Node::executeVisitor(Visitor* action, bool precomputedOrder)
         ++level;
     }
 
-    doExecuteVisitor(action, precomputedOrder);
+    // a precomputed traversal order is always executed sequentially
+    VisitorScheduler* scheduler = precomputedOrder ? nullptr : getVisitorScheduler();
+    if (scheduler)
+        scheduler->executeVisitor(this, action);
+    else
+        doExecuteVisitor(action, precomputedOrder);
 
     if(DEBUG_VISITOR)
     {
@@ -427,6 +427,11 @@ public:
     sofa::core::collision::Pipeline* getCollisionPipeline() const override;
     sofa::core::visual::VisualLoop* getVisualLoop() const override;
 
+    /// Set the VisitorScheduler executing the visitors started from this node and its descendants
+    void setVisitorScheduler(VisitorScheduler* scheduler);
+    /// VisitorScheduler of this node or of its closest ancestor having one (nullptr if none)
+    VisitorScheduler* getVisitorScheduler() const;
+
     /// @}
 
     /// Remove odesolvers and mastercontroler
@@ -500,6 +505,8 @@ protected:
     virtual void doMoveObject(sofa::core::objectmodel::BaseObject::SPtr sobj, Node* prev_parent);
 
     std::stack<Visitor*> actionStack;
+
+    VisitorScheduler* m_visitorScheduler;
 private:    
     virtual void notifyBeginAddChild(Node::SPtr parent, Node::SPtr child) const;
     virtual void notifyBeginRemoveChild(Node::SPtr parent, Node::SPtr child) const;
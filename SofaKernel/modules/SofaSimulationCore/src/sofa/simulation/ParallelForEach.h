@@ -0,0 +1,277 @@
+/******************************************************************************
+*                 SOFA, Simulation Open-Framework Architecture                *
+*                    (c) 2006 INRIA, USTL, UJF, CNRS, MGH                     *
+*                                                                             *
+* This program is free software; you can redistribute it and/or modify it     *
+* under the terms of the GNU Lesser General Public License as published by    *
+* the Free Software Foundation; either version 2.1 of the License, or (at     *
+* your option) any later version.                                             *
+*                                                                             *
+* This program is distributed in the hope that it will be useful, but WITHOUT *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License *
+* for more details.                                                           *
+*                                                                             *
+* You should have received a copy of the GNU Lesser General Public License    *
+* along with this program. If not, see <http://www.gnu.org/licenses/>.        *
+*******************************************************************************
+* Authors: The SOFA Team and external contributors (see Authors.txt)          *
+*                                                                             *
+* Contact information: contact@sofa-framework.org                             *
+******************************************************************************/
+#ifndef MultiThreadingParallelForEach_h__
+#define MultiThreadingParallelForEach_h__
+
+#include <sofa/simulation/TaskScheduler.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <type_traits>
+
+
+namespace sofa
+{
+
+	namespace simulation
+	{
+        
+        
+        /** Half-open range [start, end) of indices or random access iterators
+         *  split recursively by parallelForEach and parallelReduce
+         */
+        template<class T>
+        class Range
+        {
+        public:
+            
+            typedef T value_type;
+            
+            Range(T start, T end) : m_start(start), m_end(end) {}
+            
+            T start() const { return m_start; }
+            T end() const { return m_end; }
+            
+            std::size_t size() const { return m_end > m_start ? std::size_t(m_end - m_start) : 0; }
+            bool empty() const { return size() == 0; }
+            
+            // split the range in two halves
+            T middle() const { return m_start + (m_end - m_start) / 2; }
+            
+        private:
+            
+            T m_start;
+            T m_end;
+        };
+        
+        
+        /// number of elements processed sequentially by a single task when the grain size is not given (0)
+        /// it yields about 8 tasks per thread
+        inline std::size_t computeGrainSize(TaskScheduler& scheduler, std::size_t rangeSize, std::size_t grainSize)
+        {
+            if (grainSize > 0)
+            {
+                return grainSize;
+            }
+            const std::size_t nbThreads = std::max<std::size_t>(1, scheduler.getThreadCount());
+            return std::max<std::size_t>(1, rangeSize / (8 * nbThreads));
+        }
+        
+        
+        namespace detail
+        {
+            
+            template<class T, class Function>
+            void forEachRange(TaskScheduler& scheduler, const Range<T>& range, std::size_t grainSize, const Function& function);
+            
+            template<class T, class Value, class Function, class Reduction>
+            Value reduceRange(TaskScheduler& scheduler, const Range<T>& range, std::size_t grainSize, const Value& identity, const Function& function, const Reduction& reduction);
+            
+            
+            template<class T, class Function>
+            class ForEachRangeTask : public CpuTask
+            {
+            public:
+                
+                ForEachRangeTask(TaskScheduler& scheduler, const Range<T>& range, std::size_t grainSize, const Function& function, CpuTask::Status* status)
+                : CpuTask(status)
+                , m_scheduler(scheduler)
+                , m_range(range)
+                , m_grainSize(grainSize)
+                , m_function(function)
+                {}
+                
+                ~ForEachRangeTask() override {}
+                
+                MemoryAlloc run() final
+                {
+                    forEachRange(m_scheduler, m_range, m_grainSize, m_function);
+                    return MemoryAlloc::Stack;
+                }
+                
+            private:
+                
+                TaskScheduler& m_scheduler;
+                const Range<T> m_range;
+                const std::size_t m_grainSize;
+                const Function& m_function;
+            };
+            
+            
+            template<class T, class Value, class Function, class Reduction>
+            class ReduceRangeTask : public CpuTask
+            {
+            public:
+                
+                ReduceRangeTask(TaskScheduler& scheduler, const Range<T>& range, std::size_t grainSize, const Value& identity, const Function& function, const Reduction& reduction, Value* result, CpuTask::Status* status)
+                : CpuTask(status)
+                , m_scheduler(scheduler)
+                , m_range(range)
+                , m_grainSize(grainSize)
+                , m_identity(identity)
+                , m_function(function)
+                , m_reduction(reduction)
+                , m_result(result)
+                {}
+                
+                ~ReduceRangeTask() override {}
+                
+                MemoryAlloc run() final
+                {
+                    *m_result = reduceRange(m_scheduler, m_range, m_grainSize, m_identity, m_function, m_reduction);
+                    return MemoryAlloc::Stack;
+                }
+                
+            private:
+                
+                TaskScheduler& m_scheduler;
+                const Range<T> m_range;
+                const std::size_t m_grainSize;
+                const Value& m_identity;
+                const Function& m_function;
+                const Reduction& m_reduction;
+                Value* m_result;
+            };
+            
+            
+            // the second half of the range is queued (and may be stolen), the first half is processed by the current thread
+            template<class T, class Function>
+            void forEachRange(TaskScheduler& scheduler, const Range<T>& range, std::size_t grainSize, const Function& function)
+            {
+                if (range.size() <= grainSize)
+                {
+                    function(range);
+                    return;
+                }
+                
+                const T middle = range.middle();
+                
+                CpuTask::Status status;
+                ForEachRangeTask<T, Function> task(scheduler, Range<T>(middle, range.end()), grainSize, function, &status);
+                scheduler.addTask(&task);
+                
+                forEachRange(scheduler, Range<T>(range.start(), middle), grainSize, function);
+                
+                scheduler.workUntilDone(&status);
+            }
+            
+            // partial results are combined following the splitting tree: the result does not depend on the thread count
+            template<class T, class Value, class Function, class Reduction>
+            Value reduceRange(TaskScheduler& scheduler, const Range<T>& range, std::size_t grainSize, const Value& identity, const Function& function, const Reduction& reduction)
+            {
+                if (range.size() <= grainSize)
+                {
+                    return function(range, identity);
+                }
+                
+                const T middle = range.middle();
+                
+                CpuTask::Status status;
+                Value secondHalf = identity;
+                ReduceRangeTask<T, Value, Function, Reduction> task(scheduler, Range<T>(middle, range.end()), grainSize, identity, function, reduction, &secondHalf, &status);
+                scheduler.addTask(&task);
+                
+                const Value firstHalf = reduceRange(scheduler, Range<T>(range.start(), middle), grainSize, identity, function, reduction);
+                
+                scheduler.workUntilDone(&status);
+                
+                return reduction(firstHalf, secondHalf);
+            }
+            
+        } // namespace detail
+        
+        
+        /** Call function(subRange) on sub-ranges of at most grainSize elements, in parallel.
+         *  A grain size of 0 lets the range be split according to the number of threads.
+         *  Example: parallelForEachRange(Range<std::size_t>(0, x.size()), 0, [&](const Range<std::size_t>& r)
+         *           { for (auto i = r.start(); i != r.end(); ++i) f[i] += k * x[i]; });
+         */
+        template<class T, class Function>
+        void parallelForEachRange(TaskScheduler& scheduler, const Range<T>& range, std::size_t grainSize, const Function& function)
+        {
+            if (range.empty())
+            {
+                return;
+            }
+            detail::forEachRange(scheduler, range, computeGrainSize(scheduler, range.size(), grainSize), function);
+        }
+        
+        template<class T, class Function>
+        void parallelForEachRange(const Range<T>& range, std::size_t grainSize, const Function& function)
+        {
+            parallelForEachRange(*TaskScheduler::getInstance(), range, grainSize, function);
+        }
+        
+        
+        /** Call function(i) for each element i of the range, in parallel.
+         *  Example: parallelForEach(Range<std::size_t>(0, x.size()), 0, [&](std::size_t i) { f[i] += k * x[i]; });
+         */
+        template<class T, class Function>
+        void parallelForEach(TaskScheduler& scheduler, const Range<T>& range, std::size_t grainSize, const Function& function)
+        {
+            parallelForEachRange(scheduler, range, grainSize, [&function](const Range<T>& subRange)
+            {
+                for (T it = subRange.start(); it != subRange.end(); ++it)
+                {
+                    function(it);
+                }
+            });
+        }
+        
+        template<class T, class Function>
+        void parallelForEach(const Range<T>& range, std::size_t grainSize, const Function& function)
+        {
+            parallelForEach(*TaskScheduler::getInstance(), range, grainSize, function);
+        }
+        
+        
+        /** Parallel reduction.
+         *  function(subRange, init) accumulates the sub-range into a copy of init and returns it,
+         *  reduction(a, b) combines two partial results. Both must be thread safe.
+         *  Each task works on its own partial result, there is no synchronization on the accumulator.
+         *  Example: parallelReduce(Range<std::size_t>(0, x.size()), 0, 0.0,
+         *               [&](const Range<std::size_t>& r, double sum) { for (auto i = r.start(); i != r.end(); ++i) sum += x[i] * x[i]; return sum; },
+         *               std::plus<double>());
+         */
+        template<class T, class Value, class Function, class Reduction>
+        Value parallelReduce(TaskScheduler& scheduler, const Range<T>& range, std::size_t grainSize, const Value& identity, const Function& function, const Reduction& reduction)
+        {
+            if (range.empty())
+            {
+                return identity;
+            }
+            return detail::reduceRange(scheduler, range, computeGrainSize(scheduler, range.size(), grainSize), identity, function, reduction);
+        }
+        
+        template<class T, class Value, class Function, class Reduction>
+        Value parallelReduce(const Range<T>& range, std::size_t grainSize, const Value& identity, const Function& function, const Reduction& reduction)
+        {
+            return parallelReduce(*TaskScheduler::getInstance(), range, grainSize, identity, function, reduction);
+        }
+
+	} // namespace simulation
+
+} // namespace sofa
+
+
+#endif // MultiThreadingParallelForEach_h__
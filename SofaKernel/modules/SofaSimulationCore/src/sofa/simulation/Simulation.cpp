@@ -47,6 +47,8 @@
 #include <sofa/simulation/DefaultAnimationLoop.h>
 #include <sofa/simulation/DefaultVisualManagerLoop.h>
 #include <sofa/simulation/Node.h>
+#include <sofa/simulation/ArenaAllocator.h>
+#include <sofa/helper/Tracer.h>
 #include <sofa/helper/system/SetDirectory.h>
 #include <sofa/helper/AdvancedTimer.h>
 #include <sofa/helper/init.h>
@@ -61,6 +63,7 @@
 #include <sofa/simulation/events/SimulationInitTexturesDoneEvent.h>
 
 
+#include <atomic>
 #include <fstream>
 #include <cstring>
 
@@ -220,6 +223,9 @@ void Simulation::initNode( Node* node)
     node->execute<StoreResetStateVisitor>(params);
 }
 
+/// number of Simulation::animate() calls in progress
+static std::atomic<int> s_nbRunningSteps(0);
+
 /// Execute one timestep. If do is 0, the dt parameter in the graph will be used
 void Simulation::animate ( Node* root, SReal dt )
 {
@@ -232,9 +238,17 @@ void Simulation::animate ( Node* root, SReal dt )
     sofa::core::ExecParams* params = sofa::core::execparams::defaultInstance();
 
     sofa::core::behavior::BaseAnimationLoop* aloop = root->getAnimationLoop();
+    bool isLastRunningStep = false;
     if(aloop)
     {
+        ++s_nbRunningSteps;
         aloop->step(params,dt);
+
+        // the temporaries of the step are released after the AnimateEndEvent,
+        // unless another scene is being animated in another thread
+        isLastRunningStep = (--s_nbRunningSteps == 0);
+        if (isLastRunningStep)
+            resetThreadArenas();
     }
     else
     {
@@ -243,6 +257,10 @@ void Simulation::animate ( Node* root, SReal dt )
     }
 
     sofa::helper::AdvancedTimer::stepEnd("Simulation::animate");
+
+    // no task is running anymore: the trace of the workers can be written
+    if (isLastRunningStep)
+        sofa::helper::Tracer::endStep();
 }
 
 void Simulation::updateVisual ( Node* root)
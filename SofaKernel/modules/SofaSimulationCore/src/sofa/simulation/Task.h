@@ -69,6 +69,7 @@ namespace sofa
                 Stack     = 1 << 0,
                 Dynamic   = 1 << 1,
                 Static    = 1 << 2,
+                Arena     = 1 << 3, // allocated in an ArenaAllocator: neither destroyed nor freed by the scheduler
             };
             
             
@@ -26,6 +26,7 @@
 
 #include <sofa/simulation/Task.h>
 #include <sofa/simulation/Locks.h>
+#include <sofa/simulation/ThreadAffinity.h>
 
 #include <thread>
 #include <mutex>
@@ -78,6 +79,9 @@ namespace sofa
             
             virtual Task::Allocator* getTaskAllocator() = 0;
             
+            // placement of the threads, applied by the next init(). Ignored by the schedulers without thread placement.
+            virtual void setThreadAffinity(const ThreadAffinity& affinity) { SOFA_UNUSED(affinity); }
+            
             
         protected:
             
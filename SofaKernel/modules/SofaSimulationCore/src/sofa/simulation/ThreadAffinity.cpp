@@ -0,0 +1,309 @@
+/******************************************************************************
+*                 SOFA, Simulation Open-Framework Architecture                *
+*                    (c) 2006 INRIA, USTL, UJF, CNRS, MGH                     *
+*                                                                             *
+* This program is free software; you can redistribute it and/or modify it     *
+* under the terms of the GNU Lesser General Public License as published by    *
+* the Free Software Foundation; either version 2.1 of the License, or (at     *
+* your option) any later version.                                             *
+*                                                                             *
+* This program is distributed in the hope that it will be useful, but WITHOUT *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License *
+* for more details.                                                           *
+*                                                                             *
+* You should have received a copy of the GNU Lesser General Public License    *
+* along with this program. If not, see <http://www.gnu.org/licenses/>.        *
+*******************************************************************************
+* Authors: The SOFA Team and external contributors (see Authors.txt)          *
+*                                                                             *
+* Contact information: contact@sofa-framework.org                             *
+******************************************************************************/
+#include <sofa/simulation/ThreadAffinity.h>
+
+#include <sofa/core/objectmodel/Base.h>
+#include <sofa/helper/logging/Messaging.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <fstream>
+#include <set>
+#include <sstream>
+#include <utility>
+
+#if defined(__linux__)
+#include <pthread.h>
+#endif
+
+
+namespace sofa
+{
+    namespace simulation
+    {
+        
+        namespace
+        {
+            
+#if defined(__linux__)
+            
+            // parse a sysfs cpu list, e.g. "0-7,16-23"
+            std::vector<int> readCpuList(const std::string& fileName)
+            {
+                std::vector<int> cpus;
+                std::ifstream file(fileName);
+                std::string list;
+                if (!std::getline(file, list))
+                {
+                    return cpus;
+                }
+                
+                std::istringstream ranges(list);
+                std::string range;
+                while (std::getline(ranges, range, ','))
+                {
+                    if (range.empty())
+                    {
+                        continue;
+                    }
+                    const std::size_t dash = range.find('-');
+                    const int first = std::atoi(range.substr(0, dash).c_str());
+                    const int last = (dash == std::string::npos) ? first : std::atoi(range.substr(dash + 1).c_str());
+                    for (int cpu = first; cpu <= last; ++cpu)
+                    {
+                        cpus.push_back(cpu);
+                    }
+                }
+                return cpus;
+            }
+            
+            int readTopologyId(int cpu, const char* name)
+            {
+                std::ifstream file("/sys/devices/system/cpu/cpu" + std::to_string(cpu) + "/topology/" + name);
+                int id = -1;
+                file >> id;
+                return id;
+            }
+            
+#endif
+            
+            struct ProcessAffinity
+            {
+                ProcessAffinity()
+                {
+                    const char* env = std::getenv("SOFA_THREAD_AFFINITY");
+                    if (env == nullptr)
+                    {
+                        return;
+                    }
+                    
+                    isSet = affinity.read(env);
+                    if (!isSet)
+                    {
+                        msg_warning("ThreadAffinity") << "invalid SOFA_THREAD_AFFINITY value '" << env << "': ignored";
+                    }
+                }
+                
+                ThreadAffinity affinity;
+                bool isSet = false;
+            };
+            
+            ProcessAffinity& processAffinity()
+            {
+                static ProcessAffinity affinity;
+                return affinity;
+            }
+            
+        } // namespace
+        
+        
+        ThreadAffinity::ThreadAffinity(bool pinThreads, int numaNode)
+        : m_pinThreads(pinThreads)
+        , m_numaNode(numaNode)
+        {
+        }
+        
+        bool ThreadAffinity::read(const std::string& str)
+        {
+            bool pinThreads = false;
+            int numaNode = -1;
+            
+            std::istringstream tokens(str);
+            std::string token;
+            while (std::getline(tokens, token, ','))
+            {
+                token.erase(std::remove_if(token.begin(), token.end(), [](char c) { return std::isspace(static_cast<unsigned char>(c)); }), token.end());
+                
+                if (token.empty() || token == "none")
+                {
+                    continue;
+                }
+                if (token == "cores")
+                {
+                    pinThreads = true;
+                }
+                else if (token.compare(0, 5, "node:") == 0 && token.size() > 5
+                         && std::all_of(token.begin() + 5, token.end(), [](char c) { return std::isdigit(static_cast<unsigned char>(c)); }))
+                {
+                    numaNode = std::atoi(token.c_str() + 5);
+                }
+                else
+                {
+                    return false;
+                }
+            }
+            
+            m_pinThreads = pinThreads;
+            m_numaNode = numaNode;
+            return true;
+        }
+        
+        const char* const ThreadAffinity::DataHelp = "placement of the threads: none, cores (one thread per core), node:N (NUMA node N) or a combination as cores,node:N. Overridden by the SOFA_THREAD_AFFINITY environment variable";
+        
+        ThreadAffinity ThreadAffinity::readData(const core::objectmodel::Base* component, const std::string& str)
+        {
+            ThreadAffinity affinity;
+            if (!affinity.read(str))
+            {
+                msg_warning(component) << "invalid threadAffinity '" << str << "': the threads are not placed";
+            }
+            return affinity;
+        }
+        
+        std::string ThreadAffinity::toString() const
+        {
+            if (!isEnabled())
+            {
+                return "none";
+            }
+            
+            std::string str = m_pinThreads ? "cores" : "";
+            if (m_numaNode >= 0)
+            {
+                str += (str.empty() ? "node:" : ",node:") + std::to_string(m_numaNode);
+            }
+            return str;
+        }
+        
+        std::vector<int> ThreadAffinity::getCpus() const
+        {
+            std::vector<int> cpus;
+            
+#if defined(__linux__)
+            const std::vector<int> allowedCpus = getCurrentThreadCpus();
+            const std::set<int> allowed(allowedCpus.begin(), allowedCpus.end());
+            
+            std::vector<int> candidates;
+            if (m_numaNode >= 0)
+            {
+                candidates = readCpuList("/sys/devices/system/node/node" + std::to_string(m_numaNode) + "/cpulist");
+                if (candidates.empty())
+                {
+                    msg_warning("ThreadAffinity") << "NUMA node " << m_numaNode << " not found: the threads are not restricted to a node";
+                }
+            }
+            if (candidates.empty())
+            {
+                candidates = allowedCpus;
+            }
+            
+            // one cpu per physical core first, then the hyperthreads
+            std::set< std::pair<int, int> > cores;
+            std::vector<int> siblings;
+            for (int cpu : candidates)
+            {
+                if (allowed.count(cpu) == 0)
+                {
+                    continue;
+                }
+                
+                const std::pair<int, int> core(readTopologyId(cpu, "physical_package_id"), readTopologyId(cpu, "core_id"));
+                if (core.second < 0 || cores.insert(core).second)
+                {
+                    cpus.push_back(cpu);
+                }
+                else
+                {
+                    siblings.push_back(cpu);
+                }
+            }
+            cpus.insert(cpus.end(), siblings.begin(), siblings.end());
+#endif
+            
+            return cpus;
+        }
+        
+        bool ThreadAffinity::applyToCurrentThread(const std::vector<int>& cpus, unsigned int index) const
+        {
+            if (!isEnabled() || cpus.empty())
+            {
+                return false;
+            }
+            
+            if (m_pinThreads)
+            {
+                return setCurrentThreadCpus({ cpus[index % cpus.size()] });
+            }
+            return setCurrentThreadCpus(cpus);
+        }
+        
+        std::vector<int> ThreadAffinity::getCurrentThreadCpus()
+        {
+            std::vector<int> cpus;
+            
+#if defined(__linux__)
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            if (pthread_getaffinity_np(pthread_self(), sizeof(cpu_set_t), &set) == 0)
+            {
+                for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+                {
+                    if (CPU_ISSET(cpu, &set))
+                    {
+                        cpus.push_back(cpu);
+                    }
+                }
+            }
+#endif
+            
+            return cpus;
+        }
+        
+        bool ThreadAffinity::setCurrentThreadCpus(const std::vector<int>& cpus)
+        {
+#if defined(__linux__)
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            for (int cpu : cpus)
+            {
+                if (cpu >= 0 && cpu < CPU_SETSIZE)
+                {
+                    CPU_SET(cpu, &set);
+                }
+            }
+            return !cpus.empty() && pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &set) == 0;
+#else
+            SOFA_UNUSED(cpus);
+            return false;
+#endif
+        }
+        
+        bool ThreadAffinity::hasProcessAffinity()
+        {
+            return processAffinity().isSet;
+        }
+        
+        const ThreadAffinity& ThreadAffinity::getProcessAffinity()
+        {
+            return processAffinity().affinity;
+        }
+        
+        void ThreadAffinity::setProcessAffinity(const ThreadAffinity& affinity)
+        {
+            processAffinity().affinity = affinity;
+            processAffinity().isSet = true;
+        }
+        
+    } // namespace simulation
+    
+} // namespace sofa
@@ -0,0 +1,114 @@
+/******************************************************************************
+*                 SOFA, Simulation Open-Framework Architecture                *
+*                    (c) 2006 INRIA, USTL, UJF, CNRS, MGH                     *
+*                                                                             *
+* This program is free software; you can redistribute it and/or modify it     *
+* under the terms of the GNU Lesser General Public License as published by    *
+* the Free Software Foundation; either version 2.1 of the License, or (at     *
+* your option) any later version.                                             *
+*                                                                             *
+* This program is distributed in the hope that it will be useful, but WITHOUT *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License *
+* for more details.                                                           *
+*                                                                             *
+* You should have received a copy of the GNU Lesser General Public License    *
+* along with this program. If not, see <http://www.gnu.org/licenses/>.        *
+*******************************************************************************
+* Authors: The SOFA Team and external contributors (see Authors.txt)          *
+*                                                                             *
+* Contact information: contact@sofa-framework.org                             *
+******************************************************************************/
+#ifndef MultiThreadingThreadAffinity_h__
+#define MultiThreadingThreadAffinity_h__
+
+#include <sofa/simulation/config.h>
+
+#include <string>
+#include <vector>
+
+namespace sofa
+{
+    namespace core::objectmodel
+    {
+        class Base;
+    }
+
+	namespace simulation
+	{
+
+        
+        /** Placement of the threads of a task scheduler on the cpus.
+         *  Textual form, used by the scene Data, the SOFA_THREAD_AFFINITY environment variable
+         *  and the sofaBatch command line: a comma separated list of
+         *   - "none": the threads are free to migrate (default)
+         *   - "cores": each thread is pinned to its own cpu, one per physical core first
+         *   - "node:N": the threads only run on the cpus of the NUMA node N
+         *  e.g. "cores,node:1" pins the threads to the cores of the second socket.
+         *  Only implemented on Linux: on the other platforms the threads are left free.
+         */
+        class SOFA_SIMULATION_CORE_API ThreadAffinity
+        {
+        public:
+            
+            ThreadAffinity() = default;
+            
+            ThreadAffinity(bool pinThreads, int numaNode);
+            
+            /// return false and leave the affinity unchanged if the string is not valid
+            bool read(const std::string& str);
+            
+            /// affinity given by the threadAffinity Data of a component, with a warning of the component
+            /// if the string is not valid (the threads are then left free)
+            static ThreadAffinity readData(const core::objectmodel::Base* component, const std::string& str);
+            
+            /// help of the threadAffinity Data of the components
+            static const char* const DataHelp;
+            
+            std::string toString() const;
+            
+            bool isEnabled() const { return m_pinThreads || m_numaNode >= 0; }
+            
+            bool pinThreads() const { return m_pinThreads; }
+            
+            int getNumaNode() const { return m_numaNode; }
+            
+            bool operator==(const ThreadAffinity& other) const { return m_pinThreads == other.m_pinThreads && m_numaNode == other.m_numaNode; }
+            bool operator!=(const ThreadAffinity& other) const { return !(*this == other); }
+            
+            /// cpus the threads may run on, ordered to spread the threads on the physical cores:
+            /// the cpus allowed to the process, restricted to the NUMA node if any
+            std::vector<int> getCpus() const;
+            
+            /// restrict the calling thread to the cpus used by the thread of the given index
+            /// (the cpu cpus[index % cpus.size()] when pinning, all the cpus otherwise)
+            bool applyToCurrentThread(const std::vector<int>& cpus, unsigned int index) const;
+            
+            /// cpus the calling thread is allowed to run on (empty if not supported)
+            static std::vector<int> getCurrentThreadCpus();
+            
+            static bool setCurrentThreadCpus(const std::vector<int>& cpus);
+            
+            
+            /// affinity set for the whole process, by the SOFA_THREAD_AFFINITY environment variable
+            /// or by setProcessAffinity(). When set, it has priority over the scene settings:
+            /// the placement of the jobs depends on the machine, not on the scene.
+            static bool hasProcessAffinity();
+            
+            static const ThreadAffinity& getProcessAffinity();
+            
+            static void setProcessAffinity(const ThreadAffinity& affinity);
+            
+            
+        private:
+            
+            bool m_pinThreads = false;
+            int m_numaNode = -1;
+        };
+        
+	} // namespace simulation
+
+} // namespace sofa
+
+
+#endif // MultiThreadingThreadAffinity_h__
@@ -34,6 +34,24 @@ void VisitorScheduler::doExecuteVisitor(simulation::Node* node, Visitor* act)
     node->doExecuteVisitor(act);
 }
 
+bool VisitorScheduler::insertInNode( sofa::core::objectmodel::BaseNode* node )
+{
+    if (simulation::Node* n = dynamic_cast<simulation::Node*>(node))
+        n->setVisitorScheduler(this);
+    Inherit1::insertInNode(node);
+    // also stored in the unsorted objects of the node
+    return false;
+}
+
+bool VisitorScheduler::removeInNode( sofa::core::objectmodel::BaseNode* node )
+{
+    simulation::Node* n = dynamic_cast<simulation::Node*>(node);
+    if (n && n->getVisitorScheduler() == this)
+        n->setVisitorScheduler(nullptr);
+    Inherit1::removeInNode(node);
+    return false;
+}
+
 } // namespace simulation
 
 } // namespace sofa
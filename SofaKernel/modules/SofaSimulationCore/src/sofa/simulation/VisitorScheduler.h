@@ -45,6 +45,10 @@ public:
     /// Specify whether this scheduler is multi-threaded.
     virtual bool isMultiThreaded() const { return false; }
 
+    /// Register this scheduler in its node: visitors started from this node and its descendants are executed through it
+    bool insertInNode( sofa::core::objectmodel::BaseNode* node ) override;
+    bool removeInNode( sofa::core::objectmodel::BaseNode* node ) override;
+
 protected:
 
     VisitorScheduler() {}
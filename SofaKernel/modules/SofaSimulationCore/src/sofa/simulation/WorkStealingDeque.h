@@ -0,0 +1,199 @@
+/******************************************************************************
+*                 SOFA, Simulation Open-Framework Architecture                *
+*                    (c) 2006 INRIA, USTL, UJF, CNRS, MGH                     *
+*                                                                             *
+* This program is free software; you can redistribute it and/or modify it     *
+* under the terms of the GNU Lesser General Public License as published by    *
+* the Free Software Foundation; either version 2.1 of the License, or (at     *
+* your option) any later version.                                             *
+*                                                                             *
+* This program is distributed in the hope that it will be useful, but WITHOUT *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License *
+* for more details.                                                           *
+*                                                                             *
+* You should have received a copy of the GNU Lesser General Public License    *
+* along with this program. If not, see <http://www.gnu.org/licenses/>.        *
+*******************************************************************************
+* Authors: The SOFA Team and external contributors (see Authors.txt)          *
+*                                                                             *
+* Contact information: contact@sofa-framework.org                             *
+******************************************************************************/
+#ifndef MultiThreadingWorkStealingDeque_h__
+#define MultiThreadingWorkStealingDeque_h__
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace sofa
+{
+
+	namespace simulation
+	{
+
+        
+        /** Lock-free work-stealing deque (Chase-Lev).
+         *  The owner thread pushes and pops at the bottom, any other thread steals from the top.
+         *  The circular buffer grows on demand: there is no capacity limit.
+         *  Retired buffers are kept until the deque is destroyed since a thief may still read from them.
+         *  Reference: Le, Pop, Cohen, Zappa Nardelli, "Correct and Efficient Work-Stealing for Weak Memory Models", PPoPP 2013
+         */
+        template<class T>
+        class WorkStealingDeque
+        {
+            enum
+            {
+                CACHE_LINE = 64
+            };
+            
+            class Array
+            {
+            public:
+                
+                explicit Array(std::int64_t capacity)
+                : m_capacity(capacity)
+                , m_mask(capacity - 1)
+                , m_data(new std::atomic<T>[capacity])
+                {}
+                
+                std::int64_t capacity() const { return m_capacity; }
+                
+                T get(std::int64_t i) const { return m_data[i & m_mask].load(std::memory_order_relaxed); }
+                
+                void put(std::int64_t i, T item) { m_data[i & m_mask].store(item, std::memory_order_relaxed); }
+                
+                Array* grow(std::int64_t bottom, std::int64_t top) const
+                {
+                    Array* array = new Array(2 * m_capacity);
+                    for (std::int64_t i = top; i != bottom; ++i)
+                    {
+                        array->put(i, get(i));
+                    }
+                    return array;
+                }
+                
+            private:
+                
+                const std::int64_t m_capacity;
+                const std::int64_t m_mask;
+                std::unique_ptr<std::atomic<T>[]> m_data;
+            };
+            
+        public:
+            
+            // capacity must be a power of two
+            explicit WorkStealingDeque(std::int64_t capacity = 256)
+            : m_top(0)
+            , m_bottom(0)
+            , m_array(new Array(capacity))
+            {}
+            
+            ~WorkStealingDeque()
+            {
+                delete m_array.load(std::memory_order_relaxed);
+            }
+            
+            WorkStealingDeque(const WorkStealingDeque&) = delete;
+            WorkStealingDeque& operator=(const WorkStealingDeque&) = delete;
+            
+            // owner thread only
+            void push(T item)
+            {
+                const std::int64_t b = m_bottom.load(std::memory_order_relaxed);
+                const std::int64_t t = m_top.load(std::memory_order_acquire);
+                Array* array = m_array.load(std::memory_order_relaxed);
+                
+                if (b - t > array->capacity() - 1)
+                {
+                    // full: double the buffer, the old one may still be read by a thief
+                    m_retiredArrays.emplace_back(array);
+                    array = array->grow(b, t);
+                    m_array.store(array, std::memory_order_release);
+                }
+                
+                array->put(b, item);
+                std::atomic_thread_fence(std::memory_order_release);
+                m_bottom.store(b + 1, std::memory_order_relaxed);
+            }
+            
+            // owner thread only
+            bool pop(T& item)
+            {
+                const std::int64_t b = m_bottom.load(std::memory_order_relaxed) - 1;
+                Array* array = m_array.load(std::memory_order_relaxed);
+                m_bottom.store(b, std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                std::int64_t t = m_top.load(std::memory_order_relaxed);
+                
+                if (t > b)
+                {
+                    // empty
+                    m_bottom.store(b + 1, std::memory_order_relaxed);
+                    return false;
+                }
+                
+                item = array->get(b);
+                if (t == b)
+                {
+                    // last item: race against the thieves
+                    const bool won = m_top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+                    m_bottom.store(b + 1, std::memory_order_relaxed);
+                    return won;
+                }
+                return true;
+            }
+            
+            // any thread
+            bool steal(T& item)
+            {
+                std::int64_t t = m_top.load(std::memory_order_acquire);
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                const std::int64_t b = m_bottom.load(std::memory_order_acquire);
+                
+                if (t >= b)
+                {
+                    return false;
+                }
+                
+                Array* array = m_array.load(std::memory_order_acquire);
+                T stolen = array->get(t);
+                if (!m_top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+                {
+                    // lost the race against the owner or another thief
+                    return false;
+                }
+                item = stolen;
+                return true;
+            }
+            
+            // approximative when called concurrently with push/pop/steal
+            std::int64_t size() const
+            {
+                const std::int64_t b = m_bottom.load(std::memory_order_relaxed);
+                const std::int64_t t = m_top.load(std::memory_order_relaxed);
+                return b > t ? b - t : 0;
+            }
+            
+            bool empty() const { return size() == 0; }
+            
+            std::int64_t capacity() const { return m_array.load(std::memory_order_relaxed)->capacity(); }
+            
+        private:
+            
+            // top and bottom are written by different threads: keep them on separate cache lines
+            alignas(CACHE_LINE) std::atomic<std::int64_t> m_top;
+            alignas(CACHE_LINE) std::atomic<std::int64_t> m_bottom;
+            alignas(CACHE_LINE) std::atomic<Array*> m_array;
+            
+            // owner thread only
+            std::vector< std::unique_ptr<Array> > m_retiredArrays;
+        };
+
+	} // namespace simulation
+
+} // namespace sofa
+
+
+#endif // MultiThreadingWorkStealingDeque_h__
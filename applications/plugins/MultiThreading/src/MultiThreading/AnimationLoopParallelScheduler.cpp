@@ -3,6 +3,7 @@
 #include <sofa/simulation/TaskScheduler.h>
 #include "AnimationLoopTasks.h"
 #include <sofa/simulation/InitTasks.h>
+#include <sofa/simulation/ArenaAllocator.h>
 #include "DataExchange.h"
 
 #include <sofa/core/ObjectFactory.h>
@@ -72,6 +73,7 @@ namespace simulation
 		: Inherit()
         , schedulerName(initData(&schedulerName, "scheduler", "name of the scheduler to use"))
 		, threadNumber(initData(&threadNumber, (unsigned int)0, "threadNumber", "number of thread") )
+		, d_threadAffinity(initData(&d_threadAffinity, std::string("none"), "threadAffinity", simulation::ThreadAffinity::DataHelp) )
 		, mNbThread(0)
 		, gnode(_gnode)
         , _taskScheduler(nullptr)
@@ -102,6 +104,7 @@ namespace simulation
         {
             _taskScheduler = TaskScheduler::create(schedulerName.getValue().c_str());
         }        
+        _taskScheduler->setThreadAffinity(simulation::ThreadAffinity::readData(this, d_threadAffinity.getValue()));
         _taskScheduler->init( mNbThread );
 	}
 
@@ -115,12 +118,11 @@ namespace simulation
 
 	void AnimationLoopParallelScheduler::reinit()
 	{
-        if ( threadNumber.getValue() != _taskScheduler->getThreadCount() )
-        {
-            mNbThread = threadNumber.getValue();
-            _taskScheduler->init(mNbThread);
-            initThreadLocalData();
-        }
+        // the threads are restarted if their number or their placement changed
+        mNbThread = threadNumber.getValue();
+        _taskScheduler->setThreadAffinity(simulation::ThreadAffinity::readData(this, d_threadAffinity.getValue()));
+        _taskScheduler->init(mNbThread);
+        initThreadLocalData();
 	}
 
 	void AnimationLoopParallelScheduler::cleanup()
@@ -137,6 +139,8 @@ namespace simulation
 			dt = this->gnode->getDt();
 
 
+		// the step tasks are created in the arena of this thread and released on return
+		simulation::ArenaScope arenaScope;
 		simulation::CpuTask::Status status;
 
 		typedef Node::Sequence<simulation::Node,true>::iterator ChildIterator;
@@ -145,7 +149,7 @@ namespace simulation
 			if ( core::behavior::BaseAnimationLoop* aloop = (*it)->getAnimationLoop() )
 			{
 				//thread->addTask( new( task_pool.malloc()) StepTask( aloop, dt, &status ) );
-                _taskScheduler->addTask(new StepTask(aloop, dt, &status));
+                _taskScheduler->addTask(simulation::newInThreadArena<StepTask>(aloop, dt, &status));
 
 			}
 
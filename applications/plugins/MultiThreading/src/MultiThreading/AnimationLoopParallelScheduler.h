@@ -27,6 +27,7 @@
 
 #include <sofa/simulation/Node.h>
 #include <sofa/simulation/Visitor.h>
+#include <sofa/simulation/ThreadAffinity.h>
 #include <sofa/helper/AdvancedTimer.h>
 
 using namespace sofa::core::objectmodel;
@@ -55,6 +56,8 @@ public:
 
 	Data<unsigned int> threadNumber; ///< number of thread
 
+	Data<std::string> d_threadAffinity; ///< placement of the threads on the cpus (see ThreadAffinity)
+
 
 protected:
 	AnimationLoopParallelScheduler(simulation::Node* gnode = NULL);
@@ -33,7 +33,7 @@ namespace sofa
         Task::MemoryAlloc StepTask::run()
         {
             animationloop->step( core::ExecParams::defaultInstance(), dt);
-            return Task::MemoryAlloc::Dynamic;
+            return Task::MemoryAlloc::Arena;
         }        
         
     } // namespace simulation
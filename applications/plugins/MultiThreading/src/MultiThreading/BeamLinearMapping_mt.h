@@ -111,12 +111,10 @@ namespace mapping
             
         public:
             
-            MemoryAlloc run() final;
-            
-        protected:
-            
             applyTask( simulation::CpuTask::Status* status );
             
+            MemoryAlloc run() final;
+            
         private:
             
             BeamLinearMapping_mt<TIn,TOut>* _mapping;
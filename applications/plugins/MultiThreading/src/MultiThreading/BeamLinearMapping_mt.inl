@@ -27,6 +27,7 @@
 #include "BeamLinearMapping_tasks.inl"
 
 #include <sofa/simulation/TaskScheduler.h>
+#include <sofa/simulation/ArenaAllocator.h>
 
 namespace sofa
 {
@@ -92,6 +93,8 @@ namespace mapping
             
             
             // create tasks
+            // the tasks are created in the arena of this thread and released on return
+            simulation::ArenaScope arenaScope;
             simulation::CpuTask::Status status;
             simulation::TaskScheduler* scheduler = simulation::TaskScheduler::getInstance();
             
@@ -103,7 +106,7 @@ namespace mapping
             for ( int i=0; i<nbTasks; ++i)
             {
                 typename BeamLinearMapping_mt< TIn, TOut>::applyTask* task =
-                new typename BeamLinearMapping_mt< TIn, TOut>::applyTask( &status );
+                simulation::newInThreadArena<typename BeamLinearMapping_mt< TIn, TOut>::applyTask>( &status );
                 
                 task->_mapping = this;
                 //task->_mparams = mparams;
@@ -118,7 +121,7 @@ namespace mapping
             if ( pointsLeft > 0)
             {
                 typename BeamLinearMapping_mt< TIn, TOut>::applyTask* task =
-                new typename BeamLinearMapping_mt< TIn, TOut>::applyTask( &status );
+                simulation::newInThreadArena<typename BeamLinearMapping_mt< TIn, TOut>::applyTask>( &status );
                 
                 task->_mapping = this;
                 //task->_mparams = mparams;
@@ -137,7 +140,7 @@ namespace mapping
             for ( int i=0; i<nbTasks; ++i)
             {
                 typename BeamLinearMapping_mt< TIn, TOut>::applyTask* task =
-                new typename BeamLinearMapping_mt< TIn, TOut>::applyTask( &status );
+                simulation::newInThreadArena<typename BeamLinearMapping_mt< TIn, TOut>::applyTask>( &status );
                 
                 task->_mapping = this;
                 //task->_mparams = mparams;
@@ -186,6 +189,8 @@ namespace mapping
             
             out.resize(this->points.size());
             
+            // the tasks are created in the arena of this thread and released on return
+            simulation::ArenaScope arenaScope;
             simulation::CpuTask::Status status;
             simulation::TaskScheduler* scheduler = simulation::TaskScheduler::getInstance();
             
@@ -197,7 +202,7 @@ namespace mapping
             for ( int i=0; i<nbTasks; ++i)
             {
                 typename BeamLinearMapping_mt< TIn, TOut>::applyJTask* task =
-                new typename BeamLinearMapping_mt< TIn, TOut>::applyJTask( &status );
+                simulation::newInThreadArena<typename BeamLinearMapping_mt< TIn, TOut>::applyJTask>( &status );
                 
                 task->_mapping = this;
                 task->_in = &in;
@@ -211,7 +216,7 @@ namespace mapping
             if ( pointsLeft > 0)
             {
                 typename BeamLinearMapping_mt< TIn, TOut>::applyJTask* task =
-                new typename BeamLinearMapping_mt< TIn, TOut>::applyJTask( &status );
+                simulation::newInThreadArena<typename BeamLinearMapping_mt< TIn, TOut>::applyJTask>( &status );
                 
                 task->_mapping = this;
                 task->_in = &in;
@@ -229,7 +234,7 @@ namespace mapping
             for ( int i=0; i<nbTasks; ++i)
             {
                 typename BeamLinearMapping_mt< TIn, TOut>::applyJTask* task =
-                new typename BeamLinearMapping_mt< TIn, TOut>::applyJTask( &status );
+                simulation::newInThreadArena<typename BeamLinearMapping_mt< TIn, TOut>::applyJTask>( &status );
                 
                 task->_mapping = this;
                 task->_in = &in;
@@ -273,6 +278,8 @@ namespace mapping
             helper::ReadAccessor< Data< typename Out::VecDeriv > > in = _in;
             
             
+            // the tasks are created in the arena of this thread and released on return
+            simulation::ArenaScope arenaScope;
             simulation::CpuTask::Status status;
             simulation::TaskScheduler* scheduler = simulation::TaskScheduler::getInstance();
             
@@ -284,7 +291,7 @@ namespace mapping
             for ( int i=0; i<nbTasks; ++i)
             {
                 typename BeamLinearMapping_mt< TIn, TOut>::applyJTmechTask* task =
-                new typename BeamLinearMapping_mt< TIn, TOut>::applyJTmechTask( &status );
+                simulation::newInThreadArena<typename BeamLinearMapping_mt< TIn, TOut>::applyJTmechTask>( &status );
                 
                 task->_mapping = this;
                 task->_in = &in;
@@ -298,7 +305,7 @@ namespace mapping
             if ( pointsLeft > 0)
             {
                 typename BeamLinearMapping_mt< TIn, TOut>::applyJTmechTask* task =
-                new typename BeamLinearMapping_mt< TIn, TOut>::applyJTmechTask( &status );
+                simulation::newInThreadArena<typename BeamLinearMapping_mt< TIn, TOut>::applyJTmechTask>( &status );
                 
                 task->_mapping = this;
                 task->_in = &in;
@@ -316,7 +323,7 @@ namespace mapping
             for ( int i=0; i<nbTasks; ++i)
             {
                 typename BeamLinearMapping_mt< TIn, TOut>::applyJTmechTask* task =
-                new typename BeamLinearMapping_mt< TIn, TOut>::applyJTmechTask( &status );
+                simulation::newInThreadArena<typename BeamLinearMapping_mt< TIn, TOut>::applyJTmechTask>( &status );
                 
                 task->_mapping = this;
                 task->_in = &in;
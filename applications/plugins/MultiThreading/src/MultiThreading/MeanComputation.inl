@@ -3,6 +3,7 @@
 //#include <SofaBaseMechanics/MechanicalObject.h>
 
 #include <sofa/simulation/AnimateBeginEvent.h>
+#include <sofa/simulation/ParallelForEach.h>
 
 using namespace sofa::core::objectmodel;
 using namespace sofa::core::behavior;
@@ -120,21 +121,32 @@ namespace sofa
 
                 const double invNbInputs = 1.0 / nbInputs;
 
-                // accumulate all the input elems in result
+                // get the inputs before the parallel loop: Data access is not thread safe
+                std::vector<const VecCoord*> inputs(nbInputs);
                 for (size_t j = 0; j<nbInputs; ++j)
                 {
-                    const VecCoord& pos = *_inputs[j]->beginEdit();
+                    inputs[j] = _inputs[j]->beginEdit();
+                }
 
-                    for (size_t i = 0; i<_resultSize; ++i)
+                // accumulate all the input elems in result
+                simulation::parallelForEachRange(simulation::Range<size_t>(0, _resultSize), 0,
+                    [&](const simulation::Range<size_t>& range)
                     {
-                        result[i] += pos[i];
-                    }
-                }
+                        for (size_t j = 0; j<nbInputs; ++j)
+                        {
+                            const VecCoord& pos = *inputs[j];
 
-                for (size_t i = 0; i<_resultSize; ++i)
-                {
-                    result[i] *= invNbInputs;
-                }    
+                            for (size_t i = range.start(); i<range.end(); ++i)
+                            {
+                                result[i] += pos[i];
+                            }
+                        }
+
+                        for (size_t i = range.start(); i<range.end(); ++i)
+                        {
+                            result[i] *= invNbInputs;
+                        }
+                    });
                 
                 d_result.endEdit();
 //                d_result.setDirtyValue();
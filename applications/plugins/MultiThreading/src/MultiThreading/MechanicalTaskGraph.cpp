@@ -0,0 +1,478 @@
+/******************************************************************************
+*                 SOFA, Simulation Open-Framework Architecture                *
+*                    (c) 2006 INRIA, USTL, UJF, CNRS, MGH                     *
+*                                                                             *
+* This program is free software; you can redistribute it and/or modify it     *
+* under the terms of the GNU Lesser General Public License as published by    *
+* the Free Software Foundation; either version 2.1 of the License, or (at     *
+* your option) any later version.                                             *
+*                                                                             *
+* This program is distributed in the hope that it will be useful, but WITHOUT *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License *
+* for more details.                                                           *
+*                                                                             *
+* You should have received a copy of the GNU Lesser General Public License    *
+* along with this program. If not, see <http://www.gnu.org/licenses/>.        *
+*******************************************************************************
+* Authors: The SOFA Team and external contributors (see Authors.txt)          *
+*                                                                             *
+* Contact information: contact@sofa-framework.org                             *
+******************************************************************************/
+#include <MultiThreading/MechanicalTaskGraph.h>
+
+#include <sofa/simulation/TaskScheduler.h>
+#include <sofa/simulation/ArenaAllocator.h>
+#include <sofa/simulation/MechanicalVisitor.h>
+#include <sofa/core/behavior/BaseInteractionConstraint.h>
+#include <sofa/core/behavior/BaseInteractionProjectiveConstraintSet.h>
+#include <sofa/core/BaseMapping.h>
+#include <sofa/core/collision/Pipeline.h>
+
+#include <algorithm>
+#include <set>
+
+
+namespace sofa
+{
+
+    namespace simulation
+    {
+        
+        namespace
+        {
+            
+            // the AnimateVisitor applied on a node with a solver, once the collision has been processed
+            class IntegrationVisitor : public AnimateVisitor
+            {
+            public:
+                
+                IntegrationVisitor(const core::ExecParams* params, SReal dt)
+                : AnimateVisitor(params, dt)
+                {
+                    // constraints are reset once for the whole graph
+                    firstNodeVisited = true;
+                }
+                
+                // the collision pipeline is a separate item of the graph
+                void processCollisionPipeline(simulation::Node*, core::collision::Pipeline*) override {}
+                
+                const char* getClassName() const override { return "IntegrationVisitor"; }
+            };
+            
+        } // namespace
+        
+        
+        MechanicalTaskGraph::MechanicalTaskGraph()
+        : m_root(nullptr)
+        , m_nbSubsystems(0)
+        {
+        }
+        
+        MechanicalTaskGraph::~MechanicalTaskGraph()
+        {
+        }
+        
+        void MechanicalTaskGraph::clear()
+        {
+            m_root = nullptr;
+            m_items.clear();
+            m_roots.clear();
+            m_subsystemParent.clear();
+            m_subsystemNodes.clear();
+            m_nodeSubsystem.clear();
+            m_couplings.clear();
+            m_freeStateOwners.clear();
+            m_freeStateResources.clear();
+            m_nbSubsystems = 0;
+        }
+        
+        void MechanicalTaskGraph::build(Node* root, SReal dt)
+        {
+            clear();
+            m_root = root;
+            
+            std::set<Node*> visited;
+            traverse(root, dt, visited);
+            
+            // subsystems
+            std::map<Node*, int> owners;
+            for (std::size_t s = 0; s < m_subsystemNodes.size(); ++s)
+            {
+                collectSubsystem(m_subsystemNodes[s], int(s), owners);
+            }
+            m_nodeSubsystem = owners;
+            
+            for (const auto& coupling : m_couplings)
+            {
+                Node* node = dynamic_cast<Node*>(coupling.first->getContext());
+                auto owner = m_nodeSubsystem.find(node);
+                if (owner != m_nodeSubsystem.end())
+                {
+                    mergeSubsystems(owner->second, coupling.second);
+                }
+                else
+                {
+                    // a state outside of any subsystem used by two subsystems couples them
+                    auto freeState = m_freeStateOwners.find(coupling.first);
+                    if (freeState != m_freeStateOwners.end())
+                    {
+                        mergeSubsystems(freeState->second, coupling.second);
+                    }
+                    else
+                    {
+                        m_freeStateOwners[coupling.first] = coupling.second;
+                    }
+                }
+            }
+            
+            std::set<int> subsystems;
+            for (std::size_t s = 0; s < m_subsystemParent.size(); ++s)
+            {
+                subsystems.insert(findSubsystem(int(s)));
+            }
+            m_nbSubsystems = subsystems.size();
+            
+            // resources touched by each item
+            for (auto& item : m_items)
+            {
+                switch (item->type)
+                {
+                case Integration:
+                    item->resources.push_back(findSubsystem(m_nodeSubsystem[item->node]));
+                    break;
+                case InteractionForceField:
+                    item->resources.push_back(getResource(item->interactionForceField->getMechModel1()));
+                    item->resources.push_back(getResource(item->interactionForceField->getMechModel2()));
+                    break;
+                case Collision:
+                    break;
+                }
+            }
+            
+            computeDependencies();
+        }
+        
+        void MechanicalTaskGraph::traverse(Node* node, SReal& dt, std::set<Node*>& visited)
+        {
+            // same order and pruning as AnimateVisitor::processNodeTopDown
+            if (!visited.insert(node).second) return;
+            if (!node->isActive()) return;
+            if (node->isSleeping()) return;
+            
+            if (dt == 0) dt = node->getDt();
+            else node->setDt(dt);
+            
+            if (node->collisionPipeline != nullptr)
+            {
+                m_items.emplace_back(new Item(Collision, node));
+            }
+            
+            if (!node->solver.empty())
+            {
+                m_nodeSubsystem[node] = int(m_subsystemNodes.size());
+                m_subsystemNodes.push_back(node);
+                m_subsystemParent.push_back(int(m_subsystemParent.size()));
+                m_items.emplace_back(new Item(Integration, node));
+                return;
+            }
+            
+            for (auto ff : node->interactionForceField)
+            {
+                m_items.emplace_back(new Item(InteractionForceField, node, ff));
+            }
+            
+            for (auto child : node->child)
+            {
+                traverse(child.get(), dt, visited);
+            }
+        }
+        
+        std::vector<core::collision::Pipeline*> MechanicalTaskGraph::getIgnoredCollisionPipelines(Node* root)
+        {
+            std::vector<core::collision::Pipeline*> pipelines;
+            if (!root->solver.empty())
+            {
+                for (auto child : root->child)
+                {
+                    child->getTreeObjects<core::collision::Pipeline>(&pipelines);
+                }
+            }
+            else
+            {
+                for (auto child : root->child)
+                {
+                    const std::vector<core::collision::Pipeline*> childPipelines = getIgnoredCollisionPipelines(child.get());
+                    pipelines.insert(pipelines.end(), childPipelines.begin(), childPipelines.end());
+                }
+            }
+            
+            // a node with several parents is found once for each of them
+            std::sort(pipelines.begin(), pipelines.end());
+            pipelines.erase(std::unique(pipelines.begin(), pipelines.end()), pipelines.end());
+            return pipelines;
+        }
+        
+        void MechanicalTaskGraph::collectSubsystem(Node* node, int subsystem, std::map<Node*, int>& owners)
+        {
+            auto owner = owners.find(node);
+            if (owner != owners.end())
+            {
+                // node shared by two subsystems (multiple parents)
+                if (owner->second != subsystem)
+                {
+                    mergeSubsystems(owner->second, subsystem);
+                }
+                return;
+            }
+            owners[node] = subsystem;
+            
+            if (node->mechanicalMapping != nullptr)
+            {
+                for (auto state : node->mechanicalMapping->getMechFrom())
+                {
+                    coupleState(state, subsystem);
+                }
+            }
+            
+            for (auto ff : node->interactionForceField)
+            {
+                coupleState(ff->getMechModel1(), subsystem);
+                coupleState(ff->getMechModel2(), subsystem);
+            }
+            
+            for (auto constraint : node->constraintSet)
+            {
+                if (auto interaction = dynamic_cast<core::behavior::BaseInteractionConstraint*>(constraint))
+                {
+                    coupleState(interaction->getMechModel1(), subsystem);
+                    coupleState(interaction->getMechModel2(), subsystem);
+                }
+            }
+            
+            for (auto constraint : node->projectiveConstraintSet)
+            {
+                if (auto interaction = dynamic_cast<core::behavior::BaseInteractionProjectiveConstraintSet*>(constraint))
+                {
+                    coupleState(interaction->getMechModel1(), subsystem);
+                    coupleState(interaction->getMechModel2(), subsystem);
+                }
+            }
+            
+            for (auto child : node->child)
+            {
+                collectSubsystem(child.get(), subsystem, owners);
+            }
+        }
+        
+        void MechanicalTaskGraph::coupleState(core::behavior::BaseMechanicalState* state, int subsystem)
+        {
+            if (state != nullptr)
+            {
+                m_couplings.emplace_back(state, subsystem);
+            }
+        }
+        
+        int MechanicalTaskGraph::findSubsystem(int subsystem)
+        {
+            while (m_subsystemParent[subsystem] != subsystem)
+            {
+                m_subsystemParent[subsystem] = m_subsystemParent[m_subsystemParent[subsystem]];
+                subsystem = m_subsystemParent[subsystem];
+            }
+            return subsystem;
+        }
+        
+        void MechanicalTaskGraph::mergeSubsystems(int a, int b)
+        {
+            a = findSubsystem(a);
+            b = findSubsystem(b);
+            if (a != b)
+            {
+                m_subsystemParent[std::max(a, b)] = std::min(a, b);
+            }
+        }
+        
+        int MechanicalTaskGraph::getResource(core::behavior::BaseMechanicalState* state)
+        {
+            Node* node = state ? dynamic_cast<Node*>(state->getContext()) : nullptr;
+            
+            auto owner = m_nodeSubsystem.find(node);
+            if (owner != m_nodeSubsystem.end())
+            {
+                return findSubsystem(owner->second);
+            }
+            
+            auto freeStateOwner = m_freeStateOwners.find(state);
+            if (freeStateOwner != m_freeStateOwners.end())
+            {
+                return findSubsystem(freeStateOwner->second);
+            }
+            
+            // state which is not simulated: it is a resource of its own
+            auto freeState = m_freeStateResources.find(state);
+            if (freeState == m_freeStateResources.end())
+            {
+                const int resource = int(m_subsystemParent.size() + m_freeStateResources.size());
+                freeState = m_freeStateResources.insert(std::make_pair(state, resource)).first;
+            }
+            return freeState->second;
+        }
+        
+        void MechanicalTaskGraph::computeDependencies()
+        {
+            std::map<int, std::size_t> lastItems;
+            std::vector<std::size_t> itemsSinceBarrier;
+            bool hasBarrier = false;
+            std::size_t lastBarrier = 0;
+            
+            for (std::size_t i = 0; i < m_items.size(); ++i)
+            {
+                Item& item = *m_items[i];
+                std::set<std::size_t> predecessors;
+                
+                if (item.type == Collision)
+                {
+                    // barrier: after everything, before everything
+                    predecessors.insert(itemsSinceBarrier.begin(), itemsSinceBarrier.end());
+                    if (hasBarrier) predecessors.insert(lastBarrier);
+                    
+                    lastItems.clear();
+                    itemsSinceBarrier.clear();
+                    hasBarrier = true;
+                    lastBarrier = i;
+                }
+                else
+                {
+                    if (hasBarrier) predecessors.insert(lastBarrier);
+                    for (int resource : item.resources)
+                    {
+                        auto last = lastItems.find(resource);
+                        if (last != lastItems.end())
+                        {
+                            predecessors.insert(last->second);
+                        }
+                        lastItems[resource] = i;
+                    }
+                    itemsSinceBarrier.push_back(i);
+                }
+                
+                for (std::size_t predecessor : predecessors)
+                {
+                    m_items[predecessor]->successors.push_back(i);
+                }
+                item.nbPredecessors = (unsigned int)predecessors.size();
+                
+                if (predecessors.empty())
+                {
+                    m_roots.push_back(i);
+                }
+            }
+        }
+        
+        void MechanicalTaskGraph::resetConstraints(const core::ExecParams* params)
+        {
+            // done by the AnimateVisitor on the first visited node
+            if (m_root == nullptr || !m_root->isActive() || m_root->isSleeping()) return;
+            
+            sofa::core::ConstraintParams cparams(*params);
+            MechanicalResetConstraintVisitor resetConstraint(&cparams);
+            m_root->execute(&resetConstraint);
+        }
+        
+        void MechanicalTaskGraph::runItem(std::size_t i, const core::ExecParams* params, SReal dt)
+        {
+            Item& item = *m_items[i];
+            
+            switch (item.type)
+            {
+            case Collision:
+            {
+                AnimateVisitor act(params, dt);
+                act.processCollisionPipeline(item.node, item.node->collisionPipeline);
+                break;
+            }
+            case InteractionForceField:
+            {
+                AnimateVisitor act(params, dt);
+                act.fwdInteractionForceField(item.node, item.interactionForceField);
+                break;
+            }
+            case Integration:
+            {
+                IntegrationVisitor act(params, dt);
+                act.execute(item.node);
+                break;
+            }
+            }
+        }
+        
+        void MechanicalTaskGraph::executeSequential(const core::ExecParams* params, SReal dt)
+        {
+            resetConstraints(params);
+            
+            for (std::size_t i = 0; i < m_items.size(); ++i)
+            {
+                runItem(i, params, dt);
+            }
+        }
+        
+        void MechanicalTaskGraph::execute(TaskScheduler* scheduler, const core::ExecParams* params, SReal dt)
+        {
+            resetConstraints(params);
+            
+            // the tasks of all the items are created in the arena of this thread and released on return
+            ArenaScope arenaScope;
+            CpuTask::Status status;
+            m_tasks.resize(m_items.size());
+            for (std::size_t i = 0; i < m_items.size(); ++i)
+            {
+                m_items[i]->pendingPredecessors.store(m_items[i]->nbPredecessors, std::memory_order_relaxed);
+                m_tasks[i] = newInThreadArena<MechanicalTaskGraphTask>(this, i, scheduler, params, dt, &status);
+            }
+            
+            for (std::size_t root : m_roots)
+            {
+                scheduler->addTask(m_tasks[root]);
+            }
+            scheduler->workUntilDone(&status);
+            m_tasks.clear();
+        }
+        
+        
+        
+        MechanicalTaskGraphTask::MechanicalTaskGraphTask(MechanicalTaskGraph* graph, std::size_t item, TaskScheduler* scheduler, const core::ExecParams* params, SReal dt, CpuTask::Status* status)
+        : CpuTask(status)
+        , m_graph(graph)
+        , m_item(item)
+        , m_scheduler(scheduler)
+        , m_params(params)
+        , m_dt(dt)
+        {
+        }
+        
+        MechanicalTaskGraphTask::~MechanicalTaskGraphTask()
+        {
+        }
+        
+        Task::MemoryAlloc MechanicalTaskGraphTask::run()
+        {
+            m_graph->runItem(m_item, m_params, m_dt);
+            
+            // the successors are queued before this task is marked as done: the status stays busy
+            const MechanicalTaskGraph::Item& item = m_graph->getItem(m_item);
+            for (std::size_t successor : item.successors)
+            {
+                MechanicalTaskGraph::Item& next = m_graph->getItem(successor);
+                if (next.pendingPredecessors.fetch_sub(1, std::memory_order_acq_rel) == 1)
+                {
+                    m_scheduler->addTask(m_graph->getTask(successor));
+                }
+            }
+            return MemoryAlloc::Arena;
+        }
+        
+        
+    } // namespace simulation
+
+} // namespace sofa
@@ -0,0 +1,202 @@
+/******************************************************************************
+*                 SOFA, Simulation Open-Framework Architecture                *
+*                    (c) 2006 INRIA, USTL, UJF, CNRS, MGH                     *
+*                                                                             *
+* This program is free software; you can redistribute it and/or modify it     *
+* under the terms of the GNU Lesser General Public License as published by    *
+* the Free Software Foundation; either version 2.1 of the License, or (at     *
+* your option) any later version.                                             *
+*                                                                             *
+* This program is distributed in the hope that it will be useful, but WITHOUT *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License *
+* for more details.                                                           *
+*                                                                             *
+* You should have received a copy of the GNU Lesser General Public License    *
+* along with this program. If not, see <http://www.gnu.org/licenses/>.        *
+*******************************************************************************
+* Authors: The SOFA Team and external contributors (see Authors.txt)          *
+*                                                                             *
+* Contact information: contact@sofa-framework.org                             *
+******************************************************************************/
+#ifndef MechanicalTaskGraph_h__
+#define MechanicalTaskGraph_h__
+
+#include <MultiThreading/config.h>
+
+#include <sofa/simulation/Task.h>
+#include <sofa/simulation/Node.h>
+#include <sofa/simulation/AnimateVisitor.h>
+
+#include <atomic>
+#include <map>
+#include <memory>
+#include <set>
+#include <vector>
+
+
+namespace sofa
+{
+
+    namespace simulation
+    {
+        
+        class TaskScheduler;
+        class MechanicalTaskGraphTask;
+        
+        
+        /** Dependency graph of the animation step of a scene.
+         *
+         *  The graph is built by a top-down traversal equivalent to the AnimateVisitor one.
+         *  Each item is one of the operations the AnimateVisitor would have performed:
+         *  the collision pipeline of a node, an interaction force field of a node without solver,
+         *  or the integration (solve and propagation) of a node with a solver.
+         *
+         *  A mechanical subsystem is the subtree of a node with a solver. Subsystems sharing
+         *  nodes, mapped across each other or coupled by an interaction force field or constraint
+         *  inside their subtrees are merged, since they must be solved sequentially.
+         *
+         *  An item depends on the previous items (in the AnimateVisitor order) touching the same subsystems.
+         *  The collision pipeline is a barrier. Items without dependency between them run concurrently
+         *  on the TaskScheduler, so the result is the same as the sequential AnimateVisitor.
+         */
+        class SOFA_MULTITHREADING_PLUGIN_API MechanicalTaskGraph
+        {
+        public:
+            
+            enum ItemType
+            {
+                Collision,
+                InteractionForceField,
+                Integration
+            };
+            
+            struct Item
+            {
+                ItemType type;
+                Node* node;
+                core::behavior::BaseInteractionForceField* interactionForceField;
+                std::vector<int> resources;
+                std::vector<std::size_t> successors;
+                unsigned int nbPredecessors;
+                std::atomic<unsigned int> pendingPredecessors;
+                
+                Item(ItemType t, Node* n, core::behavior::BaseInteractionForceField* ff = nullptr)
+                : type(t), node(n), interactionForceField(ff), nbPredecessors(0), pendingPredecessors(0)
+                {}
+            };
+            
+            MechanicalTaskGraph();
+            
+            ~MechanicalTaskGraph();
+            
+            /// build the dependency graph of the animation step below root
+            /// the dt of the traversed nodes is updated as the AnimateVisitor does
+            void build(Node* root, SReal dt);
+            
+            /// run all the items: an item is queued as soon as its predecessors are done
+            void execute(TaskScheduler* scheduler, const core::ExecParams* params, SReal dt);
+            
+            /// run all the items sequentially, in the AnimateVisitor order
+            void executeSequential(const core::ExecParams* params, SReal dt);
+            
+            std::size_t getNbItems() const { return m_items.size(); }
+            
+            /// number of independent mechanical subsystems after merging the coupled ones
+            std::size_t getNbSubsystems() const { return m_nbSubsystems; }
+            
+            /// number of items without predecessor
+            std::size_t getNbRoots() const { return m_roots.size(); }
+            
+            const Item& getItem(std::size_t i) const { return *m_items[i]; }
+            
+            Item& getItem(std::size_t i) { return *m_items[i]; }
+            
+            void clear();
+            
+            /// run a single item of the graph
+            void runItem(std::size_t i, const core::ExecParams* params, SReal dt);
+            
+            /// task of an item, during execute()
+            MechanicalTaskGraphTask* getTask(std::size_t i) const { return m_tasks[i]; }
+            
+            /// collision pipelines below a node with a solver: neither the task graph nor the AnimateVisitor run them
+            static std::vector<core::collision::Pipeline*> getIgnoredCollisionPipelines(Node* root);
+            
+        private:
+            
+            void traverse(Node* node, SReal& dt, std::set<Node*>& visited);
+            
+            // record the nodes owned by the subsystem, merge subsystems coupled in this subtree
+            void collectSubsystem(Node* node, int subsystem, std::map<Node*, int>& owners);
+            
+            void coupleState(core::behavior::BaseMechanicalState* state, int subsystem);
+            
+            int findSubsystem(int subsystem);
+            
+            void mergeSubsystems(int a, int b);
+            
+            // subsystem owning the state, or a resource of its own if the state is not simulated
+            int getResource(core::behavior::BaseMechanicalState* state);
+            
+            void computeDependencies();
+            
+            void resetConstraints(const core::ExecParams* params);
+            
+            
+            Node* m_root;
+            
+            std::vector< std::unique_ptr<Item> > m_items;
+            
+            // tasks of the items, in the arena of the thread running execute()
+            std::vector<MechanicalTaskGraphTask*> m_tasks;
+            
+            std::vector<std::size_t> m_roots;
+            
+            // union-find over the solver nodes
+            std::vector<int> m_subsystemParent;
+            
+            std::vector<Node*> m_subsystemNodes;
+            
+            std::map<Node*, int> m_nodeSubsystem;
+            
+            // states coupled with a subsystem whose owner is not known yet
+            std::vector< std::pair<core::behavior::BaseMechanicalState*, int> > m_couplings;
+            
+            // states outside of the subsystems, used by a subsystem
+            std::map<core::behavior::BaseMechanicalState*, int> m_freeStateOwners;
+            
+            // states outside of the subsystems, only used by interaction force fields
+            std::map<core::behavior::BaseMechanicalState*, int> m_freeStateResources;
+            
+            std::size_t m_nbSubsystems;
+        };
+        
+        
+        
+        /// run one item of the MechanicalTaskGraph, then queue the successors which are ready
+        class SOFA_MULTITHREADING_PLUGIN_API MechanicalTaskGraphTask : public CpuTask
+        {
+        public:
+            
+            MechanicalTaskGraphTask(MechanicalTaskGraph* graph, std::size_t item, TaskScheduler* scheduler, const core::ExecParams* params, SReal dt, CpuTask::Status* status);
+            
+            ~MechanicalTaskGraphTask() override;
+            
+            MemoryAlloc run() final;
+            
+        private:
+            
+            MechanicalTaskGraph* m_graph;
+            const std::size_t m_item;
+            TaskScheduler* m_scheduler;
+            const core::ExecParams* m_params;
+            const SReal m_dt;
+        };
+        
+        
+    } // namespace simulation
+
+} // namespace sofa
+
+#endif // MechanicalTaskGraph_h__
@@ -0,0 +1,120 @@
+/******************************************************************************
+*                 SOFA, Simulation Open-Framework Architecture                *
+*                    (c) 2006 INRIA, USTL, UJF, CNRS, MGH                     *
+*                                                                             *
+* This program is free software; you can redistribute it and/or modify it     *
+* under the terms of the GNU Lesser General Public License as published by    *
+* the Free Software Foundation; either version 2.1 of the License, or (at     *
+* your option) any later version.                                             *
+*                                                                             *
+* This program is distributed in the hope that it will be useful, but WITHOUT *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License *
+* for more details.                                                           *
+*                                                                             *
+* You should have received a copy of the GNU Lesser General Public License    *
+* along with this program. If not, see <http://www.gnu.org/licenses/>.        *
+*******************************************************************************
+* Authors: The SOFA Team and external contributors (see Authors.txt)          *
+*                                                                             *
+* Contact information: contact@sofa-framework.org                             *
+******************************************************************************/
+#include <MultiThreading/TaskGraphAnimationLoop.h>
+
+#include <sofa/simulation/TaskScheduler.h>
+#include <sofa/simulation/InitTasks.h>
+#include <sofa/core/ObjectFactory.h>
+#include <sofa/core/collision/Pipeline.h>
+#include <sofa/helper/ScopedAdvancedTimer.h>
+
+
+namespace sofa
+{
+
+namespace simulation
+{
+
+int TaskGraphAnimationLoopClass = core::RegisterObject("Animation loop integrating the independent mechanical subsystems in parallel")
+        .add< TaskGraphAnimationLoop >()
+        ;
+
+
+TaskGraphAnimationLoop::TaskGraphAnimationLoop(simulation::Node* _gnode)
+    : Inherit(_gnode)
+    , schedulerName(initData(&schedulerName, "scheduler", "name of the scheduler to use"))
+    , threadNumber(initData(&threadNumber, (unsigned int)0, "threadNumber", "number of thread"))
+    , d_threadAffinity(initData(&d_threadAffinity, std::string("none"), "threadAffinity", simulation::ThreadAffinity::DataHelp))
+    , d_parallel(initData(&d_parallel, true, "parallel", "integrate the independent mechanical subsystems in parallel"))
+    , d_nbSubsystems(initData(&d_nbSubsystems, (unsigned int)0, "nbSubsystems", "number of independent mechanical subsystems at the last step"))
+    , d_nbItems(initData(&d_nbItems, (unsigned int)0, "nbItems", "number of items (collision, interaction force fields, integrations) in the task graph at the last step"))
+    , m_taskScheduler(nullptr)
+{
+    d_nbSubsystems.setReadOnly(true);
+    d_nbItems.setReadOnly(true);
+}
+
+TaskGraphAnimationLoop::~TaskGraphAnimationLoop()
+{
+}
+
+void TaskGraphAnimationLoop::init()
+{
+    Inherit::init();
+
+    m_taskScheduler = TaskScheduler::getInstance();
+
+    if (TaskScheduler::getCurrentName() != schedulerName.getValue())
+    {
+        m_taskScheduler = TaskScheduler::create(schedulerName.getValue().c_str());
+    }
+    m_taskScheduler->setThreadAffinity(simulation::ThreadAffinity::readData(this, d_threadAffinity.getValue()));
+    m_taskScheduler->init(threadNumber.getValue());
+
+    for (core::collision::Pipeline* pipeline : MechanicalTaskGraph::getIgnoredCollisionPipelines(gnode))
+    {
+        msg_warning() << "The collision pipeline " << pipeline->getPathName() << " is below a node with a solver: it is not run. "
+                      << "Move it above the solvers, e.g. in the root node.";
+    }
+}
+
+void TaskGraphAnimationLoop::bwdInit()
+{
+    initThreadLocalData();
+}
+
+void TaskGraphAnimationLoop::reinit()
+{
+    // the threads are restarted if their number or their placement changed
+    m_taskScheduler->setThreadAffinity(simulation::ThreadAffinity::readData(this, d_threadAffinity.getValue()));
+    m_taskScheduler->init(threadNumber.getValue());
+    initThreadLocalData();
+}
+
+void TaskGraphAnimationLoop::cleanup()
+{
+    m_taskGraph.clear();
+}
+
+void TaskGraphAnimationLoop::animate(const core::ExecParams* params, SReal dt)
+{
+    // the graph is rebuilt each step: nodes may be (de)activated and contacts create interactions
+    {
+        sofa::helper::ScopedAdvancedTimer timer("BuildTaskGraph");
+        m_taskGraph.build(gnode, dt);
+    }
+    d_nbSubsystems.setValue((unsigned int)m_taskGraph.getNbSubsystems());
+    d_nbItems.setValue((unsigned int)m_taskGraph.getNbItems());
+
+    if (d_parallel.getValue() && m_taskScheduler->getThreadCount() > 1)
+    {
+        m_taskGraph.execute(m_taskScheduler, params, dt);
+    }
+    else
+    {
+        m_taskGraph.executeSequential(params, dt);
+    }
+}
+
+} // namespace simulation
+
+} // namespace sofa
@@ -0,0 +1,93 @@
+/******************************************************************************
+*                 SOFA, Simulation Open-Framework Architecture                *
+*                    (c) 2006 INRIA, USTL, UJF, CNRS, MGH                     *
+*                                                                             *
+* This program is free software; you can redistribute it and/or modify it     *
+* under the terms of the GNU Lesser General Public License as published by    *
+* the Free Software Foundation; either version 2.1 of the License, or (at     *
+* your option) any later version.                                             *
+*                                                                             *
+* This program is distributed in the hope that it will be useful, but WITHOUT *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License *
+* for more details.                                                           *
+*                                                                             *
+* You should have received a copy of the GNU Lesser General Public License    *
+* along with this program. If not, see <http://www.gnu.org/licenses/>.        *
+*******************************************************************************
+* Authors: The SOFA Team and external contributors (see Authors.txt)          *
+*                                                                             *
+* Contact information: contact@sofa-framework.org                             *
+******************************************************************************/
+#ifndef SOFA_SIMULATION_TASKGRAPHANIMATIONLOOP_H
+#define SOFA_SIMULATION_TASKGRAPHANIMATIONLOOP_H
+
+#include <MultiThreading/config.h>
+#include <MultiThreading/MechanicalTaskGraph.h>
+
+#include <sofa/simulation/DefaultAnimationLoop.h>
+#include <sofa/simulation/ThreadAffinity.h>
+
+
+namespace sofa
+{
+
+namespace simulation
+{
+
+    class TaskScheduler;
+
+
+/**
+ *  \brief Same steps as the DefaultAnimationLoop, the AnimateVisitor being replaced by a MechanicalTaskGraph.
+ *
+ *  Independent mechanical subsystems (subtrees with their own solver, not coupled by
+ *  mappings, interaction force fields or constraints) are integrated concurrently on the TaskScheduler.
+ *  Interaction force fields between subsystems, declared above their solvers, are joins of the graph.
+ *  As with the DefaultAnimationLoop, the collision pipelines below a node with a solver are not run:
+ *  a warning is emitted at init.
+ */
+class SOFA_MULTITHREADING_PLUGIN_API TaskGraphAnimationLoop : public DefaultAnimationLoop
+{
+public:
+    typedef DefaultAnimationLoop Inherit;
+    SOFA_CLASS(TaskGraphAnimationLoop, DefaultAnimationLoop);
+
+    Data<std::string> schedulerName; ///< name of the scheduler to use
+    Data<unsigned int> threadNumber; ///< number of threads (0: number of physical cores)
+    Data<std::string> d_threadAffinity; ///< placement of the threads on the cpus (see ThreadAffinity)
+    Data<bool> d_parallel; ///< run the graph on the task scheduler, sequentially otherwise
+    Data<unsigned int> d_nbSubsystems; ///< output: number of independent mechanical subsystems at the last step
+    Data<unsigned int> d_nbItems; ///< output: number of items in the task graph at the last step
+
+protected:
+    TaskGraphAnimationLoop(simulation::Node* gnode = nullptr);
+
+    ~TaskGraphAnimationLoop() override;
+
+public:
+    void init() override;
+
+    void bwdInit() override;
+
+    void reinit() override;
+
+    void cleanup() override;
+
+protected:
+
+    /// the AnimateVisitor is replaced by the task graph
+    void animate(const core::ExecParams* params, SReal dt) override;
+
+private:
+
+    MechanicalTaskGraph m_taskGraph;
+
+    TaskScheduler* m_taskScheduler;
+};
+
+} // namespace simulation
+
+} // namespace sofa
+
+#endif  /* SOFA_SIMULATION_TASKGRAPHANIMATIONLOOP_H */
@@ -0,0 +1,362 @@
+/******************************************************************************
+*                 SOFA, Simulation Open-Framework Architecture                *
+*                    (c) 2006 INRIA, USTL, UJF, CNRS, MGH                     *
+*                                                                             *
+* This program is free software; you can redistribute it and/or modify it     *
+* under the terms of the GNU Lesser General Public License as published by    *
+* the Free Software Foundation; either version 2.1 of the License, or (at     *
+* your option) any later version.                                             *
+*                                                                             *
+* This program is distributed in the hope that it will be useful, but WITHOUT *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License *
+* for more details.                                                           *
+*                                                                             *
+* You should have received a copy of the GNU Lesser General Public License    *
+* along with this program. If not, see <http://www.gnu.org/licenses/>.        *
+*******************************************************************************
+* Authors: The SOFA Team and external contributors (see Authors.txt)          *
+*                                                                             *
+* Contact information: contact@sofa-framework.org                             *
+******************************************************************************/
+#include <MultiThreading/TaskVisitorScheduler.h>
+
+#include <sofa/simulation/TaskScheduler.h>
+#include <sofa/simulation/InitTasks.h>
+#include <sofa/simulation/ParallelForEach.h>
+#include <sofa/simulation/MechanicalVisitor.h>
+#include <sofa/simulation/AnimateBeginEvent.h>
+#include <sofa/simulation/Node.h>
+#include <sofa/core/ObjectFactory.h>
+#include <sofa/core/BaseMapping.h>
+#include <sofa/core/behavior/BaseMechanicalState.h>
+#include <sofa/core/behavior/BaseInteractionForceField.h>
+#include <sofa/core/behavior/BaseInteractionConstraint.h>
+#include <sofa/core/behavior/BaseInteractionProjectiveConstraintSet.h>
+#include <sofa/helper/cast.h>
+
+#include <algorithm>
+
+
+namespace sofa
+{
+
+namespace simulation
+{
+
+int TaskVisitorSchedulerClass = core::RegisterObject("Visitor scheduler traversing the independent sibling subtrees in parallel")
+        .add< TaskVisitorScheduler >()
+        ;
+
+
+TaskVisitorScheduler::TaskVisitorScheduler()
+    : Inherit(false)
+    , schedulerName(initData(&schedulerName, "scheduler", "name of the scheduler to use"))
+    , threadNumber(initData(&threadNumber, (unsigned int)0, "threadNumber", "number of thread"))
+    , d_threadAffinity(initData(&d_threadAffinity, std::string("none"), "threadAffinity", simulation::ThreadAffinity::DataHelp))
+    , d_parallel(initData(&d_parallel, true, "parallel", "traverse the independent sibling subtrees in parallel"))
+    , m_dirty(true)
+    , m_nbRunning(0)
+    , m_listener(this)
+    , m_root(nullptr)
+    , m_taskScheduler(nullptr)
+{
+    // the subtree analysis is refreshed at each time step
+    this->f_listening.setValue(true);
+}
+
+TaskVisitorScheduler::~TaskVisitorScheduler()
+{
+}
+
+void TaskVisitorScheduler::init()
+{
+    Inherit::init();
+
+    m_taskScheduler = TaskScheduler::getInstance();
+
+    if (TaskScheduler::getCurrentName() != schedulerName.getValue())
+    {
+        m_taskScheduler = TaskScheduler::create(schedulerName.getValue().c_str());
+    }
+    m_taskScheduler->setThreadAffinity(simulation::ThreadAffinity::readData(this, d_threadAffinity.getValue()));
+    m_taskScheduler->init(threadNumber.getValue());
+
+    if (m_root == nullptr)
+    {
+        m_root = down_cast<Node>(this->getContext()->getRootContext()->toBaseNode());
+        m_root->addListener(&m_listener);
+    }
+    m_dirty = true;
+}
+
+void TaskVisitorScheduler::bwdInit()
+{
+    initThreadLocalData();
+}
+
+void TaskVisitorScheduler::reinit()
+{
+    // the threads are restarted if their number or their placement changed
+    m_taskScheduler->setThreadAffinity(simulation::ThreadAffinity::readData(this, d_threadAffinity.getValue()));
+    m_taskScheduler->init(threadNumber.getValue());
+    initThreadLocalData();
+}
+
+void TaskVisitorScheduler::cleanup()
+{
+    if (m_root != nullptr)
+    {
+        m_root->removeListener(&m_listener);
+        m_root = nullptr;
+    }
+    m_nodeInfos.clear();
+    m_dirty = true;
+}
+
+void TaskVisitorScheduler::handleEvent(sofa::core::objectmodel::Event* event)
+{
+    // links between components may change without modifying the graph (e.g. contacts)
+    if (sofa::simulation::AnimateBeginEvent::checkEventType(event))
+    {
+        m_dirty = true;
+    }
+}
+
+bool TaskVisitorScheduler::hasParallelChildren(Node* node)
+{
+    if (!updateNodeInfos()) return false;
+    auto info = m_nodeInfos.find(node);
+    const bool parallelChildren = info != m_nodeInfos.end() && info->second.parallelChildren;
+    --m_nbRunning;
+    return parallelChildren;
+}
+
+ParallelVisitorScheduler* TaskVisitorScheduler::clone()
+{
+    TaskVisitorScheduler* scheduler = new TaskVisitorScheduler();
+    scheduler->schedulerName.setValue(schedulerName.getValue());
+    scheduler->threadNumber.setValue(threadNumber.getValue());
+    scheduler->d_threadAffinity.setValue(d_threadAffinity.getValue());
+    scheduler->d_parallel.setValue(d_parallel.getValue());
+    return scheduler;
+}
+
+void TaskVisitorScheduler::executeParallelVisitor(Node* node, Visitor* action)
+{
+    if (m_taskScheduler == nullptr || !d_parallel.getValue() || m_taskScheduler->getThreadCount() < 2
+        || dynamic_cast<BaseMechanicalVisitor*>(action) == nullptr || !updateNodeInfos())
+    {
+        doExecuteVisitor(node, action);
+        return;
+    }
+
+    auto info = m_nodeInfos.find(node);
+    if (info == m_nodeInfos.end() || !info->second.tree)
+    {
+        // unknown node or multiple parents: the DAG traversal order is required
+        --m_nbRunning;
+        doExecuteVisitor(node, action);
+        return;
+    }
+
+    // the traversal was registered by updateNodeInfos
+    CactusStackStorage storage;
+    std::vector<Node*> executedNodes;
+    traverse(node, action, &storage, executedNodes);
+    for (auto it = executedNodes.rbegin(); it != executedNodes.rend(); ++it)
+    {
+        action->processNodeBottomUp(*it, &storage);
+    }
+    --m_nbRunning;
+}
+
+void TaskVisitorScheduler::traverse(Node* node, Visitor* action, CactusStackStorage* storage, std::vector<Node*>& executedNodes)
+{
+    if (!node->isActive()) return;
+    if (node->isSleeping() && !action->canAccessSleepingNode) return;
+
+    const Visitor::Result result = action->processNodeTopDown(node, storage);
+    executedNodes.push_back(node);
+    if (result == Visitor::RESULT_PRUNE) return;
+
+    std::vector<Node*> children;
+    children.reserve(node->child.size());
+    for (const auto& child : node->child)
+    {
+        children.push_back(child.get());
+    }
+    if (action->childOrderReversed(node))
+    {
+        std::reverse(children.begin(), children.end());
+    }
+
+    auto info = m_nodeInfos.find(node);
+    if (children.size() < 2 || info == m_nodeInfos.end() || !info->second.parallelChildren)
+    {
+        for (Node* child : children)
+        {
+            traverse(child, action, storage, executedNodes);
+        }
+        return;
+    }
+
+    // each child gets its own stack for the node-specific data, chained to the one of its parent
+    std::vector<CactusStackStorage> storages(children.size());
+    std::vector<char> executed(children.size(), 0);
+    parallelForEach(*m_taskScheduler, Range<std::size_t>(0, children.size()), 1, [&](std::size_t i)
+    {
+        storages[i].setParent(storage);
+        std::vector<Node*> subtreeNodes;
+        traverse(children[i], action, &storages[i], subtreeNodes);
+        if (subtreeNodes.empty()) return;
+
+        // bottom-up of the subtree, except its root which may write in the parent
+        for (std::size_t n = subtreeNodes.size() - 1; n > 0; --n)
+        {
+            action->processNodeBottomUp(subtreeNodes[n], &storages[i]);
+        }
+        executed[i] = 1;
+    });
+
+    for (std::size_t i = children.size(); i > 0; --i)
+    {
+        if (executed[i - 1])
+        {
+            action->processNodeBottomUp(children[i - 1], &storages[i - 1]);
+        }
+    }
+}
+
+bool TaskVisitorScheduler::updateNodeInfos()
+{
+    std::lock_guard<std::mutex> lock(m_analysisMutex);
+    if (m_dirty)
+    {
+        // the graph changed during a parallel traversal: cannot update the infos read by other threads
+        if (m_nbRunning > 0) return false;
+
+        m_nodeInfos.clear();
+        StateList states, references;
+        analyseSubtree(static_cast<Node*>(this->getContext()), states, references);
+        m_dirty = false;
+    }
+    ++m_nbRunning;
+    return true;
+}
+
+void TaskVisitorScheduler::analyseSubtree(Node* node, StateList& states, StateList& references)
+{
+    NodeInfo info;
+    bool independentChildren = true;
+    std::vector<StateList> subtreeStates;
+    subtreeStates.reserve(node->child.size());
+
+    for (const auto& child : node->child)
+    {
+        Node* c = child.get();
+        StateList childStates, childReferences;
+        analyseSubtree(c, childStates, childReferences);
+
+        info.tree = info.tree && m_nodeInfos[c].tree && c->getParents().size() == 1;
+
+        // a subtree is independent if its components only reference its own states
+        std::sort(childStates.begin(), childStates.end());
+        for (auto state : childReferences)
+        {
+            if (state != nullptr && !std::binary_search(childStates.begin(), childStates.end(), state))
+            {
+                independentChildren = false;
+            }
+        }
+
+        // the mapping of the child may read the states of the parent, which are processed before the children,
+        // but not the states of its siblings (checked below), which are processed at the same time
+        if (c->mechanicalMapping != nullptr)
+        {
+            for (auto state : c->mechanicalMapping->getMechFrom())
+            {
+                childReferences.push_back(state);
+            }
+        }
+
+        states.insert(states.end(), childStates.begin(), childStates.end());
+        references.insert(references.end(), childReferences.begin(), childReferences.end());
+        subtreeStates.push_back(std::move(childStates));
+    }
+
+    // e.g. a multimapping whose inputs are the states of sibling subtrees
+    for (std::size_t i = 0; i < node->child.size() && independentChildren; ++i)
+    {
+        Node* c = node->child[i].get();
+        if (c->mechanicalMapping == nullptr) continue;
+        for (auto state : c->mechanicalMapping->getMechFrom())
+        {
+            if (state == nullptr || state == c->mechanicalState) continue;
+            for (std::size_t j = 0; j < subtreeStates.size(); ++j)
+            {
+                if (j != i && std::binary_search(subtreeStates[j].begin(), subtreeStates[j].end(), state))
+                {
+                    independentChildren = false;
+                }
+            }
+        }
+    }
+
+    info.parallelChildren = info.tree && independentChildren && node->child.size() > 1;
+
+    if (node->mechanicalState != nullptr)
+    {
+        states.push_back(node->mechanicalState);
+    }
+
+    for (auto ff : node->interactionForceField)
+    {
+        references.push_back(ff->getMechModel1());
+        references.push_back(ff->getMechModel2());
+    }
+
+    for (auto constraint : node->constraintSet)
+    {
+        if (auto interaction = dynamic_cast<core::behavior::BaseInteractionConstraint*>(constraint))
+        {
+            references.push_back(interaction->getMechModel1());
+            references.push_back(interaction->getMechModel2());
+        }
+    }
+
+    for (auto constraint : node->projectiveConstraintSet)
+    {
+        if (auto interaction = dynamic_cast<core::behavior::BaseInteractionProjectiveConstraintSet*>(constraint))
+        {
+            references.push_back(interaction->getMechModel1());
+            references.push_back(interaction->getMechModel2());
+        }
+    }
+
+    m_nodeInfos[node] = info;
+}
+
+void TaskVisitorScheduler::GraphListener::onEndAddChild(Node*, Node*)
+{
+    m_scheduler->m_dirty = true;
+}
+
+void TaskVisitorScheduler::GraphListener::onEndRemoveChild(Node*, Node*)
+{
+    m_scheduler->m_dirty = true;
+}
+
+void TaskVisitorScheduler::GraphListener::onEndAddObject(Node*, core::objectmodel::BaseObject*)
+{
+    m_scheduler->m_dirty = true;
+}
+
+void TaskVisitorScheduler::GraphListener::onEndRemoveObject(Node*, core::objectmodel::BaseObject*)
+{
+    m_scheduler->m_dirty = true;
+}
+
+} // namespace simulation
+
+} // namespace sofa
@@ -0,0 +1,146 @@
+/******************************************************************************
+*                 SOFA, Simulation Open-Framework Architecture                *
+*                    (c) 2006 INRIA, USTL, UJF, CNRS, MGH                     *
+*                                                                             *
+* This program is free software; you can redistribute it and/or modify it     *
+* under the terms of the GNU Lesser General Public License as published by    *
+* the Free Software Foundation; either version 2.1 of the License, or (at     *
+* your option) any later version.                                             *
+*                                                                             *
+* This program is distributed in the hope that it will be useful, but WITHOUT *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License *
+* for more details.                                                           *
+*                                                                             *
+* You should have received a copy of the GNU Lesser General Public License    *
+* along with this program. If not, see <http://www.gnu.org/licenses/>.        *
+*******************************************************************************
+* Authors: The SOFA Team and external contributors (see Authors.txt)          *
+*                                                                             *
+* Contact information: contact@sofa-framework.org                             *
+******************************************************************************/
+#ifndef SOFA_SIMULATION_TASKVISITORSCHEDULER_H
+#define SOFA_SIMULATION_TASKVISITORSCHEDULER_H
+
+#include <MultiThreading/config.h>
+
+#include <sofa/simulation/ParallelVisitorScheduler.h>
+#include <sofa/simulation/MutationListener.h>
+#include <sofa/simulation/CactusStackStorage.h>
+#include <sofa/simulation/ThreadAffinity.h>
+#include <sofa/core/objectmodel/Data.h>
+
+#include <atomic>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+
+namespace sofa
+{
+
+namespace simulation
+{
+
+    class TaskScheduler;
+
+
+/**
+ *  \brief VisitorScheduler traversing the independent sibling subtrees in parallel on the TaskScheduler.
+ *
+ *  Added to a node, it executes the thread-safe mechanical visitors started from this node and its descendants.
+ *  The children of a node are traversed in parallel when their subtrees are independent: no node with several parents,
+ *  and no mapping, interaction force field or interaction constraint referencing a state outside of the subtree.
+ *  The bottom-up callback of each child, which may write in the parent (e.g. applyJT of its mapping), is executed
+ *  sequentially after the parallel traversals, in the sequential order.
+ *  Reductions (dot products) are accumulated per subtree using the node-specific data of the mechanical visitors.
+ *  Other visitors, and graphs with multiple parents, are executed sequentially.
+ */
+class SOFA_MULTITHREADING_PLUGIN_API TaskVisitorScheduler : public ParallelVisitorScheduler
+{
+public:
+    typedef ParallelVisitorScheduler Inherit;
+    SOFA_CLASS(TaskVisitorScheduler, ParallelVisitorScheduler);
+
+    Data<std::string> schedulerName; ///< name of the scheduler to use
+    Data<unsigned int> threadNumber; ///< number of threads (0: number of physical cores)
+    Data<std::string> d_threadAffinity; ///< placement of the threads on the cpus (see ThreadAffinity)
+    Data<bool> d_parallel; ///< traverse the independent subtrees in parallel, sequentially otherwise
+
+protected:
+    TaskVisitorScheduler();
+
+    ~TaskVisitorScheduler() override;
+
+public:
+    void init() override;
+
+    void bwdInit() override;
+
+    void reinit() override;
+
+    void cleanup() override;
+
+    void handleEvent(sofa::core::objectmodel::Event* event) override;
+
+    /// Whether the children of node are traversed in parallel, according to the current graph
+    bool hasParallelChildren(Node* node);
+
+protected:
+
+    ParallelVisitorScheduler* clone() override;
+
+    void executeParallelVisitor(Node* node, Visitor* action) override;
+
+private:
+
+    struct NodeInfo
+    {
+        /// no node with several parents in the subtree
+        bool tree = true;
+        /// the subtrees of the children can be traversed concurrently
+        bool parallelChildren = false;
+    };
+
+    /// Invalidates the subtree analysis when the graph changes
+    class GraphListener : public MutationListener
+    {
+    public:
+        GraphListener(TaskVisitorScheduler* scheduler) : m_scheduler(scheduler) {}
+
+        void onEndAddChild(Node* parent, Node* child) override;
+        void onEndRemoveChild(Node* parent, Node* child) override;
+        void onEndAddObject(Node* parent, core::objectmodel::BaseObject* object) override;
+        void onEndRemoveObject(Node* parent, core::objectmodel::BaseObject* object) override;
+
+    private:
+        TaskVisitorScheduler* m_scheduler;
+    };
+
+    typedef std::vector<core::behavior::BaseMechanicalState*> StateList;
+
+    /// Recompute the node infos if the graph changed, and register a parallel traversal using them
+    /// (to end by decrementing m_nbRunning). Returns false if they are not valid.
+    bool updateNodeInfos();
+
+    /// Fill the infos of the subtree of node, with the states it contains and the states its components reference
+    void analyseSubtree(Node* node, StateList& states, StateList& references);
+
+    void traverse(Node* node, Visitor* action, CactusStackStorage* storage, std::vector<Node*>& executedNodes);
+
+    std::unordered_map<Node*, NodeInfo> m_nodeInfos;
+    std::atomic<bool> m_dirty;
+    std::atomic<int> m_nbRunning;
+    std::mutex m_analysisMutex;
+
+    GraphListener m_listener;
+    Node* m_root;
+
+    TaskScheduler* m_taskScheduler;
+};
+
+} // namespace simulation
+
+} // namespace sofa
+
+#endif  /* SOFA_SIMULATION_TASKVISITORSCHEDULER_H */
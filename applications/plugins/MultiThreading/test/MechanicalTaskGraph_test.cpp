@@ -0,0 +1,241 @@
+/******************************************************************************
+*                 SOFA, Simulation Open-Framework Architecture                *
+*                    (c) 2006 INRIA, USTL, UJF, CNRS, MGH                     *
+*                                                                             *
+* This program is free software; you can redistribute it and/or modify it     *
+* under the terms of the GNU Lesser General Public License as published by    *
+* the Free Software Foundation; either version 2.1 of the License, or (at     *
+* your option) any later version.                                             *
+*                                                                             *
+* This program is distributed in the hope that it will be useful, but WITHOUT *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License *
+* for more details.                                                           *
+*                                                                             *
+* You should have received a copy of the GNU Lesser General Public License    *
+* along with this program. If not, see <http://www.gnu.org/licenses/>.        *
+*******************************************************************************
+* Authors: The SOFA Team and external contributors (see Authors.txt)          *
+*                                                                             *
+* Contact information: contact@sofa-framework.org                             *
+******************************************************************************/
+#include <MultiThreading/MechanicalTaskGraph.h>
+
+#include <SofaBase/initSofaBase.h>
+#include <SofaBoundaryCondition/initSofaBoundaryCondition.h>
+#include <SofaDeformable/initSofaDeformable.h>
+#include <SofaImplicitOdeSolver/initSofaImplicitOdeSolver.h>
+#include <SofaSimulationGraph/SimpleApi.h>
+#include <sofa/core/ExecParams.h>
+#include <sofa/core/behavior/BaseMechanicalState.h>
+#include <sofa/core/collision/Pipeline.h>
+#include <sofa/simulation/DefaultTaskScheduler.h>
+#include <sofa/testing/BaseTest.h>
+#include <sofa/testing/TestMessageHandler.h>
+
+namespace sofa
+{
+
+using namespace simpleapi;
+using simulation::MechanicalTaskGraph;
+
+namespace
+{
+
+/// Subsystems made of a chain of particles linked by springs, each one with its own solver
+class MechanicalTaskGraph_test : public testing::BaseTest
+{
+public:
+
+    void onSetUp() override
+    {
+        component::initSofaBase();
+        component::initSofaImplicitOdeSolver();
+        component::initSofaDeformable();
+        component::initSofaBoundaryCondition();
+        m_simulation = createSimulation("DAG");
+        simulation::setSimulation(m_simulation.get());
+    }
+
+    void onTearDown() override
+    {
+        for (auto& root : m_roots)
+        {
+            m_simulation->unload(root);
+        }
+    }
+
+    NodeSPtr createScene()
+    {
+        NodeSPtr root = createRootNode(m_simulation, "root", {{"gravity", "0 -9.81 0"}, {"dt", "0.01"}});
+        m_roots.push_back(root);
+        return root;
+    }
+
+    NodeSPtr createSubsystem(NodeSPtr root, const std::string& name, double x)
+    {
+        NodeSPtr node = createChild(root, name);
+        createObject(node, "EulerImplicitSolver", {{"rayleighStiffness", "0.1"}, {"rayleighMass", "0.1"}});
+        createObject(node, "CGLinearSolver", {{"iterations", "25"}, {"tolerance", "1e-09"}, {"threshold", "1e-09"}});
+        createObject(node, "MechanicalObject", {{"name", "dofs"}, {"template", "Vec3d"},
+                                                {"position", str(x) + " 0 0  " + str(x) + " 1 0  " + str(x) + " 2 0"}});
+        createObject(node, "UniformMass", {{"totalMass", "1"}});
+        createObject(node, "FixedConstraint", {{"indices", "2"}});
+        createObject(node, "StiffSpringForceField", {{"object1", "@dofs"}, {"object2", "@dofs"},
+                                                     {"spring", "0 1 100 0.1 1  1 2 100 0.1 1"}});
+        return node;
+    }
+
+    /// four independent subsystems
+    NodeSPtr createSubsystems()
+    {
+        NodeSPtr root = createScene();
+        for (int i = 0; i < 4; ++i)
+        {
+            createSubsystem(root, "subsystem" + str(i), 2.0 * i);
+        }
+        return root;
+    }
+
+    void init(NodeSPtr root)
+    {
+        m_simulation->init(root.get());
+    }
+
+    /// index of the integration item of a subsystem
+    static std::size_t getIntegration(const MechanicalTaskGraph& graph, NodeSPtr root, const std::string& name)
+    {
+        for (std::size_t i = 0; i < graph.getNbItems(); ++i)
+        {
+            const MechanicalTaskGraph::Item& item = graph.getItem(i);
+            if (item.type == MechanicalTaskGraph::Integration && item.node == root->getChild(name))
+            {
+                return i;
+            }
+        }
+        ADD_FAILURE() << "no integration of " << name;
+        return 0;
+    }
+
+    simulation::Simulation::SPtr m_simulation;
+    std::vector<NodeSPtr> m_roots;
+};
+
+TEST_F(MechanicalTaskGraph_test, independentSubsystems)
+{
+    NodeSPtr root = createSubsystems();
+    init(root);
+
+    MechanicalTaskGraph graph;
+    graph.build(root.get(), 0.01);
+    EXPECT_EQ(graph.getNbSubsystems(), 4u);
+    EXPECT_EQ(graph.getNbItems(), 4u);
+    EXPECT_EQ(graph.getNbRoots(), 4u);
+}
+
+TEST_F(MechanicalTaskGraph_test, collisionPipelineBelowSolver)
+{
+    NodeSPtr root = createScene();
+    createObject(root, "DefaultPipeline", {{"name", "pipeline"}});
+    NodeSPtr subsystem = createSubsystem(root, "subsystem0", 0.0);
+    createObject(subsystem, "DefaultPipeline", {{"name", "solverPipeline"}});
+    NodeSPtr collision = createChild(subsystem, "collision");
+    createObject(collision, "DefaultPipeline", {{"name", "ignored"}});
+
+    // the pipeline of the node with the solver is an item of the graph, not the one below
+    const std::vector<core::collision::Pipeline*> pipelines = MechanicalTaskGraph::getIgnoredCollisionPipelines(root.get());
+    ASSERT_EQ(pipelines.size(), 1u);
+    EXPECT_EQ(pipelines[0]->getName(), "ignored");
+
+    createObject(root, "TaskGraphAnimationLoop", {{"threadNumber", "2"}});
+    EXPECT_MSG_EMIT(Warning);
+    init(root);
+}
+
+TEST_F(MechanicalTaskGraph_test, interactionForceFieldIsAJoin)
+{
+    // declared above the solvers: the coupled subsystems are integrated after it, the others do not wait
+    NodeSPtr root = createSubsystems();
+    createObject(root, "StiffSpringForceField", {{"object1", "@subsystem2/dofs"}, {"object2", "@subsystem3/dofs"},
+                                                 {"spring", "0 0 100 0.1 2"}});
+    init(root);
+
+    MechanicalTaskGraph graph;
+    graph.build(root.get(), 0.01);
+    EXPECT_EQ(graph.getNbSubsystems(), 4u);
+    ASSERT_EQ(graph.getNbItems(), 5u);
+    EXPECT_EQ(graph.getNbRoots(), 3u);
+
+    const MechanicalTaskGraph::Item& join = graph.getItem(0);
+    EXPECT_EQ(join.type, MechanicalTaskGraph::InteractionForceField);
+    EXPECT_EQ(join.successors.size(), 2u);
+    EXPECT_EQ(graph.getItem(getIntegration(graph, root, "subsystem2")).nbPredecessors, 1u);
+    EXPECT_EQ(graph.getItem(getIntegration(graph, root, "subsystem3")).nbPredecessors, 1u);
+    EXPECT_EQ(graph.getItem(getIntegration(graph, root, "subsystem0")).nbPredecessors, 0u);
+}
+
+TEST_F(MechanicalTaskGraph_test, coupledSubsystemsAreMerged)
+{
+    // an interaction inside the subtree of a solver: both subsystems must be solved sequentially
+    NodeSPtr root = createSubsystems();
+    createObject(root->getChild("subsystem0"), "StiffSpringForceField", {{"object1", "@dofs"}, {"object2", "@../subsystem1/dofs"},
+                                                                          {"spring", "0 0 100 0.1 2"}});
+    init(root);
+
+    MechanicalTaskGraph graph;
+    graph.build(root.get(), 0.01);
+    EXPECT_EQ(graph.getNbSubsystems(), 3u);
+    EXPECT_EQ(graph.getNbItems(), 4u);
+    EXPECT_EQ(graph.getNbRoots(), 3u);
+
+    const std::size_t first = getIntegration(graph, root, "subsystem0");
+    const std::size_t second = getIntegration(graph, root, "subsystem1");
+    ASSERT_EQ(graph.getItem(first).successors.size(), 1u);
+    EXPECT_EQ(graph.getItem(first).successors[0], second);
+}
+
+TEST_F(MechanicalTaskGraph_test, parallelMatchesSequential)
+{
+    NodeSPtr roots[2];
+    for (NodeSPtr& root : roots)
+    {
+        root = createSubsystems();
+        createObject(root, "StiffSpringForceField", {{"object1", "@subsystem2/dofs"}, {"object2", "@subsystem3/dofs"},
+                                                     {"spring", "0 0 100 0.1 2"}});
+        init(root);
+    }
+
+    simulation::TaskScheduler* scheduler = simulation::TaskScheduler::create(simulation::DefaultTaskScheduler::name());
+    scheduler->init(4);
+
+    const core::ExecParams* params = core::ExecParams::defaultInstance();
+    MechanicalTaskGraph sequential, parallel;
+    for (int step = 0; step < 10; ++step)
+    {
+        sequential.build(roots[0].get(), 0.01);
+        sequential.executeSequential(params, 0.01);
+        parallel.build(roots[1].get(), 0.01);
+        parallel.execute(scheduler, params, 0.01);
+    }
+    scheduler->stop();
+
+    // each subsystem is integrated by the same operations, in the same order
+    for (int i = 0; i < 4; ++i)
+    {
+        core::behavior::BaseMechanicalState* expected = roots[0]->getChild("subsystem" + str(i))->getMechanicalState();
+        core::behavior::BaseMechanicalState* state = roots[1]->getChild("subsystem" + str(i))->getMechanicalState();
+        ASSERT_EQ(state->getSize(), expected->getSize());
+        for (Size p = 0; p < state->getSize(); ++p)
+        {
+            EXPECT_EQ(state->getPX(p), expected->getPX(p));
+            EXPECT_EQ(state->getPY(p), expected->getPY(p));
+            EXPECT_EQ(state->getPZ(p), expected->getPZ(p));
+        }
+        // the particles are falling
+        EXPECT_LT(state->getPY(0), 0.0);
+    }
+}
+
+} // namespace
+
+} // namespace sofa
@@ -0,0 +1,154 @@
+/******************************************************************************
+*                 SOFA, Simulation Open-Framework Architecture                *
+*                    (c) 2006 INRIA, USTL, UJF, CNRS, MGH                     *
+*                                                                             *
+* This program is free software; you can redistribute it and/or modify it     *
+* under the terms of the GNU Lesser General Public License as published by    *
+* the Free Software Foundation; either version 2.1 of the License, or (at     *
+* your option) any later version.                                             *
+*                                                                             *
+* This program is distributed in the hope that it will be useful, but WITHOUT *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License *
+* for more details.                                                           *
+*                                                                             *
+* You should have received a copy of the GNU Lesser General Public License    *
+* along with this program. If not, see <http://www.gnu.org/licenses/>.        *
+*******************************************************************************
+* Authors: The SOFA Team and external contributors (see Authors.txt)          *
+*                                                                             *
+* Contact information: contact@sofa-framework.org                             *
+******************************************************************************/
+#include <MultiThreading/TaskVisitorScheduler.h>
+
+#include <SofaBase/initSofaBase.h>
+#include <SofaBoundaryCondition/initSofaBoundaryCondition.h>
+#include <SofaDeformable/initSofaDeformable.h>
+#include <SofaImplicitOdeSolver/initSofaImplicitOdeSolver.h>
+#include <SofaMiscMapping/initSofaMiscMapping.h>
+#include <SofaSimulationGraph/SimpleApi.h>
+#include <sofa/simulation/Node.h>
+#include <sofa/core/behavior/BaseMechanicalState.h>
+#include <sofa/testing/BaseTest.h>
+
+namespace sofa
+{
+
+using namespace simpleapi;
+using simulation::TaskVisitorScheduler;
+
+namespace
+{
+
+/// Chains of particles linked by springs, integrated by a single solver at the root
+class TaskVisitorScheduler_test : public testing::BaseTest
+{
+public:
+
+    void onSetUp() override
+    {
+        component::initSofaBase();
+        component::initSofaImplicitOdeSolver();
+        component::initSofaDeformable();
+        component::initSofaBoundaryCondition();
+        component::initSofaMiscMapping();
+        m_simulation = createSimulation("DAG");
+        simulation::setSimulation(m_simulation.get());
+    }
+
+    void onTearDown() override
+    {
+        for (auto& root : m_roots)
+        {
+            m_simulation->unload(root);
+        }
+    }
+
+    /// two chains, and optionally a node mapped from both chains by a multimapping, with a spring between its points
+    NodeSPtr createScene(bool parallel, bool multiMapping)
+    {
+        NodeSPtr root = createRootNode(m_simulation, "root", {{"gravity", "0 -9.81 0"}, {"dt", "0.01"}});
+        m_roots.push_back(root);
+        createObject(root, "TaskVisitorScheduler", {{"name", "visitorScheduler"}, {"threadNumber", "4"}, {"parallel", parallel ? "1" : "0"}});
+        createObject(root, "EulerImplicitSolver", {{"rayleighStiffness", "0.1"}, {"rayleighMass", "0.1"}});
+        createObject(root, "CGLinearSolver", {{"iterations", "100"}, {"tolerance", "1e-12"}, {"threshold", "1e-30"}});
+        for (int i = 0; i < 2; ++i)
+        {
+            NodeSPtr chain = createChild(root, "chain" + str(i));
+            const std::string x = str(2.0 * i);
+            createObject(chain, "MechanicalObject", {{"name", "dofs"}, {"template", "Vec3d"},
+                                                     {"position", x + " 0 0  " + x + " 1 0  " + x + " 2 0"}});
+            createObject(chain, "UniformMass", {{"totalMass", "1"}});
+            createObject(chain, "FixedConstraint", {{"indices", "2"}});
+            createObject(chain, "StiffSpringForceField", {{"object1", "@dofs"}, {"object2", "@dofs"},
+                                                          {"spring", "0 1 100 0.1 1  1 2 100 0.1 1"}});
+        }
+        if (multiMapping)
+        {
+            NodeSPtr coupling = createChild(root, "coupling");
+            createObject(coupling, "MechanicalObject", {{"name", "dofs"}, {"template", "Vec3d"}});
+            createObject(coupling, "SubsetMultiMapping", {{"template", "Vec3d,Vec3d"}, {"input", "@../chain0/dofs @../chain1/dofs"},
+                                                          {"output", "@dofs"}, {"indexPairs", "0 0  1 0"}});
+            createObject(coupling, "StiffSpringForceField", {{"object1", "@dofs"}, {"object2", "@dofs"},
+                                                             {"spring", "0 1 200 0.1 1.5"}});
+        }
+        m_simulation->init(root.get());
+        return root;
+    }
+
+    static TaskVisitorScheduler* getScheduler(NodeSPtr root)
+    {
+        TaskVisitorScheduler* scheduler = nullptr;
+        root->get(scheduler);
+        EXPECT_NE(scheduler, nullptr);
+        return scheduler;
+    }
+
+    /// positions of the chains after a few steps
+    std::vector<std::string> simulate(NodeSPtr root)
+    {
+        for (int i = 0; i < 10; ++i)
+        {
+            m_simulation->animate(root.get(), 0.01);
+        }
+        std::vector<std::string> positions;
+        for (int i = 0; i < 2; ++i)
+        {
+            core::behavior::BaseMechanicalState* dofs = nullptr;
+            root->getChild("chain" + str(i))->get(dofs);
+            EXPECT_NE(dofs, nullptr);
+            if (dofs) positions.push_back(dofs->findData("position")->getValueString());
+        }
+        return positions;
+    }
+
+    simulation::Simulation::SPtr m_simulation;
+    std::vector<NodeSPtr> m_roots;
+};
+
+TEST_F(TaskVisitorScheduler_test, independentChildren)
+{
+    NodeSPtr root = createScene(true, false);
+    TaskVisitorScheduler* scheduler = getScheduler(root);
+    ASSERT_NE(scheduler, nullptr);
+    EXPECT_TRUE(scheduler->hasParallelChildren(root.get()));
+
+    EXPECT_EQ(simulate(root), simulate(createScene(false, false)));
+}
+
+TEST_F(TaskVisitorScheduler_test, multiMappingFromSiblings)
+{
+    // the multimapping reads the states of the chains: the chains cannot be traversed at the same time as its node
+    NodeSPtr root = createScene(true, true);
+    TaskVisitorScheduler* scheduler = getScheduler(root);
+    ASSERT_NE(scheduler, nullptr);
+    EXPECT_FALSE(scheduler->hasParallelChildren(root.get()));
+
+    const std::vector<std::string> positions = simulate(root);
+    EXPECT_EQ(positions, simulate(createScene(false, true)));
+    EXPECT_NE(positions, simulate(createScene(false, false)));
+}
+
+} // namespace
+
+} // namespace sofa
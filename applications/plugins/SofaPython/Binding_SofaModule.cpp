@@ -909,6 +909,85 @@ static PyObject * Sofa_timerSetOutputType(PyObject* /*self*/, PyObject *args)
     Py_RETURN_NONE;
 }
 
+/**
+ * Method : Sofa_timerSetStatistics
+ * Desc   : Wrapper for python usage. Compute the rolling percentiles of the steps of the given timer over its last iterations (0 to remove them)
+ * Param  : PyObject*, self - Object of the python script
+ * Param  : PyObject*, args - given arguments to apply to the method
+ * Return : NULL
+ */
+static PyObject * Sofa_timerSetStatistics(PyObject* /*self*/, PyObject *args)
+{
+    char* id = nullptr;
+    int window = 0;
+
+    if(!PyArg_ParseTuple(args, "si", &id, &window))
+    {
+        return nullptr;
+    }
+
+    AdvancedTimer::setStatistics(id, static_cast<unsigned int>(std::max(window, 0)));
+
+    Py_RETURN_NONE;
+}
+
+
+/**
+ * Method : Sofa_timerGetStatistics
+ * Desc   : Wrapper for python usage. Return the rolling statistics of the given timer, in ms
+ * Param  : PyObject*, self - Object of the python script
+ * Param  : PyObject*, args - given arguments to apply to the method
+ * Return : list of dict, {'step', 'count', 'p50', 'p95', 'p99', 'max'} of the timer (TOTAL) then of each step
+ */
+static PyObject * Sofa_timerGetStatistics(PyObject* /*self*/, PyObject *args)
+{
+    char* id = nullptr;
+
+    if(!PyArg_ParseTuple(args, "s", &id))
+    {
+        return nullptr;
+    }
+
+    const sofa::helper::vector<sofa::helper::StepStatistics> statistics = AdvancedTimer::getStatistics(id);
+
+    PyObject* pyList = PyList_New(statistics.size());
+    for (std::size_t i = 0; i < statistics.size(); ++i)
+    {
+        const sofa::helper::StepStatistics& step = statistics[i];
+        PyObject* pyStep = Py_BuildValue("{s:s,s:n,s:d,s:d,s:d,s:d}",
+                                         "step", step.label.c_str(),
+                                         "count", static_cast<Py_ssize_t>(step.count),
+                                         "p50", step.p50, "p95", step.p95, "p99", step.p99,
+                                         "max", step.max);
+        PyList_SetItem(pyList, i, pyStep);
+    }
+    return pyList;
+}
+
+
+/**
+ * Method : Sofa_timerSetStatisticsFile
+ * Desc   : Wrapper for python usage. Write the rolling statistics of the given timer in a .csv or .json file every samplingInterval iterations
+ * Param  : PyObject*, self - Object of the python script
+ * Param  : PyObject*, args - given arguments to apply to the method
+ * Return : NULL
+ */
+static PyObject * Sofa_timerSetStatisticsFile(PyObject* /*self*/, PyObject *args)
+{
+    char* id = nullptr;
+    char* fileName = nullptr;
+    int samplingInterval = 1;
+
+    if(!PyArg_ParseTuple(args, "ss|i", &id, &fileName, &samplingInterval))
+    {
+        return nullptr;
+    }
+
+    AdvancedTimer::setStatisticsFile(id, fileName, static_cast<unsigned int>(std::max(samplingInterval, 1)));
+
+    Py_RETURN_NONE;
+}
+
 static constexpr const char* addPluginRepository_DOC =
 R"DOC(
 Adds a plugin repository path.
@@ -968,4 +1047,7 @@ SP_MODULE_METHOD_DOC(Sofa, timerStepBegin, "Method : Sofa_timerStepBegin \nDesc
 SP_MODULE_METHOD_DOC(Sofa, timerStepEnd, "Method : Sofa_timerStepEnd \nDesc   : Wrapper for python usage. \nParam  : PyObject*, args - given arguments to apply to the method \nReturn : None")
 SP_MODULE_METHOD_DOC(Sofa, timerSetOutputType, "Method : Sofa_timerSetOutputType \nDesc   : Wrapper for python usage. \nParam  : PyObject*, self - Object of the python script \nParam  : PyObject*, args - given arguments to apply to the method \nReturn : None")
 SP_MODULE_METHOD_DOC(Sofa, timerEnd, "Method : Sofa_timerEnd \nDesc   : Wrapper for python usage. Used to change output type of the given timer \nParam  : PyObject*, self - Object of the python script \nParam  : PyObject*, args - given arguments to apply to the method \nReturn : return None")
+SP_MODULE_METHOD_DOC(Sofa, timerSetStatistics, "Method : Sofa_timerSetStatistics \nDesc   : Wrapper for python usage. Compute the rolling percentiles of the steps of the given timer over its last iterations (0 to remove them) \nParam  : PyObject*, self - Object of the python script \nParam  : PyObject*, args - given arguments to apply to the method \nReturn : None")
+SP_MODULE_METHOD_DOC(Sofa, timerGetStatistics, "Method : Sofa_timerGetStatistics \nDesc   : Wrapper for python usage. Return the rolling statistics of the given timer, in ms \nParam  : PyObject*, self - Object of the python script \nParam  : PyObject*, args - given arguments to apply to the method \nReturn : list of dict {'step', 'count', 'p50', 'p95', 'p99', 'max'}")
+SP_MODULE_METHOD_DOC(Sofa, timerSetStatisticsFile, "Method : Sofa_timerSetStatisticsFile \nDesc   : Wrapper for python usage. Write the rolling statistics of the given timer in a .csv or .json file every samplingInterval iterations \nParam  : PyObject*, self - Object of the python script \nParam  : PyObject*, args - given arguments to apply to the method \nReturn : None")
 SP_MODULE_METHODS_END
@@ -21,10 +21,24 @@
 ******************************************************************************/
 #include <iostream>
 #include <fstream>
+#include <sstream>
 #include <ctime>
+#include <map>
+#include <algorithm>
+#include <thread>
+#include <cstdlib>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <unistd.h>
+#include <sys/wait.h>
+#include <cerrno>
+#include <cstring>
+#define SOFABATCH_FORK
+#endif
 
-#include <sofa/helper/ArgumentParser.h>
 #include <sofa/helper/system/PluginManager.h>
+#include <SofaSimulationGraph/init.h>
+#include <SofaSimulationGraph/DAGSimulation.h>
 
 #include <SofaBase/initSofaBase.h>
 #include <SofaCommon/initSofaCommon.h>
@@ -36,6 +50,9 @@
 
 #include <sofa/helper/Factory.h>
 #include <sofa/helper/BackTrace.h>
+#include <sofa/simulation/ThreadAffinity.h>
+#include <sofa/simulation/Node.h>
+#include <sofa/core/behavior/BaseMechanicalState.h>
 #include <SofaExporter/WriteState.h>
 
 
@@ -49,23 +66,32 @@ using std::cout;
 // ---------------------------------------------------------------------
 
 
-void apply(std::string &input, unsigned int nbsteps, std::string &output)
+/// timings and final state of a simulation, for the farm summary
+struct SimulationResult
+{
+    double initTime = 0; ///< in s
+    double runTime = 0; ///< in s
+    double simulatedTime = 0;
+    std::size_t nbDofs = 0; ///< in all the mechanical states
+    SReal bboxMin[3] = { 0, 0, 0 }; ///< of the positions of all the mechanical states
+    SReal bboxMax[3] = { 0, 0, 0 };
+};
+
+sofa::simulation::Node::SPtr load(const std::string &input)
 {
-    cout<<"\n****SIMULATION*  (.scn:"<< input<<", #steps:"<<nbsteps<<", .simu:"<<output<<")"<<endl;
-
-    // --- Create simulation graph ---
     sofa::simulation::Node::SPtr groot = sofa::core::objectmodel::SPtr_dynamic_cast<sofa::simulation::Node>( sofa::simulation::getSimulation()->load(input.c_str()));
     if (groot==NULL)
     {
         groot = sofa::simulation::getSimulation()->createNewGraph("");
     }
+    return groot;
+}
 
-    if (!groot)
-    {
-        cerr << "Error, unable to access groot" << std::endl;
-        return;
-    }
-
+/// init the loaded scene, compute nbsteps time steps and save the states in the output .simu
+SimulationResult simulate(sofa::simulation::Node::SPtr groot, const std::string &input, unsigned int nbsteps, const std::string &output)
+{
+    SimulationResult result;
+    const sofa::simulation::Visitor::ctime_t t0 = sofa::helper::system::thread::CTime::getRefTime();
     sofa::simulation::getSimulation()->init(groot.get());
     groot->setAnimate(true);
 
@@ -75,11 +101,11 @@ void apply(std::string &input, unsigned int nbsteps, std::string &output)
     std::string mstate = outputdir + sofa::helper::system::SetDirectory::GetFileName(output.c_str());
 
     // --- Init Write state visitor ---
-    sofa::component::misc::WriteStateCreator visitor(sofa::core::ExecParams::defaultInstance());
+    sofa::component::misc::WriteStateCreator visitor(sofa::core::execparams::defaultInstance());
     visitor.setSceneName(mstate);
     visitor.execute(groot.get());
 
-    sofa::component::misc::WriteStateActivator v_write(sofa::core::ExecParams::defaultInstance(), true);
+    sofa::component::misc::WriteStateActivator v_write(sofa::core::execparams::defaultInstance(), true);
     v_write.execute(groot.get());
 
 
@@ -91,12 +117,30 @@ void apply(std::string &input, unsigned int nbsteps, std::string &output)
     sofa::simulation::Visitor::ctime_t tfreq = sofa::helper::system::thread::CTime::getTicksPerSec();
     sofa::simulation::Visitor::ctime_t rt = sofa::helper::system::thread::CTime::getRefTime();
     sofa::simulation::Visitor::ctime_t t = sofa::helper::system::thread::CTime::getFastTime();
+    result.initTime = ((double)(rt - t0))/((double)rtfreq); // init, state writers and first time step
     for (unsigned int i=0; i<nbsteps; i++)
         sofa::simulation::getSimulation()->animate(groot.get());
 
     t = sofa::helper::system::thread::CTime::getFastTime()-t;
     rt = sofa::helper::system::thread::CTime::getRefTime()-rt;
 
+    result.runTime = ((double)rt)/((double)rtfreq);
+    result.simulatedTime = groot->getTime();
+    std::vector<sofa::core::behavior::BaseMechanicalState*> mstates;
+    groot->getTreeObjects<sofa::core::behavior::BaseMechanicalState>(&mstates);
+    for (const sofa::core::behavior::BaseMechanicalState* mstate : mstates)
+    {
+        for (std::size_t i = 0; i < mstate->getSize(); ++i, ++result.nbDofs)
+        {
+            const SReal p[3] = { mstate->getPX(i), mstate->getPY(i), mstate->getPZ(i) };
+            for (int c = 0; c < 3; ++c)
+            {
+                if (result.nbDofs == 0 || p[c] < result.bboxMin[c]) result.bboxMin[c] = p[c];
+                if (result.nbDofs == 0 || p[c] > result.bboxMax[c]) result.bboxMax[c] = p[c];
+            }
+        }
+    }
+
     std::cout << nbsteps << " iterations done in "<< ((double)t)/((double)tfreq) << " s ( " << (((double)tfreq)*nbsteps)/((double)t) << " FPS)." << std::endl;
     std::cout << nbsteps << " iterations done in "<< ((double)rt)/((double)rtfreq) << " s ( " << (((double)rtfreq)*nbsteps)/((double)rt) << " FPS)." << std::endl;
 
@@ -115,46 +159,436 @@ void apply(std::string &input, unsigned int nbsteps, std::string &output)
         std::cout<<simulationFileName<<" file error\n";
     }
 
+    return result;
+}
+
+
+void apply(std::string &input, unsigned int nbsteps, std::string &output)
+{
+    cout<<"\n****SIMULATION*  (.scn:"<< input<<", #steps:"<<nbsteps<<", .simu:"<<output<<")"<<endl;
+
+    // --- Create simulation graph ---
+    sofa::simulation::Node::SPtr groot = load(input);
+
+    if (!groot)
+    {
+        cerr << "Error, unable to access groot" << std::endl;
+        return;
+    }
+
+    simulate(groot, input, nbsteps, output);
 
     sofa::simulation::getSimulation()->unload(groot);
 
     return;
 }
 
+// ---------------------------------------------------------------------
+// --- Farm mode: runs of scenes with Data overrides, over a pool of processes
+// ---------------------------------------------------------------------
+
+/// a line of the farm manifest: scene #steps output [path.data=value ...]
+struct FarmRun
+{
+    unsigned int index = 0;
+    std::string scene;
+    unsigned int nbsteps = 0;
+    std::string output;
+    std::vector< std::pair<std::string, std::string> > overrides;
+};
+
+/// split a manifest line in words, a double-quoted part being a single word (i.e. gravity="0 -9.81 0")
+std::vector<std::string> splitWords(const std::string& line)
+{
+    std::vector<std::string> words;
+    std::string word;
+    bool quoted = false, inWord = false;
+    for (char c : line)
+    {
+        if (c == '"')
+        {
+            quoted = !quoted;
+            inWord = true;
+        }
+        else if (!quoted && (c == ' ' || c == '\t' || c == '\r'))
+        {
+            if (inWord) words.push_back(word);
+            word.clear();
+            inWord = false;
+        }
+        else
+        {
+            word += c;
+            inWord = true;
+        }
+    }
+    if (inWord) words.push_back(word);
+    return words;
+}
+
+bool readManifest(const std::string& fileName, std::vector<FarmRun>& runs)
+{
+    std::ifstream manifest(fileName.c_str());
+    if (!manifest.is_open())
+    {
+        cerr << "Unable to read the farm manifest " << fileName << endl;
+        return false;
+    }
+
+    std::string line;
+    unsigned int lineNumber = 0;
+    while (std::getline(manifest, line))
+    {
+        ++lineNumber;
+        const std::vector<std::string> words = splitWords(line);
+        if (words.empty() || words[0][0] == '#' || words[0].compare(0, 2, "//") == 0)
+            continue;
+
+        FarmRun run;
+        run.index = unsigned(runs.size());
+        std::istringstream nbsteps(words.size() > 1 ? words[1] : std::string());
+        if (words.size() < 3 || !(nbsteps >> run.nbsteps))
+        {
+            cerr << fileName << ":" << lineNumber << ": expected: scene #steps output [path.data=value ...]" << endl;
+            return false;
+        }
+        run.scene = words[0];
+        run.output = words[2];
+        for (std::size_t i = 3; i < words.size(); ++i)
+        {
+            const std::size_t equal = words[i].find('=');
+            if (equal == std::string::npos || equal == 0)
+            {
+                cerr << fileName << ":" << lineNumber << ": invalid override " << words[i] << ", expected path.data=value" << endl;
+                return false;
+            }
+            run.overrides.emplace_back(words[i].substr(0, equal), words[i].substr(equal + 1));
+        }
+        sofa::helper::system::DataRepository.findFile(run.scene);
+        runs.push_back(run);
+    }
+    return true;
+}
+
+/// set the Data given by the path of its node or object from the root and its name (i.e. Beam/FEM.youngModulus),
+/// or by its name only for the Data of the root node (i.e. dt)
+bool applyOverride(sofa::simulation::Node* groot, const std::string& target, const std::string& value)
+{
+    sofa::core::objectmodel::Base* owner = groot;
+    std::string dataName = target;
+    const std::size_t dot = target.rfind('.');
+    if (dot != std::string::npos)
+    {
+        owner = groot->findLinkDestClass(sofa::core::objectmodel::Base::GetClass(), "@/" + target.substr(0, dot), nullptr);
+        dataName = target.substr(dot + 1);
+    }
+
+    sofa::core::objectmodel::BaseData* data = owner ? owner->findData(dataName) : nullptr;
+    if (!data || !data->read(value))
+    {
+        cerr << "Unable to set " << target << " to " << value << endl;
+        return false;
+    }
+    return true;
+}
+
+std::string quoted(const std::string& str)
+{
+    std::string result = "\"";
+    for (char c : str)
+    {
+        if (c == '"') result += '"';
+        result += c;
+    }
+    return result + "\"";
+}
+
+/// the line of a run in the farm summary
+std::string summaryLine(const FarmRun& run, const std::string& status, const SimulationResult& result)
+{
+    std::ostringstream line;
+    line << run.index << ',' << quoted(run.scene) << ',' << run.nbsteps << ',' << quoted(run.output) << ',' << quoted(status) << ','
+         << result.initTime << ',' << result.runTime << ','
+         << (result.runTime > 0 ? run.nbsteps / result.runTime : 0.0) << ',' << result.simulatedTime << ',' << result.nbDofs << ','
+         << '"' << result.bboxMin[0] << ' ' << result.bboxMin[1] << ' ' << result.bboxMin[2] << "\","
+         << '"' << result.bboxMax[0] << ' ' << result.bboxMax[1] << ' ' << result.bboxMax[2] << '"';
+    return line.str();
+}
+
+/// apply the overrides of the run to the loaded scene, simulate it and return its summary line
+std::string runFarmTask(sofa::simulation::Node::SPtr groot, const FarmRun& run)
+{
+    cout<<"\n****FARM RUN " << run.index << "*  (.scn:"<< run.scene<<", #steps:"<<run.nbsteps<<", .simu:"<<run.output<<")"<<endl;
+    for (const auto& dataOverride : run.overrides)
+    {
+        if (!applyOverride(groot.get(), dataOverride.first, dataOverride.second))
+            return summaryLine(run, "invalid override " + dataOverride.first, SimulationResult());
+    }
+    const SimulationResult result = simulate(groot, run.scene, run.nbsteps, run.output);
+    return summaryLine(run, "ok", result);
+}
+
+/// run the scenes of the manifest over nbJobs processes, writing a line per run in the summary file
+int farm(const std::string& manifestFileName, unsigned int nbJobs, const std::string& summaryFileName)
+{
+    std::vector<FarmRun> runs;
+    if (!readManifest(manifestFileName, runs))
+        return 1;
+
+    std::ofstream summary(summaryFileName.c_str());
+    if (!summary.is_open())
+    {
+        cerr << "Unable to write the farm summary " << summaryFileName << endl;
+        return 1;
+    }
+    summary << "run,scene,steps,output,status,initTime,runTime,fps,simulatedTime,nbDofs,bboxMin,bboxMax" << endl;
+
+    // the runs of a same scene share its loading, so the meshes are read once
+    std::vector<std::string> scenes;
+    std::map< std::string, std::vector<const FarmRun*> > sceneRuns;
+    for (const FarmRun& run : runs)
+    {
+        if (sceneRuns.find(run.scene) == sceneRuns.end())
+            scenes.push_back(run.scene);
+        sceneRuns[run.scene].push_back(&run);
+    }
+
+#ifdef SOFABATCH_FORK
+    // Each run is a process forked from this one once the plugins are initialized and its scene
+    // loaded, but not initialized: no thread of a task scheduler is running when forking, and
+    // the runs share the plugins and the loaded meshes, copied on write.
+    struct Job
+    {
+        pid_t pid;
+        int pipe;
+        const FarmRun* run;
+    };
+    std::vector<Job> jobs;
+
+    const auto waitJob = [&]()
+    {
+        int status = 0;
+        pid_t pid;
+        do
+        {
+            pid = waitpid(-1, &status, 0);
+        }
+        while (pid < 0 && errno == EINTR);
+
+        if (pid < 0)
+        {
+            // no run can be waited for anymore (i.e. ECHILD): the remaining runs are lost
+            const std::string error = std::string("wait failed (") + strerror(errno) + ")";
+            for (const Job& j : jobs)
+            {
+                close(j.pipe);
+                summary << summaryLine(*j.run, error, SimulationResult()) << endl;
+            }
+            jobs.clear();
+            return;
+        }
+
+        auto job = std::find_if(jobs.begin(), jobs.end(), [pid](const Job& j) { return j.pid == pid; });
+        if (job == jobs.end())
+            return;
+
+        // the line of a run is smaller than the pipe buffer: it was written without blocking the run
+        std::string line;
+        char buffer[512];
+        ssize_t size;
+        while ((size = read(job->pipe, buffer, sizeof(buffer))) > 0)
+            line.append(buffer, std::size_t(size));
+        close(job->pipe);
+
+        if (line.empty())
+        {
+            std::ostringstream failure;
+            if (WIFSIGNALED(status)) failure << "crashed (signal " << WTERMSIG(status) << ")";
+            else failure << "failed (exit code " << WEXITSTATUS(status) << ")";
+            line = summaryLine(*job->run, failure.str(), SimulationResult());
+        }
+        summary << line << endl;
+        jobs.erase(job);
+    };
+
+    for (const std::string& scene : scenes)
+    {
+        std::string sceneFile = scene;
+        sofa::simulation::Node::SPtr groot = sofa::helper::system::DataRepository.findFile(sceneFile) ? load(scene) : nullptr;
+        if (!groot)
+        {
+            for (const FarmRun* run : sceneRuns[scene])
+                summary << summaryLine(*run, "load failed", SimulationResult()) << endl;
+            continue;
+        }
+
+        for (const FarmRun* run : sceneRuns[scene])
+        {
+            while (jobs.size() >= nbJobs)
+                waitJob();
+
+            int fds[2];
+            if (pipe(fds) != 0)
+            {
+                summary << summaryLine(*run, "pipe failed", SimulationResult()) << endl;
+                continue;
+            }
+            cout.flush();
+            cerr.flush();
+            const pid_t pid = fork();
+            if (pid == 0)
+            {
+                close(fds[0]);
+                const std::string line = runFarmTask(groot, *run);
+                // the state files are closed by the destruction of the scene
+                sofa::simulation::getSimulation()->unload(groot);
+                if (write(fds[1], line.data(), line.size()) < 0)
+                    cerr << "Unable to send the summary of run " << run->index << endl;
+                close(fds[1]);
+                cout.flush();
+                cerr.flush();
+                _exit(0);
+            }
+            close(fds[1]);
+            if (pid < 0)
+            {
+                close(fds[0]);
+                summary << summaryLine(*run, "fork failed", SimulationResult()) << endl;
+                continue;
+            }
+            jobs.push_back({ pid, fds[0], run });
+        }
+
+        // the running runs have their own copy of the scene
+        sofa::simulation::getSimulation()->unload(groot);
+    }
+
+    while (!jobs.empty())
+        waitJob();
+#else
+    // without fork, the runs are done one after the other in this process
+    SOFA_UNUSED(nbJobs);
+    for (const std::string& scene : scenes)
+    {
+        std::string sceneFile = scene;
+        const bool found = sofa::helper::system::DataRepository.findFile(sceneFile);
+        for (const FarmRun* run : sceneRuns[scene])
+        {
+            sofa::simulation::Node::SPtr groot = found ? load(scene) : nullptr;
+            summary << (groot ? runFarmTask(groot, *run) : summaryLine(*run, "load failed", SimulationResult())) << endl;
+            if (groot)
+                sofa::simulation::getSimulation()->unload(groot);
+        }
+    }
+#endif
+
+    cout << runs.size() << " runs done, summary written in " << summaryFileName << endl;
+    return 0;
+}
+
+
+/// value of the option at argv[i], or of the following argument
+bool readOption(int argc, char** argv, int& i, const char* shortName, const char* longName, std::string& value)
+{
+    const std::string arg = argv[i];
+    const std::string longPrefix = std::string("--") + longName;
+    if (arg.compare(0, longPrefix.size() + 1, longPrefix + "=") == 0)
+    {
+        value = arg.substr(longPrefix.size() + 1);
+        return true;
+    }
+    if (arg != longPrefix && arg != std::string("-") + shortName)
+        return false;
+    if (i + 1 >= argc)
+    {
+        cerr << "Missing value of " << arg << "\nsee help\n";
+        exit(1);
+    }
+    value = argv[++i];
+    return true;
+}
+
+void printHelp(const char* program)
+{
+    cout << "This is a SOFA batch that permits to run and to save simulation states without GUI.\n"
+            "Usage: " << program << " [options] scene.scn #steps output\n"
+            "       " << program << " [options] --farm manifest\n"
+            "Options:\n"
+            "  -h, --help             display this help message\n"
+            "  -l, --load plugin      load the given plugin (may be repeated)\n"
+            "  -a, --affinity value   placement of the scheduler threads: none, cores, node:N or cores,node:N (overrides the scenes and SOFA_THREAD_AFFINITY)\n"
+            "  -f, --farm manifest    farm mode: run the scenes of the given manifest == list of (input .scn, #simulated time steps, output .simu, [path.data=value ...])\n"
+            "  -j, --jobs N           farm mode: number of runs at the same time, each in its own process (default: number of cores)\n"
+            "  -o, --summary file     farm mode: file of the timings and final state of each run (default: farm_summary.csv)\n";
+}
 
 int main(int argc, char** argv)
 {
-    sofa::simulation::tree::init();
+    sofa::simulation::graph::init();
     sofa::component::initSofaBase();
     sofa::component::initSofaCommon();
     sofa::component::initSofaGeneral();
 
     // --- Parameter initialisation ---
     std::vector<std::string> files;
-    std::string fileName ;
     std::vector<std::string> plugins;
-    std::vector<unsigned int> nbstepsations;
+    std::string threadAffinity;
+    std::string farmManifest;
+    int nbJobs = 0;
+    std::string farmSummary = "farm_summary.csv";
 
-    sofa::helper::parse(&files, "\nThis is a SOFA batch that permits to run and to save simulation states without GUI.\nGive a name file containing actions == list of (input .scn, #simulated time steps, output .simu). See file tasks for an example.\n\nHere are the command line arguments")
-    .option(&plugins,'l',"load","load given plugins")
-    (argc,argv);
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string value;
+        const std::string arg = argv[i];
+        if (arg == "-h" || arg == "--help")
+        {
+            printHelp(argv[0]);
+            return 0;
+        }
+        else if (readOption(argc, argv, i, "l", "load", value))
+            plugins.push_back(value);
+        else if (readOption(argc, argv, i, "a", "affinity", value))
+            threadAffinity = value;
+        else if (readOption(argc, argv, i, "f", "farm", value))
+            farmManifest = value;
+        else if (readOption(argc, argv, i, "j", "jobs", value))
+            nbJobs = std::atoi(value.c_str());
+        else if (readOption(argc, argv, i, "o", "summary", value))
+            farmSummary = value;
+        else if (arg.size() > 1 && arg[0] == '-')
+        {
+            cerr << "Unknown option " << arg << "\nsee help\n";
+            return 1;
+        }
+        else
+            files.push_back(arg);
+    }
 
 
     // --- check input file
-    if (!files.empty())
-        fileName = files[0];
-    else
+    if (farmManifest.empty() && files.size() < 3)
     {
-        cerr<<"No input tasks file\nsee help\n";
+        cerr<<"No input scene, number of steps and output\nsee help\n";
         return 0;
     }
 
-    fileName = sofa::helper::system::DataRepository.getFile(fileName);
-    //sofa::helper::system::DataRepository.findFile(fileName);
+
+    // --- thread placement, for several batches running side by side ---
+    if (!threadAffinity.empty())
+    {
+        sofa::simulation::ThreadAffinity affinity;
+        if (!affinity.read(threadAffinity))
+        {
+            cerr << "Invalid thread affinity " << threadAffinity << "\nsee help\n";
+            return 1;
+        }
+        sofa::simulation::ThreadAffinity::setProcessAffinity(affinity);
+    }
 
 
     // --- Init component ---
-    sofa::simulation::setSimulation(new sofa::simulation::tree::TreeSimulation());
+    sofa::simulation::setSimulation(new sofa::simulation::graph::DAGSimulation());
 
 
     // --- plugins ---
@@ -164,26 +598,22 @@ int main(int argc, char** argv)
     sofa::helper::system::PluginManager::getInstance().init();
 
 
-    // --- Perform task list ---
-    //std::ifstream end(fileName.c_str());
-
-    std::string input;
-//    int nbsteps;
-    std::string output;
+    // --- Farm mode ---
+    if (!farmManifest.empty())
+    {
+        const unsigned int jobs = nbJobs > 0 ? unsigned(nbJobs) : std::max(1u, std::thread::hardware_concurrency());
+        const int result = farm(sofa::helper::system::DataRepository.getFile(farmManifest), jobs, farmSummary);
+        sofa::simulation::graph::cleanup();
+        return result;
+    }
 
-//    while( end >> input && end >>nbsteps && end >> output  )
-//    {
-//        std::cout<<"input "<<input<<std::endl;
-//        sofa::helper::system::DataRepository.findFile(input);
-//        apply(input, nbsteps, output);
-//    }
-//    end.close();
 
-    std::string strfilename(argv[1]);
-    std::string stroutput(argv[3]);
-    sofa::helper::system::DataRepository.findFile(strfilename);
-    apply(strfilename, atoi(argv[2]), stroutput);
+    // --- Perform the simulation ---
+    std::string input = files[0];
+    std::string output = files[2];
+    sofa::helper::system::DataRepository.findFile(input);
+    apply(input, unsigned(std::atoi(files[1].c_str())), output);
 
-    sofa::simulation::tree::cleanup();
+    sofa::simulation::graph::cleanup();
     return 0;
 }
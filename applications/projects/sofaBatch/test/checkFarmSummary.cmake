@@ -0,0 +1,13 @@
+# Checks the summary written by sofaBatch for the runs of test/farmTasks:
+# every run gets its line, whatever the order the jobs finished in.
+file(STRINGS "${SUMMARY}" lines)
+list(LENGTH lines nbLines)
+if(NOT nbLines EQUAL 5)
+    message(FATAL_ERROR "${SUMMARY}: 4 runs expected, got ${nbLines} lines")
+endif()
+foreach(expected "\"chain\",\"ok\"" "\"chainSmallStep\",\"ok\"" "\"chainNoGravity\",\"ok\"" "\"missing\",\"load failed\"")
+    string(FIND "${lines}" "${expected}" found)
+    if(found EQUAL -1)
+        message(FATAL_ERROR "${SUMMARY}: no line with ${expected}")
+    endif()
+endforeach()
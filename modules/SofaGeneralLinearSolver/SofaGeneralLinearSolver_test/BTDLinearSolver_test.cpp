@@ -0,0 +1,216 @@
+/******************************************************************************
+*                 SOFA, Simulation Open-Framework Architecture                *
+*                    (c) 2006 INRIA, USTL, UJF, CNRS, MGH                     *
+*                                                                             *
+* This program is free software; you can redistribute it and/or modify it     *
+* under the terms of the GNU Lesser General Public License as published by    *
+* the Free Software Foundation; either version 2.1 of the License, or (at     *
+* your option) any later version.                                             *
+*                                                                             *
+* This program is distributed in the hope that it will be useful, but WITHOUT *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License *
+* for more details.                                                           *
+*                                                                             *
+* You should have received a copy of the GNU Lesser General Public License    *
+* along with this program. If not, see <http://www.gnu.org/licenses/>.        *
+*******************************************************************************
+* Authors: The SOFA Team and external contributors (see Authors.txt)          *
+*                                                                             *
+* Contact information: contact@sofa-framework.org                             *
+******************************************************************************/
+#include <SofaGeneralLinearSolver/BTDLinearSolver.inl>
+#include <sofa/simulation/DefaultTaskScheduler.h>
+#include <sofa/testing/BaseTest.h>
+
+#include <cmath>
+
+namespace sofa
+{
+
+using namespace component::linearsolver;
+using core::objectmodel::New;
+
+typedef BTDMatrix<6, double> Matrix;
+typedef BlockVector<6, double> Vector;
+typedef BTDLinearSolver<Matrix, Vector> Solver;
+
+// independent block tridiagonal systems of the given numbers of blocks, stored one after the other,
+// plus a dense copy of the global matrix
+static void createSystems(const std::vector<int>& lengths, Matrix& M, std::vector<double>& dense)
+{
+    int nbBlocs = 0;
+    for (int length : lengths) nbBlocs += length;
+    const int n = 6 * nbBlocs;
+    M.resize(n, n);
+    dense.assign(n * n, 0.0);
+    auto set = [&](int i, int j, double v) { M.set(i, j, v); dense[i * n + j] = v; };
+
+    int first = 0;
+    for (int length : lengths)
+    {
+        for (int b = first; b < first + length; ++b)
+        {
+            for (int i = 0; i < 6; ++i)
+            {
+                for (int j = 0; j < 6; ++j)
+                {
+                    // symmetric, diagonally dominant
+                    const double v = std::sin(double(b + 7 * (i + j)));
+                    set(6 * b + i, 6 * b + j, v + (i == j ? 20.0 : 0.0));
+                    if (b + 1 < first + length)
+                    {
+                        const double c = std::cos(double(3 * b + i - 2 * j));
+                        set(6 * b + i, 6 * (b + 1) + j, c);
+                        set(6 * (b + 1) + j, 6 * b + i, c);
+                    }
+                }
+            }
+        }
+        first += length;
+    }
+}
+
+struct BTDLinearSolver_test : public testing::BaseTest
+{
+    Matrix M;
+    std::vector<double> dense;
+    Vector b;
+
+    void createProblem(const std::vector<int>& lengths)
+    {
+        createSystems(lengths, M, dense);
+        b.resize(M.rowSize());
+        for (Index i = 0; i < b.size(); ++i)
+        {
+            b[i] = std::sin(0.1 * double(i));
+        }
+    }
+
+    Solver::SPtr createSolver(bool batched, bool parallel)
+    {
+        Solver::SPtr solver = New<Solver>();
+        solver->d_batched.setValue(batched);
+        solver->d_parallel.setValue(parallel);
+        solver->invert(M);
+        return solver;
+    }
+
+    Vector solve(Solver* solver)
+    {
+        Vector x;
+        x.resize(b.size());
+        solver->solve(M, x, b);
+        return x;
+    }
+
+    double residual(const Vector& x) const
+    {
+        const Index n = b.size();
+        double norm = 0;
+        for (Index i = 0; i < n; ++i)
+        {
+            double r = -b[i];
+            for (Index j = 0; j < n; ++j)
+            {
+                r += dense[i * n + j] * x[j];
+            }
+            norm = std::max(norm, std::abs(r));
+        }
+        return norm;
+    }
+};
+
+TEST_F(BTDLinearSolver_test, batchedMatchesSequential)
+{
+    // 7 systems: a full group of BatchLanes systems and a partial one
+    createProblem({5, 1, 8, 3, 3, 6, 2});
+
+    simulation::TaskScheduler* scheduler = simulation::TaskScheduler::create(simulation::DefaultTaskScheduler::name());
+    scheduler->init(4);
+
+    Solver::SPtr sequential = createSolver(false, false);
+    Solver::SPtr batched = createSolver(true, false);
+    Solver::SPtr parallel = createSolver(true, true);
+    EXPECT_EQ(batched->d_nbSystems.getValue(), 7);
+
+    const Vector x = solve(sequential.get());
+    const Vector xBatched = solve(batched.get());
+    const Vector xParallel = solve(parallel.get());
+    scheduler->stop();
+
+    EXPECT_LT(residual(x), 1e-12);
+    EXPECT_LT(residual(xBatched), 1e-12);
+    for (Index i = 0; i < b.size(); ++i)
+    {
+        EXPECT_NEAR(xBatched[i], x[i], 1e-12);
+        EXPECT_EQ(xParallel[i], xBatched[i]);
+    }
+}
+
+TEST_F(BTDLinearSolver_test, batchedPivoting)
+{
+    createProblem({3, 4, 2});
+
+    // the first diagonal block of the second system has a null pivot
+    const int bloc = 3;
+    for (int j = 0; j < 6; ++j)
+    {
+        const double v = (j == 1) ? 20.0 : 0.0;
+        M.set(6 * bloc, 6 * bloc + j, v);
+        M.set(6 * bloc + j, 6 * bloc, v);
+        dense[(6 * bloc) * M.rowSize() + 6 * bloc + j] = v;
+        dense[(6 * bloc + j) * M.rowSize() + 6 * bloc] = v;
+    }
+
+    Solver::SPtr batched = createSolver(true, false);
+    const Vector x = solve(batched.get());
+    EXPECT_LT(residual(x), 1e-10);
+}
+
+TEST_F(BTDLinearSolver_test, batchedAddJMInvJt)
+{
+    createProblem({4, 2, 5, 3, 1});
+    const Index n = M.rowSize();
+
+    // constraints on single dofs, and between two systems
+    SparseMatrix<double> J;
+    J.resize(4, n);
+    J.set(0, 2, 1.0);
+    J.set(1, 6 * 5 + 4, 1.0);
+    J.set(2, 6 * 3, 1.0);
+    J.set(2, 6 * 8 + 1, -1.0);
+    J.set(3, n - 1, 0.5);
+
+    Solver::SPtr sequential = createSolver(false, false);
+    Solver::SPtr batched = createSolver(true, false);
+
+    // the inverse of the batched solver is only allocated here
+    FullMatrix<double> expected, result;
+    expected.resize(4, 4);
+    result.resize(4, 4);
+    ASSERT_TRUE(sequential->addJMInvJt(&expected, &J, 1.0));
+    ASSERT_TRUE(batched->addJMInvJt(&result, &J, 1.0));
+
+    // J M^-1 J^T, column by column
+    for (Index c = 0; c < 4; ++c)
+    {
+        for (Index i = 0; i < n; ++i)
+        {
+            b[i] = J.element(c, i);
+        }
+        const Vector x = solve(sequential.get());
+        for (Index r = 0; r < 4; ++r)
+        {
+            double value = 0;
+            for (Index i = 0; i < n; ++i)
+            {
+                value += J.element(r, i) * x[i];
+            }
+            EXPECT_NEAR(expected.element(r, c), value, 1e-12);
+            EXPECT_NEAR(result.element(r, c), value, 1e-12);
+        }
+    }
+}
+
+} // namespace sofa
@@ -28,6 +28,7 @@
 #include <SofaBaseLinearSolver/FullMatrix.h>
 #include <cmath>
 #include <sofa/defaulttype/Mat.h>
+#include <sofa/simulation/TaskScheduler.h>
 
 namespace sofa::component::linearsolver
 {
@@ -502,6 +503,10 @@ public:
     Vector Y;
 
     Data<int> f_blockSize; ///< dimension of the blocks in the matrix
+
+    Data<bool> d_batched; ///< Split the matrix into the independent systems separated by null coupling blocks (one per wire) and solve them together, vectorized across the systems
+    Data<bool> d_parallel; ///< Factorize and solve the groups of systems of the batched mode in parallel with the TaskScheduler
+    Data<int> d_nbSystems; ///< Number of independent systems found by the batched mode
 protected:
     BTDLinearSolver()
         : f_verbose( initData(&f_verbose,false,"verbose","Dump system state at each iteration") )
@@ -510,7 +515,12 @@ protected:
         , verification(initData(&verification, false,"verification", "verification of the subpartSolve"))
         , test_perf(initData(&test_perf, false,"test_perf", "verification of performance"))
         , f_blockSize( initData(&f_blockSize,6,"blockSize","dimension of the blocks in the matrix") )
+        , d_batched( initData(&d_batched, false, "batched", "Split the matrix into the independent systems separated by null coupling blocks (one per wire) and solve them together, vectorized across the systems") )
+        , d_parallel( initData(&d_parallel, false, "parallel", "Factorize and solve the groups of systems of the batched mode in parallel with the TaskScheduler") )
+        , d_nbSystems( initData(&d_nbSystems, 0, "nbSystems", "Number of independent systems found by the batched mode") )
+        , scheduler(nullptr)
     {
+        d_nbSystems.setReadOnly(true);
         Index bsize = Matrix::getSubMatrixDim(0);
         if (bsize > 0)
         {
@@ -591,6 +601,54 @@ private:
     void fwdComputeLHinBloc(Index indMaxBloc);
 
 
+    /// @name Batched mode
+    /// @{
+
+    /// Number of systems factorized and solved together, one per SIMD lane
+    static constexpr Index BatchLanes = 4;
+    static constexpr Index BatchN = BlocType::nbLines;
+
+    /// Blocks of the BatchLanes systems of a group stored as structure of arrays: the scalars (i,j)
+    /// of the blocks of all the systems are contiguous, the loops over the lanes are vectorized
+    struct BatchBloc
+    {
+        alignas(32) Real v[BatchN][BatchN][BatchLanes];
+    };
+    struct BatchVec
+    {
+        alignas(32) Real v[BatchN][BatchLanes];
+    };
+
+    struct BatchGroup
+    {
+        Index systems[BatchLanes]; ///< system of each lane, or -1 for the unused lanes
+        Index nbBlocs;             ///< number of blocks of the longest system of the group
+        Index offset;              ///< first block of the group in the batch storage
+    };
+
+    helper::vector<IndexPair> systems;    ///< first block and number of blocks of each independent system
+    helper::vector<Index> blocSystem;     ///< system of each block
+    helper::vector<BatchGroup> batchGroups;
+    helper::vector<BatchBloc> batchAlphaInv, batchLambda, batchB;
+    helper::vector<BatchVec> batchX;
+    simulation::TaskScheduler* scheduler;
+
+    static void mulLanes(const BatchBloc& a, const BatchBloc& b, BatchBloc& r);
+    static void mulLanes(const BatchBloc& a, const BatchVec& x, BatchVec& r);
+    /// returns the mask of the lanes which need pivoting
+    static unsigned invertLanes(BatchBloc& m, BatchBloc& inv);
+
+    void findSystems(Matrix& M, Index nb);
+    void factorizeGroup(Matrix& M, const BatchGroup& group);
+    void solveGroup(Vector& x, const Vector& b, const BatchGroup& group);
+    void invertBatched(Matrix& M, Index nb);
+    void solveBatched(Vector& x, Vector& b);
+    /// allocate the dense inverse, which is only used by addJMInvJt in batched mode
+    void initMinv();
+    template<class Function>
+    void forEachGroup(const Function& function);
+
+    /// @}
 };
 
 #if  !defined(SOFA_COMPONENT_LINEARSOLVER_BTDLINEARSOLVER_CPP)
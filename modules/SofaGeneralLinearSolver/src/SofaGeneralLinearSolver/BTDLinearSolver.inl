@@ -21,6 +21,10 @@
 ******************************************************************************/
 #pragma once
 #include "BTDLinearSolver.h"
+#include <sofa/simulation/ParallelForEach.h>
+
+#include <algorithm>
+#include <numeric>
 
 
 namespace sofa::component::linearsolver
@@ -623,42 +627,54 @@ void BTDLinearSolver<Matrix,Vector>::invert(Matrix& M)
         this->init_partial_inverse(nb,bsize);
     }
 
-    SubMatrix A, C;
-    //Index ndiag = 0;
-    M.getAlignedSubMatrix(0,0,bsize,bsize,A);
-    M.getAlignedSubMatrix(0,1,bsize,bsize,C);
-    invert(alpha_inv[0],A);
-    msg_info_when(this->f_verbose.getValue()) << "alpha_inv[0] = " << alpha_inv[0] ;
-    lambda[0] = alpha_inv[0]*C;
-    msg_info_when(this->f_verbose.getValue()) << "lambda[0] = " << lambda[0] ;
-
-    for (Index i=1; i<nb; ++i)
+    if (d_batched.getValue())
+    {
+        invertBatched(M, nb);
+    }
+    else
     {
-        M.getAlignedSubMatrix((i  ),(i  ),bsize,bsize,A);
-        M.getAlignedSubMatrix((i  ),(i-1),bsize,bsize,B[i]);
+        batchGroups.clear();
+        SubMatrix A, C;
+        //Index ndiag = 0;
+        M.getAlignedSubMatrix(0,0,bsize,bsize,A);
+        M.getAlignedSubMatrix(0,1,bsize,bsize,C);
+        invert(alpha_inv[0],A);
+        msg_info_when(this->f_verbose.getValue()) << "alpha_inv[0] = " << alpha_inv[0] ;
+        lambda[0] = alpha_inv[0]*C;
+        msg_info_when(this->f_verbose.getValue()) << "lambda[0] = " << lambda[0] ;
+
+        for (Index i=1; i<nb; ++i)
+        {
+            M.getAlignedSubMatrix((i  ),(i  ),bsize,bsize,A);
+            M.getAlignedSubMatrix((i  ),(i-1),bsize,bsize,B[i]);
 
-        BlocType Temp1= B[i]*lambda[i-1];
-        BlocType Temp2= A - Temp1;
-        invert(alpha_inv[i], Temp2);
+            BlocType Temp1= B[i]*lambda[i-1];
+            BlocType Temp2= A - Temp1;
+            invert(alpha_inv[i], Temp2);
 
-        msg_info_when(this->f_verbose.getValue()) << "alpha_inv["<<i<<"] = " << alpha_inv[i] ;
-        if (i<nb-1)
-        {
-            M.getAlignedSubMatrix((i  ),(i+1),bsize,bsize,C);
-            lambda[i] = alpha_inv[i]*C;
+            msg_info_when(this->f_verbose.getValue()) << "alpha_inv["<<i<<"] = " << alpha_inv[i] ;
+            if (i<nb-1)
+            {
+                M.getAlignedSubMatrix((i  ),(i+1),bsize,bsize,C);
+                lambda[i] = alpha_inv[i]*C;
 
-            msg_info_when(this->f_verbose.getValue()) << "lambda["<<i<<"] = " << lambda[i] ;
+                msg_info_when(this->f_verbose.getValue()) << "lambda["<<i<<"] = " << lambda[i] ;
+            }
         }
     }
     nBlockComputedMinv.resize(nb);
     for (Index i=0; i<nb; ++i)
         nBlockComputedMinv[i] = 0;
 
-    // WARNING : cost of resize here : ???
-    Minv.resize(nb*bsize,nb*bsize);
-    Minv.setAlignedSubMatrix((nb-1),(nb-1),bsize,bsize,alpha_inv[nb-1]);
-
-    nBlockComputedMinv[nb-1] = 1;
+    if (d_batched.getValue() && !subpartSolve.getValue())
+    {
+        // the dense inverse of the many systems is only allocated if addJMInvJt needs it
+        Minv.resize(0,0);
+    }
+    else
+    {
+        initMinv();
+    }
 
     if(subpartSolve.getValue() )
     {
@@ -789,6 +805,19 @@ void BTDLinearSolver<Matrix,Vector>::computeMinvBlock(Index i, Index j)
     }
 }
 
+template<class Matrix, class Vector>
+void BTDLinearSolver<Matrix,Vector>::initMinv()
+{
+    const Index bsize = Matrix::getSubMatrixDim(f_blockSize.getValue());
+    const Index nb = (Index)alpha_inv.size();
+
+    // WARNING : cost of resize here : ???
+    Minv.resize(nb*bsize,nb*bsize);
+    Minv.setAlignedSubMatrix((nb-1),(nb-1),bsize,bsize,alpha_inv[nb-1]);
+
+    nBlockComputedMinv[nb-1] = 1;
+}
+
 template<class Matrix, class Vector>
 double BTDLinearSolver<Matrix,Vector>::getMinvElement(Index i, Index j)
 {
@@ -798,6 +827,12 @@ double BTDLinearSolver<Matrix,Vector>::getMinvElement(Index i, Index j)
         // lower diagonal
         return getMinvElement(j,i);
     }
+    if (!batchGroups.empty())
+    {
+        // the systems are independent
+        if (blocSystem[i/bsize] != blocSystem[j/bsize]) return 0.0;
+        if (Minv.rowSize() == 0) initMinv();
+    }
     computeMinvBlock(i/bsize, j/bsize);
     return Minv.element(i,j);
 }
@@ -811,6 +846,13 @@ void BTDLinearSolver<Matrix,Vector>::solve (Matrix& /*M*/, Vector& x, Vector& b)
     const Index nb = b.size() / bsize;
     if (nb == 0) return;
 
+    if (!batchGroups.empty())
+    {
+        solveBatched(x, b);
+        msg_info_when(this->f_verbose.getValue()) << "solve, solution = "<<x;
+        return;
+    }
+
     x.asub(0,bsize) = alpha_inv[0] * b.asub(0,bsize);
     for (Index i=1; i<nb; ++i)
     {
@@ -826,6 +868,312 @@ void BTDLinearSolver<Matrix,Vector>::solve (Matrix& /*M*/, Vector& x, Vector& b)
 
 }
 
+///////////////////////////////////////
+///////  batched mode  //////////
+///////////////////////////////////////
+
+template<class Matrix, class Vector>
+void BTDLinearSolver<Matrix,Vector>::mulLanes(const BatchBloc& a, const BatchBloc& b, BatchBloc& r)
+{
+    for (Index i = 0; i < BatchN; ++i)
+    {
+        for (Index j = 0; j < BatchN; ++j)
+        {
+            Real* rij = r.v[i][j];
+            for (Index l = 0; l < BatchLanes; ++l)
+                rij[l] = 0;
+            for (Index k = 0; k < BatchN; ++k)
+                for (Index l = 0; l < BatchLanes; ++l)
+                    rij[l] += a.v[i][k][l] * b.v[k][j][l];
+        }
+    }
+}
+
+template<class Matrix, class Vector>
+void BTDLinearSolver<Matrix,Vector>::mulLanes(const BatchBloc& a, const BatchVec& x, BatchVec& r)
+{
+    for (Index i = 0; i < BatchN; ++i)
+    {
+        Real* ri = r.v[i];
+        for (Index l = 0; l < BatchLanes; ++l)
+            ri[l] = 0;
+        for (Index k = 0; k < BatchN; ++k)
+            for (Index l = 0; l < BatchLanes; ++l)
+                ri[l] += a.v[i][k][l] * x.v[k][l];
+    }
+}
+
+/// Gauss-Jordan elimination without pivoting, the diagonal blocks of the Schur complements of the
+/// symmetric positive definite systems of the beams do not need any. Returns the mask of the lanes
+/// where a pivot is too small, which must be inverted with pivoting.
+template<class Matrix, class Vector>
+unsigned BTDLinearSolver<Matrix,Vector>::invertLanes(BatchBloc& m, BatchBloc& inv)
+{
+    Real scale[BatchLanes];
+    for (Index l = 0; l < BatchLanes; ++l)
+        scale[l] = 0;
+    for (Index i = 0; i < BatchN; ++i)
+        for (Index j = 0; j < BatchN; ++j)
+            for (Index l = 0; l < BatchLanes; ++l)
+            {
+                inv.v[i][j][l] = (i == j) ? Real(1) : Real(0);
+                scale[l] = std::max(scale[l], std::abs(m.v[i][j][l]));
+            }
+
+    unsigned singular = 0;
+    for (Index k = 0; k < BatchN; ++k)
+    {
+        Real p[BatchLanes];
+        for (Index l = 0; l < BatchLanes; ++l)
+        {
+            if (!(std::abs(m.v[k][k][l]) > scale[l] * Real(1e-10)))
+            {
+                singular |= 1u << l;
+                m.v[k][k][l] = Real(1);
+            }
+            p[l] = Real(1) / m.v[k][k][l];
+        }
+        for (Index j = 0; j < BatchN; ++j)
+        {
+            for (Index l = 0; l < BatchLanes; ++l)
+            {
+                m.v[k][j][l] *= p[l];
+                inv.v[k][j][l] *= p[l];
+            }
+        }
+        for (Index i = 0; i < BatchN; ++i)
+        {
+            if (i == k) continue;
+            Real f[BatchLanes];
+            for (Index l = 0; l < BatchLanes; ++l)
+                f[l] = m.v[i][k][l];
+            for (Index j = 0; j < BatchN; ++j)
+            {
+                for (Index l = 0; l < BatchLanes; ++l)
+                {
+                    m.v[i][j][l] -= f[l] * m.v[k][j][l];
+                    inv.v[i][j][l] -= f[l] * inv.v[k][j][l];
+                }
+            }
+        }
+    }
+    return singular;
+}
+
+template<class Matrix, class Vector>
+void BTDLinearSolver<Matrix,Vector>::findSystems(Matrix& M, Index nb)
+{
+    BlocType C, Bt;
+    systems.clear();
+    blocSystem.resize(nb);
+    Index first = 0;
+    for (Index i = 0; i < nb; ++i)
+    {
+        bool last = (i == nb-1);
+        if (!last)
+        {
+            M.getAlignedSubMatrix(i, i+1, BatchN, BatchN, C);
+            M.getAlignedSubMatrix(i+1, i, BatchN, BatchN, Bt);
+            last = true;
+            for (Index r = 0; r < BatchN && last; ++r)
+                for (Index c = 0; c < BatchN && last; ++c)
+                    last = (C[r][c] == 0 && Bt[r][c] == 0);
+        }
+        blocSystem[i] = (Index)systems.size();
+        if (last)
+        {
+            systems.push_back(IndexPair(first, i+1-first));
+            first = i+1;
+        }
+    }
+
+    // the systems of similar lengths are grouped to limit the padding of the lanes
+    helper::vector<Index> order(systems.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [this](Index a, Index b) { return systems[a].second > systems[b].second; });
+
+    batchGroups.clear();
+    Index offset = 0;
+    for (std::size_t s = 0; s < order.size(); s += BatchLanes)
+    {
+        BatchGroup group;
+        group.nbBlocs = systems[order[s]].second;
+        group.offset = offset;
+        for (Index l = 0; l < BatchLanes; ++l)
+            group.systems[l] = (s + l < order.size()) ? order[s + l] : -1;
+        batchGroups.push_back(group);
+        offset += group.nbBlocs;
+    }
+    batchAlphaInv.resize(offset);
+    batchLambda.resize(offset);
+    batchB.resize(offset);
+    batchX.resize(offset);
+}
+
+template<class Matrix, class Vector>
+void BTDLinearSolver<Matrix,Vector>::factorizeGroup(Matrix& M, const BatchGroup& group)
+{
+    const Index nb = (Index)alpha_inv.size();
+    BlocType A, Bk, C;
+    BatchBloc S, BL, Cb;
+    for (Index k = 0; k < group.nbBlocs; ++k)
+    {
+        BatchBloc& alphaInvK = batchAlphaInv[group.offset + k];
+        BatchBloc& lambdaK = batchLambda[group.offset + k];
+        BatchBloc& BK = batchB[group.offset + k];
+        for (Index l = 0; l < BatchLanes; ++l)
+        {
+            const Index s = group.systems[l];
+            if (s >= 0 && k < systems[s].second)
+            {
+                const Index bi = systems[s].first + k;
+                M.getAlignedSubMatrix(bi, bi, BatchN, BatchN, A);
+                if (k > 0) M.getAlignedSubMatrix(bi, bi-1, BatchN, BatchN, Bk);
+                else Bk.clear();
+                if (k+1 < systems[s].second) M.getAlignedSubMatrix(bi, bi+1, BatchN, BatchN, C);
+                else C.clear();
+            }
+            else
+            {
+                // the lanes after the end of their system solve uncoupled identity blocks
+                A.identity();
+                Bk.clear();
+                C.clear();
+            }
+            for (Index i = 0; i < BatchN; ++i)
+            {
+                for (Index j = 0; j < BatchN; ++j)
+                {
+                    S.v[i][j][l] = A[i][j];
+                    BK.v[i][j][l] = Bk[i][j];
+                    Cb.v[i][j][l] = C[i][j];
+                }
+            }
+        }
+
+        // alpha_inv[k] = (A[k] - B[k] lambda[k-1])^-1 and lambda[k] = alpha_inv[k] C[k]
+        if (k > 0)
+        {
+            mulLanes(BK, batchLambda[group.offset + k - 1], BL);
+            for (Index i = 0; i < BatchN; ++i)
+                for (Index j = 0; j < BatchN; ++j)
+                    for (Index l = 0; l < BatchLanes; ++l)
+                        S.v[i][j][l] -= BL.v[i][j][l];
+        }
+        const BatchBloc Schur = S;
+        if (const unsigned singular = invertLanes(S, alphaInvK))
+        {
+            // small pivots: these lanes are inverted like in the sequential factorization
+            for (Index l = 0; l < BatchLanes; ++l)
+            {
+                if (!(singular & (1u << l))) continue;
+                SubMatrix inv;
+                for (Index i = 0; i < BatchN; ++i)
+                    for (Index j = 0; j < BatchN; ++j)
+                        A[i][j] = Schur.v[i][j][l];
+                invert(inv, A);
+                for (Index i = 0; i < BatchN; ++i)
+                    for (Index j = 0; j < BatchN; ++j)
+                        alphaInvK.v[i][j][l] = inv[i][j];
+            }
+        }
+        mulLanes(alphaInvK, Cb, lambdaK);
+
+        // blocks of the sequential factorization, used by the inverse of addJMInvJt and the partial solve
+        for (Index l = 0; l < BatchLanes; ++l)
+        {
+            const Index s = group.systems[l];
+            if (s < 0 || k >= systems[s].second) continue;
+            const Index bi = systems[s].first + k;
+            for (Index i = 0; i < BatchN; ++i)
+            {
+                for (Index j = 0; j < BatchN; ++j)
+                {
+                    alpha_inv[bi][i][j] = alphaInvK.v[i][j][l];
+                    B[bi][i][j] = BK.v[i][j][l];
+                    if (bi < nb-1) lambda[bi][i][j] = lambdaK.v[i][j][l];
+                }
+            }
+        }
+    }
+}
+
+template<class Matrix, class Vector>
+void BTDLinearSolver<Matrix,Vector>::solveGroup(Vector& x, const Vector& b, const BatchGroup& group)
+{
+    BatchVec r, t;
+    BatchVec* X = &batchX[group.offset];
+    for (Index k = 0; k < group.nbBlocs; ++k)
+    {
+        for (Index l = 0; l < BatchLanes; ++l)
+        {
+            const Index s = group.systems[l];
+            const bool active = (s >= 0 && k < systems[s].second);
+            for (Index i = 0; i < BatchN; ++i)
+                r.v[i][l] = active ? b[(systems[s].first + k) * BatchN + i] : Real(0);
+        }
+        if (k > 0)
+        {
+            mulLanes(batchB[group.offset + k], X[k-1], t);
+            for (Index i = 0; i < BatchN; ++i)
+                for (Index l = 0; l < BatchLanes; ++l)
+                    r.v[i][l] -= t.v[i][l];
+        }
+        mulLanes(batchAlphaInv[group.offset + k], r, X[k]);
+    }
+    for (Index k = group.nbBlocs-2; k >= 0; --k)
+    {
+        mulLanes(batchLambda[group.offset + k], X[k+1], t);
+        for (Index i = 0; i < BatchN; ++i)
+            for (Index l = 0; l < BatchLanes; ++l)
+                X[k].v[i][l] -= t.v[i][l];
+    }
+    for (Index l = 0; l < BatchLanes; ++l)
+    {
+        const Index s = group.systems[l];
+        if (s < 0) continue;
+        for (Index k = 0; k < systems[s].second; ++k)
+            for (Index i = 0; i < BatchN; ++i)
+                x[(systems[s].first + k) * BatchN + i] = X[k].v[i][l];
+    }
+}
+
+template<class Matrix, class Vector>
+template<class Function>
+void BTDLinearSolver<Matrix,Vector>::forEachGroup(const Function& function)
+{
+    const Index nbGroups = (Index)batchGroups.size();
+    if (scheduler && nbGroups > 1)
+    {
+        simulation::parallelForEach(*scheduler, simulation::Range<Index>(0, nbGroups), 1,
+                                    [&](Index g) { function(batchGroups[g]); });
+    }
+    else
+    {
+        for (const BatchGroup& group : batchGroups)
+            function(group);
+    }
+}
+
+template<class Matrix, class Vector>
+void BTDLinearSolver<Matrix,Vector>::invertBatched(Matrix& M, Index nb)
+{
+    scheduler = d_parallel.getValue() ? simulation::TaskScheduler::getInstance() : nullptr;
+
+    findSystems(M, nb);
+    d_nbSystems.setValue((int)systems.size());
+    msg_info_when(this->f_verbose.getValue()) << systems.size() << " independent systems in " << batchGroups.size() << " groups";
+
+    forEachGroup([&](const BatchGroup& group) { factorizeGroup(M, group); });
+}
+
+template<class Matrix, class Vector>
+void BTDLinearSolver<Matrix,Vector>::solveBatched(Vector& x, Vector& b)
+{
+    scheduler = d_parallel.getValue() ? simulation::TaskScheduler::getInstance() : nullptr;
+    forEachGroup([&](const BatchGroup& group) { solveGroup(x, b, group); });
+}
+
 template<class Matrix, class Vector>
 bool BTDLinearSolver<Matrix,Vector>::addJMInvJt(defaulttype::BaseMatrix* result, defaulttype::BaseMatrix* J, double fact)
 {
@@ -1216,7 +1564,8 @@ template<class RMatrix, class JMatrix>
 bool BTDLinearSolver<Matrix,Vector>::addJMInvJt(RMatrix& result, JMatrix& J, double fact)
 {
     const Index Jcols = J.colSize();
-    if (Jcols != Minv.rowSize())
+    const Index systemSize = (Index)alpha_inv.size() * Matrix::getSubMatrixDim(f_blockSize.getValue());
+    if (Jcols != systemSize)
     {
         msg_error() << "AddJMInvJt: incompatible J matrix size.";
         return false;
@@ -1226,10 +1575,10 @@ bool BTDLinearSolver<Matrix,Vector>::addJMInvJt(RMatrix& result, JMatrix& J, dou
     {
         std::stringstream tmpStr;
         tmpStr<< "C = ["<<msgendl;
-        for  (Index mr=0; mr<Minv.rowSize(); mr++)
+        for  (Index mr=0; mr<systemSize; mr++)
         {
             tmpStr<<" "<<msgendl;
-            for (Index mc=0; mc<Minv.colSize(); mc++)
+            for (Index mc=0; mc<systemSize; mc++)
             {
                 tmpStr<<" "<< getMinvElement(mr,mc);
             }
@@ -0,0 +1,219 @@
+/******************************************************************************
+*                 SOFA, Simulation Open-Framework Architecture                *
+*                    (c) 2006 INRIA, USTL, UJF, CNRS, MGH                     *
+*                                                                             *
+* This program is free software; you can redistribute it and/or modify it     *
+* under the terms of the GNU Lesser General Public License as published by    *
+* the Free Software Foundation; either version 2.1 of the License, or (at     *
+* your option) any later version.                                             *
+*                                                                             *
+* This program is distributed in the hope that it will be useful, but WITHOUT *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License *
+* for more details.                                                           *
+*                                                                             *
+* You should have received a copy of the GNU Lesser General Public License    *
+* along with this program. If not, see <http://www.gnu.org/licenses/>.        *
+*******************************************************************************
+* Authors: The SOFA Team and external contributors (see Authors.txt)          *
+*                                                                             *
+* Contact information: contact@sofa-framework.org                             *
+******************************************************************************/
+#include <SofaPreconditioner/AMGPreconditioner.inl>
+#include <SofaPreconditioner/initSofaPreconditioner.h>
+#include <SofaBase/initSofaBase.h>
+#include <SofaBoundaryCondition/initSofaBoundaryCondition.h>
+#include <SofaImplicitOdeSolver/initSofaImplicitOdeSolver.h>
+#include <SofaSimpleFem/initSofaSimpleFem.h>
+#include <SofaSparseSolver/initSofaSparseSolver.h>
+#include <SofaSimulationGraph/SimpleApi.h>
+#include <sofa/simulation/Node.h>
+#include <sofa/core/behavior/BaseMechanicalState.h>
+#include <sofa/testing/BaseTest.h>
+
+namespace sofa
+{
+
+using namespace simpleapi;
+using namespace component::linearsolver;
+using core::objectmodel::New;
+
+typedef CompressedRowSparseMatrix< defaulttype::Mat<3,3,double> > BlockMatrix;
+
+/// Access to the hierarchy of the preconditioner
+class AMGPreconditionerTester : public AMGPreconditioner< BlockMatrix, FullVector<double> >
+{
+public:
+    SOFA_CLASS(AMGPreconditionerTester, SOFA_TEMPLATE2(AMGPreconditioner, BlockMatrix, FullVector<double>));
+
+    const LevelMatrix& getInterpolation(std::size_t l) const { return levels[l].P; }
+    const LevelMatrix& getLevelMatrix(std::size_t l) const { return levels[l].A; }
+    std::size_t getNbLevels() const { return levels.size(); }
+};
+
+// chain of nodes linked by isotropic springs, plus a mass term on the diagonal
+static void createChainMatrix(int nbNodes, double mass, BlockMatrix& M)
+{
+    typedef defaulttype::Mat<3,3,double> Block;
+    Block identity;
+    identity.identity();
+
+    M.resize(3 * nbNodes, 3 * nbNodes);
+    for (int i = 0; i < nbNodes; ++i)
+    {
+        M.add(i, i, identity * (mass + (i > 0 ? 1.0 : 0.0) + (i + 1 < nbNodes ? 1.0 : 0.0)));
+        if (i > 0) M.add(i, i - 1, -identity);
+        if (i + 1 < nbNodes) M.add(i, i + 1, -identity);
+    }
+    M.compress();
+}
+
+struct AMGPreconditioner_test : public testing::BaseTest
+{
+    simulation::Simulation::SPtr m_simulation;
+    std::vector<NodeSPtr> m_roots;
+
+    void onSetUp() override
+    {
+        component::initSofaBase();
+        component::initSofaImplicitOdeSolver();
+        component::initSofaSimpleFem();
+        component::initSofaBoundaryCondition();
+        component::initSofaSparseSolver();
+        component::initSofaPreconditioner();
+        m_simulation = createSimulation("DAG");
+        simulation::setSimulation(m_simulation.get());
+    }
+
+    void onTearDown() override
+    {
+        for (auto& root : m_roots)
+        {
+            m_simulation->unload(root);
+        }
+    }
+
+    /// Hexahedral FEM beam fixed at one end, bending under gravity, solved by the given linear solvers
+    NodeSPtr createBeam(const std::vector<std::pair<std::string, std::map<std::string, std::string> > >& solvers)
+    {
+        const int nx = 11, ny = 4, nz = 4;
+        std::ostringstream fixed;
+        for (int k = 0; k < nz; ++k)
+        {
+            for (int j = 0; j < ny; ++j)
+            {
+                fixed << nx * (j + ny * k) << " ";
+            }
+        }
+
+        NodeSPtr root = createRootNode(m_simulation, "root", {{"gravity", "0 -9.81 0"}, {"dt", "0.01"}});
+        m_roots.push_back(root);
+        createObject(root, "EulerImplicitSolver", {{"rayleighStiffness", "0.1"}, {"rayleighMass", "0.1"}});
+        for (const auto& solver : solvers)
+        {
+            createObject(root, solver.first, solver.second);
+        }
+        createObject(root, "RegularGridTopology", {{"n", str(nx) + " " + str(ny) + " " + str(nz)}, {"min", "0 0 0"}, {"max", "10 3 3"}});
+        createObject(root, "MechanicalObject", {{"template", "Vec3d"}});
+        createObject(root, "UniformMass", {{"totalMass", "10"}});
+        createObject(root, "HexahedronFEMForceField", {{"youngModulus", "10000"}, {"poissonRatio", "0.45"}, {"method", "large"}});
+        createObject(root, "FixedConstraint", {{"indices", fixed.str()}});
+        m_simulation->init(root.get());
+        return root;
+    }
+
+    static std::map<std::string, std::string> pcg(bool precond)
+    {
+        return {{"name", "pcg"}, {"iterations", "1000"}, {"tolerance", "1e-20"},
+                {"use_precond", precond ? "true" : "false"}, {"preconditioners", "precond"}};
+    }
+
+    /// number of iterations of the PCG in the first step
+    std::size_t stepAndCountIterations(NodeSPtr root)
+    {
+        m_simulation->animate(root.get(), 0.01);
+        const auto* data = dynamic_cast<Data<std::map<std::string, helper::vector<double> > >*>(root->getObject("pcg")->findData("graph"));
+        EXPECT_NE(data, nullptr);
+        if (data == nullptr || data->getValue().empty()) return 0;
+        return data->getValue().begin()->second.size();
+    }
+};
+
+TEST_F(AMGPreconditioner_test, fewerIterationsThanJacobi)
+{
+    NodeSPtr amg = createBeam({{"ShewchukPCGLinearSolver", pcg(true)}, {"AMGPreconditioner", {{"name", "precond"}, {"coarseSize", "60"}}}});
+    NodeSPtr jacobi = createBeam({{"ShewchukPCGLinearSolver", pcg(true)}, {"JacobiPreconditioner", {{"name", "precond"}}}});
+    NodeSPtr none = createBeam({{"ShewchukPCGLinearSolver", pcg(false)}, {"JacobiPreconditioner", {{"name", "precond"}}}});
+
+    const std::size_t nbAMG = stepAndCountIterations(amg);
+    const std::size_t nbJacobi = stepAndCountIterations(jacobi);
+    const std::size_t nbNone = stepAndCountIterations(none);
+
+    const auto* levelSizes = dynamic_cast<Data<helper::vector<int> >*>(amg->getObject("precond")->findData("levelSizes"));
+    ASSERT_NE(levelSizes, nullptr);
+    EXPECT_GT(levelSizes->getValue().size(), 1u);
+    EXPECT_GT(nbAMG, 0u);
+    EXPECT_LT(2 * nbAMG, nbJacobi);
+    EXPECT_LT(2 * nbAMG, nbNone);
+}
+
+TEST_F(AMGPreconditioner_test, matchesDirectSolve)
+{
+    NodeSPtr amg = createBeam({{"ShewchukPCGLinearSolver", pcg(true)}, {"AMGPreconditioner", {{"name", "precond"}, {"coarseSize", "60"}}}});
+    NodeSPtr direct = createBeam({{"SparseLDLSolver", {{"template", "CompressedRowSparseMatrixMat3x3d"}}}});
+
+    for (int step = 0; step < 5; ++step)
+    {
+        m_simulation->animate(amg.get(), 0.01);
+        m_simulation->animate(direct.get(), 0.01);
+    }
+
+    core::behavior::BaseMechanicalState* expected = direct->getMechanicalState();
+    core::behavior::BaseMechanicalState* state = amg->getMechanicalState();
+    ASSERT_EQ(state->getSize(), expected->getSize());
+    EXPECT_LT(expected->getPY(state->getSize() - 1), 3.0); // the free end is falling
+    for (Size i = 0; i < state->getSize(); ++i)
+    {
+        EXPECT_NEAR(state->getPX(i), expected->getPX(i), 1e-6);
+        EXPECT_NEAR(state->getPY(i), expected->getPY(i), 1e-6);
+        EXPECT_NEAR(state->getPZ(i), expected->getPZ(i), 1e-6);
+    }
+}
+
+TEST_F(AMGPreconditioner_test, hierarchyReuse)
+{
+    AMGPreconditionerTester::SPtr amg = New<AMGPreconditionerTester>();
+    amg->d_coarseSize.setValue(30);
+    amg->d_rigidBodyModes.setValue(false);
+
+    BlockMatrix M;
+    createChainMatrix(100, 0.1, M);
+    amg->invert(M);
+    ASSERT_GT(amg->getNbLevels(), 1u);
+    const AMGPreconditionerTester::LevelMatrix P = amg->getInterpolation(0);
+
+    // same pattern, other values: the interpolation is kept, the coarse matrix is updated
+    BlockMatrix heavier;
+    createChainMatrix(100, 1.0, heavier);
+    amg->invert(heavier);
+    EXPECT_EQ((amg->getInterpolation(0) - P).norm(), 0.0);
+    const AMGPreconditionerTester::LevelMatrix coarse = amg->getInterpolation(0).transpose() * amg->getLevelMatrix(0) * amg->getInterpolation(0);
+    EXPECT_LT((amg->getLevelMatrix(1) - coarse).norm(), 1e-10 * coarse.norm());
+
+    // without reuse, the interpolation is smoothed with the new matrix
+    amg->d_reuseHierarchy.setValue(false);
+    amg->invert(heavier);
+    EXPECT_GT((amg->getInterpolation(0) - P).norm(), 1e-3);
+
+    // new pattern: the hierarchy is rebuilt
+    amg->d_reuseHierarchy.setValue(true);
+    BlockMatrix longer;
+    createChainMatrix(120, 0.1, longer);
+    amg->invert(longer);
+    EXPECT_EQ(amg->getLevelMatrix(0).rows(), 360);
+    EXPECT_EQ(amg->getInterpolation(0).rows(), 360);
+    amg->invert(M);
+    EXPECT_EQ((amg->getInterpolation(0) - P).norm(), 0.0);
+}
+
+} // namespace sofa
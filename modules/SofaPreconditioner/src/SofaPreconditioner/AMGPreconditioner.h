@@ -0,0 +1,129 @@
+/******************************************************************************
+*                 SOFA, Simulation Open-Framework Architecture                *
+*                    (c) 2006 INRIA, USTL, UJF, CNRS, MGH                     *
+*                                                                             *
+* This program is free software; you can redistribute it and/or modify it     *
+* under the terms of the GNU Lesser General Public License as published by    *
+* the Free Software Foundation; either version 2.1 of the License, or (at     *
+* your option) any later version.                                             *
+*                                                                             *
+* This program is distributed in the hope that it will be useful, but WITHOUT *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License *
+* for more details.                                                           *
+*                                                                             *
+* You should have received a copy of the GNU Lesser General Public License    *
+* along with this program. If not, see <http://www.gnu.org/licenses/>.        *
+*******************************************************************************
+* Authors: The SOFA Team and external contributors (see Authors.txt)          *
+*                                                                             *
+* Contact information: contact@sofa-framework.org                             *
+******************************************************************************/
+#ifndef SOFA_COMPONENT_LINEARSOLVER_AMGPRECONDITIONER_H
+#define SOFA_COMPONENT_LINEARSOLVER_AMGPRECONDITIONER_H
+#include <SofaPreconditioner/config.h>
+
+#include <sofa/core/behavior/LinearSolver.h>
+#include <SofaBaseLinearSolver/MatrixLinearSolver.h>
+#include <SofaBaseLinearSolver/CompressedRowSparseMatrix.h>
+#include <SofaBaseLinearSolver/FullVector.h>
+#include <sofa/simulation/TaskScheduler.h>
+
+#include <Eigen/Sparse>
+#include <Eigen/SparseCholesky>
+#include <vector>
+
+namespace sofa
+{
+
+namespace component
+{
+
+namespace linearsolver
+{
+
+/// Preconditioner applying a V-cycle of smoothed aggregation algebraic multigrid (AMG).
+///
+/// The strongly coupled nodes of the matrix are grouped into aggregates, on which the near null space
+/// (the rigid body modes of the mechanical state) is interpolated exactly, then the interpolation is smoothed.
+/// While the pattern of the matrix is unchanged, the aggregates and interpolations are kept and only the
+/// coarse matrices are recomputed. The smoothers are damped Jacobi iterations, which can run in parallel.
+template<class TMatrix, class TVector>
+class AMGPreconditioner : public sofa::component::linearsolver::MatrixLinearSolver<TMatrix,TVector>
+{
+public:
+    SOFA_CLASS(SOFA_TEMPLATE2(AMGPreconditioner,TMatrix,TVector),SOFA_TEMPLATE2(sofa::component::linearsolver::MatrixLinearSolver,TMatrix,TVector));
+
+    typedef TMatrix Matrix;
+    typedef TVector Vector;
+    typedef sofa::component::linearsolver::MatrixLinearSolver<TMatrix,TVector> Inherit;
+    typedef Eigen::SparseMatrix<double,Eigen::RowMajor,int> LevelMatrix;
+    typedef Eigen::VectorXd LevelVector;
+
+    Data<double> d_strengthThreshold; ///< threshold on the coupling between two nodes for them to be aggregated
+    Data<unsigned> d_maxLevels; ///< maximum number of levels of the hierarchy
+    Data<unsigned> d_coarseSize; ///< the coarsening stops below this number of unknowns, the coarsest system is solved directly
+    Data<unsigned> d_smoothingSteps; ///< number of Jacobi iterations before and after the coarse correction
+    Data<bool> d_rigidBodyModes; ///< interpolate the rotations of the nodes besides their translations
+    Data<bool> d_reuseHierarchy; ///< keep the aggregates and interpolations while the pattern of the matrix is unchanged
+    Data<bool> d_parallel; ///< smoothers and matrix-vector products in parallel
+    Data<helper::vector<int> > d_levelSizes; ///< output: number of unknowns of each level
+
+protected:
+    AMGPreconditioner();
+
+public:
+    void solve (Matrix& M, Vector& x, Vector& b) override;
+    void invert(Matrix& M) override;
+
+protected:
+
+    struct Level
+    {
+        LevelMatrix A; ///< matrix of the level
+        LevelMatrix P, R; ///< interpolation from the next level, and restriction to it
+        LevelVector invDiag; ///< inverse of the diagonal of A
+        double omega; ///< weight of the Jacobi iterations
+        LevelVector x, b, r;
+    };
+
+    /// Aggregates of the nodes (sets of consecutive unknowns starting at nodePtr), -1 for the nodes without strong coupling.
+    /// Returns the number of aggregates.
+    int aggregate(const LevelMatrix& A, const helper::vector<int>& nodePtr, helper::vector<int>& aggregates) const;
+
+    /// Orthonormal basis of the near null space B on each aggregate: the columns of P, and the near null space of the coarse level
+    void tentativeInterpolation(const helper::vector<int>& nodePtr, const helper::vector<int>& aggregates, int nbAggregates,
+                                const Eigen::MatrixXd& B, LevelMatrix& P, Eigen::MatrixXd& coarseB, helper::vector<int>& coarseNodePtr) const;
+
+    /// Translations, and rotations around the center of the positions of the mechanical state
+    void nearNullSpace(int n, Eigen::MatrixXd& B);
+
+    void buildHierarchy(const LevelMatrix& A);
+    void updateHierarchy(const LevelMatrix& A);
+    void setupSmoother(Level& level) const;
+    void factorizeCoarsest();
+
+    void vcycle(std::size_t l);
+    void smooth(Level& level);
+    /// r = b - A x
+    void residual(const LevelMatrix& A, const LevelVector& x, const LevelVector& b, LevelVector& r);
+    /// y = A x
+    void product(const LevelMatrix& A, const LevelVector& x, LevelVector& y);
+
+    template<class Function>
+    void forEachRow(int n, const Function& function);
+
+    CompressedRowSparseMatrix<double> Mfiltered;
+    helper::vector<int> patternRowBegin, patternColsIndex; ///< pattern of the hierarchy
+    std::vector<Level> levels;
+    Eigen::SimplicialLDLT<Eigen::SparseMatrix<double> > coarseSolver;
+    simulation::TaskScheduler* scheduler;
+};
+
+} // namespace linearsolver
+
+} // namespace component
+
+} // namespace sofa
+
+#endif
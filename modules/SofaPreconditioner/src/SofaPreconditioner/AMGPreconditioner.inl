@@ -0,0 +1,490 @@
+/******************************************************************************
+*                 SOFA, Simulation Open-Framework Architecture                *
+*                    (c) 2006 INRIA, USTL, UJF, CNRS, MGH                     *
+*                                                                             *
+* This program is free software; you can redistribute it and/or modify it     *
+* under the terms of the GNU Lesser General Public License as published by    *
+* the Free Software Foundation; either version 2.1 of the License, or (at     *
+* your option) any later version.                                             *
+*                                                                             *
+* This program is distributed in the hope that it will be useful, but WITHOUT *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License *
+* for more details.                                                           *
+*                                                                             *
+* You should have received a copy of the GNU Lesser General Public License    *
+* along with this program. If not, see <http://www.gnu.org/licenses/>.        *
+*******************************************************************************
+* Authors: The SOFA Team and external contributors (see Authors.txt)          *
+*                                                                             *
+* Contact information: contact@sofa-framework.org                             *
+******************************************************************************/
+#ifndef SOFA_COMPONENT_LINEARSOLVER_AMGPRECONDITIONER_INL
+#define SOFA_COMPONENT_LINEARSOLVER_AMGPRECONDITIONER_INL
+
+#include <SofaPreconditioner/AMGPreconditioner.h>
+#include <SofaBaseLinearSolver/CompressedRowSparseMatrix.inl>
+#include <sofa/core/behavior/MechanicalState.h>
+#include <sofa/core/objectmodel/BaseContext.h>
+#include <sofa/defaulttype/VecTypes.h>
+#include <sofa/helper/AdvancedTimer.h>
+#include <sofa/simulation/ParallelForEach.h>
+#include <cmath>
+
+namespace sofa
+{
+
+namespace component
+{
+
+namespace linearsolver
+{
+
+template<class TMatrix, class TVector>
+AMGPreconditioner<TMatrix,TVector>::AMGPreconditioner()
+    : d_strengthThreshold( initData(&d_strengthThreshold, 0.08, "strengthThreshold", "Two nodes are aggregated if the norm of their coupling block is larger than this threshold times the geometric mean of the norms of their diagonal blocks") )
+    , d_maxLevels( initData(&d_maxLevels, (unsigned)10, "maxLevels", "Maximum number of levels of the hierarchy") )
+    , d_coarseSize( initData(&d_coarseSize, (unsigned)500, "coarseSize", "The coarsening stops below this number of unknowns, the coarsest system is solved directly") )
+    , d_smoothingSteps( initData(&d_smoothingSteps, (unsigned)1, "smoothingSteps", "Number of damped Jacobi iterations before and after the coarse correction") )
+    , d_rigidBodyModes( initData(&d_rigidBodyModes, true, "rigidBodyModes", "Interpolate the rotations of the nodes besides their translations, using the positions of the mechanical state") )
+    , d_reuseHierarchy( initData(&d_reuseHierarchy, true, "reuseHierarchy", "Keep the aggregates and interpolations while the pattern of the matrix is unchanged, only the coarse matrices are recomputed") )
+    , d_parallel( initData(&d_parallel, false, "parallel", "Smoothers and matrix-vector products in parallel with the TaskScheduler") )
+    , d_levelSizes( initData(&d_levelSizes, "levelSizes", "Output: number of unknowns of each level") )
+    , scheduler(nullptr)
+{
+    d_levelSizes.setReadOnly(true);
+}
+
+template<class TMatrix, class TVector>
+void AMGPreconditioner<TMatrix,TVector>::invert(Matrix& M)
+{
+    sofa::helper::AdvancedTimer::stepBegin("AMG::invert");
+
+    Mfiltered.copyNonZeros(M);
+    Mfiltered.compress();
+
+    // rows of the compressed matrix, including the empty ones
+    const int n = M.rowSize();
+    const auto& rowIndex = Mfiltered.getRowIndex();
+    const auto& rowBegin = Mfiltered.getRowBegin();
+    helper::vector<int> rowPtr(n+1, 0);
+    for (std::size_t i = 0; i < rowIndex.size(); i++) rowPtr[rowIndex[i]+1] = rowBegin[i+1] - rowBegin[i];
+    for (int i = 0; i < n; i++) rowPtr[i+1] += rowPtr[i];
+    const auto& cols = Mfiltered.getColsIndex();
+    helper::vector<int> colsIndex(cols.size());
+    std::copy(cols.begin(), cols.end(), colsIndex.begin());
+
+    const LevelMatrix A = Eigen::Map<const LevelMatrix>(n, n, rowPtr[n], rowPtr.data(), colsIndex.data(), Mfiltered.getColsValue().data());
+
+    if (d_reuseHierarchy.getValue() && !levels.empty() && rowPtr == patternRowBegin && colsIndex == patternColsIndex)
+    {
+        updateHierarchy(A);
+    }
+    else
+    {
+        buildHierarchy(A);
+        patternRowBegin.swap(rowPtr);
+        patternColsIndex.swap(colsIndex);
+    }
+    factorizeCoarsest();
+
+    helper::WriteOnlyAccessor<Data<helper::vector<int> > > levelSizes = d_levelSizes;
+    levelSizes.clear();
+    for (Level& level : levels)
+    {
+        const int size = level.A.rows();
+        level.x.resize(size);
+        level.b.resize(size);
+        level.r.resize(size);
+        levelSizes.push_back(size);
+    }
+    msg_info() << "levels: " << levelSizes.ref();
+
+    sofa::helper::AdvancedTimer::stepEnd("AMG::invert");
+}
+
+template<class TMatrix, class TVector>
+void AMGPreconditioner<TMatrix,TVector>::solve (Matrix& /*M*/, Vector& z, Vector& r)
+{
+    if (levels.empty()) return;
+
+    scheduler = d_parallel.getValue() ? simulation::TaskScheduler::getInstance() : nullptr;
+
+    Level& fine = levels.front();
+    const int n = fine.A.rows();
+    for (int i = 0; i < n; i++) fine.b[i] = r[i];
+    vcycle(0);
+    for (int i = 0; i < n; i++) z[i] = fine.x[i];
+}
+
+template<class TMatrix, class TVector>
+void AMGPreconditioner<TMatrix,TVector>::nearNullSpace(int n, Eigen::MatrixXd& B)
+{
+    typedef core::behavior::MechanicalState<defaulttype::Vec3Types> MState;
+    const int nodeSize = Matrix::NL;
+    const int nbNodes = n / nodeSize;
+
+    MState* mstate = dynamic_cast<MState*>(this->getContext()->getMechanicalState());
+    const bool rotations = d_rigidBodyModes.getValue() && nodeSize == 3 && mstate != nullptr && int(mstate->getSize()) == nbNodes;
+    if (d_rigidBodyModes.getValue() && !rotations)
+    {
+        msg_info() << "the system is not made of the positions of a single mechanical state: only the translations are interpolated";
+    }
+
+    B.setZero(n, nodeSize + (rotations ? 3 : 0));
+    for (int i = 0; i < nbNodes; i++)
+    {
+        for (int c = 0; c < nodeSize; c++) B(i*nodeSize+c, c) = 1.0;
+    }
+
+    if (rotations)
+    {
+        helper::ReadAccessor<Data<MState::VecCoord> > x = *mstate->read(core::ConstVecCoordId::position());
+        MState::Coord center;
+        for (int i = 0; i < nbNodes; i++) center += x[i];
+        center /= nbNodes;
+
+        for (int i = 0; i < nbNodes; i++)
+        {
+            const MState::Coord p = x[i] - center;
+            B(3*i+1, 3) = -p[2]; B(3*i+2, 3) =  p[1];
+            B(3*i  , 4) =  p[2]; B(3*i+2, 4) = -p[0];
+            B(3*i  , 5) = -p[1]; B(3*i+1, 5) =  p[0];
+        }
+    }
+}
+
+template<class TMatrix, class TVector>
+int AMGPreconditioner<TMatrix,TVector>::aggregate(const LevelMatrix& A, const helper::vector<int>& nodePtr, helper::vector<int>& aggregates) const
+{
+    const int nbNodes = nodePtr.size() - 1;
+    const double theta2 = d_strengthThreshold.getValue() * d_strengthThreshold.getValue();
+
+    helper::vector<int> nodeOf(nodePtr.back());
+    for (int i = 0; i < nbNodes; i++)
+    {
+        for (int d = nodePtr[i]; d < nodePtr[i+1]; d++) nodeOf[d] = i;
+    }
+
+    // squared norms of the blocks between the nodes
+    helper::vector<double> diag(nbNodes, 0.0);
+    for (int i = 0; i < nbNodes; i++)
+    {
+        for (int d = nodePtr[i]; d < nodePtr[i+1]; d++)
+        {
+            for (LevelMatrix::InnerIterator it(A, d); it; ++it)
+            {
+                if (nodeOf[it.col()] == i) diag[i] += it.value() * it.value();
+            }
+        }
+    }
+
+    // strong couplings: |A_ij| >= theta sqrt(|A_ii| |A_jj|)
+    helper::vector<int> strongPtr(nbNodes+1, 0), strong;
+    helper::vector<double> strength, block(nbNodes, 0.0);
+    helper::vector<int> neighbours;
+    for (int i = 0; i < nbNodes; i++)
+    {
+        for (int d = nodePtr[i]; d < nodePtr[i+1]; d++)
+        {
+            for (LevelMatrix::InnerIterator it(A, d); it; ++it)
+            {
+                const int j = nodeOf[it.col()];
+                if (j == i) continue;
+                if (block[j] == 0.0) neighbours.push_back(j);
+                block[j] += it.value() * it.value();
+            }
+        }
+        for (int j : neighbours)
+        {
+            if (block[j] >= theta2 * std::sqrt(diag[i] * diag[j]))
+            {
+                strong.push_back(j);
+                strength.push_back(block[j] / std::sqrt(diag[i] * diag[j]));
+            }
+            block[j] = 0.0;
+        }
+        neighbours.clear();
+        strongPtr[i+1] = strong.size();
+    }
+
+    // 1. a node with all its strong neighbours, when none of them is aggregated yet
+    aggregates.assign(nbNodes, -1);
+    int nbAggregates = 0;
+    for (int i = 0; i < nbNodes; i++)
+    {
+        if (aggregates[i] != -1 || strongPtr[i] == strongPtr[i+1]) continue;
+        bool free = true;
+        for (int p = strongPtr[i]; p < strongPtr[i+1] && free; p++) free = aggregates[strong[p]] == -1;
+        if (!free) continue;
+
+        aggregates[i] = nbAggregates;
+        for (int p = strongPtr[i]; p < strongPtr[i+1]; p++) aggregates[strong[p]] = nbAggregates;
+        nbAggregates++;
+    }
+
+    // 2. the other coupled nodes join the aggregate of their most strongly coupled neighbour of the first pass
+    const helper::vector<int> firstPass = aggregates;
+    for (int i = 0; i < nbNodes; i++)
+    {
+        if (aggregates[i] != -1 || strongPtr[i] == strongPtr[i+1]) continue;
+        int best = -1;
+        for (int p = strongPtr[i]; p < strongPtr[i+1]; p++)
+        {
+            if (firstPass[strong[p]] != -1 && (best == -1 || strength[p] > strength[best])) best = p;
+        }
+        aggregates[i] = best != -1 ? firstPass[strong[best]] : nbAggregates++;
+    }
+
+    // the nodes without strong coupling (e.g. fixed) are left to the smoother
+    return nbAggregates;
+}
+
+template<class TMatrix, class TVector>
+void AMGPreconditioner<TMatrix,TVector>::tentativeInterpolation(const helper::vector<int>& nodePtr, const helper::vector<int>& aggregates, int nbAggregates,
+                                                               const Eigen::MatrixXd& B, LevelMatrix& P, Eigen::MatrixXd& coarseB, helper::vector<int>& coarseNodePtr) const
+{
+    const int nbNodes = nodePtr.size() - 1;
+    const int k = B.cols();
+
+    // nodes of each aggregate
+    helper::vector<int> aggregatePtr(nbAggregates+1, 0), aggregateNodes;
+    for (int i = 0; i < nbNodes; i++)
+    {
+        if (aggregates[i] != -1) aggregatePtr[aggregates[i]+1]++;
+    }
+    for (int a = 0; a < nbAggregates; a++) aggregatePtr[a+1] += aggregatePtr[a];
+    aggregateNodes.resize(aggregatePtr[nbAggregates]);
+    {
+        helper::vector<int> position(aggregatePtr.begin(), aggregatePtr.end() - 1);
+        for (int i = 0; i < nbNodes; i++)
+        {
+            if (aggregates[i] != -1) aggregateNodes[position[aggregates[i]]++] = i;
+        }
+    }
+
+    std::vector<Eigen::Triplet<double> > triplets;
+    std::vector<Eigen::MatrixXd> coarseRows(nbAggregates);
+    coarseNodePtr.assign(1, 0);
+    helper::vector<int> dofs;
+    for (int a = 0; a < nbAggregates; a++)
+    {
+        dofs.clear();
+        for (int p = aggregatePtr[a]; p < aggregatePtr[a+1]; p++)
+        {
+            for (int d = nodePtr[aggregateNodes[p]]; d < nodePtr[aggregateNodes[p]+1]; d++) dofs.push_back(d);
+        }
+        const int m = dofs.size();
+        Eigen::MatrixXd localB(m, k);
+        for (int r = 0; r < m; r++) localB.row(r) = B.row(dofs[r]);
+
+        // Gram-Schmidt on the modes, without the ones which are dependent on this aggregate
+        Eigen::MatrixXd Q(m, std::min(m, k));
+        int kept = 0;
+        for (int c = 0; c < k && kept < m; c++)
+        {
+            Eigen::VectorXd v = localB.col(c);
+            const double norm0 = v.norm();
+            if (norm0 == 0.0) continue;
+            for (int pass = 0; pass < 2; pass++)
+            {
+                for (int q = 0; q < kept; q++) v -= Q.col(q).dot(v) * Q.col(q);
+            }
+            const double norm = v.norm();
+            if (norm <= 1e-8 * norm0) continue;
+            Q.col(kept++) = v / norm;
+        }
+
+        for (int r = 0; r < m; r++)
+        {
+            for (int q = 0; q < kept; q++) triplets.emplace_back(dofs[r], coarseNodePtr.back() + q, Q(r, q));
+        }
+        coarseRows[a] = Q.leftCols(kept).transpose() * localB;
+        coarseNodePtr.push_back(coarseNodePtr.back() + kept);
+    }
+
+    P.resize(nodePtr.back(), coarseNodePtr.back());
+    P.setFromTriplets(triplets.begin(), triplets.end());
+    coarseB.resize(coarseNodePtr.back(), k);
+    for (int a = 0; a < nbAggregates; a++) coarseB.middleRows(coarseNodePtr[a], coarseRows[a].rows()) = coarseRows[a];
+}
+
+template<class TMatrix, class TVector>
+void AMGPreconditioner<TMatrix,TVector>::setupSmoother(Level& level) const
+{
+    const LevelMatrix& A = level.A;
+    const int n = A.rows();
+
+    level.invDiag.setZero(n);
+    for (int i = 0; i < n; i++)
+    {
+        for (LevelMatrix::InnerIterator it(A, i); it; ++it)
+        {
+            if (it.col() == i && it.value() != 0.0) level.invDiag[i] = 1.0 / it.value();
+        }
+    }
+
+    // largest eigenvalue of D^-1 A, by power iterations
+    LevelVector v(n);
+    for (int i = 0; i < n; i++) v[i] = 1.0 + 0.5 * std::sin(double(i));
+    v.normalize();
+    double rho = 0.0;
+    for (int it = 0; it < 15; it++)
+    {
+        const LevelVector w = level.invDiag.cwiseProduct(A * v);
+        rho = w.norm();
+        if (rho == 0.0) break;
+        v = w / rho;
+    }
+    level.omega = rho > 0.0 ? 4.0 / (3.0 * rho) : 1.0;
+}
+
+template<class TMatrix, class TVector>
+void AMGPreconditioner<TMatrix,TVector>::buildHierarchy(const LevelMatrix& A)
+{
+    const int n = A.rows();
+    levels.clear();
+    levels.emplace_back();
+    levels.back().A = A;
+
+    Eigen::MatrixXd B;
+    nearNullSpace(n, B);
+    helper::vector<int> nodePtr(n / Matrix::NL + 1);
+    for (std::size_t i = 0; i < nodePtr.size(); i++) nodePtr[i] = i * Matrix::NL;
+
+    while (true)
+    {
+        const std::size_t l = levels.size() - 1;
+        setupSmoother(levels[l]);
+
+        const int size = levels[l].A.rows();
+        if (size <= int(d_coarseSize.getValue()) || levels.size() >= d_maxLevels.getValue()) break;
+
+        helper::vector<int> aggregates;
+        const int nbAggregates = aggregate(levels[l].A, nodePtr, aggregates);
+        if (nbAggregates == 0) break;
+
+        LevelMatrix tentative;
+        Eigen::MatrixXd coarseB;
+        helper::vector<int> coarseNodePtr;
+        tentativeInterpolation(nodePtr, aggregates, nbAggregates, B, tentative, coarseB, coarseNodePtr);
+        if (tentative.cols() >= size) break;
+
+        // smoothed interpolation: P = (I - omega D^-1 A) tentative
+        Level& level = levels[l];
+        const LevelMatrix AP = level.A * tentative;
+        level.P = tentative - LevelMatrix((level.omega * level.invDiag).asDiagonal() * AP);
+        level.P.makeCompressed();
+        level.R = level.P.transpose();
+        level.R.makeCompressed();
+
+        const LevelMatrix coarse = level.R * level.A * level.P;
+        levels.emplace_back();
+        levels.back().A = coarse;
+        levels.back().A.makeCompressed();
+
+        B.swap(coarseB);
+        nodePtr.swap(coarseNodePtr);
+    }
+}
+
+template<class TMatrix, class TVector>
+void AMGPreconditioner<TMatrix,TVector>::updateHierarchy(const LevelMatrix& A)
+{
+    levels.front().A = A;
+    for (std::size_t l = 0; l + 1 < levels.size(); l++)
+    {
+        Level& level = levels[l];
+        setupSmoother(level);
+        levels[l+1].A = level.R * level.A * level.P;
+        levels[l+1].A.makeCompressed();
+    }
+}
+
+template<class TMatrix, class TVector>
+void AMGPreconditioner<TMatrix,TVector>::factorizeCoarsest()
+{
+    const Eigen::SparseMatrix<double> coarse = levels.back().A;
+    coarseSolver.compute(coarse);
+    if (coarseSolver.info() != Eigen::Success)
+    {
+        msg_error() << "Failed to factorize the coarsest level (" << coarse.rows() << " unknowns)";
+    }
+}
+
+template<class TMatrix, class TVector>
+void AMGPreconditioner<TMatrix,TVector>::vcycle(std::size_t l)
+{
+    Level& level = levels[l];
+    if (l + 1 == levels.size())
+    {
+        level.x = coarseSolver.solve(level.b);
+        return;
+    }
+
+    Level& coarse = levels[l+1];
+    level.x.setZero();
+    smooth(level);
+
+    residual(level.A, level.x, level.b, level.r);
+    product(level.R, level.r, coarse.b);
+    vcycle(l+1);
+    product(level.P, coarse.x, level.r);
+    level.x += level.r;
+
+    smooth(level);
+}
+
+template<class TMatrix, class TVector>
+void AMGPreconditioner<TMatrix,TVector>::smooth(Level& level)
+{
+    const double omega = level.omega;
+    for (unsigned s = 0; s < d_smoothingSteps.getValue(); s++)
+    {
+        residual(level.A, level.x, level.b, level.r);
+        forEachRow(level.A.rows(), [&](int i) { level.x[i] += omega * level.invDiag[i] * level.r[i]; });
+    }
+}
+
+template<class TMatrix, class TVector>
+void AMGPreconditioner<TMatrix,TVector>::residual(const LevelMatrix& A, const LevelVector& x, const LevelVector& b, LevelVector& r)
+{
+    const int* outer = A.outerIndexPtr();
+    const int* inner = A.innerIndexPtr();
+    const double* values = A.valuePtr();
+    forEachRow(A.rows(), [&](int i) {
+        double acc = b[i];
+        for (int p = outer[i]; p < outer[i+1]; p++) acc -= values[p] * x[inner[p]];
+        r[i] = acc;
+    });
+}
+
+template<class TMatrix, class TVector>
+void AMGPreconditioner<TMatrix,TVector>::product(const LevelMatrix& A, const LevelVector& x, LevelVector& y)
+{
+    const int* outer = A.outerIndexPtr();
+    const int* inner = A.innerIndexPtr();
+    const double* values = A.valuePtr();
+    forEachRow(A.rows(), [&](int i) {
+        double acc = 0.0;
+        for (int p = outer[i]; p < outer[i+1]; p++) acc += values[p] * x[inner[p]];
+        y[i] = acc;
+    });
+}
+
+template<class TMatrix, class TVector>
+template<class Function>
+void AMGPreconditioner<TMatrix,TVector>::forEachRow(int n, const Function& function)
+{
+    // the coarse levels are too small to be worth the tasks
+    if (scheduler && n > 1024) simulation::parallelForEach(*scheduler, simulation::Range<int>(0, n), 0, function);
+    else for (int i = 0; i < n; i++) function(i);
+}
+
+} // namespace linearsolver
+
+} // namespace component
+
+} // namespace sofa
+
+#endif
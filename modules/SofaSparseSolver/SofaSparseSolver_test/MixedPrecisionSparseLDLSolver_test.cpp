@@ -0,0 +1,166 @@
+/******************************************************************************
+*                 SOFA, Simulation Open-Framework Architecture                *
+*                    (c) 2006 INRIA, USTL, UJF, CNRS, MGH                     *
+*                                                                             *
+* This program is free software; you can redistribute it and/or modify it     *
+* under the terms of the GNU Lesser General Public License as published by    *
+* the Free Software Foundation; either version 2.1 of the License, or (at     *
+* your option) any later version.                                             *
+*                                                                             *
+* This program is distributed in the hope that it will be useful, but WITHOUT *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License *
+* for more details.                                                           *
+*                                                                             *
+* You should have received a copy of the GNU Lesser General Public License    *
+* along with this program. If not, see <http://www.gnu.org/licenses/>.        *
+*******************************************************************************
+* Authors: The SOFA Team and external contributors (see Authors.txt)          *
+*                                                                             *
+* Contact information: contact@sofa-framework.org                             *
+******************************************************************************/
+#include <SofaSparseSolver/MixedPrecisionSparseLDLSolver.h>
+#include <SofaSparseSolver/SparseLDLSolver.h>
+#include <sofa/helper/testing/BaseTest.h>
+
+namespace sofa
+{
+
+using namespace component::linearsolver;
+using core::objectmodel::New;
+
+// springs between the neighbour nodes of a regular grid, plus a mass term (3 dofs per node)
+// stiff springs along x make the system ill-conditioned for a single precision factorization
+template<class TMatrix>
+static void createGridMatrix(int nx, int ny, int nz, double massFactor, double stiffnessX, TMatrix& M)
+{
+    const int n = 3 * nx * ny * nz;
+    M.resize(n, n);
+    auto node = [&](int x, int y, int z) { return (z * ny + y) * nx + x; };
+
+    for (int z = 0; z < nz; ++z)
+    for (int y = 0; y < ny; ++y)
+    for (int x = 0; x < nx; ++x)
+    {
+        const int a = node(x, y, z);
+        for (int c = 0; c < 3; ++c)
+        {
+            M.add(3 * a + c, 3 * a + c, massFactor);
+        }
+
+        const int neighbours[3][3] = { {1, 0, 0}, {0, 1, 0}, {0, 0, 1} };
+        for (const auto& d : neighbours)
+        {
+            if (x + d[0] >= nx || y + d[1] >= ny || z + d[2] >= nz) continue;
+            const int b = node(x + d[0], y + d[1], z + d[2]);
+            const double k = d[0] ? stiffnessX : 1.0;
+            for (int c = 0; c < 3; ++c)
+            {
+                M.add(3 * a + c, 3 * a + c, k);
+                M.add(3 * b + c, 3 * b + c, k);
+                M.add(3 * a + c, 3 * b + c, -k);
+                M.add(3 * b + c, 3 * a + c, -k);
+            }
+        }
+    }
+    M.compress();
+}
+
+template<class TMatrix>
+struct MixedPrecisionSparseLDLSolver_test : public helper::testing::BaseTest
+{
+    typedef MixedPrecisionSparseLDLSolver< TMatrix, FullVector<double> > Solver;
+
+    TMatrix M;
+    FullVector<double> b;
+
+    void onSetUp() override
+    {
+        createGridMatrix(6, 5, 4, 1e-2, 1e3, M);
+        b.resize(M.rowSize());
+        for (int i = 0; i < b.size(); ++i)
+        {
+            b[i] = std::sin(double(i));
+        }
+    }
+
+    double relativeResidual(const FullVector<double>& x)
+    {
+        FullVector<double> r;
+        r.resize(b.size());
+        M.mul(r, x);
+        for (int i = 0; i < b.size(); ++i)
+        {
+            r[i] -= b[i];
+        }
+        return r.norm() / b.norm();
+    }
+};
+
+typedef ::testing::Types<
+    CompressedRowSparseMatrix<double>,
+    CompressedRowSparseMatrix<defaulttype::Mat<3,3,double> >
+> MatrixTypes;
+TYPED_TEST_SUITE(MixedPrecisionSparseLDLSolver_test, MatrixTypes);
+
+TYPED_TEST(MixedPrecisionSparseLDLSolver_test, refinementReachesDoublePrecision)
+{
+    typename TestFixture::Solver::SPtr solver = New<typename TestFixture::Solver>();
+    solver->d_tolerance.setValue(1e-12);
+
+    FullVector<double> x;
+    solver->invert(this->M);
+    solver->solve(this->M, x, this->b);
+
+    EXPECT_LT(this->relativeResidual(x), 1e-12);
+    EXPECT_DOUBLE_EQ(solver->d_residual.getValue(), this->relativeResidual(x));
+    // the single precision solve alone is not accurate enough
+    EXPECT_GT(solver->d_refinementIterations.getValue(), 0u);
+    EXPECT_LE(solver->d_refinementIterations.getValue(), solver->d_maxIterations.getValue());
+
+    // the same solution as the double precision factorization
+    typedef SparseLDLSolver< CompressedRowSparseMatrix<double>, FullVector<double> > DoubleSolver;
+    DoubleSolver::SPtr reference = New<DoubleSolver>();
+    CompressedRowSparseMatrix<double> Mdouble;
+    createGridMatrix(6, 5, 4, 1e-2, 1e3, Mdouble);
+    FullVector<double> xReference;
+    xReference.resize(this->b.size());
+    reference->invert(Mdouble);
+    reference->solve(Mdouble, xReference, this->b);
+    for (int i = 0; i < x.size(); ++i)
+    {
+        EXPECT_NEAR(x[i], xReference[i], 1e-8 * std::abs(xReference[i]) + 1e-10);
+    }
+}
+
+TYPED_TEST(MixedPrecisionSparseLDLSolver_test, solutionInRightHandSide)
+{
+    typename TestFixture::Solver::SPtr solver = New<typename TestFixture::Solver>();
+
+    FullVector<double> x, xb = this->b;
+    solver->invert(this->M);
+    solver->solve(this->M, x, this->b);
+    solver->solve(this->M, xb, xb);
+
+    for (int i = 0; i < x.size(); ++i)
+    {
+        EXPECT_EQ(xb[i], x[i]);
+    }
+}
+
+TYPED_TEST(MixedPrecisionSparseLDLSolver_test, maxIterations)
+{
+    typename TestFixture::Solver::SPtr solver = New<typename TestFixture::Solver>();
+    solver->d_tolerance.setValue(0.0);
+    solver->d_maxIterations.setValue(2);
+
+    FullVector<double> x;
+    solver->invert(this->M);
+    {
+        EXPECT_MSG_EMIT(Warning);
+        solver->solve(this->M, x, this->b);
+    }
+    EXPECT_EQ(solver->d_refinementIterations.getValue(), 2u);
+}
+
+} // namespace sofa
@@ -0,0 +1,152 @@
+/******************************************************************************
+*                 SOFA, Simulation Open-Framework Architecture                *
+*                    (c) 2006 INRIA, USTL, UJF, CNRS, MGH                     *
+*                                                                             *
+* This program is free software; you can redistribute it and/or modify it     *
+* under the terms of the GNU Lesser General Public License as published by    *
+* the Free Software Foundation; either version 2.1 of the License, or (at     *
+* your option) any later version.                                             *
+*                                                                             *
+* This program is distributed in the hope that it will be useful, but WITHOUT *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License *
+* for more details.                                                           *
+*                                                                             *
+* You should have received a copy of the GNU Lesser General Public License    *
+* along with this program. If not, see <http://www.gnu.org/licenses/>.        *
+*******************************************************************************
+* Authors: The SOFA Team and external contributors (see Authors.txt)          *
+*                                                                             *
+* Contact information: contact@sofa-framework.org                             *
+******************************************************************************/
+#include <SofaSparseSolver/SparseLDLSolver.h>
+#include <sofa/simulation/DefaultTaskScheduler.h>
+
+#include <benchmark/benchmark.h>
+
+#include <cmath>
+#include <thread>
+
+using namespace sofa;
+using namespace sofa::component::linearsolver;
+using sofa::core::objectmodel::New;
+
+namespace
+{
+
+typedef SparseLDLSolver< CompressedRowSparseMatrix<double>, FullVector<double> > Solver;
+
+/// stiffness of the springs between the neighbour nodes of a n^3 grid, plus a mass term (3 dofs per node)
+void createGridMatrix(int n, CompressedRowSparseMatrix<double>& M)
+{
+    const int size = 3 * n * n * n;
+    M.resize(size, size);
+    auto node = [n](int x, int y, int z) { return (z * n + y) * n + x; };
+
+    for (int z = 0; z < n; ++z)
+    for (int y = 0; y < n; ++y)
+    for (int x = 0; x < n; ++x)
+    {
+        const int a = node(x, y, z);
+        for (int c = 0; c < 3; ++c)
+            M.add(3 * a + c, 3 * a + c, 1.0);
+
+        for (int dz = 0; dz <= 1; ++dz)
+        for (int dy = -1; dy <= 1; ++dy)
+        for (int dx = -1; dx <= 1; ++dx)
+        {
+            // each spring once
+            if (dz == 0 && (dy < 0 || (dy == 0 && dx <= 0))) continue;
+            if (x + dx < 0 || x + dx >= n || y + dy < 0 || y + dy >= n || z + dz >= n) continue;
+
+            const int b = node(x + dx, y + dy, z + dz);
+            const double d[3] = { double(dx), double(dy), double(dz) };
+            const double length2 = d[0] * d[0] + d[1] * d[1] + d[2] * d[2];
+            for (int i = 0; i < 3; ++i)
+                for (int j = 0; j < 3; ++j)
+                {
+                    const double k = d[i] * d[j] / length2 + (i == j ? 0.1 : 0.0);
+                    M.add(3 * a + i, 3 * a + j, k);
+                    M.add(3 * b + i, 3 * b + j, k);
+                    M.add(3 * a + i, 3 * b + j, -k);
+                    M.add(3 * b + i, 3 * a + j, -k);
+                }
+        }
+    }
+    M.compress();
+}
+
+/// constraint rows on 3 dofs of a node and on another dof
+void createJacobian(int nbRows, int nbCols, SparseMatrix<double>& J)
+{
+    J.resize(nbRows, nbCols);
+    for (int i = 0; i < nbRows; ++i)
+    {
+        const int node = (i * 7919) % (nbCols / 3);
+        for (int c = 0; c < 3; ++c)
+            J.add(i, 3 * node + c, std::cos(double(i + c)));
+        J.add(i, (i * 104729) % nbCols, 0.5);
+    }
+}
+
+/// numeric factorization, the ordering and the symbolic factorization being done before the timing
+/// arg 0: grid size, arg 1: 0 scalar, 1 supernodal, 2 parallel supernodal
+void BM_SparseLDL_factorization(benchmark::State& state)
+{
+    CompressedRowSparseMatrix<double> M;
+    createGridMatrix(int(state.range(0)), M);
+
+    simulation::TaskScheduler* scheduler = simulation::TaskScheduler::create(simulation::DefaultTaskScheduler::name());
+    scheduler->init(std::thread::hardware_concurrency());
+
+    const char* modes[] = { "scalar", "supernodal", "parallel supernodal" };
+    state.SetLabel(modes[state.range(1)]);
+
+    Solver::SPtr solver = New<Solver>();
+    solver->d_supernodal.setValue(state.range(1) > 0);
+    solver->d_parallelFactorization.setValue(state.range(1) > 1);
+    solver->invert(M);
+
+    for (auto _ : state)
+    {
+        solver->invert(M);
+    }
+    state.counters["dofs"] = double(M.rowSize());
+
+    scheduler->stop();
+}
+
+/// J A^-1 J^T, arg 0: number of constraint rows, arg 1: parallel
+void BM_SparseLDL_inverseProduct(benchmark::State& state)
+{
+    CompressedRowSparseMatrix<double> M;
+    createGridMatrix(12, M);
+    SparseMatrix<double> J;
+    createJacobian(int(state.range(0)), M.colSize(), J);
+
+    simulation::TaskScheduler* scheduler = simulation::TaskScheduler::create(simulation::DefaultTaskScheduler::name());
+    scheduler->init(std::thread::hardware_concurrency());
+
+    Solver::SPtr solver = New<Solver>();
+    solver->d_parallelInverseProduct.setValue(state.range(1) != 0);
+    state.SetLabel(state.range(1) ? "parallel" : "sequential");
+    solver->invert(M);
+
+    FullMatrix<double> W;
+    W.resize(J.rowSize(), J.rowSize());
+    for (auto _ : state)
+    {
+        W.clear();
+        solver->addJMInvJtLocal(&M, &W, &J, 1.0);
+        benchmark::DoNotOptimize(W.ptr());
+    }
+
+    scheduler->stop();
+}
+
+} // namespace
+
+BENCHMARK(BM_SparseLDL_factorization)->Args({12, 0})->Args({12, 1})->Args({12, 2})->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK(BM_SparseLDL_inverseProduct)->Args({600, 0})->Args({600, 1})->Unit(benchmark::kMillisecond)->UseRealTime();
+
+BENCHMARK_MAIN();
@@ -0,0 +1,355 @@
+/******************************************************************************
+*                 SOFA, Simulation Open-Framework Architecture                *
+*                    (c) 2006 INRIA, USTL, UJF, CNRS, MGH                     *
+*                                                                             *
+* This program is free software; you can redistribute it and/or modify it     *
+* under the terms of the GNU Lesser General Public License as published by    *
+* the Free Software Foundation; either version 2.1 of the License, or (at     *
+* your option) any later version.                                             *
+*                                                                             *
+* This program is distributed in the hope that it will be useful, but WITHOUT *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License *
+* for more details.                                                           *
+*                                                                             *
+* You should have received a copy of the GNU Lesser General Public License    *
+* along with this program. If not, see <http://www.gnu.org/licenses/>.        *
+*******************************************************************************
+* Authors: The SOFA Team and external contributors (see Authors.txt)          *
+*                                                                             *
+* Contact information: contact@sofa-framework.org                             *
+******************************************************************************/
+#include <SofaSparseSolver/SparseLDLSolver.h>
+#include <sofa/simulation/DefaultTaskScheduler.h>
+#include <sofa/helper/testing/BaseTest.h>
+#include <sofa/helper/testing/TestMessageHandler.h>
+
+#include <cmath>
+#include <thread>
+
+namespace sofa
+{
+
+using namespace component::linearsolver;
+using core::objectmodel::New;
+
+typedef SparseLDLSolver< CompressedRowSparseMatrix<double>, FullVector<double> > Solver;
+
+// stiffness of a network of springs between the neighbour nodes of a regular grid, plus a mass term:
+// a symmetric positive definite matrix with the structure of a hexahedral FEM mesh (3 dofs per node)
+static void createGridMatrix(int nx, int ny, int nz, double massFactor, CompressedRowSparseMatrix<double>& M)
+{
+    const int n = 3 * nx * ny * nz;
+    M.resize(n, n);
+    auto node = [&](int x, int y, int z) { return (z * ny + y) * nx + x; };
+
+    for (int z = 0; z < nz; ++z)
+    for (int y = 0; y < ny; ++y)
+    for (int x = 0; x < nx; ++x)
+    {
+        const int a = node(x, y, z);
+        for (int c = 0; c < 3; ++c)
+        {
+            M.add(3 * a + c, 3 * a + c, massFactor);
+        }
+
+        for (int dz = 0; dz <= 1; ++dz)
+        for (int dy = -1; dy <= 1; ++dy)
+        for (int dx = -1; dx <= 1; ++dx)
+        {
+            // each spring once
+            if (dz == 0 && (dy < 0 || (dy == 0 && dx <= 0))) continue;
+            if (x + dx < 0 || x + dx >= nx || y + dy < 0 || y + dy >= ny || z + dz >= nz) continue;
+
+            const int b = node(x + dx, y + dy, z + dz);
+            const double d[3] = { double(dx), double(dy), double(dz) };
+            const double length2 = d[0] * d[0] + d[1] * d[1] + d[2] * d[2];
+            for (int i = 0; i < 3; ++i)
+            {
+                for (int j = 0; j < 3; ++j)
+                {
+                    const double k = d[i] * d[j] / length2 + (i == j ? 0.1 : 0.0);
+                    M.add(3 * a + i, 3 * a + j, k);
+                    M.add(3 * b + i, 3 * b + j, k);
+                    M.add(3 * a + i, 3 * b + j, -k);
+                    M.add(3 * b + i, 3 * a + j, -k);
+                }
+            }
+        }
+    }
+    M.compress();
+}
+
+static double residual(CompressedRowSparseMatrix<double>& M, FullVector<double>& x, FullVector<double>& b)
+{
+    FullVector<double> r;
+    r.resize(b.size());
+    M.mul(r, x);
+    double norm = 0;
+    for (int i = 0; i < b.size(); ++i)
+    {
+        norm = std::max(norm, std::abs(r[i] - b[i]));
+    }
+    return norm;
+}
+
+static void factorizeAndSolve(Solver* solver, CompressedRowSparseMatrix<double>& M, FullVector<double>& x, FullVector<double>& b)
+{
+    x.resize(b.size());
+    solver->invert(M);
+    solver->solve(M, x, b);
+}
+
+struct SparseLDLSolver_test : public helper::testing::BaseTest
+{
+    CompressedRowSparseMatrix<double> M;
+    FullVector<double> b;
+
+    void onSetUp() override
+    {
+        createGridMatrix(6, 5, 4, 1.0, M);
+        b.resize(M.rowSize());
+        for (int i = 0; i < b.size(); ++i)
+        {
+            b[i] = std::sin(double(i));
+        }
+    }
+};
+
+TEST_F(SparseLDLSolver_test, supernodalMatchesScalar)
+{
+    Solver::SPtr scalar = New<Solver>();
+    scalar->d_supernodal.setValue(false);
+    Solver::SPtr supernodal = New<Solver>();
+    supernodal->d_supernodal.setValue(true);
+
+    FullVector<double> xScalar, xSupernodal;
+    factorizeAndSolve(scalar.get(), M, xScalar, b);
+    factorizeAndSolve(supernodal.get(), M, xSupernodal, b);
+
+    EXPECT_LT(residual(M, xSupernodal, b), 1e-10);
+    for (int i = 0; i < b.size(); ++i)
+    {
+        EXPECT_NEAR(xSupernodal[i], xScalar[i], 1e-10);
+    }
+}
+
+TEST_F(SparseLDLSolver_test, refactorizeSamePattern)
+{
+    Solver::SPtr solver = New<Solver>();
+
+    FullVector<double> x;
+    factorizeAndSolve(solver.get(), M, x, b);
+
+    // same structure, other values: the symbolic factorization is reused
+    CompressedRowSparseMatrix<double> M2;
+    createGridMatrix(6, 5, 4, 3.0, M2);
+    factorizeAndSolve(solver.get(), M2, x, b);
+    EXPECT_LT(residual(M2, x, b), 1e-10);
+
+    // other structure
+    CompressedRowSparseMatrix<double> M3;
+    createGridMatrix(4, 4, 7, 1.0, M3);
+    FullVector<double> b3;
+    b3.resize(M3.rowSize());
+    for (int i = 0; i < b3.size(); ++i)
+    {
+        b3[i] = 1.0;
+    }
+    factorizeAndSolve(solver.get(), M3, x, b3);
+    EXPECT_LT(residual(M3, x, b3), 1e-10);
+}
+
+TEST_F(SparseLDLSolver_test, parallelFactorization)
+{
+    simulation::TaskScheduler* scheduler = simulation::TaskScheduler::create(simulation::DefaultTaskScheduler::name());
+    scheduler->init(4);
+
+    Solver::SPtr sequential = New<Solver>();
+    sequential->d_supernodal.setValue(true);
+    Solver::SPtr parallel = New<Solver>();
+    parallel->d_supernodal.setValue(true);
+    parallel->d_parallelFactorization.setValue(true);
+
+    FullVector<double> xSequential, xParallel;
+    factorizeAndSolve(sequential.get(), M, xSequential, b);
+    factorizeAndSolve(parallel.get(), M, xParallel, b);
+
+    // each supernode is factorized the same way whatever the thread
+    for (int i = 0; i < b.size(); ++i)
+    {
+        EXPECT_EQ(xParallel[i], xSequential[i]);
+    }
+
+    scheduler->stop();
+}
+
+TEST_F(SparseLDLSolver_test, asyncFactorization)
+{
+    Solver::SPtr solver = New<Solver>();
+    solver->d_asyncFactorization.setValue(true);
+
+    // large enough for the background factorization to last longer than the next solve
+    CompressedRowSparseMatrix<double> M1, M2;
+    createGridMatrix(10, 10, 10, 1.0, M1);
+    createGridMatrix(10, 10, 10, 1.1, M2);
+    FullVector<double> b1, x;
+    b1.resize(M1.rowSize());
+    for (int i = 0; i < b1.size(); ++i)
+    {
+        b1[i] = std::sin(double(i));
+    }
+
+    // the first factorization is done immediately
+    factorizeAndSolve(solver.get(), M1, x, b1);
+    EXPECT_EQ(solver->d_pcgIterations.getValue(), 0u);
+    EXPECT_LT(residual(M1, x, b1), 1e-10);
+
+    // a close matrix is solved with the previous factors as preconditioner while it is factorized, in place
+    solver->invert(M2);
+    x = b1;
+    solver->solve(M2, x, x);
+    EXPECT_LT(residual(M2, x, b1), 1e-8);
+    EXPECT_LE(solver->d_pcgIterations.getValue(), 10u);
+
+    // then with its own factors
+    solver->waitForFactorization();
+    solver->solve(M2, x, b1);
+    EXPECT_EQ(solver->d_pcgIterations.getValue(), 0u);
+    EXPECT_LT(residual(M2, x, b1), 1e-10);
+
+    // another structure: the factorization is done immediately
+    factorizeAndSolve(solver.get(), M, x, b);
+    EXPECT_EQ(solver->d_pcgIterations.getValue(), 0u);
+    EXPECT_LT(residual(M, x, b), 1e-10);
+}
+
+TEST_F(SparseLDLSolver_test, asyncFactorizationFailure)
+{
+    Solver::SPtr solver = New<Solver>();
+    solver->d_asyncFactorization.setValue(true);
+
+    // the same size, with an empty column: a zero pivot
+    CompressedRowSparseMatrix<double> singular;
+    singular.resize(M.rowSize(), M.colSize());
+    for (int i = 0; i < M.rowSize(); ++i)
+    {
+        if (i != 5) singular.add(i, i, 1.0);
+    }
+    singular.compress();
+
+    FullVector<double> x;
+    factorizeAndSolve(solver.get(), M, x, b);
+
+    // the background thread does not emit messages, the failure is reported by the simulation thread
+    {
+        EXPECT_MSG_NOEMIT(Error);
+        solver->invert(singular);
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+    {
+        EXPECT_MSG_EMIT(Error);
+        solver->waitForFactorization();
+    }
+}
+
+// rows of a constraint jacobian: a few dofs each, and empty rows for the constraints of other objects
+static void createJacobian(int nbRows, int nbCols, SparseMatrix<double>& J)
+{
+    J.resize(nbRows, nbCols);
+    for (int i = 0; i < nbRows; ++i)
+    {
+        if (i % 7 == 3) continue;
+        const int node = (i * 7919) % (nbCols / 3);
+        for (int c = 0; c < 3; ++c)
+        {
+            J.add(i, 3 * node + c, std::cos(double(i + c)));
+        }
+        J.add(i, (i * 104729) % nbCols, 0.5);
+    }
+}
+
+TEST_F(SparseLDLSolver_test, addJMInvJt)
+{
+    Solver::SPtr solver = New<Solver>();
+    solver->invert(M);
+
+    SparseMatrix<double> J;
+    createJacobian(45, M.colSize(), J);
+
+    FullMatrix<double> W;
+    W.resize(J.rowSize(), J.rowSize());
+    EXPECT_TRUE(solver->addJMInvJtLocal(&M, &W, &J, 0.5));
+
+    // the same with one solve per row
+    FullVector<double> x, rhs;
+    rhs.resize(M.rowSize());
+    for (int i = 0; i < J.rowSize(); ++i)
+    {
+        for (int k = 0; k < rhs.size(); ++k) rhs[k] = J.element(i, k);
+        factorizeAndSolve(solver.get(), M, x, rhs);
+        for (int j = 0; j < J.rowSize(); ++j)
+        {
+            double expected = 0;
+            for (const auto& it : J[j]) expected += it.second * x[it.first];
+            EXPECT_NEAR(W.element(i, j), 0.5 * expected, 1e-10);
+        }
+    }
+
+    // in parallel, into another kind of matrix
+    simulation::TaskScheduler* scheduler = simulation::TaskScheduler::create(simulation::DefaultTaskScheduler::name());
+    scheduler->init(4);
+    solver->d_parallelInverseProduct.setValue(true);
+
+    SparseMatrix<double> W2;
+    W2.resize(J.rowSize(), J.rowSize());
+    EXPECT_TRUE(solver->addJMInvJtLocal(&M, &W2, &J, 0.5));
+    for (int i = 0; i < J.rowSize(); ++i)
+    {
+        for (int j = 0; j < J.rowSize(); ++j)
+        {
+            EXPECT_EQ(W2.element(i, j), W.element(i, j));
+        }
+    }
+
+    scheduler->stop();
+}
+
+TEST_F(SparseLDLSolver_test, asyncCompliance)
+{
+    Solver::SPtr solver = New<Solver>();
+    solver->d_asyncFactorization.setValue(true);
+    Solver::SPtr reference = New<Solver>();
+
+    CompressedRowSparseMatrix<double> M2;
+    createGridMatrix(6, 5, 4, 1.1, M2);
+    SparseMatrix<double> J;
+    createJacobian(45, M.colSize(), J);
+
+    // the compliance of a matrix being factorized in the background uses its own factors
+    solver->invert(M);
+    solver->invert(M2);
+    FullMatrix<double> W;
+    W.resize(J.rowSize(), J.rowSize());
+    EXPECT_TRUE(solver->addJMInvJtLocal(&M2, &W, &J, 1.0));
+
+    reference->invert(M2);
+    FullMatrix<double> Wreference;
+    Wreference.resize(J.rowSize(), J.rowSize());
+    EXPECT_TRUE(reference->addJMInvJtLocal(&M2, &Wreference, &J, 1.0));
+    for (int i = 0; i < J.rowSize(); ++i)
+    {
+        for (int j = 0; j < J.rowSize(); ++j)
+        {
+            EXPECT_NEAR(W.element(i, j), Wreference.element(i, j), 1e-12);
+        }
+    }
+
+    // and the next solves too
+    FullVector<double> x;
+    x.resize(b.size());
+    solver->solve(M2, x, b);
+    EXPECT_EQ(solver->d_pcgIterations.getValue(), 0u);
+}
+
+} // namespace sofa
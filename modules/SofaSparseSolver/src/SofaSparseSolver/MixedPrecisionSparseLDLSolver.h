@@ -0,0 +1,92 @@
+/******************************************************************************
+*                 SOFA, Simulation Open-Framework Architecture                *
+*                    (c) 2006 INRIA, USTL, UJF, CNRS, MGH                     *
+*                                                                             *
+* This program is free software; you can redistribute it and/or modify it     *
+* under the terms of the GNU Lesser General Public License as published by    *
+* the Free Software Foundation; either version 2.1 of the License, or (at     *
+* your option) any later version.                                             *
+*                                                                             *
+* This program is distributed in the hope that it will be useful, but WITHOUT *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License *
+* for more details.                                                           *
+*                                                                             *
+* You should have received a copy of the GNU Lesser General Public License    *
+* along with this program. If not, see <http://www.gnu.org/licenses/>.        *
+*******************************************************************************
+* Authors: The SOFA Team and external contributors (see Authors.txt)          *
+*                                                                             *
+* Contact information: contact@sofa-framework.org                             *
+******************************************************************************/
+#ifndef SOFA_COMPONENT_LINEARSOLVER_MIXEDPRECISIONSPARSELDLSOLVER_H
+#define SOFA_COMPONENT_LINEARSOLVER_MIXEDPRECISIONSPARSELDLSOLVER_H
+#include <SofaSparseSolver/config.h>
+
+#include <SofaSparseSolver/SparseLDLSolver.h>
+#include <SofaBaseLinearSolver/MatrixLinearSolver.h>
+#include <SofaBaseLinearSolver/CompressedRowSparseMatrix.h>
+#include <SofaBaseLinearSolver/FullVector.h>
+
+namespace sofa
+{
+
+namespace component
+{
+
+namespace linearsolver
+{
+
+/// Direct linear solver factorizing the system in single precision with SparseLDLSolver.
+/// The solution is refined in double precision, with the residual of the double precision system,
+/// until the requested tolerance: it halves the memory traffic of the factorization and of the solves.
+template<class TMatrix, class TVector>
+class MixedPrecisionSparseLDLSolver : public sofa::component::linearsolver::MatrixLinearSolver<TMatrix,TVector>
+{
+public :
+    SOFA_CLASS(SOFA_TEMPLATE2(MixedPrecisionSparseLDLSolver,TMatrix,TVector),SOFA_TEMPLATE2(sofa::component::linearsolver::MatrixLinearSolver,TMatrix,TVector));
+
+    typedef TMatrix Matrix;
+    typedef TVector Vector;
+    typedef typename Matrix::Real Real;
+    typedef sofa::component::linearsolver::MatrixLinearSolver<TMatrix,TVector> Inherit;
+
+    typedef CompressedRowSparseMatrix<float> FloatMatrix;
+    typedef FullVector<float> FloatVector;
+    typedef SparseLDLSolver<FloatMatrix,FloatVector> FloatSolver;
+
+    Data<SReal> d_tolerance; ///< maximum ratio of the norm of the residual over the norm of the right-hand side
+    Data<unsigned> d_maxIterations; ///< maximum number of refinement iterations
+    Data<bool> d_supernodal; ///< numeric factorization on dense blocks of the columns with the same structure
+    Data<bool> d_parallelFactorization; ///< factorize the independent subtrees of the elimination tree in parallel
+    Data<unsigned> d_refinementIterations; ///< output: number of refinement iterations of the last solve
+    Data<SReal> d_residual; ///< output: ratio of the norm of the residual over the norm of the right-hand side after the last solve
+
+    void solve (Matrix& M, Vector& x, Vector& b) override;
+    void invert(Matrix& M) override;
+
+protected :
+    MixedPrecisionSparseLDLSolver();
+
+    /// x += (L D L^T)^-1 r, with the factorization in single precision
+    void addCorrection(Vector& x, const Vector& r);
+
+    typename FloatSolver::SPtr floatSolver;
+    FloatMatrix Mfloat;
+    FloatVector rfloat, zfloat;
+    Vector rhs, residual;
+};
+
+#if  !defined(SOFA_COMPONENT_LINEARSOLVER_MIXEDPRECISIONSPARSELDLSOLVER_CPP)
+extern template class SOFA_SOFASPARSESOLVER_API MixedPrecisionSparseLDLSolver< CompressedRowSparseMatrix< double>,FullVector<double> >;
+extern template class SOFA_SOFASPARSESOLVER_API MixedPrecisionSparseLDLSolver< CompressedRowSparseMatrix< defaulttype::Mat<3,3,double> >,FullVector<double> >;
+#endif
+
+
+} // namespace linearsolver
+
+} // namespace component
+
+} // namespace sofa
+
+#endif
@@ -0,0 +1,123 @@
+/******************************************************************************
+*                 SOFA, Simulation Open-Framework Architecture                *
+*                    (c) 2006 INRIA, USTL, UJF, CNRS, MGH                     *
+*                                                                             *
+* This program is free software; you can redistribute it and/or modify it     *
+* under the terms of the GNU Lesser General Public License as published by    *
+* the Free Software Foundation; either version 2.1 of the License, or (at     *
+* your option) any later version.                                             *
+*                                                                             *
+* This program is distributed in the hope that it will be useful, but WITHOUT *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License *
+* for more details.                                                           *
+*                                                                             *
+* You should have received a copy of the GNU Lesser General Public License    *
+* along with this program. If not, see <http://www.gnu.org/licenses/>.        *
+*******************************************************************************
+* Authors: The SOFA Team and external contributors (see Authors.txt)          *
+*                                                                             *
+* Contact information: contact@sofa-framework.org                             *
+******************************************************************************/
+#ifndef SOFA_COMPONENT_LINEARSOLVER_MIXEDPRECISIONSPARSELDLSOLVER_INL
+#define SOFA_COMPONENT_LINEARSOLVER_MIXEDPRECISIONSPARSELDLSOLVER_INL
+
+#include <SofaSparseSolver/MixedPrecisionSparseLDLSolver.h>
+#include <SofaBaseLinearSolver/CompressedRowSparseMatrix.inl>
+#include <sofa/helper/AdvancedTimer.h>
+#include <cmath>
+
+namespace sofa {
+
+namespace component {
+
+namespace linearsolver {
+
+template<class TMatrix, class TVector>
+MixedPrecisionSparseLDLSolver<TMatrix,TVector>::MixedPrecisionSparseLDLSolver()
+    : d_tolerance( initData(&d_tolerance, (SReal)1e-10, "tolerance", "Maximum ratio of the norm of the residual over the norm of the right-hand side") )
+    , d_maxIterations( initData(&d_maxIterations, (unsigned)10, "iterations", "Maximum number of refinement iterations after the first solve") )
+    , d_supernodal( initData(&d_supernodal, false, "supernodal", "Numeric factorization on dense blocks of the columns with the same structure (supernodes)") )
+    , d_parallelFactorization( initData(&d_parallelFactorization, false, "parallelFactorization", "Factorize the independent subtrees of the elimination tree in parallel with the TaskScheduler (requires supernodal)") )
+    , d_refinementIterations( initData(&d_refinementIterations, (unsigned)0, "refinementIterations", "Output: number of refinement iterations of the last solve") )
+    , d_residual( initData(&d_residual, (SReal)0, "residual", "Output: ratio of the norm of the residual over the norm of the right-hand side after the last solve") )
+    , floatSolver(sofa::core::objectmodel::New<FloatSolver>())
+{
+    d_refinementIterations.setReadOnly(true);
+    d_residual.setReadOnly(true);
+}
+
+template<class TMatrix, class TVector>
+void MixedPrecisionSparseLDLSolver<TMatrix,TVector>::invert(Matrix& M) {
+    // single precision copy of the system, without its zeros
+    Mfloat.copyNonZeros(M);
+    Mfloat.compress();
+
+    floatSolver->d_supernodal.setValue(d_supernodal.getValue());
+    floatSolver->d_parallelFactorization.setValue(d_parallelFactorization.getValue());
+    floatSolver->invert(Mfloat);
+}
+
+template<class TMatrix, class TVector>
+void MixedPrecisionSparseLDLSolver<TMatrix,TVector>::addCorrection(Vector& x, const Vector& r) {
+    const int n = r.size();
+    rfloat.resize(n);
+    zfloat.resize(n);
+    for (int i = 0; i < n; i++) rfloat[i] = (float) r[i];
+
+    floatSolver->solve(Mfloat, zfloat, rfloat);
+
+    for (int i = 0; i < n; i++) x[i] += zfloat[i];
+}
+
+/// Iterative refinement: x_0 = 0, r_k = b - M x_k in double precision, x_k+1 = x_k + (L D L^T)^-1 r_k in single precision
+template<class TMatrix, class TVector>
+void MixedPrecisionSparseLDLSolver<TMatrix,TVector>::solve (Matrix& M, Vector& x, Vector& b) {
+    const int n = b.size();
+
+    // x and b can be the same vector
+    rhs.resize(n);
+    for (int i = 0; i < n; i++) rhs[i] = b[i];
+    const double normb = rhs.norm();
+
+    x.resize(n);
+    x.clear();
+    residual.resize(n);
+
+    unsigned nbIter = 0;
+    double error = 0;
+    if (normb != 0.0) {
+        addCorrection(x, rhs);
+
+        const unsigned maxIter = d_maxIterations.getValue();
+        const double tolerance = d_tolerance.getValue();
+        while (true) {
+            // r = b - M x
+            M.mul(residual, x);
+            for (int i = 0; i < n; i++) residual[i] = rhs[i] - residual[i];
+            error = residual.norm() / normb;
+
+            if (error <= tolerance || nbIter >= maxIter) break;
+
+            addCorrection(x, residual);
+            nbIter++;
+        }
+
+        if (error > tolerance) {
+            msg_warning() << "tolerance not reached after " << nbIter << " refinement iterations, residual = " << error << msgendl
+                          << "the system may be too ill-conditioned for a single precision factorization";
+        }
+    }
+
+    d_refinementIterations.setValue(nbIter);
+    d_residual.setValue(error);
+    sofa::helper::AdvancedTimer::valSet("MixedPrecisionSparseLDL refinement iterations", nbIter);
+}
+
+} // namespace linearsolver
+
+} // namespace component
+
+} // namespace sofa
+
+#endif
@@ -33,6 +33,8 @@
 #include <SofaSparseSolver/SparseLDLSolverImpl.h>
 #include <sofa/defaulttype/BaseMatrix.h>
 #include <sofa/core/objectmodel/DataFileName.h>
+#include <future>
+#include <memory>
 
 namespace sofa
 {
@@ -63,9 +65,17 @@ public :
     bool addJMInvJtLocal(TMatrix * M, ResMatrixType * result,const JMatrixType * J, double fact) override;
     int numStep;
 
+    /// Wait for the background factorization, if any, and use its factors from now on
+    void waitForFactorization();
+
     Data<bool> f_saveMatrixToFile;      ///< save matrix to a text file (can be very slow, as full matrix is stored)
     sofa::core::objectmodel::DataFileName d_filename;   ///< file where this matrix will be saved
     Data<int> d_precision;      ///< number of digits used to save system's matrix, default is 6
+    Data<bool> d_parallelInverseProduct; ///< compute the blocks of constraint rows of J A^-1 J^T in parallel
+    Data<bool> d_asyncFactorization; ///< factorize in a background thread, the previous factors precondition a conjugate gradient meanwhile (the compliance waits for the factors)
+    Data<unsigned> d_pcgMaxIterations; ///< maximum number of iterations of the preconditioned conjugate gradient
+    Data<double> d_pcgTolerance; ///< relative residual reached by the preconditioned conjugate gradient
+    Data<unsigned> d_pcgIterations; ///< output: iterations of the preconditioned conjugate gradient in the last solve, 0 for a direct solve
 
     MatrixInvertData * createInvertData() override {
         return new InvertData();
@@ -73,14 +83,46 @@ public :
 
 protected :
     SparseLDLSolver();
+    ~SparseLDLSolver() override;
+
+    /// Factorization of M into data in the calling thread
+    bool factorizeNow(Matrix& M, InvertData * data);
+
+    /// Swap the factors with the ones of the background factorization if it is done, or once it is done when wait is true
+    void collectFactorization(InvertData * data, bool wait);
+
+    /// Conjugate gradient on M, preconditioned by the factors of a previous matrix
+    void solveLagged(Matrix& M, Vector& x, Vector& r, InvertData * data);
 
-    FullMatrix<Real> Jminv,Jdense;
+    /// block of rows of J, and their forward solves L^-1 P J^T restricted to the reach of the rows in the elimination tree
+    struct JBlock
+    {
+        enum { Size = 16 };
+        helper::vector<int> rows; ///< rows of J
+        helper::vector<int> reach; ///< sorted rows of L where the solves are not zero
+        helper::vector<Real> values; ///< Size values per row of the reach
+    };
+
+    void solveJBlock(JBlock& block, const JMatrixType * J, InvertData * data);
+
+    helper::vector<JBlock> Jblocks;
+    FullMatrix<Real> JMinvJt; ///< between the non empty rows of J
     sofa::component::linearsolver::CompressedRowSparseMatrix<Real> Mfiltered;
+
+    // asynchronous factorization
+    int factorizedStep; ///< numStep of the matrix of the current factors, -1 without factors
+    int backgroundStep; ///< numStep of the matrix being factorized in the background
+    sofa::component::linearsolver::CompressedRowSparseMatrix<Real> Mbackground;
+    std::unique_ptr<InvertData> backgroundData;
+    simulation::ArenaAllocator backgroundArena;
+    std::future<bool> backgroundFactorization; ///< false on a zero pivot, reported when the factors are collected
+    Vector pcg_r, pcg_z, pcg_p, pcg_q;
 };
 
 #if  !defined(SOFA_COMPONENT_LINEARSOLVER_SPARSELDLSOLVER_CPP)
 extern template class SOFA_SOFASPARSESOLVER_API SparseLDLSolver< CompressedRowSparseMatrix< double>,FullVector<double> >;
 extern template class SOFA_SOFASPARSESOLVER_API SparseLDLSolver< CompressedRowSparseMatrix< defaulttype::Mat<3,3,double> >,FullVector<double> >;
+extern template class SOFA_SOFASPARSESOLVER_API SparseLDLSolver< CompressedRowSparseMatrix<float>,FullVector<float> >;
 
 #endif
 
@@ -34,6 +34,9 @@
 #include <fstream>
 #include <iomanip>      // std::setprecision
 #include <string>
+#include <functional>
+#include <chrono>
+#include <sofa/helper/AdvancedTimer.h>
 
 namespace sofa {
 
@@ -47,11 +50,33 @@ SparseLDLSolver<TMatrix,TVector,TThreadManager>::SparseLDLSolver()
     , f_saveMatrixToFile( initData(&f_saveMatrixToFile, false, "savingMatrixToFile", "save matrix to a text file (can be very slow, as full matrix is stored"))
     , d_filename( initData(&d_filename, std::string("MatrixInLDL_%04d.txt"),"savingFilename", "Name of file where system matrix (mass, stiffness and damping) will be stored."))
     , d_precision( initData(&d_precision, 6, "savingPrecision", "Number of digits used to store system's matrix. Default is 6."))
-{}
+    , d_parallelInverseProduct( initData(&d_parallelInverseProduct, false, "parallelInverseProduct", "Compute the blocks of constraint rows of J A^-1 J^T in parallel with the TaskScheduler"))
+    , d_asyncFactorization( initData(&d_asyncFactorization, false, "asyncFactorization", "Factorize the new matrices in a background thread. Until it is done, the systems are solved by a conjugate gradient preconditioned with the previous factorization. The compliance of the constraints waits for the factorization of the current matrix"))
+    , d_pcgMaxIterations( initData(&d_pcgMaxIterations, (unsigned)25, "pcgMaxIterations", "Maximum number of iterations of the conjugate gradient preconditioned with a previous factorization"))
+    , d_pcgTolerance( initData(&d_pcgTolerance, 1e-10, "pcgTolerance", "Relative residual reached by the conjugate gradient preconditioned with a previous factorization"))
+    , d_pcgIterations( initData(&d_pcgIterations, (unsigned)0, "pcgIterations", "Output: iterations of the preconditioned conjugate gradient in the last solve, 0 when the factors of the matrix were used directly"))
+    , factorizedStep(-1)
+    , backgroundStep(-1)
+{
+    d_pcgIterations.setReadOnly(true);
+}
+
+template<class TMatrix, class TVector, class TThreadManager>
+SparseLDLSolver<TMatrix,TVector,TThreadManager>::~SparseLDLSolver() {
+    if (backgroundFactorization.valid()) backgroundFactorization.wait();
+}
 
 template<class TMatrix, class TVector, class TThreadManager>
 void SparseLDLSolver<TMatrix,TVector,TThreadManager>::solve (Matrix& M, Vector& z, Vector& r) {
-    Inherit::solve_cpu(&z[0],&r[0],(InvertData *) this->getMatrixInvertData(&M));
+    InvertData * data = (InvertData *) this->getMatrixInvertData(&M);
+    if (d_asyncFactorization.getValue()) collectFactorization(data, false);
+
+    if (factorizedStep < 0 || factorizedStep == numStep - 1) {
+        Inherit::solve_cpu(&z[0],&r[0],data);
+        d_pcgIterations.setValue(0);
+    } else {
+        solveLagged(M, z, r, data);
+    }
 }
 
 template<class TMatrix, class TVector, class TThreadManager>
@@ -71,6 +96,40 @@ void SparseLDLSolver<TMatrix,TVector,TThreadManager>::invert(Matrix& M) {
         f.close();
     }
 
+    InvertData * data = (InvertData *) this->getMatrixInvertData(&M);
+    const int n = M.colSize();
+
+    // the current factors are kept to precondition the solves, until the background factorization of a newer matrix is done
+    if (d_asyncFactorization.getValue() && factorizedStep >= 0 && data->n == n) {
+        collectFactorization(data, false);
+        if (!backgroundFactorization.valid()) {
+            Mbackground.copyNonZeros(M);
+            Mbackground.compress();
+            if (!backgroundData) backgroundData.reset(new InvertData());
+            this->setFactorizationParameters(backgroundData.get());
+            backgroundStep = numStep;
+            backgroundFactorization = std::async(std::launch::async, [this, n]() {
+                const bool factorized = this->factorize(n,(int *) &Mbackground.getRowBegin()[0],(int *) &Mbackground.getColsIndex()[0],(Real *) &Mbackground.getColsValue()[0],
+                                backgroundData.get(),&backgroundArena);
+                backgroundArena.reset();
+                return factorized;
+            });
+        }
+        numStep++;
+        return;
+    }
+
+    // a single factorization at a time: they share the scratch vectors
+    if (backgroundFactorization.valid()) backgroundFactorization.get();
+
+    if (!factorizeNow(M, data)) return;
+
+    factorizedStep = numStep;
+    numStep++;
+}
+
+template<class TMatrix, class TVector, class TThreadManager>
+bool SparseLDLSolver<TMatrix,TVector,TThreadManager>::factorizeNow(Matrix& M, InvertData * data) {
     Mfiltered.copyNonZeros(M);
     Mfiltered.compress();
 
@@ -83,69 +142,210 @@ void SparseLDLSolver<TMatrix,TVector,TThreadManager>::invert(Matrix& M) {
     if(M_colptr==nullptr || M_rowind==nullptr || M_values==nullptr || Mfiltered.getRowBegin().size() < (size_t)n )
     {
         msg_warning() << "Invalid Linear System to solve. Please insure that there is enough constraints (not rank deficient)." ;
-        return ;
+        return false;
     }
 
-    Inherit::factorize(n,M_colptr,M_rowind,M_values,(InvertData *) this->getMatrixInvertData(&M));
+    this->setFactorizationParameters(data);
+    Inherit::factorize(n,M_colptr,M_rowind,M_values,data);
+    return true;
+}
 
-    numStep++;
+template<class TMatrix, class TVector, class TThreadManager>
+void SparseLDLSolver<TMatrix,TVector,TThreadManager>::collectFactorization(InvertData * data, bool wait) {
+    if (!backgroundFactorization.valid()) return;
+    if (!wait && backgroundFactorization.wait_for(std::chrono::seconds(0)) != std::future_status::ready) return;
+
+    // the background factorization does not emit messages, they are not thread safe
+    const bool factorized = backgroundFactorization.get();
+    if (backgroundData->new_factorization_needed) msg_info() << "Recomputing new factorization" ;
+    if (!factorized) msg_error() << "Failed to factorize, D(k,k) is zero" ;
+    std::swap(*data, *backgroundData);
+    factorizedStep = backgroundStep;
 }
 
-/// Default implementation of Multiply the inverse of the system matrix by the transpose of the given matrix, and multiply the result with the given matrix J
 template<class TMatrix, class TVector, class TThreadManager>
-bool SparseLDLSolver<TMatrix,TVector,TThreadManager>::addJMInvJtLocal(TMatrix * M, ResMatrixType * result,const JMatrixType * J, double fact) {
-    if (J->rowSize()==0) return true;
+void SparseLDLSolver<TMatrix,TVector,TThreadManager>::waitForFactorization() {
+    collectFactorization((InvertData *) this->getMatrixInvertData(nullptr), true);
+}
 
-    InvertData * data = (InvertData *) this->getMatrixInvertData(M);
+/// Conjugate gradient on M, with the factors of a previous matrix as preconditioner:
+/// a few iterations are enough while M is close to this matrix.
+template<class TMatrix, class TVector, class TThreadManager>
+void SparseLDLSolver<TMatrix,TVector,TThreadManager>::solveLagged(Matrix& M, Vector& x, Vector& b, InvertData * data) {
+    const int n = b.size();
 
-    Jdense.clear();
-    Jdense.resize(J->rowSize(),data->n);
-    Jminv.resize(J->rowSize(),data->n);
+    // x and b can be the same vector
+    pcg_r.resize(n);
+    for (int i = 0; i < n; i++) pcg_r[i] = b[i];
+    const double normb = pcg_r.norm();
 
-    for (typename SparseMatrix<Real>::LineConstIterator jit = J->begin() , jitend = J->end(); jit != jitend; ++jit) {
-        int l = jit->first;
-        Real * line = Jdense[l];
-        for (typename SparseMatrix<Real>::LElementConstIterator it = jit->second.begin(), i2end = jit->second.end(); it != i2end; ++it) {
-            int col = data->invperm[it->first];
-            double val = it->second;
+    pcg_z.resize(n);
+    pcg_p.resize(n);
+    pcg_q.resize(n);
+    x.resize(n);
+    x.clear();
+
+    unsigned nbIter = 0;
+    double error = 0;
+    if (normb != 0.0) {
+        Inherit::solve_cpu(&pcg_z[0],&pcg_r[0],data);
+        pcg_p.eq(pcg_z, Real(1));
+        double rho = pcg_r.dot(pcg_z);
+
+        const unsigned maxIter = d_pcgMaxIterations.getValue();
+        const double tolerance = d_pcgTolerance.getValue();
+        while (nbIter < maxIter) {
+            nbIter++;
+
+            // x += alpha p, r -= alpha M p
+            M.mul(pcg_q, pcg_p);
+            const double alpha = rho / pcg_p.dot(pcg_q);
+            x.peq(pcg_p, Real(alpha));
+            pcg_r.peq(pcg_q, Real(-alpha));
+
+            error = pcg_r.norm() / normb;
+            if (error <= tolerance) break;
 
-            line[col] = val;
+            // p = z + beta p
+            Inherit::solve_cpu(&pcg_z[0],&pcg_r[0],data);
+            const double rhoNext = pcg_r.dot(pcg_z);
+            pcg_p.eq(pcg_z, pcg_p, Real(rhoNext / rho));
+            rho = rhoNext;
+        }
+
+        if (error > tolerance) {
+            msg_warning() << "tolerance not reached after " << nbIter << " iterations preconditioned with the factorization of a previous matrix, residual = " << error;
         }
     }
 
-    //Solve the lower triangular system
-    for (unsigned c=0;c<(unsigned)J->rowSize();c++) {
-        Real * line = Jdense[c];
+    d_pcgIterations.setValue(nbIter);
+    sofa::helper::AdvancedTimer::valSet("SparseLDL lagged PCG iterations", nbIter);
+}
+
+/// Forward solve of the rows of the block: Y = L^-1 P J^T.
+/// Y is zero outside of the ancestors, in the elimination tree, of the columns of J: only the reach is computed.
+template<class TMatrix, class TVector, class TThreadManager>
+void SparseLDLSolver<TMatrix,TVector,TThreadManager>::solveJBlock(JBlock& block, const JMatrixType * J, InvertData * data) {
+    // position of a row of L in the reach, in the arena of the thread
+    simulation::ArenaScope arenaScope;
+    int * position = (int *) simulation::getThreadArena().allocate(data->n * sizeof(int), alignof(int));
+    std::fill(position, position + data->n, -1);
 
-        for (int j=0; j<data->n; j++) {
-            for (int p = data->LT_colptr[j] ; p<data->LT_colptr[j+1] ; p++) {
-                int col = data->LT_rowind[p];
-                double val = data->LT_values[p];
-                line[j] -= val * line[col];
+    block.reach.clear();
+    for (int row : block.rows) {
+        for (const auto& it : (*J)[row]) {
+            for (int k = data->invperm[it.first]; k != -1 && position[k] == -1; k = data->Parent[k]) {
+                position[k] = 0;
+                block.reach.push_back(k);
             }
         }
     }
+    std::sort(block.reach.begin(), block.reach.end());
+    for (std::size_t i = 0; i < block.reach.size(); i++) position[block.reach[i]] = i;
+
+    block.values.clear();
+    block.values.resize(block.reach.size() * JBlock::Size, 0.0);
+    Real * Y = block.values.data();
+    for (std::size_t c = 0; c < block.rows.size(); c++) {
+        for (const auto& it : (*J)[block.rows[c]]) {
+            Y[position[data->invperm[it.first]] * JBlock::Size + c] = it.second;
+        }
+    }
 
-    //apply diagonal
-    for (unsigned j=0; j<(unsigned)J->rowSize(); j++) {
-        Real * lineD = Jdense[j];
-        Real * lineM = Jminv[j];
-        for (unsigned i=0;i<(unsigned)J->colSize();i++) {
-            lineM[i] = lineD[i] * data->invD[i];
+    // column oriented: the rows of L below the diagonal are ancestors, already in the reach
+    for (std::size_t i = 0; i < block.reach.size(); i++) {
+        const int k = block.reach[i];
+        const Real * yk = Y + i * JBlock::Size;
+        for (int p = data->L_colptr[k]; p < data->L_colptr[k+1]; p++) {
+            Real * y = Y + position[data->L_rowind[p]] * JBlock::Size;
+            const Real l = data->L_values[p];
+            for (int c = 0; c < JBlock::Size; c++) y[c] -= l * yk[c];
         }
     }
+}
+
+/// J A^-1 J^T = Y^T D^-1 Y with Y = L^-1 P J^T.
+/// The rows of J are solved by blocks, and the products between the blocks only use the rows of L in both reaches.
+template<class TMatrix, class TVector, class TThreadManager>
+bool SparseLDLSolver<TMatrix,TVector,TThreadManager>::addJMInvJtLocal(TMatrix * M, ResMatrixType * result,const JMatrixType * J, double fact) {
+    if (J->rowSize()==0) return true;
+
+    InvertData * data = (InvertData *) this->getMatrixInvertData(M);
+
+    // the compliance is built from the factors without the correction of solveLagged:
+    // it waits for the factors of the current matrix, or computes them
+    if (d_asyncFactorization.getValue() && factorizedStep >= 0 && factorizedStep != numStep - 1) {
+        collectFactorization(data, true);
+        if (factorizedStep != numStep - 1 && factorizeNow(*M, data)) factorizedStep = numStep - 1;
+    }
+
+    // only the non empty rows of J
+    helper::vector<int> rows;
+    for (typename SparseMatrix<Real>::LineConstIterator jit = J->begin() , jitend = J->end(); jit != jitend; ++jit) {
+        if (!jit->second.empty()) rows.push_back(jit->first);
+    }
+    const int nbRows = rows.size();
+    const int nbBlocks = (nbRows + JBlock::Size - 1) / JBlock::Size;
+    if (nbRows == 0) return true;
+
+    Jblocks.resize(nbBlocks);
+    for (int b = 0; b < nbBlocks; b++) {
+        Jblocks[b].rows.assign(rows.begin() + b * JBlock::Size, rows.begin() + std::min(nbRows, (b+1) * JBlock::Size));
+    }
+    JMinvJt.resize(nbRows, nbRows);
+
+    simulation::TaskScheduler* scheduler = d_parallelInverseProduct.getValue() ? simulation::TaskScheduler::getInstance() : nullptr;
+    auto forEach = [scheduler](int size, const std::function<void(int)>& function) {
+        if (scheduler) simulation::parallelForEach(*scheduler, simulation::Range<int>(0, size), 1, function);
+        else for (int i = 0; i < size; i++) function(i);
+    };
 
-    for (unsigned j=0; j<(unsigned)J->rowSize(); j++) {
-        Real * lineJ = Jminv[j];
-        for (unsigned i=j;i<(unsigned)J->rowSize();i++) {
-            Real * lineI = Jdense[i];
+    forEach(nbBlocks, [&](int b) {
+        solveJBlock(Jblocks[b], J, data);
+    });
 
-            double acc = 0.0;
-            for (unsigned k=0;k<(unsigned)J->colSize();k++) {
-                acc += lineJ[k] * lineI[k];
+    // upper blocks of Y^T D^-1 Y, by merging the reaches
+    forEach(nbBlocks * (nbBlocks + 1) / 2, [&](int pair) {
+        int b1 = 0;
+        while (pair >= nbBlocks - b1) pair -= nbBlocks - b1++;
+        const int b2 = b1 + pair;
+        const JBlock& block1 = Jblocks[b1];
+        const JBlock& block2 = Jblocks[b2];
+
+        Real acc[JBlock::Size][JBlock::Size] = {};
+        for (std::size_t i1 = 0, i2 = 0; i1 < block1.reach.size() && i2 < block2.reach.size();) {
+            if (block1.reach[i1] < block2.reach[i2]) i1++;
+            else if (block1.reach[i1] > block2.reach[i2]) i2++;
+            else {
+                const Real invD = data->invD[block1.reach[i1]];
+                const Real * y1 = block1.values.data() + i1 * JBlock::Size;
+                const Real * y2 = block2.values.data() + i2 * JBlock::Size;
+                for (int r = 0; r < JBlock::Size; r++) {
+                    const Real y1D = y1[r] * invD;
+                    for (int c = 0; c < JBlock::Size; c++) acc[r][c] += y1D * y2[c];
+                }
+                i1++;
+                i2++;
+            }
+        }
+
+        for (std::size_t r = 0; r < block1.rows.size(); r++) {
+            for (std::size_t c = 0; c < block2.rows.size(); c++) {
+                JMinvJt[b1 * JBlock::Size + r][b2 * JBlock::Size + c] = acc[r][c];
+                JMinvJt[b2 * JBlock::Size + c][b1 * JBlock::Size + r] = acc[r][c];
             }
-            result->add(j,i,acc*fact);
-            if(i!=j) result->add(i,j,acc*fact);
+        }
+    });
+
+    // the constraint solvers use a full W matrix: its rows are written directly
+    if (FullMatrix<Real> * W = dynamic_cast<FullMatrix<Real> *>(result)) {
+        for (int i = 0; i < nbRows; i++) {
+            Real * line = (*W)[rows[i]];
+            for (int j = 0; j < nbRows; j++) line[rows[j]] += JMinvJt[i][j] * fact;
+        }
+    } else {
+        for (int i = 0; i < nbRows; i++) {
+            for (int j = 0; j < nbRows; j++) result->add(rows[i], rows[j], JMinvJt[i][j] * fact);
         }
     }
 
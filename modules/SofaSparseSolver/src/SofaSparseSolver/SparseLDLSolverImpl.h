@@ -25,6 +25,12 @@
 
 #include <sofa/core/behavior/LinearSolver.h>
 #include <SofaBaseLinearSolver/MatrixLinearSolver.h>
+#include <sofa/simulation/ArenaAllocator.h>
+#include <sofa/simulation/ParallelForEach.h>
+
+#include <Eigen/Dense>
+#include <algorithm>
+#include <atomic>
 
 extern "C" {
 #include <metis.h>
@@ -49,6 +55,18 @@ public :
     VecReal P_values,L_values,LT_values,invD;
     helper::vector<int> Parent;
     bool new_factorization_needed;
+
+    // parameters of the factorization, copied from the Data of the solver as it may run in another thread
+    bool supernodal = false;
+    bool parallelFactorization = false;
+
+    // supernodes: sets of consecutive columns of L with the same structure, stored as dense column-major blocks
+    helper::vector<int> SN_firstcol; ///< first column of each supernode, and n
+    helper::vector<int> SN_rowptr,SN_rowind; ///< rows of each supernode, starting with its own columns
+    helper::vector<int> SN_valptr; ///< position of the dense block of each supernode in SN_values
+    helper::vector<int> SN_updptr,SN_upd,SN_updrow; ///< supernodes updating each supernode, and the position of the first updated row in their rows
+    helper::vector<int> SN_levelptr,SN_order; ///< supernodes sorted by level in the elimination tree, the leaves first
+    VecReal SN_values;
 };
 
 inline void CSPARSE_symbolic (int n,int * M_colptr,int * M_rowind,int * colptr,int * perm,int * invperm,int * Parent, int * Flag, int * Lnz)
@@ -82,7 +100,7 @@ inline void CSPARSE_symbolic (int n,int * M_colptr,int * M_rowind,int * colptr,i
 }
 
 template<class Real>
-inline void CSPARSE_numeric(int n,int * M_colptr,int * M_rowind,Real * M_values,int * colptr,int * rowind,Real * values,Real * D,int * perm,int * invperm,int * Parent, int * Flag, int * Lnz, int * Pattern, Real * Y)
+inline bool CSPARSE_numeric(int n,int * M_colptr,int * M_rowind,Real * M_values,int * colptr,int * rowind,Real * values,Real * D,int * perm,int * invperm,int * Parent, int * Flag, int * Lnz, int * Pattern, Real * Y)
 {
     Real yi, l_ki ;
     int i, p, kk, len, top ;
@@ -126,10 +144,30 @@ inline void CSPARSE_numeric(int n,int * M_colptr,int * M_rowind,Real * M_values,
             values[p] = l_ki ;
             Lnz[i]++ ;		    /* increment count of nonzeros in col i */
         }
-        if (D[k] == 0.0)
+        if (D[k] == 0.0) return false;
+    }
+    return true;
+}
+
+/// pattern of L computed as in CSPARSE_numeric, colptr must be computed by CSPARSE_symbolic
+inline void CSPARSE_pattern(int n,int * M_colptr,int * M_rowind,int * colptr,int * rowind,int * perm,int * invperm,int * Parent, int * Flag, int * Lnz)
+{
+    for (int k = 0 ; k < n ; k++)
+    {
+        Flag [k] = k ;		    /* mark node k as visited */
+        Lnz [k] = 0 ;		    /* count of nonzeros in column k of L */
+        int kk = perm[k];  /* kth original, or permuted, column */
+        for (int p = M_colptr[kk] ; p < M_colptr[kk+1] ; p++)
         {
-            msg_error("SparseLDLSolver") << "Failed to factorize, D(k,k) is zero" ;
-            return;
+            int i = invperm[M_rowind[p]];
+            if (i < k)
+            {
+                for ( ; Flag [i] != k ; i = Parent [i])
+                {
+                    rowind[colptr[i] + Lnz[i]++] = k ;	/* L (k,i) is nonzero */
+                    Flag [i] = k ;			/* mark i as visited */
+                }
+            }
         }
     }
 }
@@ -164,7 +202,24 @@ public:
 
 protected :
 
-    SparseLDLSolverImpl() : Inherit() {}
+    SparseLDLSolverImpl()
+        : Inherit()
+        , d_supernodal(initData(&d_supernodal, false, "supernodal", "Numeric factorization on dense blocks of the columns with the same structure (supernodes)"))
+        , d_parallelFactorization(initData(&d_parallelFactorization, false, "parallelFactorization", "Factorize the independent subtrees of the elimination tree in parallel with the TaskScheduler (requires supernodal)"))
+    {}
+
+public:
+    Data<bool> d_supernodal; ///< numeric factorization on dense blocks of the columns with the same structure
+    Data<bool> d_parallelFactorization; ///< factorize the independent subtrees of the elimination tree in parallel
+
+protected :
+
+    /// Copy the parameters of the factorization in data, factorize never reads the Data of the solver
+    template<class VecInt,class VecReal>
+    void setFactorizationParameters(SparseLDLImplInvertData<VecInt,VecReal> * data) const {
+        data->supernodal = d_supernodal.getValue();
+        data->parallelFactorization = d_parallelFactorization.getValue();
+    }
 
     template<class VecInt,class VecReal>
     void solve_cpu(Real * x,const Real * b,SparseLDLImplInvertData<VecInt,VecReal> * data) {
@@ -272,14 +327,209 @@ protected :
         CSPARSE_symbolic(n,M_colptr,M_rowind,colptr,perm,invperm,Parent,Flag.data(),Lnz.data());
     }
 
-    void LDL_numeric(int n,int * M_colptr,int * M_rowind,Real * M_values,int * colptr,int * rowind,Real * values,Real * D,int * perm,int * invperm,int * Parent) {
+    bool LDL_numeric(int n,int * M_colptr,int * M_rowind,Real * M_values,int * colptr,int * rowind,Real * values,Real * D,int * perm,int * invperm,int * Parent) {
         Y.resize(n);
 
-        CSPARSE_numeric<Real>(n,M_colptr,M_rowind,M_values,colptr,rowind,values,D,perm,invperm,Parent,Flag.data(),Lnz.data(),Pattern.data(),Y.data());
+        return CSPARSE_numeric<Real>(n,M_colptr,M_rowind,M_values,colptr,rowind,values,D,perm,invperm,Parent,Flag.data(),Lnz.data(),Pattern.data(),Y.data());
     }
 
+    /// Find the supernodes and the supernodes updating each of them, from the structure of L
     template<class VecInt,class VecReal>
-    void factorize(int n,int * M_colptr, int * M_rowind, Real * M_values, SparseLDLImplInvertData<VecInt,VecReal> * data) {
+    void LDL_supernodal_symbolic(int n,int * M_colptr,int * M_rowind,SparseLDLImplInvertData<VecInt,VecReal> * data) {
+        const int * Parent = data->Parent.data();
+        const int * colptr = data->L_colptr.data();
+        int * rowind = data->L_rowind.data();
+
+        CSPARSE_pattern(n,M_colptr,M_rowind,data->L_colptr.data(),rowind,data->perm.data(),data->invperm.data(),data->Parent.data(),Flag.data(),Lnz.data());
+
+        // the column j is merged with the column j-1 if it is its parent and if they have the same structure below j
+        colSupernode.resize(n);
+        data->SN_firstcol.clear();
+        for (int j=0;j<n;j++) {
+            if (j==0 || Parent[j-1]!=j || colptr[j]-colptr[j-1] != colptr[j+1]-colptr[j]+1) data->SN_firstcol.push_back(j);
+            colSupernode[j] = data->SN_firstcol.size()-1;
+        }
+        data->SN_firstcol.push_back(n);
+        const int nbSupernodes = data->SN_firstcol.size()-1;
+
+        // rows of a supernode: its own columns, then the rows below the diagonal of its last column
+        data->SN_rowptr.resize(nbSupernodes+1);
+        data->SN_valptr.resize(nbSupernodes+1);
+        data->SN_rowind.clear();
+        data->SN_rowptr[0] = 0;
+        data->SN_valptr[0] = 0;
+        for (int s=0;s<nbSupernodes;s++) {
+            const int first = data->SN_firstcol[s], last = data->SN_firstcol[s+1];
+            for (int j=first;j<last;j++) data->SN_rowind.push_back(j);
+            for (int p=colptr[last-1];p<colptr[last];p++) data->SN_rowind.push_back(rowind[p]);
+            data->SN_rowptr[s+1] = data->SN_rowind.size();
+            data->SN_valptr[s+1] = data->SN_valptr[s] + (data->SN_rowptr[s+1]-data->SN_rowptr[s]) * (last-first);
+        }
+        data->SN_values.clear();data->SN_values.fastResize(data->SN_valptr[nbSupernodes]);
+
+        // the supernode d updates the supernodes containing its rows below its diagonal block
+        data->SN_updptr.clear();
+        data->SN_updptr.resize(nbSupernodes+1);
+        for (int pass=0;pass<2;pass++) {
+            if (pass==1) {
+                for (int s=0;s<nbSupernodes;s++) data->SN_updptr[s+1] += data->SN_updptr[s];
+                data->SN_upd.resize(data->SN_updptr[nbSupernodes]);
+                data->SN_updrow.resize(data->SN_updptr[nbSupernodes]);
+                tran_countvec.clear();
+                tran_countvec.resize(nbSupernodes);
+            }
+            for (int d=0;d<nbSupernodes;d++) {
+                const int * rows = data->SN_rowind.data() + data->SN_rowptr[d];
+                const int m = data->SN_rowptr[d+1]-data->SN_rowptr[d];
+                for (int r=data->SN_firstcol[d+1]-data->SN_firstcol[d];r<m;) {
+                    const int s = colSupernode[rows[r]];
+                    if (pass==0) data->SN_updptr[s+1]++;
+                    else {
+                        const int u = data->SN_updptr[s] + tran_countvec[s]++;
+                        data->SN_upd[u] = d;
+                        data->SN_updrow[u] = r;
+                    }
+                    while (r<m && colSupernode[rows[r]]==s) r++;
+                }
+            }
+        }
+
+        // level of a supernode in the supernodal elimination tree: the subtrees of a level are independent
+        levels.clear();
+        levels.resize(nbSupernodes);
+        int nbLevels = 0;
+        for (int d=0;d<nbSupernodes;d++) {
+            const int parent = Parent[data->SN_firstcol[d+1]-1];
+            if (parent >= 0) levels[colSupernode[parent]] = std::max(levels[colSupernode[parent]], levels[d]+1);
+            nbLevels = std::max(nbLevels, levels[d]+1);
+        }
+        data->SN_levelptr.clear();
+        data->SN_levelptr.resize(nbLevels+1);
+        for (int s=0;s<nbSupernodes;s++) data->SN_levelptr[levels[s]+1]++;
+        for (int l=0;l<nbLevels;l++) data->SN_levelptr[l+1] += data->SN_levelptr[l];
+        data->SN_order.resize(nbSupernodes);
+        tran_countvec.clear();
+        tran_countvec.resize(nbLevels);
+        for (int s=0;s<nbSupernodes;s++) data->SN_order[data->SN_levelptr[levels[s]] + tran_countvec[levels[s]]++] = s;
+    }
+
+    /// Left-looking LDL^T factorization of the supernode s, once all its descendants are factorized.
+    /// The updates from the descendants and the factorization of the block are dense matrix products.
+    /// Returns false on a zero pivot.
+    template<class VecInt,class VecReal>
+    bool LDL_supernode(int s,int * M_colptr,int * M_rowind,Real * M_values,Real * D,SparseLDLImplInvertData<VecInt,VecReal> * data,simulation::ArenaAllocator& arena) const {
+        typedef Eigen::Matrix<Real,Eigen::Dynamic,Eigen::Dynamic> DenseMatrix;
+        typedef Eigen::Map<DenseMatrix,0,Eigen::OuterStride<> > DenseBlock;
+        enum { PanelSize = 32 };
+
+        // temporaries in the arena, released on return
+        simulation::ArenaScope arenaScope(arena);
+
+        const int first = data->SN_firstcol[s];
+        const int w = data->SN_firstcol[s+1]-first;
+        const int * rows = data->SN_rowind.data() + data->SN_rowptr[s];
+        const int m = data->SN_rowptr[s+1]-data->SN_rowptr[s];
+        Real * values = data->SN_values.data() + data->SN_valptr[s];
+        DenseBlock B(values,m,w,Eigen::OuterStride<>(m));
+
+        // lower part of the permuted columns
+        B.setZero();
+        for (int j=0;j<w;j++) {
+            const int kk = data->perm[first+j];
+            for (int p=M_colptr[kk];p<M_colptr[kk+1];p++) {
+                const int i = data->invperm[M_rowind[p]];
+                if (i < first+j) continue;
+                const int r = i < first+w ? i-first : int(std::lower_bound(rows+w,rows+m,i)-rows);
+                B(r,j) += M_values[p];
+            }
+        }
+
+        // updates from the descendants: B -= Ld D Ld^T on the rows and columns they share
+        for (int u=data->SN_updptr[s];u<data->SN_updptr[s+1];u++) {
+            const int d = data->SN_upd[u];
+            const int firstRow = data->SN_updrow[u];
+            const int dfirst = data->SN_firstcol[d];
+            const int dw = data->SN_firstcol[d+1]-dfirst;
+            const int * drows = data->SN_rowind.data() + data->SN_rowptr[d];
+            const int dm = data->SN_rowptr[d+1]-data->SN_rowptr[d];
+            const int m2 = dm-firstRow;
+            int m1 = 0;
+            while (m1 < m2 && drows[firstRow+m1] < first+w) m1++;
+
+            const DenseBlock Ld(data->SN_values.data() + data->SN_valptr[d] + firstRow,m2,dw,Eigen::OuterStride<>(dm));
+            DenseBlock W((Real*)arena.allocate(m1*dw*sizeof(Real),alignof(Real)),m1,dw,Eigen::OuterStride<>(m1));
+            DenseBlock C((Real*)arena.allocate(m2*m1*sizeof(Real),alignof(Real)),m2,m1,Eigen::OuterStride<>(m2));
+            W.noalias() = Ld.topRows(m1) * Eigen::Map<const Eigen::Matrix<Real,Eigen::Dynamic,1> >(D+dfirst,dw).asDiagonal();
+            C.noalias() = Ld * W.transpose();
+
+            // the rows of d below its first row in s are also rows of s
+            int * rel = (int*)arena.allocate(m2*sizeof(int),alignof(int));
+            for (int r=0,t=0;r<m2;r++) {
+                while (rows[t] != drows[firstRow+r]) t++;
+                rel[r] = t;
+            }
+            for (int q=0;q<m1;q++) {
+                Real * col = values + (drows[firstRow+q]-first) * m;
+                for (int r=q;r<m2;r++) col[rel[r]] -= C(r,q);
+            }
+        }
+
+        // dense LDL^T of the block, by panels of columns
+        for (int j0=0;j0<w;j0+=PanelSize) {
+            const int b = std::min<int>(PanelSize,w-j0);
+            for (int j=j0;j<j0+b;j++) {
+                const Real dj = B(j,j);
+                if (dj == 0.0) return false;
+                D[first+j] = dj;
+                auto col = B.col(j).tail(m-j-1);
+                B.block(j+1,j+1,m-j-1,j0+b-j-1).noalias() -= (col / dj) * col.head(j0+b-j-1).transpose();
+                col /= dj;
+            }
+            const int rest = w-j0-b;
+            if (rest > 0) {
+                const auto Lp = B.block(j0+b,j0,m-j0-b,b);
+                DenseBlock W((Real*)arena.allocate(rest*b*sizeof(Real),alignof(Real)),rest,b,Eigen::OuterStride<>(rest));
+                W.noalias() = Lp.topRows(rest) * Eigen::Map<const Eigen::Matrix<Real,Eigen::Dynamic,1> >(D+first+j0,b).asDiagonal();
+                B.block(j0+b,j0+b,m-j0-b,rest).noalias() -= Lp * W.transpose();
+            }
+        }
+
+        // copy the columns in L, below the diagonal
+        Real * L_values = data->L_values.data();
+        for (int j=0;j<w;j++) {
+            std::copy(values + j*m + j+1, values + (j+1)*m, L_values + data->L_colptr[first+j]);
+        }
+        return true;
+    }
+
+    /// Supernodal numeric factorization, the supernodes of a level of the elimination tree are factorized in parallel.
+    /// With a background arena, the factorization runs sequentially in a thread which is not a worker of the TaskScheduler.
+    /// Returns false on a zero pivot.
+    template<class VecInt,class VecReal>
+    bool LDL_supernodal_numeric(int * M_colptr,int * M_rowind,Real * M_values,Real * D,SparseLDLImplInvertData<VecInt,VecReal> * data,simulation::ArenaAllocator * backgroundArena) {
+        simulation::TaskScheduler* scheduler = data->parallelFactorization && !backgroundArena ? simulation::TaskScheduler::getInstance() : nullptr;
+        std::atomic<bool> zeroPivot(false);
+
+        for (std::size_t l=0;l+1<data->SN_levelptr.size();l++) {
+            const simulation::Range<int> level(data->SN_levelptr[l],data->SN_levelptr[l+1]);
+            auto factorizeSupernode = [&](int i) {
+                simulation::ArenaAllocator& arena = backgroundArena ? *backgroundArena : simulation::getThreadArena();
+                if (!LDL_supernode(data->SN_order[i],M_colptr,M_rowind,M_values,D,data,arena)) zeroPivot = true;
+            };
+            if (scheduler && level.size() > 1) simulation::parallelForEach(*scheduler,level,0,factorizeSupernode);
+            else for (int i=level.start();i<level.end();i++) factorizeSupernode(i);
+
+            if (zeroPivot) return false;
+        }
+        return true;
+    }
+
+    /// Factorization of M in data, with the parameters set by setFactorizationParameters.
+    /// The scratch vectors below are used: at most one factorization runs at a time.
+    /// backgroundArena is given when it runs in another thread than the simulation, see LDL_supernodal_numeric.
+    /// Returns false on a zero pivot, which is reported here only if the factorization runs in the simulation thread.
+    template<class VecInt,class VecReal>
+    bool factorize(int n,int * M_colptr, int * M_rowind, Real * M_values, SparseLDLImplInvertData<VecInt,VecReal> * data, simulation::ArenaAllocator * backgroundArena = nullptr) {
         data->new_factorization_needed = data->P_colptr.size() == 0 || data->P_rowind.size() == 0 || CSPARSE_need_symbolic_factorization(n, M_colptr, M_rowind, data->n,
                                                                                                                                          (int *) data->P_colptr.data(),(int *) data->P_rowind.data());
 
@@ -290,7 +540,8 @@ protected :
 
         // we test if the matrix has the same struct as previous factorized matrix
         if (data->new_factorization_needed) {
-            msg_info() << "Recomputing new factorization" ;
+            // the messages are not thread safe: the background factorization is reported when it is collected
+            if (backgroundArena == nullptr) msg_info() << "Recomputing new factorization" ;
 
             data->perm.clear();data->perm.fastResize(data->n);
             data->invperm.clear();data->invperm.fastResize(data->n);
@@ -330,8 +581,18 @@ protected :
         Real * tran_values = data->LT_values.data();
 
         //Numeric Factorization
-        LDL_numeric(data->n,M_colptr,M_rowind,M_values,colptr,rowind,values,D,
-                    data->perm.data(),data->invperm.data(),data->Parent.data());
+        bool factorized;
+        if (data->supernodal) {
+            if (data->new_factorization_needed || data->SN_firstcol.empty())
+                LDL_supernodal_symbolic(data->n,M_colptr,M_rowind,data);
+
+            factorized = LDL_supernodal_numeric(M_colptr,M_rowind,M_values,D,data,backgroundArena);
+        } else {
+            factorized = LDL_numeric(data->n,M_colptr,M_rowind,M_values,colptr,rowind,values,D,
+                        data->perm.data(),data->invperm.data(),data->Parent.data());
+        }
+
+        if (!factorized && backgroundArena == nullptr) msg_error() << "Failed to factorize, D(k,k) is zero" ;
 
         //inverse the diagonal
         for (int i=0;i<data->n;i++) D[i] = 1.0/D[i];
@@ -363,6 +624,8 @@ protected :
             tran_countvec[line]++;
           }
         }
+
+        return factorized;
     }
 
     helper::vector<Real> Tmp;
@@ -371,6 +634,7 @@ protected : //the folowing variables are used during the factorization they cann
     helper::vector<Real> Y;
     helper::vector<int> Lnz,Flag,Pattern;
     helper::vector<int> tran_countvec;
+    helper::vector<int> colSupernode,levels;
 
 //    helper::vector<int> perm, invperm; //premutation inverse
 